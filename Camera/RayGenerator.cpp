@@ -0,0 +1,166 @@
+#include "RayGenerator.h"
+#include <cassert>
+
+namespace CameraLib
+{
+
+RayGenerator::RayGenerator()
+{
+	m_Origin.setXYZW(0.0f, 0.0f, 0.0f, 1.0f);
+	m_DirectionOrigin.setXYZW(0.0f, 0.0f, -1.0f, 0.0f);
+	m_DirectionDeltaX.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+	m_DirectionDeltaY.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+	m_ViewAxis.setXYZW(0.0f, 0.0f, -1.0f, 0.0f);
+	m_ProjectionX.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+	m_ProjectionY.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+	m_ProjectionCenterX = 0.0f;
+	m_ProjectionCenterY = 0.0f;
+}
+
+RayGenerator::RayGenerator(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight)
+{
+	Initialize(camera, viewportWidth, viewportHeight);
+}
+
+void RayGenerator::Initialize(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight)
+{
+	assert(viewportWidth > 1 && viewportHeight > 1);
+
+	const float screenWidth = (float)viewportWidth;
+	const float screenHeight = (float)viewportHeight;
+
+	const float nearClipPlaneDistance = camera.GetNearClipPlaneDistance();
+	const float aspectRatio = screenWidth / screenHeight;
+	const float halfFov = camera.GetYFov() * 0.5f;
+
+	const float top = nearClipPlaneDistance * tanf(MATHLIB_DEG_TO_RAD(halfFov));
+	const float right = top * aspectRatio;
+
+	const MathLib::vector4& xAxis = camera.GetXAxis();
+	const MathLib::vector4& yAxis = camera.GetYAxis();
+	const MathLib::vector4& zAxis = camera.GetZAxis();
+
+	// In camera space pixel (x, y) maps onto the near clip plane at
+	// (right * (2x / (w - 1) - 1), top * (1 - 2y / (h - 1)), -near). Rotating this into world space
+	// gives a direction which is linear in x and y, so we only need the direction through the
+	// top left pixel and the change in direction per column and per row.
+	MathLib::vector4_scale(xAxis, -right, m_DirectionOrigin);
+	MathLib::vector4_addScaledVector(m_DirectionOrigin, yAxis, top, m_DirectionOrigin);
+	MathLib::vector4_addScaledVector(m_DirectionOrigin, zAxis, -nearClipPlaneDistance, m_DirectionOrigin);
+	MathLib::vector4_setToVector(m_DirectionOrigin);
+
+	MathLib::vector4_scale(xAxis, 2.0f * right / (screenWidth - 1.0f), m_DirectionDeltaX);
+	MathLib::vector4_setToVector(m_DirectionDeltaX);
+
+	MathLib::vector4_scale(yAxis, -2.0f * top / (screenHeight - 1.0f), m_DirectionDeltaY);
+	MathLib::vector4_setToVector(m_DirectionDeltaY);
+
+	MathLib::vector4_copy(m_Origin, camera.GetPosition());
+
+	// A point at depth d along the view axis projects onto the near clip plane at camera space
+	// (x, y) * near / d, which is then mapped back onto pixel coordinates.
+	MathLib::vector4_scale(zAxis, -1.0f, m_ViewAxis);
+	MathLib::vector4_setToVector(m_ViewAxis);
+
+	MathLib::vector4_scale(xAxis, nearClipPlaneDistance * (screenWidth - 1.0f) / (2.0f * right), m_ProjectionX);
+	MathLib::vector4_setToVector(m_ProjectionX);
+
+	MathLib::vector4_scale(yAxis, -nearClipPlaneDistance * (screenHeight - 1.0f) / (2.0f * top), m_ProjectionY);
+	MathLib::vector4_setToVector(m_ProjectionY);
+
+	m_ProjectionCenterX = (screenWidth - 1.0f) * 0.5f;
+	m_ProjectionCenterY = (screenHeight - 1.0f) * 0.5f;
+}
+
+void RayGenerator::GenerateDirection(float x, float y, MathLib::vector4& direction) const
+{
+	MathLib::vector4_addScaledVector(m_DirectionOrigin, m_DirectionDeltaX, x, direction);
+	MathLib::vector4_addScaledVector(direction, m_DirectionDeltaY, y, direction);
+	MathLib::vector4_normalize(direction);
+}
+
+void RayGenerator::GenerateRay(float x, float y, MathLib::ray& primaryRay) const
+{
+	MathLib::vector4 direction;
+	GenerateDirection(x, y, direction);
+
+	primaryRay.setPosition(m_Origin);
+	primaryRay.setDirection(direction);
+}
+
+bool RayGenerator::ProjectPoint(const MathLib::vector4& point, float& x, float& y, float& depth) const
+{
+	MathLib::vector4 offset;
+	MathLib::vector4_sub(point, m_Origin, offset);
+
+	depth = MathLib::vector4_dotProduct(offset, m_ViewAxis);
+	if (depth <= 0.0f)
+		return false;
+
+	float inverseDepth = 1.0f / depth;
+	x = MathLib::vector4_dotProduct(offset, m_ProjectionX) * inverseDepth + m_ProjectionCenterX;
+	y = MathLib::vector4_dotProduct(offset, m_ProjectionY) * inverseDepth + m_ProjectionCenterY;
+
+	return true;
+}
+
+void RayGenerator::GenerateDirections(uint32_t x, uint32_t y, uint32_t count, float* directionsX,
+	float* directionsY, float* directionsZ) const
+{
+	// Direction through the first pixel of the run, stepping by m_DirectionDeltaX per pixel.
+	MathLib::vector4 rowStart;
+	MathLib::vector4_addScaledVector(m_DirectionOrigin, m_DirectionDeltaX, (float)x, rowStart);
+	MathLib::vector4_addScaledVector(rowStart, m_DirectionDeltaY, (float)y, rowStart);
+
+	const float startX = rowStart.extractX();
+	const float startY = rowStart.extractY();
+	const float startZ = rowStart.extractZ();
+
+	const float deltaX = m_DirectionDeltaX.extractX();
+	const float deltaY = m_DirectionDeltaX.extractY();
+	const float deltaZ = m_DirectionDeltaX.extractZ();
+
+	uint32_t i = 0;
+
+#if (MATHLIB_SSE)
+	const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 three = _mm_set1_ps(3.0f);
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 step = _mm_add_ps(_mm_set1_ps((float)i), laneOffsets);
+
+		__m128 dx = _mm_add_ps(_mm_set1_ps(startX), _mm_mul_ps(step, _mm_set1_ps(deltaX)));
+		__m128 dy = _mm_add_ps(_mm_set1_ps(startY), _mm_mul_ps(step, _mm_set1_ps(deltaY)));
+		__m128 dz = _mm_add_ps(_mm_set1_ps(startZ), _mm_mul_ps(step, _mm_set1_ps(deltaZ)));
+
+		__m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+		// Approximate reciprocal square root refined by a single Newton-Raphson iteration,
+		// which is accurate to roughly 22 bits.
+		__m128 inverseLength = _mm_rsqrt_ps(lengthSquared);
+		__m128 estimateSquared = _mm_mul_ps(_mm_mul_ps(lengthSquared, inverseLength), inverseLength);
+		inverseLength = _mm_mul_ps(_mm_mul_ps(half, inverseLength), _mm_sub_ps(three, estimateSquared));
+
+		_mm_storeu_ps(directionsX + i, _mm_mul_ps(dx, inverseLength));
+		_mm_storeu_ps(directionsY + i, _mm_mul_ps(dy, inverseLength));
+		_mm_storeu_ps(directionsZ + i, _mm_mul_ps(dz, inverseLength));
+	}
+#endif // (MATHLIB_SSE)
+
+	for (; i < count; i++)
+	{
+		float dx = startX + (float)i * deltaX;
+		float dy = startY + (float)i * deltaY;
+		float dz = startZ + (float)i * deltaZ;
+
+		float inverseLength = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz);
+
+		directionsX[i] = dx * inverseLength;
+		directionsY[i] = dy * inverseLength;
+		directionsZ[i] = dz * inverseLength;
+	}
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#ifndef RAYGENERATOR_H_INCLUDED
+#define RAYGENERATOR_H_INCLUDED
+
+#include <MathLib.h>
+#include "Camera.h"
+
+namespace CameraLib
+{
+
+/// <summary>
+/// Structure of arrays holding a batch of normalized primary ray directions.
+/// Element i holds the direction of the i-th consecutive pixel along a row.
+/// </summary>
+template <unsigned int Width>
+struct RayDirectionBatch
+{
+	static const unsigned int BatchWidth = Width;
+
+	float m_X[Width];
+	float m_Y[Width];
+	float m_Z[Width];
+} CAMERA_ALIGN(16);
+
+typedef RayDirectionBatch<4> RayDirectionBatch4;
+typedef RayDirectionBatch<8> RayDirectionBatch8;
+
+/// <summary>
+/// Generates primary rays for a camera and a viewport of a given size.
+///
+/// The (unnormalized) direction of the ray passing through pixel (x, y) is an affine function
+/// of the pixel coordinate, so it is precomputed once per frame as the direction through pixel
+/// (0, 0) plus per-column and per-row deltas. Generating a direction then costs two multiply-adds
+/// per component and a normalize, rather than a pair of matrix transforms.
+/// Pixel (0, 0) is the top left of the viewport.
+/// </summary>
+class RayGenerator
+{
+	public:
+
+		RayGenerator();
+
+		RayGenerator(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight);
+
+		/// <summary>
+		/// Recalculates the ray deltas. This should be called whenever the camera or the
+		/// viewport dimensions have changed.
+		/// </summary>
+		void Initialize(const Camera& camera, uint32_t viewportWidth, uint32_t viewportHeight);
+
+		/// <summary>
+		/// Returns the world space origin shared by all primary rays.
+		/// </summary>
+		CAMERA_INLINE const MathLib::vector4& GetOrigin() const
+		{
+			return m_Origin;
+		}
+
+		/// <summary>
+		/// Returns the unnormalized world space direction of the ray passing through pixel (0, 0).
+		/// </summary>
+		CAMERA_INLINE const MathLib::vector4& GetDirectionOrigin() const
+		{
+			return m_DirectionOrigin;
+		}
+
+		/// <summary>
+		/// Returns the change in the unnormalized direction when moving one pixel along a row.
+		/// </summary>
+		CAMERA_INLINE const MathLib::vector4& GetDirectionDeltaX() const
+		{
+			return m_DirectionDeltaX;
+		}
+
+		/// <summary>
+		/// Returns the change in the unnormalized direction when moving one pixel down a column.
+		/// </summary>
+		CAMERA_INLINE const MathLib::vector4& GetDirectionDeltaY() const
+		{
+			return m_DirectionDeltaY;
+		}
+
+		/// <summary>
+		/// Calculates the normalized world space direction through the specified (possibly
+		/// fractional) pixel coordinate.
+		/// </summary>
+		void GenerateDirection(float x, float y, MathLib::vector4& direction) const;
+
+		/// <summary>
+		/// Calculates the world space primary ray through the specified (possibly fractional)
+		/// pixel coordinate.
+		/// </summary>
+		void GenerateRay(float x, float y, MathLib::ray& primaryRay) const;
+
+		/// <summary>
+		/// Projects a world space point onto the viewport; the inverse of GenerateDirection. The pixel coordinate
+		/// is fractional, and depth is the distance of the point along the camera's view axis. Returns false if
+		/// the point is not in front of the camera.
+		/// </summary>
+		bool ProjectPoint(const MathLib::vector4& point, float& x, float& y, float& depth) const;
+
+		/// <summary>
+		/// Calculates the normalized directions of count consecutive pixels starting at pixel
+		/// (x, y) and moving along the row. The output arrays must be able to hold count elements.
+		/// Directions are generated four at a time using SIMD where available.
+		/// </summary>
+		void GenerateDirections(uint32_t x, uint32_t y, uint32_t count, float* directionsX,
+			float* directionsY, float* directionsZ) const;
+
+		/// <summary>
+		/// Fills a batch with the directions of consecutive pixels starting at pixel (x, y).
+		/// </summary>
+		template <unsigned int Width>
+		CAMERA_INLINE void GenerateBatch(uint32_t x, uint32_t y, RayDirectionBatch<Width>& batch) const
+		{
+			GenerateDirections(x, y, Width, batch.m_X, batch.m_Y, batch.m_Z);
+		}
+
+	protected:
+
+		MathLib::vector4 m_Origin;
+		MathLib::vector4 m_DirectionOrigin;
+		MathLib::vector4 m_DirectionDeltaX;
+		MathLib::vector4 m_DirectionDeltaY;
+
+		/// Used to project points back onto the viewport.
+		MathLib::vector4 m_ViewAxis;
+		MathLib::vector4 m_ProjectionX;
+		MathLib::vector4 m_ProjectionY;
+		float m_ProjectionCenterX;
+		float m_ProjectionCenterY;
+
+} CAMERA_ALIGN(16);
+
+}
+
+#endif // RAYGENERATOR_H_INCLUDED
\ No newline at end of file
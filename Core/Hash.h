@@ -0,0 +1,44 @@
+/// Hash.h:
+/// This file contains hash functions for identifying blocks of data, e.g. as keys of cached results
+/// derived from them.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Core
+{
+	/// <summary>
+	/// Initial value of a 64 bit FNV-1a hash.
+	/// </summary>
+	const uint64_t FNV1aOffsetBasis = 14695981039346656037ull;
+
+	/// <summary>
+	/// Continues a 64 bit FNV-1a hash with the specified data. Hashing several blocks in turn gives the same
+	/// result as hashing them as one block.
+	/// </summary>
+	inline uint64_t HashFNV1a(const void* data, size_t size, uint64_t hash = FNV1aOffsetBasis)
+	{
+		const uint64_t FNV1aPrime = 1099511628211ull;
+
+		auto bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV1aPrime;
+		}
+
+		return hash;
+	}
+
+	/// <summary>
+	/// Continues a 64 bit FNV-1a hash with the bytes of a value.
+	/// </summary>
+	template <typename Value>
+	uint64_t HashFNV1aValue(const Value& value, uint64_t hash)
+	{
+		return HashFNV1a(&value, sizeof(Value), hash);
+	}
+
+}
\ No newline at end of file
@@ -44,4 +44,12 @@ long double HighPerformanceTimer::GetTimeMilliseconds()
 	return m_Interval * 1000.0;
 }
 
+long double HighPerformanceTimer::GetElapsedTimeMilliseconds() const
+{
+	int64_t currentCount;
+	QueryPerformanceCounter(reinterpret_cast<LARGE_INTEGER*>(&currentCount));
+
+	return (long double)(currentCount - m_StartCount) * 1000.0 / (long double)m_Frequency;
+}
+
 }
\ No newline at end of file
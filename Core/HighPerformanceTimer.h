@@ -36,6 +36,11 @@ class HighPerformanceTimer
 		/// </summary>
 		long double GetTimeMilliseconds();
 
+		/// <summary>
+		/// Returns the time in milliseconds since the timer was started, without stopping it.
+		/// </summary>
+		long double GetElapsedTimeMilliseconds() const;
+
 	protected:
 
 		int64_t m_Frequency;
@@ -0,0 +1,96 @@
+#include "MemoryArena.h"
+#include "MemoryAllocatorAligned.h"
+#include <cassert>
+#include <stdint.h>
+
+namespace Core
+{
+
+MemoryArena::MemoryArena(size_t blockSize) :
+	m_BlockSize(blockSize),
+	m_Current(nullptr),
+	m_End(nullptr),
+	m_BytesAllocated(0),
+	m_BytesReserved(0)
+{
+}
+
+MemoryArena::~MemoryArena()
+{
+	Reset();
+}
+
+void* MemoryArena::Allocate(size_t size, size_t alignment)
+{
+	assert(alignment > 0 && alignment <= MaxAlignment && 0 == (alignment & (alignment - 1)));
+
+	m_BytesAllocated += size;
+
+	// Large allocations get a block of their own, so that the rest of the current block is not wasted.
+	if (size > m_BlockSize / 4)
+		return AllocateBlock(size);
+
+	uintptr_t current = reinterpret_cast<uintptr_t>(m_Current);
+	uintptr_t aligned = (current + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	if (nullptr == m_Current || aligned + size > reinterpret_cast<uintptr_t>(m_End))
+	{
+		m_Current = reinterpret_cast<char*>(AllocateBlock(m_BlockSize));
+		m_End = m_Current + m_BlockSize;
+
+		aligned = reinterpret_cast<uintptr_t>(m_Current);
+	}
+
+	m_Current = reinterpret_cast<char*>(aligned + size);
+
+	return reinterpret_cast<void*>(aligned);
+}
+
+void MemoryArena::TakeBlocks(MemoryArena& other)
+{
+	m_Blocks.insert(m_Blocks.end(), other.m_Blocks.begin(), other.m_Blocks.end());
+	m_BytesAllocated += other.m_BytesAllocated;
+	m_BytesReserved += other.m_BytesReserved;
+
+	// The rest of the other arena's current block is given up, as this arena carries on with its own.
+	other.m_Blocks.clear();
+	other.m_Current = nullptr;
+	other.m_End = nullptr;
+	other.m_BytesAllocated = 0;
+	other.m_BytesReserved = 0;
+}
+
+void MemoryArena::Reset()
+{
+	for (auto block : m_Blocks)
+		MemoryAllocatorAligned::Deallocate(block);
+
+	m_Blocks.clear();
+	m_Current = nullptr;
+	m_End = nullptr;
+	m_BytesAllocated = 0;
+	m_BytesReserved = 0;
+}
+
+size_t MemoryArena::GetBytesAllocated() const
+{
+	return m_BytesAllocated;
+}
+
+size_t MemoryArena::GetBytesReserved() const
+{
+	return m_BytesReserved;
+}
+
+void* MemoryArena::AllocateBlock(size_t size)
+{
+	void* block = MemoryAllocatorAligned::Allocate(size);
+	assert(nullptr != block);
+
+	m_Blocks.push_back(block);
+	m_BytesReserved += size;
+
+	return block;
+}
+
+}
\ No newline at end of file
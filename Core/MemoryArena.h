@@ -0,0 +1,95 @@
+#ifndef MEMORYARENA_H_INCLUDED
+#define MEMORYARENA_H_INCLUDED
+
+#include <new>
+#include <stddef.h>
+#include <vector>
+
+namespace Core
+{
+
+/// <summary>
+/// Allocates memory by advancing through large blocks, and frees everything allocated from it at once.
+/// Objects allocated from an arena are never destructed, so must not own any other resources.
+/// Arenas are not thread safe; threads allocating in parallel each use their own arena, and move its
+/// blocks into a shared arena with TakeBlocks once they are done.
+/// </summary>
+class MemoryArena
+{
+	public:
+
+		static const size_t DefaultBlockSize = 64 * 1024;
+
+		/// Largest alignment which allocations can request, that of the blocks themselves.
+		static const size_t MaxAlignment = 16;
+
+		MemoryArena(size_t blockSize = DefaultBlockSize);
+		~MemoryArena();
+
+		MemoryArena(const MemoryArena& rvalue) = delete;
+		MemoryArena& operator=(const MemoryArena& rvalue) = delete;
+
+		/// <summary>
+		/// Returns uninitialized memory of the specified size. The alignment must be a power of two no
+		/// larger than MaxAlignment. Allocations larger than a quarter of the block size get a block of their
+		/// own, so that they do not waste the rest of the current block.
+		/// </summary>
+		void* Allocate(size_t size, size_t alignment = MaxAlignment);
+
+		/// <summary>
+		/// Allocates and default constructs an object.
+		/// </summary>
+		template <class TObject>
+		TObject* New()
+		{
+			return new (Allocate(sizeof(TObject), __alignof(TObject))) TObject();
+		}
+
+		/// <summary>
+		/// Allocates an uninitialized array of the specified number of objects.
+		/// </summary>
+		template <class TObject>
+		TObject* AllocateArray(size_t count)
+		{
+			return reinterpret_cast<TObject*>(Allocate(count * sizeof(TObject), __alignof(TObject)));
+		}
+
+		/// <summary>
+		/// Moves all blocks of the other arena into this one, leaving the other arena empty. Memory allocated
+		/// from the other arena then stays valid until this one is reset.
+		/// </summary>
+		void TakeBlocks(MemoryArena& other);
+
+		/// <summary>
+		/// Frees all memory allocated from this arena.
+		/// </summary>
+		void Reset();
+
+		/// <summary>
+		/// Returns the number of bytes requested from this arena, including those taken from other arenas.
+		/// </summary>
+		size_t GetBytesAllocated() const;
+
+		/// <summary>
+		/// Returns the number of bytes in the blocks of this arena, including those not allocated yet.
+		/// </summary>
+		size_t GetBytesReserved() const;
+
+	protected:
+
+		size_t m_BlockSize;
+
+		std::vector<void*> m_Blocks;
+
+		char* m_Current;
+		char* m_End;
+
+		size_t m_BytesAllocated;
+		size_t m_BytesReserved;
+
+		void* AllocateBlock(size_t size);
+};
+
+}
+
+#endif // MEMORYARENA_H_INCLUDED
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "MemoryArenaTests.h"
+#include "MemoryArena.h"
+#include <cstring>
+#include <stdint.h>
+
+namespace Core
+{
+
+static bool IsAligned(const void* address, size_t alignment)
+{
+	return 0 == reinterpret_cast<uintptr_t>(address) % alignment;
+}
+
+static bool Validation_AllocationsAreAligned()
+{
+	MemoryArena arena(1024);
+
+	// Odd sizes leave the arena misaligned for the following allocation.
+	for (size_t alignment = 1; alignment <= MemoryArena::MaxAlignment; alignment *= 2)
+	{
+		for (size_t size = 1; size < 8; size += 2)
+		{
+			void* allocation = arena.Allocate(size, alignment);
+			if (!IsAligned(allocation, alignment))
+				return false;
+		}
+	}
+
+	// Allocations without an explicit alignment are aligned to the largest supported one.
+	arena.Allocate(3, 1);
+	if (!IsAligned(arena.Allocate(3), MemoryArena::MaxAlignment))
+		return false;
+
+	arena.Allocate(1, 1);
+	if (!IsAligned(arena.New<double>(), __alignof(double)))
+		return false;
+
+	return true;
+}
+
+static bool Validation_AllocationsDoNotOverlap()
+{
+	MemoryArena arena(256);
+
+	// Allocations span several blocks, and each is filled with its own value.
+	const int numAllocations = 100;
+	unsigned char* allocations[numAllocations];
+
+	for (int i = 0; i < numAllocations; i++)
+	{
+		allocations[i] = arena.AllocateArray<unsigned char>(13);
+		memset(allocations[i], i, 13);
+	}
+
+	for (int i = 0; i < numAllocations; i++)
+	{
+		for (int j = 0; j < 13; j++)
+		{
+			if (allocations[i][j] != (unsigned char)i)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+static bool Validation_LargeAllocationsGetTheirOwnBlock()
+{
+	const size_t blockSize = 1024;
+	MemoryArena arena(blockSize);
+
+	char* first = reinterpret_cast<char*>(arena.Allocate(16));
+	if (arena.GetBytesReserved() != blockSize)
+		return false;
+
+	// A large allocation is given a block of exactly its size.
+	void* large = arena.Allocate(blockSize / 2);
+	if (nullptr == large || arena.GetBytesReserved() != blockSize + blockSize / 2)
+		return false;
+
+	// Small allocations carry on in the block they were using before.
+	char* second = reinterpret_cast<char*>(arena.Allocate(16));
+	if (second != first + 16 || arena.GetBytesReserved() != blockSize + blockSize / 2)
+		return false;
+
+	// Allocations larger than the block size do not overflow their block.
+	char* huge = reinterpret_cast<char*>(arena.Allocate(blockSize * 4));
+	memset(huge, 0xff, blockSize * 4);
+	if (arena.GetBytesReserved() != blockSize * 5 + blockSize / 2)
+		return false;
+
+	return true;
+}
+
+static bool Validation_TakeBlocksKeepsMemoryValid()
+{
+	MemoryArena shared(1024);
+	shared.Allocate(100);
+
+	const int numValues = 64;
+	int* values;
+
+	{
+		MemoryArena worker(1024);
+		values = worker.AllocateArray<int>(numValues);
+		for (int i = 0; i < numValues; i++)
+			values[i] = i * 3;
+
+		shared.TakeBlocks(worker);
+
+		// The worker arena is left empty, but can still be used.
+		if (0 != worker.GetBytesAllocated() || 0 != worker.GetBytesReserved())
+			return false;
+
+		if (nullptr == worker.Allocate(8) || 1024 != worker.GetBytesReserved())
+			return false;
+	}
+
+	// The values outlive the worker arena they were allocated from.
+	for (int i = 0; i < numValues; i++)
+	{
+		if (values[i] != i * 3)
+			return false;
+	}
+
+	if (shared.GetBytesAllocated() != 100 + numValues * sizeof(int) || shared.GetBytesReserved() != 2 * 1024)
+		return false;
+
+	// The shared arena carries on allocating from its own block.
+	shared.Allocate(100);
+	if (shared.GetBytesReserved() != 2 * 1024)
+		return false;
+
+	return true;
+}
+
+static bool Validation_ResetFreesEverything()
+{
+	MemoryArena arena(1024);
+
+	arena.Allocate(10);
+	arena.Allocate(20, 4);
+	arena.Allocate(2000);
+
+	if (arena.GetBytesAllocated() != 10 + 20 + 2000 || arena.GetBytesReserved() != 1024 + 2000)
+		return false;
+
+	arena.Reset();
+	if (0 != arena.GetBytesAllocated() || 0 != arena.GetBytesReserved())
+		return false;
+
+	// The arena can be used again after it is reset.
+	arena.Allocate(10);
+	if (10 != arena.GetBytesAllocated() || 1024 != arena.GetBytesReserved())
+		return false;
+
+	return true;
+}
+
+bool MemoryArenaTests::RunValidationTests()
+{
+	return Validation_AllocationsAreAligned() &&
+		Validation_AllocationsDoNotOverlap() &&
+		Validation_LargeAllocationsGetTheirOwnBlock() &&
+		Validation_TakeBlocksKeepsMemoryValid() &&
+		Validation_ResetFreesEverything();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef MEMORYARENATESTS_H_INCLUDED
+#define MEMORYARENATESTS_H_INCLUDED
+
+namespace Core
+{
+
+class MemoryArenaTests
+{
+	public:
+
+		static bool RunValidationTests();
+};
+
+}
+
+#endif // MEMORYARENATESTS_H_INCLUDED
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "MemoryMappedFile.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+
+namespace Core
+{
+
+MemoryMappedFile::MemoryMappedFile() :
+	m_File(INVALID_HANDLE_VALUE),
+	m_Mapping(nullptr),
+	m_Data(nullptr),
+	m_Size(0)
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+bool MemoryMappedFile::Open(const std::string& fileName)
+{
+	Close();
+
+	m_File = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (INVALID_HANDLE_VALUE == m_File)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(m_File, &fileSize) || 0 == fileSize.QuadPart)
+	{
+		Close();
+		return false;
+	}
+
+	// Empty files cannot be mapped, and have been rejected above.
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (nullptr == m_Mapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_Data = MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (nullptr == m_Data)
+	{
+		Close();
+		return false;
+	}
+
+	m_Size = (size_t)fileSize.QuadPart;
+
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (nullptr != m_Data)
+		UnmapViewOfFile(m_Data);
+
+	if (nullptr != m_Mapping)
+		CloseHandle(m_Mapping);
+
+	if (INVALID_HANDLE_VALUE != m_File)
+		CloseHandle(m_File);
+
+	m_File = INVALID_HANDLE_VALUE;
+	m_Mapping = nullptr;
+	m_Data = nullptr;
+	m_Size = 0;
+}
+
+bool MemoryMappedFile::IsOpen() const
+{
+	return nullptr != m_Data;
+}
+
+const void* MemoryMappedFile::GetData() const
+{
+	return m_Data;
+}
+
+size_t MemoryMappedFile::GetSize() const
+{
+	return m_Size;
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef MEMORYMAPPEDFILE_H_INCLUDED
+#define MEMORYMAPPEDFILE_H_INCLUDED
+
+#include <stddef.h>
+#include <string>
+
+namespace Core
+{
+
+/// <summary>
+/// Maps a file into memory for reading. The file's contents are paged in on demand as they are accessed,
+/// and stay mapped until the file is closed.
+/// </summary>
+class MemoryMappedFile
+{
+	public:
+
+		MemoryMappedFile();
+		~MemoryMappedFile();
+
+		MemoryMappedFile(const MemoryMappedFile& rvalue) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile& rvalue) = delete;
+
+		/// <summary>
+		/// Maps the specified file, closing any file mapped previously. Returns false if the file cannot be
+		/// opened or is empty.
+		/// </summary>
+		bool Open(const std::string& fileName);
+
+		/// <summary>
+		/// Unmaps the file.
+		/// </summary>
+		void Close();
+
+		bool IsOpen() const;
+
+		/// <summary>
+		/// Returns the start of the mapped file. The mapping is aligned to at least a page boundary.
+		/// </summary>
+		const void* GetData() const;
+
+		size_t GetSize() const;
+
+	protected:
+
+		void* m_File;
+		void* m_Mapping;
+
+		const void* m_Data;
+		size_t m_Size;
+};
+
+}
+
+#endif // MEMORYMAPPEDFILE_H_INCLUDED
\ No newline at end of file
@@ -129,4 +129,56 @@ TEST(TriangleAABB, TriangleAABB_Intersection_Test_Works)
 		triangle.m_Vertices[2].m_Position.setXYZW(-0.079721f, 0.856389f, 0.5f, 1.0f);
 		ASSERT_FALSE(TriangleIntersectsAABB(triangle, minExtents, maxExtents));
 	}
+}
+
+TEST(TriangleAABB, Clip_Triangle_To_AABB_Works)
+{
+	vector4 minExtents(0.0f, 0.0f, -1.0f, 1.0f);
+	vector4 maxExtents(5.0f, 5.0f, 1.0f, 1.0f);
+
+	vector4 clippedMin;
+	vector4 clippedMax;
+
+	// A thin triangle crossing the AABB is clipped tighter than its own bounds.
+	{
+		Triangle triangle;
+		triangle.m_Vertices[0].m_Position.setXYZW(0.0f, 0.0f, 0.0f, 1.0f);
+		triangle.m_Vertices[1].m_Position.setXYZW(10.0f, 0.0f, 0.0f, 1.0f);
+		triangle.m_Vertices[2].m_Position.setXYZW(10.0f, 1.0f, 0.0f, 1.0f);
+		ASSERT_TRUE(ClipTriangleToAABB(triangle, minExtents, maxExtents, clippedMin, clippedMax));
+
+		ASSERT_FLOAT_EQ(clippedMin.extractX(), 0.0f);
+		ASSERT_FLOAT_EQ(clippedMin.extractY(), 0.0f);
+		ASSERT_FLOAT_EQ(clippedMin.extractZ(), 0.0f);
+
+		ASSERT_FLOAT_EQ(clippedMax.extractX(), 5.0f);
+		ASSERT_FLOAT_EQ(clippedMax.extractY(), 0.5f);
+		ASSERT_FLOAT_EQ(clippedMax.extractZ(), 0.0f);
+	}
+
+	// A triangle inside the AABB keeps its own bounds.
+	{
+		Triangle triangle;
+		triangle.m_Vertices[0].m_Position.setXYZW(1.0f, 1.0f, -0.5f, 1.0f);
+		triangle.m_Vertices[1].m_Position.setXYZW(4.0f, 2.0f, 0.0f, 1.0f);
+		triangle.m_Vertices[2].m_Position.setXYZW(2.0f, 3.0f, 0.5f, 1.0f);
+		ASSERT_TRUE(ClipTriangleToAABB(triangle, minExtents, maxExtents, clippedMin, clippedMax));
+
+		ASSERT_FLOAT_EQ(clippedMin.extractX(), 1.0f);
+		ASSERT_FLOAT_EQ(clippedMin.extractY(), 1.0f);
+		ASSERT_FLOAT_EQ(clippedMin.extractZ(), -0.5f);
+
+		ASSERT_FLOAT_EQ(clippedMax.extractX(), 4.0f);
+		ASSERT_FLOAT_EQ(clippedMax.extractY(), 3.0f);
+		ASSERT_FLOAT_EQ(clippedMax.extractZ(), 0.5f);
+	}
+
+	// The bounds of this triangle overlap the AABB, but the triangle itself passes by its corner.
+	{
+		Triangle triangle;
+		triangle.m_Vertices[0].m_Position.setXYZW(4.0f, 7.0f, 0.0f, 1.0f);
+		triangle.m_Vertices[1].m_Position.setXYZW(7.0f, 4.0f, 0.0f, 1.0f);
+		triangle.m_Vertices[2].m_Position.setXYZW(7.0f, 7.0f, 0.0f, 1.0f);
+		ASSERT_FALSE(ClipTriangleToAABB(triangle, minExtents, maxExtents, clippedMin, clippedMax));
+	}
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #include "Triangle.h"
 #include "TriangleAABB.h"
 #include "PlaneAABB.h"
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
 namespace GeometryLib
 {
@@ -283,6 +285,92 @@ namespace GeometryLib
 		return true;
 	}
 
+	bool ClipTriangleToAABB(const Triangle& triangle, const vector4& min, const vector4& max, vector4& clippedMin,
+		vector4& clippedMax)
+	{
+		// Clipping a convex polygon to a plane adds at most one vertex, so the triangle clipped to all six
+		// planes of the AABB has at most nine.
+		const int MaxVertices = 9;
+
+		float polygons[2][MaxVertices][3];
+		int numVertices = 3;
+		int current = 0;
+
+		for (int i = 0; i < 3; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+				polygons[current][i][axis] = triangle.m_Vertices[i].m_Position[axis];
+		}
+
+		// Sutherland-Hodgman clipping against each plane of the AABB in turn.
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int side = 0; side < 2; side++)
+			{
+				const float bound = (0 == side) ? min[axis] : max[axis];
+				const float direction = (0 == side) ? 1.0f : -1.0f;
+
+				const float (*input)[3] = polygons[current];
+				float (*output)[3] = polygons[1 - current];
+				int numOutputVertices = 0;
+
+				for (int i = 0; i < numVertices; i++)
+				{
+					const float* start = input[i];
+					const float* end = input[(i + 1) % numVertices];
+
+					// Positive distances are inside the AABB.
+					float startDistance = direction * (start[axis] - bound);
+					float endDistance = direction * (end[axis] - bound);
+
+					if (startDistance >= 0.0f)
+					{
+						assert(numOutputVertices < MaxVertices);
+						memcpy(output[numOutputVertices++], start, sizeof(float) * 3);
+					}
+
+					if ((startDistance < 0.0f && endDistance > 0.0f) || (startDistance > 0.0f && endDistance < 0.0f))
+					{
+						assert(numOutputVertices < MaxVertices);
+
+						float t = startDistance / (startDistance - endDistance);
+						float* intersection = output[numOutputVertices++];
+
+						for (int k = 0; k < 3; k++)
+							intersection[k] = start[k] + (end[k] - start[k]) * t;
+
+						// Placing the intersection exactly on the plane keeps it from drifting outside due to rounding.
+						intersection[axis] = bound;
+					}
+				}
+
+				if (0 == numOutputVertices)
+					return false;
+
+				numVertices = numOutputVertices;
+				current = 1 - current;
+			}
+		}
+
+		float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (int i = 0; i < numVertices; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				boundsMin[axis] = std::min(boundsMin[axis], polygons[current][i][axis]);
+				boundsMax[axis] = std::max(boundsMax[axis], polygons[current][i][axis]);
+			}
+		}
+
+		// Interpolated coordinates along the other axes can still round slightly past the AABB.
+		clippedMin.setXYZ(std::max(boundsMin[0], min[0]), std::max(boundsMin[1], min[1]), std::max(boundsMin[2], min[2]));
+		clippedMax.setXYZ(std::min(boundsMax[0], max[0]), std::min(boundsMax[1], max[1]), std::min(boundsMax[2], max[2]));
+
+		return true;
+	}
+
 	void GeometryLib::ComputeAABBForTriangles(unsigned int numTriangles, const Triangle* triangles, vector4& min, vector4& max)
 	{
 		const float EPSILON = 0.00f;
@@ -18,6 +18,19 @@ namespace GeometryLib
 	/// <returns>True if there exists an intersection, false if not.</returns>
 	bool TriangleIntersectsAABB(const Triangle& triangle, const vector4& min, const vector4& max);
 
+	/// <summary>
+	/// Clips a triangle to an AABB and determines the bounds of the part of the triangle inside it.
+	/// These are often much tighter than the triangle's own bounds clipped to the AABB.
+	/// </summary>
+	/// <param name="triangle">The triangle to clip.</param>
+	/// <param name="min">The minimum bounding extents of the AABB.</param>
+	/// <param name="max">The maximum bounding extents of the AABB.</param>
+	/// <param name="clippedMin">Reference to the vector that will store the minimal values of the clipped triangle.</param>
+	/// <param name="clippedMax">Reference to the vector that will store the maximal values of the clipped triangle.</param>
+	/// <returns>True if any part of the triangle is inside the AABB, false if not.</returns>
+	bool ClipTriangleToAABB(const Triangle& triangle, const vector4& min, const vector4& max, vector4& clippedMin,
+		vector4& clippedMax);
+
 	/// <summary>
 	/// Determines the minimal and maximal extents of an AABB volume enclosing the specified list of triangles.
 	/// </summary>
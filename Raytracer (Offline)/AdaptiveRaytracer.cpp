@@ -0,0 +1,352 @@
+#include "AdaptiveRaytracer.h"
+#include "DeferredShadingPass.h"
+#include "HighPerformanceTimer.h"
+#include <MathLib.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+using namespace MathLib;
+using namespace Core;
+using namespace std;
+using CameraLib::RayGenerator;
+
+namespace Raytracer
+{
+	namespace
+	{
+		float CalculateLuminance(const float* color)
+		{
+			return 0.2126f * color[0] + 0.7152f * color[1] + 0.0722f * color[2];
+		}
+	}
+
+	AdaptiveRaytracer::AdaptiveRaytracer() :
+		TiledRaytracer(),
+		m_BaseSamplesPerAxis(DefaultBaseSamplesPerAxis),
+		m_RefinedSamplesPerAxis(DefaultRefinedSamplesPerAxis),
+		m_VarianceThreshold(0.0025f),
+		m_ContrastThreshold(0.1f),
+		m_NumRaysTraced(0),
+		m_NumRefinedPixels(0)
+	{
+	}
+
+	AdaptiveRaytracer::AdaptiveRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene) :
+		TiledRaytracer(frameBuffer, camera, scene),
+		m_BaseSamplesPerAxis(DefaultBaseSamplesPerAxis),
+		m_RefinedSamplesPerAxis(DefaultRefinedSamplesPerAxis),
+		m_VarianceThreshold(0.0025f),
+		m_ContrastThreshold(0.1f),
+		m_NumRaysTraced(0),
+		m_NumRefinedPixels(0)
+	{
+	}
+
+	void AdaptiveRaytracer::SetSamplesPerAxis(unsigned baseSamplesPerAxis, unsigned refinedSamplesPerAxis)
+	{
+		assert(baseSamplesPerAxis > 0 && baseSamplesPerAxis * baseSamplesPerAxis <= RayPacket::MaxSize);
+		assert(refinedSamplesPerAxis * refinedSamplesPerAxis <= RayPacket::MaxSize);
+
+		m_BaseSamplesPerAxis = baseSamplesPerAxis;
+		m_RefinedSamplesPerAxis = refinedSamplesPerAxis;
+	}
+
+	unsigned AdaptiveRaytracer::GetBaseSamplesPerAxis() const
+	{
+		return m_BaseSamplesPerAxis;
+	}
+
+	unsigned AdaptiveRaytracer::GetRefinedSamplesPerAxis() const
+	{
+		return m_RefinedSamplesPerAxis;
+	}
+
+	void AdaptiveRaytracer::SetVarianceThreshold(float varianceThreshold)
+	{
+		m_VarianceThreshold = varianceThreshold;
+	}
+
+	float AdaptiveRaytracer::GetVarianceThreshold() const
+	{
+		return m_VarianceThreshold;
+	}
+
+	void AdaptiveRaytracer::SetContrastThreshold(float contrastThreshold)
+	{
+		m_ContrastThreshold = contrastThreshold;
+	}
+
+	float AdaptiveRaytracer::GetContrastThreshold() const
+	{
+		return m_ContrastThreshold;
+	}
+
+	unsigned AdaptiveRaytracer::GetNumRaysTraced() const
+	{
+		return m_NumRaysTraced;
+	}
+
+	unsigned AdaptiveRaytracer::GetNumRefinedPixels() const
+	{
+		return m_NumRefinedPixels;
+	}
+
+	void AdaptiveRaytracer::Raytrace()
+	{
+		vector<Tile> tiles;
+		unsigned numWorkers = BeginFrame(tiles);
+
+		unsigned numPixels = m_FrameBuffer->GetWidth() * m_FrameBuffer->GetHeight();
+		m_Luminance.resize(numPixels);
+		m_LuminanceVariance.resize(numPixels);
+		m_NumRaysTraced = 0;
+		m_NumRefinedPixels = 0;
+
+		RayGenerator rayGenerator(*m_Camera, m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight());
+		TileScheduler scheduler(numWorkers);
+
+		HighPerformanceTimer timer;
+		timer.Start();
+
+		// Refinement compares each pixel to its neighbours, so every tile has to be sampled before any
+		// tile can be refined.
+		for (unsigned pass = 0; pass < 2; pass++)
+		{
+			bool refine = 1 == pass;
+			if (refine && 0 == m_RefinedSamplesPerAxis)
+				break;
+
+			scheduler.Reset((unsigned)tiles.size());
+
+			RunWorkers(numWorkers, [&](unsigned workerIndex)
+			{
+				RenderPassTiles(workerIndex, scheduler, tiles, rayGenerator, refine);
+			});
+		}
+
+		timer.Stop();
+
+		ConvertHeatmapToFalseColour();
+
+		PrintFrameTime(timer.GetTimeMilliseconds(), numWorkers, to_string(tiles.size()) + " tiles");
+		printf("Rays traced: %u (%4.2f per pixel, %u pixels refined)\n", (unsigned)m_NumRaysTraced,
+			(float)m_NumRaysTraced / (float)numPixels, (unsigned)m_NumRefinedPixels);
+		PrintTraversalStatistics(m_FrameStatistics);
+	}
+
+	void AdaptiveRaytracer::RenderPassTiles(unsigned workerIndex, TileScheduler& scheduler, const vector<Tile>& tiles,
+		const RayGenerator& rayGenerator, bool refine)
+	{
+		DeferredShadingPass shadingPass;
+		vector<float> sampleColors;
+		vector<unsigned> refinedPixels;
+
+		unsigned tileIndex;
+		while (scheduler.AcquireTile(workerIndex, tileIndex))
+		{
+			if (refine)
+				RefineTile(tiles[tileIndex], rayGenerator, shadingPass, sampleColors, refinedPixels);
+			else
+				SampleTile(tiles[tileIndex], rayGenerator, shadingPass, sampleColors);
+		}
+	}
+
+	void AdaptiveRaytracer::SampleTile(const Tile& tile, const RayGenerator& rayGenerator, DeferredShadingPass& shadingPass,
+		vector<float>& sampleColors)
+	{
+		unsigned frameBufferWidth = m_FrameBuffer->GetWidth();
+		float* frameBufferData = m_FrameBuffer->GetData();
+
+		unsigned numSamples = m_BaseSamplesPerAxis * m_BaseSamplesPerAxis;
+		unsigned pixelStride = numSamples * 4;
+
+		// The shading pass writes to the sample buffer, so it must not be reallocated until the tile is shaded.
+		sampleColors.resize(tile.m_Width * tile.m_Height * pixelStride);
+
+		RayBeam beam;
+		BeamEntryCache entryCache;
+		const RayBeam* tileBeam = PrepareTileBeam(tile, rayGenerator, beam, entryCache);
+
+		float* currentSampleColors = sampleColors.data();
+		for (unsigned y = tile.m_Y; y < tile.m_Y + tile.m_Height; y++)
+		{
+			for (unsigned x = tile.m_X; x < tile.m_X + tile.m_Width; x++)
+			{
+				TracePixelSamples(x, y, m_BaseSamplesPerAxis, rayGenerator, tileBeam, shadingPass, currentSampleColors);
+				currentSampleColors += pixelStride;
+			}
+		}
+
+		shadingPass.Shade(*m_Scene);
+
+		currentSampleColors = sampleColors.data();
+		for (unsigned y = tile.m_Y; y < tile.m_Y + tile.m_Height; y++)
+		{
+			for (unsigned x = tile.m_X; x < tile.m_X + tile.m_Width; x++)
+			{
+				unsigned pixelIndex = y * frameBufferWidth + x;
+				float* pixel = frameBufferData + pixelIndex * 4;
+
+				float luminanceSum = 0.0f;
+				float luminanceSquaredSum = 0.0f;
+
+				memset(pixel, 0, sizeof(float) * 4);
+				for (unsigned i = 0; i < numSamples; i++, currentSampleColors += 4)
+				{
+					for (unsigned component = 0; component < 4; component++)
+						pixel[component] += currentSampleColors[component];
+
+					float luminance = CalculateLuminance(currentSampleColors);
+					luminanceSum += luminance;
+					luminanceSquaredSum += luminance * luminance;
+				}
+
+				for (unsigned component = 0; component < 4; component++)
+					pixel[component] /= (float)numSamples;
+
+				float meanLuminance = luminanceSum / (float)numSamples;
+				m_Luminance[pixelIndex] = meanLuminance;
+				m_LuminanceVariance[pixelIndex] = max(0.0f, luminanceSquaredSum / (float)numSamples - meanLuminance * meanLuminance);
+			}
+		}
+
+		m_NumRaysTraced += tile.m_Width * tile.m_Height * numSamples;
+	}
+
+	void AdaptiveRaytracer::RefineTile(const Tile& tile, const RayGenerator& rayGenerator, DeferredShadingPass& shadingPass,
+		vector<float>& sampleColors, vector<unsigned>& refinedPixels)
+	{
+		unsigned frameBufferWidth = m_FrameBuffer->GetWidth();
+		float* frameBufferData = m_FrameBuffer->GetData();
+
+		refinedPixels.clear();
+		for (unsigned y = tile.m_Y; y < tile.m_Y + tile.m_Height; y++)
+		{
+			for (unsigned x = tile.m_X; x < tile.m_X + tile.m_Width; x++)
+			{
+				if (NeedsRefinement(x, y))
+					refinedPixels.push_back(y * frameBufferWidth + x);
+			}
+		}
+
+		if (refinedPixels.empty())
+			return;
+
+		unsigned numBaseSamples = m_BaseSamplesPerAxis * m_BaseSamplesPerAxis;
+		unsigned numRefinedSamples = m_RefinedSamplesPerAxis * m_RefinedSamplesPerAxis;
+		unsigned pixelStride = numRefinedSamples * 4;
+
+		// The shading pass writes to the sample buffer, so it must not be reallocated until the tile is shaded.
+		sampleColors.resize(refinedPixels.size() * pixelStride);
+
+		RayBeam beam;
+		BeamEntryCache entryCache;
+		const RayBeam* tileBeam = PrepareTileBeam(tile, rayGenerator, beam, entryCache);
+
+		for (size_t i = 0; i < refinedPixels.size(); i++)
+		{
+			unsigned x = refinedPixels[i] % frameBufferWidth;
+			unsigned y = refinedPixels[i] / frameBufferWidth;
+
+			TracePixelSamples(x, y, m_RefinedSamplesPerAxis, rayGenerator, tileBeam, shadingPass,
+				&sampleColors[i * pixelStride]);
+		}
+
+		shadingPass.Shade(*m_Scene);
+
+		// Weight every sample of the pixel equally, whichever grid it belongs to.
+		float totalSamples = (float)(numBaseSamples + numRefinedSamples);
+
+		const float* currentSampleColors = sampleColors.data();
+		for (unsigned pixelIndex : refinedPixels)
+		{
+			float* pixel = frameBufferData + pixelIndex * 4;
+
+			float colorSum[4];
+			for (unsigned component = 0; component < 4; component++)
+				colorSum[component] = pixel[component] * (float)numBaseSamples;
+
+			for (unsigned i = 0; i < numRefinedSamples; i++, currentSampleColors += 4)
+			{
+				for (unsigned component = 0; component < 4; component++)
+					colorSum[component] += currentSampleColors[component];
+			}
+
+			for (unsigned component = 0; component < 4; component++)
+				pixel[component] = colorSum[component] / totalSamples;
+		}
+
+		m_NumRaysTraced += (unsigned)refinedPixels.size() * numRefinedSamples;
+		m_NumRefinedPixels += (unsigned)refinedPixels.size();
+	}
+
+	bool AdaptiveRaytracer::NeedsRefinement(unsigned x, unsigned y) const
+	{
+		unsigned width = m_FrameBuffer->GetWidth();
+		unsigned height = m_FrameBuffer->GetHeight();
+		unsigned pixelIndex = y * width + x;
+
+		if (m_LuminanceVariance[pixelIndex] > m_VarianceThreshold)
+			return true;
+
+		float luminance = m_Luminance[pixelIndex];
+
+		// The statistics of the first pass are only read during refinement, so neighbours in other tiles
+		// can be compared safely.
+		if (x > 0 && fabsf(luminance - m_Luminance[pixelIndex - 1]) > m_ContrastThreshold)
+			return true;
+		if (x + 1 < width && fabsf(luminance - m_Luminance[pixelIndex + 1]) > m_ContrastThreshold)
+			return true;
+		if (y > 0 && fabsf(luminance - m_Luminance[pixelIndex - width]) > m_ContrastThreshold)
+			return true;
+		if (y + 1 < height && fabsf(luminance - m_Luminance[pixelIndex + width]) > m_ContrastThreshold)
+			return true;
+
+		return false;
+	}
+
+	void AdaptiveRaytracer::TracePixelSamples(unsigned x, unsigned y, unsigned samplesPerAxis, const RayGenerator& rayGenerator,
+		const RayBeam* tileBeam, DeferredShadingPass& shadingPass, float* sampleColors)
+	{
+		unsigned numSamples = samplesPerAxis * samplesPerAxis;
+
+		// The samples lie within the pixel, so the beam through the outer edges of the tile encloses them.
+		RayPacket packet(numSamples);
+		packet.m_Beam = tileBeam;
+
+		HitRecord hitRecords[RayPacket::MaxSize];
+
+		// Every sample is charged to the pixel in the heatmap.
+		unsigned pixelIndices[RayPacket::MaxSize];
+		fill(pixelIndices, pixelIndices + numSamples, y * m_FrameBuffer->GetWidth() + x);
+
+		// Samples are placed at the centres of a regular grid of cells covering the pixel. Pixel coordinates
+		// address the centre of the pixel.
+		float cellSize = 1.0f / (float)samplesPerAxis;
+
+		for (unsigned sampleY = 0; sampleY < samplesPerAxis; sampleY++)
+		{
+			for (unsigned sampleX = 0; sampleX < samplesPerAxis; sampleX++)
+			{
+				float offsetX = ((float)sampleX + 0.5f) * cellSize - 0.5f;
+				float offsetY = ((float)sampleY + 0.5f) * cellSize - 0.5f;
+
+				rayGenerator.GenerateRay((float)x + offsetX, (float)y + offsetY, packet.m_Rays[sampleY * samplesPerAxis + sampleX]);
+			}
+		}
+
+		uint32_t hitMask = TracePixelPacket(packet, hitRecords, pixelIndices);
+
+		// Samples which miss the scene are transparent black.
+		for (unsigned i = 0; i < numSamples; i++)
+		{
+			if (0 != (hitMask & (1u << i)))
+				shadingPass.AddHit(hitRecords[i], sampleColors + i * 4);
+			else
+				memset(sampleColors + i * 4, 0, sizeof(float) * 4);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "TiledRaytracer.h"
+#include <atomic>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Multithreaded raytracer which anti-aliases the frame with adaptive supersampling.
+	///
+	/// Every pixel is first traced with a small stratified grid of samples. Pixels whose samples disagree, or
+	/// whose colour differs strongly from a neighbouring pixel, are then traced again with a denser grid. Most
+	/// pixels of a typical frame are flat, so edges such as silhouettes receive the extra rays while the rest of
+	/// the frame costs little more than a single sample per pixel.
+	/// </summary>
+	class AdaptiveRaytracer : public TiledRaytracer
+	{
+	public:
+
+		static const unsigned DefaultBaseSamplesPerAxis = 2;
+		static const unsigned DefaultRefinedSamplesPerAxis = 4;
+
+		AdaptiveRaytracer();
+		AdaptiveRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene);
+
+		/// <summary>
+		/// Sets the size of the grid of samples every pixel is traced with, and the size of the grid of additional
+		/// samples traced for pixels which need refining. A pixel is traced with at most RayPacket::MaxSize
+		/// samples at a time, so neither grid may hold more samples than that.
+		/// </summary>
+		void SetSamplesPerAxis(unsigned baseSamplesPerAxis, unsigned refinedSamplesPerAxis);
+		unsigned GetBaseSamplesPerAxis() const;
+		unsigned GetRefinedSamplesPerAxis() const;
+
+		/// <summary>
+		/// Sets the variance of the luminance of a pixel's samples above which the pixel is refined.
+		/// </summary>
+		void SetVarianceThreshold(float varianceThreshold);
+		float GetVarianceThreshold() const;
+
+		/// <summary>
+		/// Sets the difference in luminance between a pixel and any of its four neighbours above which the
+		/// pixel is refined.
+		/// </summary>
+		void SetContrastThreshold(float contrastThreshold);
+		float GetContrastThreshold() const;
+
+		void Raytrace() override;
+
+		/// <summary>Returns the number of rays traced for the last frame.</summary>
+		unsigned GetNumRaysTraced() const;
+
+		/// <summary>Returns the number of pixels of the last frame which received additional samples.</summary>
+		unsigned GetNumRefinedPixels() const;
+
+	protected:
+
+		unsigned m_BaseSamplesPerAxis;
+		unsigned m_RefinedSamplesPerAxis;
+		float m_VarianceThreshold;
+		float m_ContrastThreshold;
+
+		/// <summary>Mean and variance of the luminance of each pixel's base samples.</summary>
+		std::vector<float> m_Luminance;
+		std::vector<float> m_LuminanceVariance;
+
+		std::atomic<unsigned> m_NumRaysTraced;
+		std::atomic<unsigned> m_NumRefinedPixels;
+
+		/// <summary>
+		/// Acquires and renders tiles until the scheduler has none remaining. Either every pixel is sampled
+		/// with the base grid, or the pixels which need it are refined.
+		/// </summary>
+		void RenderPassTiles(unsigned workerIndex, TileScheduler& scheduler, const std::vector<Tile>& tiles,
+			const CameraLib::RayGenerator& rayGenerator, bool refine);
+
+		/// <summary>
+		/// Traces the base samples of every pixel of the tile, writing the mean colour to the frame buffer
+		/// and the luminance statistics used to decide which pixels to refine.
+		/// </summary>
+		void SampleTile(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, DeferredShadingPass& shadingPass,
+			std::vector<float>& sampleColors);
+
+		/// <summary>
+		/// Traces the refined samples of the pixels of the tile which need them, and blends them with the
+		/// pixel's base samples.
+		/// </summary>
+		void RefineTile(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, DeferredShadingPass& shadingPass,
+			std::vector<float>& sampleColors, std::vector<unsigned>& refinedPixels);
+
+		/// <summary>Returns true if the base samples of the pixel indicate it needs more samples.</summary>
+		bool NeedsRefinement(unsigned x, unsigned y) const;
+
+		/// <summary>
+		/// Traces a stratified grid of samples through pixel (x, y), starting at the entry node of the tile's beam
+		/// if there is one. The colour of each sample is written to four floats of sampleColors once the shading
+		/// pass has been shaded.
+		/// </summary>
+		void TracePixelSamples(unsigned x, unsigned y, unsigned samplesPerAxis, const CameraLib::RayGenerator& rayGenerator,
+			const RayBeam* tileBeam, DeferredShadingPass& shadingPass, float* sampleColors);
+	};
+}
\ No newline at end of file
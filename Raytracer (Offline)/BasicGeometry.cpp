@@ -68,14 +68,10 @@ namespace Raytracer
 		m_NumTriangles = 0;
 	}
 
-	bool BasicGeometry::Trace(const ray& intersectionRay, float* t, float* results) const
+	bool BasicGeometry::Trace(const ray& intersectionRay, HitRecord& hitRecord) const
 	{
 		bool intersectionFound = false;
-		*t = FLT_MAX;
-
-		unsigned int intersectedIndex = 0;
-		float intersectedU = 0.0f;
-		float intersectedV = 0.0f;
+		hitRecord.m_T = FLT_MAX;
 
 		for (unsigned int i = 0; i < m_NumTriangles; i++)
 		{
@@ -86,39 +82,52 @@ namespace Raytracer
 			if (GeometryLib::RayTriangleIntersection(intersectionRay, m_Triangles[i], latestT, u, v))
 			{
 				intersectionFound = true;
-				if (latestT < *t)
+				if (latestT < hitRecord.m_T)
 				{
-					*t = latestT;
-
-					intersectedIndex = i;
-					intersectedU = u;
-					intersectedV = v;
+					hitRecord.m_T = latestT;
+					hitRecord.m_U = u;
+					hitRecord.m_V = v;
+					hitRecord.m_PrimitiveId = i;
 				}
 			}
 		}
 
-		if (intersectionFound)
+		return intersectionFound;
+	}
+
+	bool BasicGeometry::Occluded(const ray& intersectionRay, float tMax) const
+	{
+		for (unsigned int i = 0; i < m_NumTriangles; i++)
 		{
-			// Shade result.
-			vector4 objectSpaceNormal;
-			objectSpaceNormal.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedIndex].m_Vertices[0].m_Normal, 1.0f - intersectedU - intersectedV, objectSpaceNormal);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedIndex].m_Vertices[1].m_Normal, intersectedV, objectSpaceNormal);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedIndex].m_Vertices[2].m_Normal, intersectedU, objectSpaceNormal);
-			vector4_normalize(objectSpaceNormal);
-
-			float lightFactor = vector4_dotProduct(objectSpaceNormal, vector4(0.0f, 1.0f, 0.0f, 0.0f));
-			if (lightFactor > 1.0f) lightFactor = 1.0f;
-			if (lightFactor < 0.0f) lightFactor = 0.0f;
-
-			results[0] = lightFactor;
-			results[1] = lightFactor;
-			results[2] = lightFactor;
-			results[3] = 1.0f;
-
-			return true;
+			float t;
+			float u;
+			float v;
+
+			if (GeometryLib::RayTriangleIntersection(intersectionRay, m_Triangles[i], t, u, v) && t >= 0.0f && t < tMax)
+				return true;
 		}
 
 		return false;
 	}
+
+	void BasicGeometry::Shade(const HitRecord& hitRecord, float* results) const
+	{
+		const Triangle& triangle = m_Triangles[hitRecord.m_PrimitiveId];
+
+		vector4 objectSpaceNormal;
+		objectSpaceNormal.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[0].m_Normal, 1.0f - hitRecord.m_U - hitRecord.m_V, objectSpaceNormal);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[1].m_Normal, hitRecord.m_V, objectSpaceNormal);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[2].m_Normal, hitRecord.m_U, objectSpaceNormal);
+		vector4_normalize(objectSpaceNormal);
+
+		float lightFactor = vector4_dotProduct(objectSpaceNormal, vector4(0.0f, 1.0f, 0.0f, 0.0f));
+		if (lightFactor > 1.0f) lightFactor = 1.0f;
+		if (lightFactor < 0.0f) lightFactor = 0.0f;
+
+		results[0] = lightFactor;
+		results[1] = lightFactor;
+		results[2] = lightFactor;
+		results[3] = 1.0f;
+	}
 }
\ No newline at end of file
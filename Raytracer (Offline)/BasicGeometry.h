@@ -35,7 +35,11 @@ namespace Raytracer
 
 		/// ITraceable implementation begin.
 
-		bool Trace(const ray& intersectionRay, float* t, float* results) const override;
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override;
+
+		bool Occluded(const ray& intersectionRay, float tMax) const override;
+
+		void Shade(const HitRecord& hitRecord, float* results) const override;
 
 		/// ITraceable implementation end.
 
@@ -1,11 +1,13 @@
 #include <cassert>
 #include <MathLib.h>
+#include <RayGenerator.h>
 #include "BasicRaytracer.h"
 #include "DebugManager.h"
 #include "HighPerformanceTimer.h"
 
 using namespace MathLib;
 using namespace Core;
+using CameraLib::RayGenerator;
 
 namespace Raytracer
 {
@@ -27,45 +29,7 @@ namespace Raytracer
 		const float screenWidth = (float)m_FrameBuffer->GetWidth();
 		const float screenHeight = (float)m_FrameBuffer->GetHeight();
 
-		const float nearClipPlaneDistance = m_Camera->GetNearClipPlaneDistance();
-		const float aspectRatio = screenWidth / screenHeight;
-		const float halfFov = m_Camera->GetYFov() * 0.5f;
-
-		const float top = nearClipPlaneDistance * tan(MATHLIB_DEG_TO_RAD(halfFov));
-		const float right = top * aspectRatio;
-
-		// Now we need to transform the direction into world space.
-		vector4& camera_xAxis = m_Camera->GetXAxis();
-		vector4& camera_yAxis = m_Camera->GetYAxis();
-		vector4& camera_zAxis = m_Camera->GetZAxis();
-
-		matrix4x4 rotationMatrix
-		(
-			camera_xAxis.extractX(), camera_yAxis.extractX(), camera_zAxis.extractX(), 0.0f,
-			camera_xAxis.extractY(), camera_yAxis.extractY(), camera_zAxis.extractY(), 0.0f,
-			camera_xAxis.extractZ(), camera_yAxis.extractZ(), camera_zAxis.extractZ(), 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-		// First project the point onto the near clip plane (in camera space of course)
-		matrix4x4 screenCoordToNearPlaneB
-		(
-			right, 0.0f, 0.0f, 0.0f,
-			0.0f, top, 0.0f, 0.0f,
-			0.0f, 0.0f, 1.0f, 0.0f,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-		matrix4x4 screenCoordToNearPlaneA
-		(
-			2.0f / (screenWidth - 1.0f), 0.0f, 0.0f, -1.0f,
-			0.0f, -2.0f / (screenHeight - 1.0f), 0.0f, +1.0f,
-			0.0f, 0.0f, 0.0f, -nearClipPlaneDistance,
-			0.0f, 0.0f, 0.0f, 1.0f
-		);
-
-		matrix4x4 transform;
-		matrix4x4_mul(screenCoordToNearPlaneB, screenCoordToNearPlaneA, transform);
+		RayGenerator rayGenerator(*m_Camera, m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight());
 
 		float* currentFrameBufferPosition = m_FrameBuffer->GetData();
 
@@ -81,23 +45,13 @@ namespace Raytracer
 				if (x == (screenWidth * 0.5f) && y == (screenHeight * 0.5f))
 					debugManager.SetEnabled(false);
 
-				vector4 screenCoord((float)x, (float)y, 0.0f, 1.0f);
-				vector4 cameraSpaceDirection;
-
-				matrix4x4_vectorMul(transform, screenCoord, cameraSpaceDirection);
-				vector4_setToVector(cameraSpaceDirection);
-
-				matrix4x4_vectorMul(rotationMatrix, cameraSpaceDirection, cameraSpaceDirection);
-				vector4_normalize(cameraSpaceDirection);
-
-				// Transfer position and direction across to ray.
 				ray worldSpaceRay;
-				worldSpaceRay.setPosition(m_Camera->GetPosition());
-				worldSpaceRay.setDirection(cameraSpaceDirection);
+				rayGenerator.GenerateRay((float)x, (float)y, worldSpaceRay);
 
 				// Intersect world with ray.
-				float t;
-				m_Scene->Trace(worldSpaceRay, &t, currentFrameBufferPosition);
+				HitRecord hitRecord;
+				if (m_Scene->Trace(worldSpaceRay, hitRecord))
+					m_Scene->Shade(hitRecord, currentFrameBufferPosition);
 
 				currentFrameBufferPosition += 4;
 
@@ -1,4 +1,6 @@
 #include "BasicScene.h"
+#include "TraversalStatistics.h"
+#include <cassert>
 
 namespace Raytracer
 {
@@ -6,24 +8,26 @@ namespace Raytracer
 	{
 	}
 
-	bool BasicScene::Trace(const ray& intersectionRay, float* t, float* results) const
+	bool BasicScene::Trace(const ray& intersectionRay, HitRecord& hitRecord) const
 	{
-		*t = FLT_MAX;
+		hitRecord.m_T = FLT_MAX;
 
 		bool intersectionFound = false;
 
+		RAYTRACER_COUNT(m_RaysTraced, 1);
+		RAYTRACER_COUNT(m_ElementsTested, m_Elements.size());
+
 		// Naive implementation simply traces through every object in the scene. 
-		for (const ITraceable* currentElement : m_Elements)
+		for (unsigned int i = 0; i < m_Elements.size(); i++)
 		{
-			float currentT;
-			float currentInstanceResults[4];
+			HitRecord currentHitRecord;
 
-			if (currentElement->Trace(intersectionRay, &currentT, currentInstanceResults))
+			if (m_Elements[i]->Trace(intersectionRay, currentHitRecord))
 			{
-				if (currentT < *t)
+				if (currentHitRecord.m_T < hitRecord.m_T)
 				{
-					memcpy(results, currentInstanceResults, sizeof(float) * 4);
-					*t = currentT;
+					hitRecord = currentHitRecord;
+					hitRecord.m_InstanceId = i;
 				}
 
 				intersectionFound = true;
@@ -33,6 +37,74 @@ namespace Raytracer
 		return intersectionFound;
 	}
 
+	uint32_t BasicScene::TracePacket(const RayPacket& packet, HitRecord* hitRecords) const
+	{
+		for (unsigned int i = 0; i < packet.m_Size; i++)
+			hitRecords[i].m_T = FLT_MAX;
+
+		uint32_t hitMask = 0;
+
+		unsigned int numActiveRays = RayPacket::CountRays(packet.m_ActiveMask);
+		RAYTRACER_COUNT(m_RaysTraced, numActiveRays);
+		RAYTRACER_COUNT(m_ElementsTested, m_Elements.size() * numActiveRays);
+
+		// Each element traces the whole packet, so the elements can share work between rays.
+		for (unsigned int e = 0; e < m_Elements.size(); e++)
+		{
+			HitRecord currentHitRecords[RayPacket::MaxSize];
+
+			uint32_t currentHitMask = m_Elements[e]->TracePacket(packet, currentHitRecords);
+
+			for (unsigned int i = 0; i < packet.m_Size; i++)
+			{
+				if (0 == (currentHitMask & (1u << i)) || currentHitRecords[i].m_T >= hitRecords[i].m_T)
+					continue;
+
+				hitRecords[i] = currentHitRecords[i];
+				hitRecords[i].m_InstanceId = e;
+			}
+
+			hitMask |= currentHitMask;
+		}
+
+		return hitMask;
+	}
+
+	bool BasicScene::Occluded(const ray& intersectionRay, float tMax) const
+	{
+		RAYTRACER_COUNT(m_RaysTraced, 1);
+
+		for (const ITraceable* currentElement : m_Elements)
+		{
+			RAYTRACER_COUNT(m_ElementsTested, 1);
+
+			if (currentElement->Occluded(intersectionRay, tMax))
+				return true;
+		}
+
+		return false;
+	}
+
+	void BasicScene::Shade(const HitRecord& hitRecord, float* results) const
+	{
+		assert(hitRecord.m_InstanceId < m_Elements.size());
+		m_Elements[hitRecord.m_InstanceId]->Shade(hitRecord, results);
+	}
+
+	void BasicScene::ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const
+	{
+		if (0 == numHits)
+			return;
+
+		assert(hitRecords[0].m_InstanceId < m_Elements.size());
+		m_Elements[hitRecords[0].m_InstanceId]->ShadeBatch(hitRecords, numHits, results);
+	}
+
+	unsigned int BasicScene::GetNumElements() const
+	{
+		return (unsigned int)m_Elements.size();
+	}
+
 	void BasicScene::AddTraceable(ITraceable& traceable)
 	{
 		m_Elements.push_back(&traceable);
@@ -42,4 +114,4 @@ namespace Raytracer
 	{
 		m_Elements.clear();
 	}
-}
+}
\ No newline at end of file
@@ -15,7 +15,17 @@ namespace Raytracer
 
 		BasicScene();
 
-		bool Trace(const ray& intersectionRay, float* t, float* results) const override;
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override;
+
+		uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const override;
+
+		bool Occluded(const ray& intersectionRay, float tMax) const override;
+
+		void Shade(const HitRecord& hitRecord, float* results) const override;
+
+		void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const override;
+
+		unsigned int GetNumElements() const override;
 
 		void AddTraceable(ITraceable& traceable) override;
 
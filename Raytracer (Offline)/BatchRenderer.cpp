@@ -0,0 +1,347 @@
+#include "BatchRenderer.h"
+#include "AdaptiveRaytracer.h"
+#include "FrameBuffer.h"
+#include "HighPerformanceTimer.h"
+#include "Mailbox.h"
+#include "ProgressiveRaytracer.h"
+#include "TiledRaytracer.h"
+#include <Camera.h>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+using namespace Core;
+using namespace std;
+using CameraLib::Camera;
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// <summary>Parses count comma separated floats, e.g. "1,2.5,-3".</summary>
+		bool ParseFloats(const string& value, float* results, unsigned count)
+		{
+			istringstream stream(value);
+
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (i > 0 && stream.get() != ',')
+					return false;
+
+				if (!(stream >> results[i]))
+					return false;
+			}
+
+			return stream.peek() == char_traits<char>::eof();
+		}
+
+		template <typename ValueType>
+		bool ParseValue(const string& value, ValueType& result)
+		{
+			// Streams wrap negative values around when reading unsigned types, rather than failing.
+			if (!numeric_limits<ValueType>::is_signed && string::npos != value.find('-'))
+				return false;
+
+			istringstream stream(value);
+			return (stream >> result) && stream.peek() == char_traits<char>::eof();
+		}
+
+		string EscapeJson(const string& value)
+		{
+			string result;
+
+			for (char character : value)
+			{
+				if ('"' == character || '\\' == character)
+					result += '\\';
+
+				result += character;
+			}
+
+			return result;
+		}
+	}
+
+	RenderJob::RenderJob() :
+		m_Width(1280),
+		m_Height(720),
+		m_YFov(60.0f),
+		m_NearClipPlaneDistance(0.01f),
+		m_Raytracer("tiled"),
+		m_NumThreads(0),
+		m_TimeBudget(0.0),
+		m_WriteHeatmap(false),
+		m_Mailboxing(false),
+		m_EntryPointSearch(true)
+	{
+		m_Position[0] = 0.0f;
+		m_Position[1] = 0.0f;
+		m_Position[2] = 0.0f;
+
+		m_Rotation[0] = 0.0f;
+		m_Rotation[1] = 0.0f;
+	}
+
+	BatchRenderer::BatchRenderer() :
+		m_SceneBuildTime(0.0)
+	{
+	}
+
+	bool BatchRenderer::LoadJobFile(const string& fileName)
+	{
+		ifstream file(fileName);
+		if (!file)
+		{
+			fprintf(stderr, "Error: Unable to open job file [%s]\n", fileName.c_str());
+			return false;
+		}
+
+		stringstream contents;
+		contents << file.rdbuf();
+
+		return ParseJobs(contents.str());
+	}
+
+	bool BatchRenderer::ParseJobs(const string& jobDescriptions)
+	{
+		istringstream lines(jobDescriptions);
+		string line;
+		unsigned lineNumber = 0;
+
+		while (getline(lines, line))
+		{
+			lineNumber++;
+
+			istringstream tokens(line);
+			string token;
+
+			if (!(tokens >> token) || '#' == token[0])
+				continue;
+
+			bool isDefaults = "defaults" == token;
+
+			RenderJob job = m_Defaults;
+			if (!isDefaults)
+				tokens.seekg(0);
+
+			while (tokens >> token)
+			{
+				size_t separator = token.find('=');
+
+				if (string::npos == separator || !ParseJobProperty(token.substr(0, separator), token.substr(separator + 1), job))
+				{
+					fprintf(stderr, "Error: Invalid job property [%s] on line %u\n", token.c_str(), lineNumber);
+					return false;
+				}
+			}
+
+			if (isDefaults)
+			{
+				// Names and output files identify a single job, so they are never inherited.
+				job.m_Name.clear();
+				job.m_OutputFileName.clear();
+
+				m_Defaults = job;
+				continue;
+			}
+
+			if (job.m_Name.empty())
+				job.m_Name = "job" + to_string(m_Jobs.size());
+
+			if (job.m_OutputFileName.empty())
+				job.m_OutputFileName = job.m_Name + ".tga";
+
+			m_Jobs.push_back(job);
+		}
+
+		return true;
+	}
+
+	bool BatchRenderer::ParseJobProperty(const string& key, const string& value, RenderJob& job) const
+	{
+		if ("name" == key)
+			job.m_Name = value;
+		else if ("output" == key)
+			job.m_OutputFileName = value;
+		else if ("width" == key)
+			return ParseValue(value, job.m_Width) && job.m_Width > 1 && job.m_Width <= RenderJob::MaxImageSize;
+		else if ("height" == key)
+			return ParseValue(value, job.m_Height) && job.m_Height > 1 && job.m_Height <= RenderJob::MaxImageSize;
+		else if ("position" == key)
+			return ParseFloats(value, job.m_Position, 3);
+		else if ("rotation" == key)
+			return ParseFloats(value, job.m_Rotation, 2);
+		else if ("fov" == key)
+			return ParseValue(value, job.m_YFov);
+		else if ("near" == key)
+			return ParseValue(value, job.m_NearClipPlaneDistance);
+		else if ("threads" == key)
+			return ParseValue(value, job.m_NumThreads) && job.m_NumThreads <= RenderJob::MaxThreads;
+		else if ("budget" == key)
+			return ParseValue(value, job.m_TimeBudget) && job.m_TimeBudget >= 0.0;
+		else if ("heatmap" == key)
+			return ParseValue(value, job.m_WriteHeatmap);
+		else if ("mailbox" == key)
+			return ParseValue(value, job.m_Mailboxing);
+		else if ("entrysearch" == key)
+			return ParseValue(value, job.m_EntryPointSearch);
+		else if ("raytracer" == key)
+		{
+			job.m_Raytracer = value;
+			return "tiled" == value || "progressive" == value || "adaptive" == value;
+		}
+		else
+			return false;
+
+		return !value.empty();
+	}
+
+	const vector<RenderJob>& BatchRenderer::GetJobs() const
+	{
+		return m_Jobs;
+	}
+
+	void BatchRenderer::SetSceneBuildTime(double milliseconds)
+	{
+		m_SceneBuildTime = milliseconds;
+	}
+
+	void BatchRenderer::Render(IScene& scene)
+	{
+		m_Timings.clear();
+
+		for (size_t i = 0; i < m_Jobs.size(); i++)
+		{
+			printf("Rendering job %u of %u [%s]\n", (unsigned)i + 1, (unsigned)m_Jobs.size(), m_Jobs[i].m_Name.c_str());
+			m_Timings.push_back(RenderSingleJob(m_Jobs[i], scene));
+		}
+	}
+
+	const vector<RenderJobTimings>& BatchRenderer::GetTimings() const
+	{
+		return m_Timings;
+	}
+
+	RenderJobTimings BatchRenderer::RenderSingleJob(const RenderJob& job, IScene& scene) const
+	{
+		FrameBuffer frameBuffer(job.m_Width, job.m_Height);
+
+		Camera camera;
+		camera.SetPosition(job.m_Position[0], job.m_Position[1], job.m_Position[2]);
+		camera.SetCameraYFov(job.m_YFov);
+		camera.ResetCameraOrientation();
+		camera.RotateXAxis(job.m_Rotation[0]);
+		camera.RotateYAxis(job.m_Rotation[1]);
+		camera.SetNearClipPlaneDistance(job.m_NearClipPlaneDistance);
+		camera.Update();
+
+		unique_ptr<TiledRaytracer> raytracer;
+		if ("progressive" == job.m_Raytracer)
+		{
+			auto progressiveRaytracer = new ProgressiveRaytracer(&frameBuffer, &camera, &scene);
+			progressiveRaytracer->SetTimeBudget(job.m_TimeBudget);
+			raytracer.reset(progressiveRaytracer);
+		}
+		else if ("adaptive" == job.m_Raytracer)
+			raytracer.reset(new AdaptiveRaytracer(&frameBuffer, &camera, &scene));
+		else
+			raytracer.reset(new TiledRaytracer(&frameBuffer, &camera, &scene));
+
+		raytracer->SetNumThreads(job.m_NumThreads);
+		raytracer->SetEntryPointSearch(job.m_EntryPointSearch);
+
+		unique_ptr<FrameBuffer> heatmapFrameBuffer;
+		if (job.m_WriteHeatmap)
+		{
+			heatmapFrameBuffer.reset(new FrameBuffer(job.m_Width, job.m_Height));
+			raytracer->SetHeatmapFrameBuffer(heatmapFrameBuffer.get());
+		}
+
+		RenderJobTimings timings;
+		HighPerformanceTimer timer;
+
+		SetMailboxingEnabled(job.m_Mailboxing);
+
+		timer.Start();
+		raytracer->Raytrace();
+		timer.Stop();
+
+		SetMailboxingEnabled(false);
+		timings.m_TraceTime = (double)timer.GetTimeMilliseconds();
+		timings.m_Statistics = raytracer->GetFrameStatistics();
+
+		timer.Start();
+		frameBuffer.SaveAsTga(job.m_OutputFileName);
+		timer.Stop();
+		timings.m_SaveTime = (double)timer.GetTimeMilliseconds();
+
+		if (heatmapFrameBuffer)
+		{
+			string heatmapFileName = job.m_OutputFileName;
+			size_t extension = heatmapFileName.rfind(".tga");
+			if (string::npos != extension)
+				heatmapFileName.erase(extension);
+
+			heatmapFrameBuffer->SaveAsTga(heatmapFileName + "_heatmap.tga");
+		}
+
+		return timings;
+	}
+
+	string BatchRenderer::FormatTimings() const
+	{
+		ostringstream json;
+
+		json << "{\n";
+		json << "\t\"sceneBuildMilliseconds\": " << m_SceneBuildTime << ",\n";
+		json << "\t\"jobs\": [";
+
+		for (size_t i = 0; i < m_Timings.size(); i++)
+		{
+			const RenderJob& job = m_Jobs[i];
+			const RenderJobTimings& timings = m_Timings[i];
+
+			json << (i > 0 ? "," : "") << "\n\t\t{\n";
+			json << "\t\t\t\"name\": \"" << EscapeJson(job.m_Name) << "\",\n";
+			json << "\t\t\t\"output\": \"" << EscapeJson(job.m_OutputFileName) << "\",\n";
+			json << "\t\t\t\"raytracer\": \"" << job.m_Raytracer << "\",\n";
+			json << "\t\t\t\"width\": " << job.m_Width << ",\n";
+			json << "\t\t\t\"height\": " << job.m_Height << ",\n";
+			json << "\t\t\t\"mailbox\": " << (job.m_Mailboxing ? "true" : "false") << ",\n";
+			json << "\t\t\t\"entryPointSearch\": " << (job.m_EntryPointSearch ? "true" : "false") << ",\n";
+			json << "\t\t\t\"traceMilliseconds\": " << timings.m_TraceTime << ",\n";
+			json << "\t\t\t\"saveMilliseconds\": " << timings.m_SaveTime << ",\n";
+			json << "\t\t\t\"raysTraced\": " << timings.m_Statistics.m_RaysTraced << ",\n";
+			json << "\t\t\t\"elementsTested\": " << timings.m_Statistics.m_ElementsTested << ",\n";
+			json << "\t\t\t\"nodesVisited\": " << timings.m_Statistics.m_NodesVisited << ",\n";
+			json << "\t\t\t\"aabbTests\": " << timings.m_Statistics.m_AABBTests << ",\n";
+			json << "\t\t\t\"leavesVisited\": " << timings.m_Statistics.m_LeavesVisited << ",\n";
+			json << "\t\t\t\"triangleTests\": " << timings.m_Statistics.m_TriangleTests << ",\n";
+			json << "\t\t\t\"mailboxSkips\": " << timings.m_Statistics.m_MailboxSkips << "\n";
+			json << "\t\t}";
+		}
+
+		json << "\n\t]\n}\n";
+
+		return json.str();
+	}
+
+	bool BatchRenderer::WriteTimings(const string& fileName) const
+	{
+		FILE* file;
+		fopen_s(&file, fileName.c_str(), "w");
+		if (nullptr == file)
+		{
+			fprintf(stderr, "Error: Unable to create file [%s] for writing\n", fileName.c_str());
+			return false;
+		}
+
+		string json = FormatTimings();
+		fwrite(json.c_str(), 1, json.size(), file);
+		fclose(file);
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "TraversalStatistics.h"
+#include <string>
+#include <vector>
+
+namespace Raytracer
+{
+	class IScene;
+
+	/// <summary>
+	/// Describes a single frame to be rendered by the BatchRenderer.
+	/// </summary>
+	struct RenderJob
+	{
+		/// Largest width and height of a frame. TGA files store them in 16 bits, and the offsets of the
+		/// elements of a frame buffer this size still fit in 32 bits.
+		static const unsigned MaxImageSize = 16384;
+
+		static const unsigned MaxThreads = 256;
+
+		RenderJob();
+
+		std::string m_Name;
+		std::string m_OutputFileName;
+
+		unsigned m_Width;
+		unsigned m_Height;
+
+		float m_Position[3];
+
+		/// <summary>Rotation of the camera in degrees, applied around the x axis first and then the y axis.</summary>
+		float m_Rotation[2];
+
+		float m_YFov;
+		float m_NearClipPlaneDistance;
+
+		/// <summary>One of "tiled", "progressive" or "adaptive".</summary>
+		std::string m_Raytracer;
+
+		/// <summary>Number of threads to render with, 0 uses every hardware thread.</summary>
+		unsigned m_NumThreads;
+
+		/// <summary>Time budget in milliseconds of the progressive raytracer, 0 is unlimited.</summary>
+		double m_TimeBudget;
+
+		/// <summary>
+		/// Whether to save a traversal cost heatmap next to the output, e.g. frame_heatmap.tga, see
+		/// TiledRaytracer::SetHeatmapFrameBuffer.
+		/// </summary>
+		bool m_WriteHeatmap;
+
+		/// <summary>Whether single rays skip triangles they were already tested against, see TriangleMailbox.</summary>
+		bool m_Mailboxing;
+
+		/// <summary>
+		/// Whether each tile's primary rays start at the entry node of the tile's beam, see
+		/// TiledRaytracer::SetEntryPointSearch.
+		/// </summary>
+		bool m_EntryPointSearch;
+	};
+
+	/// <summary>
+	/// Timings recorded while rendering a job.
+	/// </summary>
+	struct RenderJobTimings
+	{
+		double m_TraceTime;
+		double m_SaveTime;
+
+		TraversalStatistics m_Statistics;
+	};
+
+	/// <summary>
+	/// Renders a list of jobs read from a job file against a single scene, so that the scene's acceleration
+	/// structures are built once and reused by every job.
+	///
+	/// Each line of a job file describes one job as whitespace separated key=value pairs, e.g.
+	///     name=front output=front.tga width=1280 height=720 position=-5,7,0 rotation=-30,-30 raytracer=tiled
+	/// Keys which are not specified take the values of the most recent line starting with "defaults", which
+	/// uses the same syntax. Empty lines and lines starting with '#' are ignored.
+	/// </summary>
+	class BatchRenderer
+	{
+	public:
+
+		BatchRenderer();
+
+		/// <summary>
+		/// Reads the jobs from the specified file, appending them to the job list. Returns false and prints
+		/// the offending line if the file cannot be read or parsed.
+		/// </summary>
+		bool LoadJobFile(const std::string& fileName);
+
+		/// <summary>
+		/// Parses the jobs from the contents of a job file. Returns false if any line cannot be parsed.
+		/// </summary>
+		bool ParseJobs(const std::string& jobDescriptions);
+
+		const std::vector<RenderJob>& GetJobs() const;
+
+		/// <summary>
+		/// Records the time taken to prepare the scene, which is reported alongside the job timings.
+		/// </summary>
+		void SetSceneBuildTime(double milliseconds);
+
+		/// <summary>
+		/// Renders every job against the scene and saves the results to their output files.
+		/// </summary>
+		void Render(IScene& scene);
+
+		const std::vector<RenderJobTimings>& GetTimings() const;
+
+		/// <summary>
+		/// Writes the timings of the rendered jobs to the specified file as JSON.
+		/// </summary>
+		bool WriteTimings(const std::string& fileName) const;
+
+		/// <summary>
+		/// Formats the timings of the rendered jobs as JSON.
+		/// </summary>
+		std::string FormatTimings() const;
+
+	protected:
+
+		RenderJob m_Defaults;
+		std::vector<RenderJob> m_Jobs;
+		std::vector<RenderJobTimings> m_Timings;
+
+		double m_SceneBuildTime;
+
+		/// <summary>Sets a single property of the job. Returns false if the key or value are invalid.</summary>
+		bool ParseJobProperty(const std::string& key, const std::string& value, RenderJob& job) const;
+
+		/// <summary>Renders a single job, returning the time taken to render and save it.</summary>
+		RenderJobTimings RenderSingleJob(const RenderJob& job, IScene& scene) const;
+	};
+}
\ No newline at end of file
@@ -13,7 +13,7 @@ namespace Raytracer
 		virtual ~BoundedTraceable();
 
 		/// ITraceable implementation begin.
-		virtual bool Trace(const ray& intersectionRay, float* t, float* results) const = 0;
+		virtual bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const = 0;
 		/// ITraceable implementation end.
 
 		/// <summary>Return an immutable pointer to the min/max extents of the bounding volume.</summary>
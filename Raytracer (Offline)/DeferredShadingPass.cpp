@@ -0,0 +1,71 @@
+#include "DeferredShadingPass.h"
+#include "IScene.h"
+#include <cassert>
+#include <cstring>
+
+namespace Raytracer
+{
+	DeferredShadingPass::DeferredShadingPass()
+	{
+	}
+
+	void DeferredShadingPass::AddHit(const HitRecord& hitRecord, float* target)
+	{
+		m_HitRecords.push_back(hitRecord);
+		m_Targets.push_back(target);
+	}
+
+	void DeferredShadingPass::Shade(const IScene& scene)
+	{
+		unsigned int numHits = (unsigned int)m_HitRecords.size();
+		if (0 == numHits)
+			return;
+
+		unsigned int numInstances = scene.GetNumElements();
+
+		// Counting sort the hits by instance ID so that each instance's hits are contiguous.
+		m_InstanceOffsets.assign(numInstances + 1, 0);
+		for (const HitRecord& hitRecord : m_HitRecords)
+		{
+			assert(hitRecord.m_InstanceId < numInstances);
+			m_InstanceOffsets[hitRecord.m_InstanceId + 1]++;
+		}
+
+		for (unsigned int i = 0; i < numInstances; i++)
+			m_InstanceOffsets[i + 1] += m_InstanceOffsets[i];
+
+		m_SortedHitRecords.resize(numHits);
+		m_SortedTargets.resize(numHits);
+		m_Colors.resize(numHits * 4);
+
+		m_InsertPositions.assign(m_InstanceOffsets.begin(), m_InstanceOffsets.end() - 1);
+		for (unsigned int i = 0; i < numHits; i++)
+		{
+			unsigned int position = m_InsertPositions[m_HitRecords[i].m_InstanceId]++;
+
+			m_SortedHitRecords[position] = m_HitRecords[i];
+			m_SortedTargets[position] = m_Targets[i];
+		}
+
+		// Shade each instance's hits as a single batch.
+		for (unsigned int i = 0; i < numInstances; i++)
+		{
+			unsigned int batchBegin = m_InstanceOffsets[i];
+			unsigned int batchSize = m_InstanceOffsets[i + 1] - batchBegin;
+
+			if (batchSize > 0)
+				scene.ShadeBatch(&m_SortedHitRecords[batchBegin], batchSize, &m_Colors[batchBegin * 4]);
+		}
+
+		for (unsigned int i = 0; i < numHits; i++)
+			memcpy(m_SortedTargets[i], &m_Colors[i * 4], sizeof(float) * 4);
+
+		m_HitRecords.clear();
+		m_Targets.clear();
+	}
+
+	unsigned int DeferredShadingPass::GetNumPendingHits() const
+	{
+		return (unsigned int)m_HitRecords.size();
+	}
+}
\ No newline at end of file
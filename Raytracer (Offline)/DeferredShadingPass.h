@@ -0,0 +1,46 @@
+#pragma once
+
+#include "HitRecord.h"
+#include <vector>
+
+namespace Raytracer
+{
+	class IScene;
+
+	/// <summary>
+	/// Collects hit records and shades them in a separate pass once tracing is complete.
+	/// Hits are grouped by instance before shading so that each element of the scene shades all of
+	/// its hits in a single batch, rather than shading being interleaved with traversal.
+	/// </summary>
+	class DeferredShadingPass
+	{
+	public:
+
+		DeferredShadingPass();
+
+		/// <summary>
+		/// Queues a hit to be shaded. The resulting RGBA colour is written to the four floats at target.
+		/// </summary>
+		void AddHit(const HitRecord& hitRecord, float* target);
+
+		/// <summary>
+		/// Shades every queued hit, then clears the queue.
+		/// </summary>
+		void Shade(const IScene& scene);
+
+		/// <summary>Returns the number of hits waiting to be shaded.</summary>
+		unsigned int GetNumPendingHits() const;
+
+	protected:
+
+		std::vector<HitRecord> m_HitRecords;
+		std::vector<float*> m_Targets;
+
+		/// Scratch buffers reused between passes to avoid reallocating.
+		std::vector<unsigned int> m_InstanceOffsets;
+		std::vector<unsigned int> m_InsertPositions;
+		std::vector<HitRecord> m_SortedHitRecords;
+		std::vector<float*> m_SortedTargets;
+		std::vector<float> m_Colors;
+	};
+}
\ No newline at end of file
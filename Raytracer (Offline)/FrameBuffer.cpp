@@ -67,7 +67,7 @@ namespace Raytracer
 	{
 		FreeMemory();
 
-		m_Data = reinterpret_cast<float*>(MemoryAllocatorAligned::Allocate(m_Width * m_Height * 4 * sizeof(float)));
+		m_Data = reinterpret_cast<float*>(MemoryAllocatorAligned::Allocate((size_t)m_Width * m_Height * 4 * sizeof(float)));
 	}
 
 	void FrameBuffer::FreeMemory()
@@ -84,7 +84,7 @@ namespace Raytracer
 
 		memcpy(reinterpret_cast<void*>(m_Data),
 			   reinterpret_cast<void*>(other.m_Data),
-			   m_Width * m_Height * 4 * sizeof(float));
+			   (size_t)m_Width * m_Height * 4 * sizeof(float));
 	}
 
 	float* FrameBuffer::GetData() const
@@ -142,8 +142,8 @@ namespace Raytracer
 		fwrite(&imageDescriptor, sizeof(imageDescriptor), 1, file);
 
 		// Now we can write out the image itself.
-		size_t imageDataLength = m_Width * m_Height * 4;
-		size_t imageStride = m_Width * 4;
+		size_t imageDataLength = (size_t)m_Width * m_Height * 4;
+		size_t imageStride = (size_t)m_Width * 4;
 
 		// Convert data.
 		auto buffer = new uint8_t[imageDataLength];
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <map>
 #include <string>
 #include <GenericAlgorithms.h>
@@ -18,11 +19,21 @@ namespace Raytracer
 	{
 	public:
 
+		/// Creates the geometry of a mesh loaded from the mesh database.
+		typedef std::function<GeomType*(const string& id, const Assets::StaticMesh& mesh)> Factory;
+
 		GeomType& operator[](const string& id);
 
+		/// <summary>
+		/// Sets the function creating geometry which is not loaded yet. By default it is constructed from the mesh alone.
+		/// </summary>
+		void SetFactory(const Factory& factory);
+
 	protected:
 
 		map<string, GeomType*> m_Geometry;
+
+		Factory m_Factory;
 	};
 
 	template <typename GeomType>
@@ -37,7 +48,7 @@ namespace Raytracer
 			auto& meshManager = MeshManager::GetInstance();
 			auto meshData = meshManager.GetMesh(id);
 
-			auto newElement = new GeomType(*meshData);
+			auto newElement = m_Factory ? m_Factory(id, *meshData) : new GeomType(*meshData);
 			m_Geometry[id] = newElement;
 
 			delete meshData;
@@ -45,4 +56,10 @@ namespace Raytracer
 
 		return *m_Geometry[id];
 	}
+
+	template <typename GeomType>
+	void GeometryCollection<GeomType>::SetFactory(const Factory& factory)
+	{
+		m_Factory = factory;
+	}
 }
\ No newline at end of file
@@ -42,7 +42,7 @@ namespace Raytracer
 		Update();
 	}
 
-	bool GeometryInstance::Trace(const ray& intersectionRay, float* t, float* results) const
+	bool GeometryInstance::Trace(const ray& intersectionRay, HitRecord& hitRecord) const
 	{
 		auto& debugManager = DebugManager::GetInstance();
 
@@ -60,33 +60,125 @@ namespace Raytracer
 		if (debugManager.GetEnabled())
 			debugManager.AddTransform(m_ObjectToWorld);
 
-		float objectSpaceT;
-		float intersectionResults[4];
-
-		bool intersectionFound = m_Geometry.Trace(intersectionRayObjectSpace, &objectSpaceT,
-			intersectionResults);
+		bool intersectionFound = m_Geometry.Trace(intersectionRayObjectSpace, hitRecord);
 		if (intersectionFound)
 		{
-			results[0] = intersectionResults[0];
-			results[1] = intersectionResults[1];
-			results[2] = intersectionResults[2];
-			results[3] = intersectionResults[3];
-
 			// Need to calculate intersection point in object space, then transform back into
 			// world space to get world space distance from ray.
 			vector4 objectSpaceIntersectionPoint;
-			vector4_addScaledVector(rayPosition, rayDirection, objectSpaceT, 
+			vector4_addScaledVector(rayPosition, rayDirection, hitRecord.m_T, 
 				objectSpaceIntersectionPoint);
 
 			matrix4x4_vectorMul(m_ObjectToWorld, objectSpaceIntersectionPoint, 
 				objectSpaceIntersectionPoint);
 
-			*t = vector4_distance(objectSpaceIntersectionPoint, intersectionRay.getPosition());
+			hitRecord.m_T = vector4_distance(objectSpaceIntersectionPoint, intersectionRay.getPosition());
 		}
 
 		return intersectionFound;
 	}
 
+	uint32_t GeometryInstance::TracePacket(const RayPacket& packet, HitRecord* hitRecords) const
+	{
+		auto& debugManager = DebugManager::GetInstance();
+
+		// Transform the whole packet into object space up front so that the geometry can trace
+		// the rays together.
+		RayPacket objectSpacePacket(packet.m_Size);
+		objectSpacePacket.m_ActiveMask = packet.m_ActiveMask;
+
+		for (unsigned int i = 0; i < packet.m_Size; i++)
+		{
+			if (!packet.IsActive(i))
+				continue;
+
+			vector4 rayPosition;
+			matrix4x4_vectorMul(m_WorldToObject, packet.m_Rays[i].getPosition(), rayPosition);
+
+			vector4 rayDirection;
+			matrix4x4_vectorMul(m_WorldToObject, packet.m_Rays[i].getDirection(), rayDirection);
+			vector4_normalize(rayDirection);
+
+			objectSpacePacket.m_Rays[i].setPosition(rayPosition);
+			objectSpacePacket.m_Rays[i].setDirection(rayDirection);
+		}
+
+		// The beam is transformed along with its rays. Its entry nodes in this instance's space are cached
+		// apart from those of other instances of the same geometry.
+		RayBeam objectSpaceBeam;
+		if (nullptr != packet.m_Beam)
+		{
+			matrix4x4_vectorMul(m_WorldToObject, packet.m_Beam->m_Origin, objectSpaceBeam.m_Origin);
+
+			for (unsigned int i = 0; i < 4; i++)
+				matrix4x4_vectorMul(m_WorldToObject, packet.m_Beam->m_Corners[i], objectSpaceBeam.m_Corners[i]);
+
+			objectSpaceBeam.m_EntryCache = packet.m_Beam->m_EntryCache;
+			objectSpaceBeam.m_Space = this;
+
+			objectSpacePacket.m_Beam = &objectSpaceBeam;
+		}
+
+		if (debugManager.GetEnabled())
+			debugManager.AddTransform(m_ObjectToWorld);
+
+		uint32_t hitMask = m_Geometry.TracePacket(objectSpacePacket, hitRecords);
+
+		for (unsigned int i = 0; i < packet.m_Size; i++)
+		{
+			if (0 == (hitMask & (1u << i)))
+				continue;
+
+			const ray& objectSpaceRay = objectSpacePacket.m_Rays[i];
+
+			// Need to calculate intersection point in object space, then transform back into
+			// world space to get world space distance from ray.
+			vector4 objectSpaceIntersectionPoint;
+			vector4_addScaledVector(objectSpaceRay.getPosition(), objectSpaceRay.getDirection(), hitRecords[i].m_T,
+				objectSpaceIntersectionPoint);
+
+			matrix4x4_vectorMul(m_ObjectToWorld, objectSpaceIntersectionPoint,
+				objectSpaceIntersectionPoint);
+
+			hitRecords[i].m_T = vector4_distance(objectSpaceIntersectionPoint, packet.m_Rays[i].getPosition());
+		}
+
+		return hitMask;
+	}
+
+	bool GeometryInstance::Occluded(const ray& intersectionRay, float tMax) const
+	{
+		vector4 rayPosition;
+		matrix4x4_vectorMul(m_WorldToObject, intersectionRay.getPosition(), rayPosition);
+
+		vector4 rayDirection;
+		matrix4x4_vectorMul(m_WorldToObject, intersectionRay.getDirection(), rayDirection);
+
+		// The object space direction is normalized, so tMax has to be scaled by the change in length
+		// of the direction to cover the same segment of the ray.
+		float objectSpaceTMax = tMax;
+		if (tMax < FLT_MAX)
+			objectSpaceTMax *= vector4_magnitude(rayDirection);
+
+		vector4_normalize(rayDirection);
+
+		ray intersectionRayObjectSpace;
+		intersectionRayObjectSpace.setPosition(rayPosition);
+		intersectionRayObjectSpace.setDirection(rayDirection);
+
+		return m_Geometry.Occluded(intersectionRayObjectSpace, objectSpaceTMax);
+	}
+
+	void GeometryInstance::Shade(const HitRecord& hitRecord, float* results) const
+	{
+		m_Geometry.Shade(hitRecord, results);
+	}
+
+	void GeometryInstance::ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const
+	{
+		m_Geometry.ShadeBatch(hitRecords, numHits, results);
+	}
+
 	void GeometryInstance::Update()
 	{
 		// Recalculate matrices.
@@ -34,7 +34,15 @@ namespace Raytracer
 
 		/// BoundedTraceable implementation begin.
 
-		virtual bool Trace(const ray& intersectionRay, float* t, float* results) const override;
+		virtual bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override;
+
+		virtual uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const override;
+
+		virtual bool Occluded(const ray& intersectionRay, float tMax) const override;
+
+		virtual void Shade(const HitRecord& hitRecord, float* results) const override;
+
+		virtual void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const override;
 
 		/// BoundedTraceable implementation end.
 
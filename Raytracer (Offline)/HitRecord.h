@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// The result of an intersection query. Hit records hold just enough information to shade the
+	/// intersection point later, so traversal never pays for shading candidates which are discarded.
+	/// </summary>
+	struct HitRecord
+	{
+		static const uint32_t InvalidId = 0xffffffff;
+
+		/// <summary>Distance along the ray to the intersection point.</summary>
+		float m_T;
+
+		/// <summary>Barycentric coordinates of the intersection point on the primitive.</summary>
+		float m_U;
+		float m_V;
+
+		/// <summary>Index of the intersected primitive within its geometry.</summary>
+		uint32_t m_PrimitiveId;
+
+		/// <summary>Index of the intersected element within the scene.</summary>
+		uint32_t m_InstanceId;
+	};
+}
\ No newline at end of file
@@ -1,3 +1,7 @@
+#pragma once
+
+#include "HitRecord.h"
+#include "RayPacket.h"
 #include <MathLib.h>
 
 using namespace MathLib;
@@ -18,13 +22,45 @@ namespace Raytracer
 		/// </summary>
 		/// <param name="geometry">Geometry containing the kd tree to traverse.</param>
 		/// <param name="intersectionRay">The ray to intersect.</param>
-		/// <param name="index">If successful, will store the correct triangle's index in the address specified.</param>
-		/// <param name="t">If successful, will store the t value of the correct triangle. Used to generate the intersection point.</param>
-		/// <param name="u">If successful, will store the barycentric u value of the correct triangle. Used to shade the intersection point.</param>
-		/// <param name="v">If successful, will store the barycentric v value of the correct triangle. Used to shade the intersection point.</param>
+		/// <param name="hitRecord">
+		/// If successful, will store the t value, barycentric coordinates and index of the correct triangle.
+		/// The instance ID is left untouched.
+		/// </param>
 		/// <return>
 		/// True if an intersection was found, false if not.
 		/// </return>
-		virtual bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned int* index, float* t, float* u, float* v) = 0;
+		virtual bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord) = 0;
+
+		/// <summary>
+		/// Determines whether the ray intersects any triangle in the range [0, tMax).
+		/// The default implementation performs a closest hit traversal; implementations should override this to
+		/// stop at the first intersection found.
+		/// </summary>
+		virtual bool TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax)
+		{
+			HitRecord hitRecord;
+			return Traverse(geometry, intersectionRay, hitRecord) && hitRecord.m_T >= 0.0f && hitRecord.m_T < tMax;
+		}
+
+		/// <summary>
+		/// Traverses the generated kd tree with every active ray of the packet. hitRecords is indexed by the
+		/// ray's position in the packet, and is only written for rays which intersect a triangle.
+		/// The default implementation traverses the tree once per active ray.
+		/// </summary>
+		/// <return>
+		/// A mask with bit i set if ray i intersected a triangle.
+		/// </return>
+		virtual uint32_t TraversePacket(const KdTreeGeometry& geometry, const RayPacket& packet, HitRecord* hitRecords)
+		{
+			uint32_t hitMask = 0;
+
+			for (unsigned int i = 0; i < packet.m_Size; i++)
+			{
+				if (packet.IsActive(i) && Traverse(geometry, packet.m_Rays[i], hitRecords[i]))
+					hitMask |= 1u << i;
+			}
+
+			return hitMask;
+		}
 	};
 }
\ No newline at end of file
@@ -17,7 +17,26 @@ namespace Raytracer
 	{
 	public:
 
-		virtual bool Trace(const ray& intersectionRay, float* t, float* results) const = 0;
+		virtual bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const = 0;
+
+		virtual uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const = 0;
+
+		virtual bool Occluded(const ray& intersectionRay, float tMax) const = 0;
+
+		/// <summary>
+		/// Shades a hit record returned by this scene by forwarding it to the intersected element.
+		/// </summary>
+		virtual void Shade(const HitRecord& hitRecord, float* results) const = 0;
+
+		/// <summary>
+		/// Shades a batch of hit records which all share the same instance ID.
+		/// </summary>
+		virtual void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const = 0;
+
+		/// <summary>
+		/// Returns the number of elements in the scene. Instance IDs are in the range [0, GetNumElements()).
+		/// </summary>
+		virtual unsigned int GetNumElements() const = 0;
 
 		virtual void AddTraceable(ITraceable& traceable) = 0;
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "HitRecord.h"
+#include "RayPacket.h"
 #include <MathLib.h>
 
 using namespace MathLib;
@@ -10,6 +12,51 @@ namespace Raytracer
 	{
 	public:
 
-		virtual bool Trace(const ray& intersectionRay, float* t, float* results) const = 0;
+		/// <summary>
+		/// Finds the closest intersection of the ray with this traceable. The contents of the hit record
+		/// are undefined if no intersection is found.
+		/// </summary>
+		virtual bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const = 0;
+
+		/// <summary>
+		/// Traces every active ray of the packet. hitRecords is indexed by the ray's position in the packet,
+		/// and is only meaningful for rays which intersect this traceable.
+		/// The default implementation traces each active ray individually.
+		/// </summary>
+		/// <return>
+		/// A mask with bit i set if ray i intersected this traceable.
+		/// </return>
+		virtual uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const
+		{
+			uint32_t hitMask = 0;
+
+			for (unsigned int i = 0; i < packet.m_Size; i++)
+			{
+				if (packet.IsActive(i) && Trace(packet.m_Rays[i], hitRecords[i]))
+					hitMask |= 1u << i;
+			}
+
+			return hitMask;
+		}
+
+		/// <summary>
+		/// Determines whether anything intersects the ray in the range [0, tMax). Unlike Trace this may stop at
+		/// the first intersection found, so it is the cheaper query for shadow and visibility rays.
+		/// </summary>
+		virtual bool Occluded(const ray& intersectionRay, float tMax) const = 0;
+
+		/// <summary>
+		/// Calculates the RGBA colour of an intersection previously returned by this traceable.
+		/// </summary>
+		virtual void Shade(const HitRecord& hitRecord, float* results) const = 0;
+
+		/// <summary>
+		/// Shades a batch of intersections with this traceable, writing four floats per hit to results.
+		/// </summary>
+		virtual void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const
+		{
+			for (unsigned int i = 0; i < numHits; i++)
+				Shade(hitRecords[i], results + i * 4);
+		}
 	};
 }
\ No newline at end of file
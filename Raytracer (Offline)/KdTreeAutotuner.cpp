@@ -0,0 +1,368 @@
+#include "KdTreeAutotuner.h"
+#include "HighPerformanceTimer.h"
+#include "HitRecord.h"
+#include "KdTreeCompact.h"
+#include <CommonDefines.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+using namespace Core;
+using namespace std;
+
+namespace Raytracer
+{
+	namespace
+	{
+		template <typename ValueType>
+		bool ParseValue(const string& value, ValueType& result)
+		{
+			// Streams wrap negative values around when reading unsigned types, rather than failing.
+			if (!numeric_limits<ValueType>::is_signed && string::npos != value.find('-'))
+				return false;
+
+			istringstream stream(value);
+			return (stream >> result) && stream.peek() == char_traits<char>::eof();
+		}
+
+		/// <summary>
+		/// Creates rays starting on a sphere around the geometry, each aimed at a random point inside its bounds.
+		/// A fixed seed gives every candidate the same rays.
+		/// </summary>
+		vector<ray> CreateSampleRays(const KdTreeGeometry& geometry, unsigned numRays)
+		{
+			const vector4& boundsMin = geometry.GetBounds()[AABB_EXTENTS_MIN];
+			const vector4& boundsMax = geometry.GetBounds()[AABB_EXTENTS_MAX];
+
+			vector4 center;
+			vector4_add(boundsMin, boundsMax, center);
+			vector4_scale(center, 0.5f, center);
+
+			vector4 halfExtents;
+			vector4_sub(boundsMax, boundsMin, halfExtents);
+			vector4_scale(halfExtents, 0.5f, halfExtents);
+
+			float radius = 2.0f * sqrtf(halfExtents[0] * halfExtents[0] + halfExtents[1] * halfExtents[1] +
+				halfExtents[2] * halfExtents[2]);
+
+			mt19937 generator(1);
+			uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+			vector<ray> rays;
+			rays.reserve(numRays);
+
+			while (rays.size() < numRays)
+			{
+				vector4 offset(distribution(generator), distribution(generator), distribution(generator), 0.0f);
+				if (vector4_dotProduct(offset, offset) < 1e-6f)
+					continue;
+
+				vector4_normalize(offset);
+
+				vector4 position;
+				vector4_addScaledVector(center, offset, radius, position);
+				position.setW(1.0f);
+
+				vector4 target;
+				for (int axis = 0; axis < 3; axis++)
+					target[axis] = center[axis] + distribution(generator) * halfExtents[axis];
+				target.setW(1.0f);
+
+				vector4 direction;
+				vector4_sub(target, position, direction);
+				vector4_normalize(direction);
+
+				ray sampleRay;
+				sampleRay.setPosition(position);
+				sampleRay.setDirection(direction);
+				rays.push_back(sampleRay);
+			}
+
+			return rays;
+		}
+
+		/// <summary>
+		/// Returns the time taken to trace the rays, in milliseconds. They are traced twice and the faster time
+		/// kept, to reduce the noise of a single measurement.
+		/// </summary>
+		long double TimeSampleRays(const KdTreeGeometry& geometry, const vector<ray>& rays)
+		{
+			long double bestTime = DBL_MAX;
+
+			for (int run = 0; run < 2; run++)
+			{
+				HighPerformanceTimer timer;
+				timer.Start();
+
+				for (auto& sampleRay : rays)
+				{
+					HitRecord hitRecord;
+					geometry.Trace(sampleRay, hitRecord);
+				}
+
+				timer.Stop();
+
+				if (timer.GetTimeMilliseconds() < bestTime)
+					bestTime = timer.GetTimeMilliseconds();
+			}
+
+			return bestTime;
+		}
+
+		/// <summary>
+		/// Determines whether trees can be built to the maximum depth, which is 0 to derive it from the number
+		/// of triangles. Builders limit deeper trees to what traversal stacks hold, so greater depths cannot be
+		/// the ones tuned.
+		/// </summary>
+		bool IsValidMaxDepth(unsigned maxDepth)
+		{
+			return maxDepth < KdTreeCompact::MaxDepth;
+		}
+	}
+
+	KdTreeAutotuner::KdTreeAutotuner() :
+		m_NumSampleRays(10000)
+	{
+		m_MaxDepths.push_back(16);
+		m_MaxDepths.push_back(20);
+		m_MaxDepths.push_back(24);
+
+		m_MaxTriangles.push_back(4);
+		m_MaxTriangles.push_back(8);
+		m_MaxTriangles.push_back(16);
+
+		m_TraversalCosts.push_back(4.0f);
+		m_TraversalCosts.push_back(8.0f);
+		m_TraversalCosts.push_back(16.0f);
+	}
+
+	bool KdTreeAutotuner::SetMaxDepths(const vector<unsigned>& maxDepths)
+	{
+		for (auto maxDepth : maxDepths)
+		{
+			if (!IsValidMaxDepth(maxDepth))
+				return false;
+		}
+
+		m_MaxDepths = maxDepths;
+		return true;
+	}
+
+	bool KdTreeAutotuner::SetMaxTriangles(const vector<unsigned>& maxTriangles)
+	{
+		for (auto triangles : maxTriangles)
+		{
+			if (0 == triangles)
+				return false;
+		}
+
+		m_MaxTriangles = maxTriangles;
+		return true;
+	}
+
+	bool KdTreeAutotuner::SetTraversalCosts(const vector<float>& traversalCosts)
+	{
+		for (auto traversalCost : traversalCosts)
+		{
+			if (!(traversalCost > 0.0f))
+				return false;
+		}
+
+		m_TraversalCosts = traversalCosts;
+		return true;
+	}
+
+	void KdTreeAutotuner::SetBaseParameters(const KdTreeBuildParameters& baseParameters)
+	{
+		m_BaseParameters = baseParameters;
+	}
+
+	void KdTreeAutotuner::SetNumSampleRays(unsigned numSampleRays)
+	{
+		m_NumSampleRays = numSampleRays;
+	}
+
+	KdTreeBuildParameters KdTreeAutotuner::Tune(const StaticMesh& mesh) const
+	{
+		string treeCacheDirectory = KdTreeGeometry::GetTreeCacheDirectory();
+		KdTreeGeometry::SetTreeCacheDirectory("");
+
+		KdTreeBuildParameters bestParameters = m_BaseParameters;
+		long double bestTime = DBL_MAX;
+
+		vector<ray> sampleRays;
+
+		for (auto maxDepth : m_MaxDepths)
+		{
+			for (auto maxTriangles : m_MaxTriangles)
+			{
+				for (auto traversalCost : m_TraversalCosts)
+				{
+					KdTreeBuildParameters parameters = m_BaseParameters;
+					parameters.m_MaxDepth = maxDepth;
+					parameters.m_MaxTriangles = maxTriangles;
+					parameters.m_CostModel.m_TraversalCost = traversalCost;
+
+					KdTreeGeometry geometry(mesh, parameters);
+
+					if (sampleRays.empty())
+						sampleRays = CreateSampleRays(geometry, m_NumSampleRays);
+
+					long double time = TimeSampleRays(geometry, sampleRays);
+
+					printf("Autotune max depth %u, max triangles %u, traversal cost %4.2f: %4.2Lf msecs\n", maxDepth,
+						maxTriangles, traversalCost, time);
+
+					if (time < bestTime)
+					{
+						bestTime = time;
+						bestParameters = parameters;
+					}
+				}
+			}
+		}
+
+		KdTreeGeometry::SetTreeCacheDirectory(treeCacheDirectory);
+
+		return bestParameters;
+	}
+
+	const KdTreeBuildParameters& KdTreeAutotuner::GetParameters(const string& meshId, const StaticMesh& mesh)
+	{
+		auto result = m_Results.find(meshId);
+		if (result != m_Results.end())
+			return result->second;
+
+		printf("Autotuning kd tree of mesh [%s]\n", meshId.c_str());
+
+		return m_Results[meshId] = Tune(mesh);
+	}
+
+	bool KdTreeAutotuner::FindParameters(const string& meshId, KdTreeBuildParameters& parameters) const
+	{
+		auto result = m_Results.find(meshId);
+		if (result == m_Results.end())
+			return false;
+
+		parameters = result->second;
+		return true;
+	}
+
+	bool KdTreeAutotuner::LoadResults(const string& fileName)
+	{
+		ifstream file(fileName);
+		if (!file)
+		{
+			fprintf(stderr, "Error: Unable to open autotune results file [%s]\n", fileName.c_str());
+			return false;
+		}
+
+		stringstream contents;
+		contents << file.rdbuf();
+
+		return ParseResults(contents.str());
+	}
+
+	bool KdTreeAutotuner::ParseResults(const string& results)
+	{
+		istringstream lines(results);
+		string line;
+		unsigned lineNumber = 0;
+
+		while (getline(lines, line))
+		{
+			lineNumber++;
+
+			istringstream tokens(line);
+			string meshId;
+
+			if (!(tokens >> meshId) || '#' == meshId[0])
+				continue;
+
+			KdTreeBuildParameters parameters;
+			string token;
+
+			while (tokens >> token)
+			{
+				size_t separator = token.find('=');
+
+				if (string::npos == separator || !ParseParameter(token.substr(0, separator), token.substr(separator + 1), parameters))
+				{
+					fprintf(stderr, "Error: Invalid autotune parameter [%s] on line %u\n", token.c_str(), lineNumber);
+					return false;
+				}
+			}
+
+			m_Results[meshId] = parameters;
+		}
+
+		return true;
+	}
+
+	bool KdTreeAutotuner::ParseParameter(const string& key, const string& value, KdTreeBuildParameters& parameters) const
+	{
+		if ("maxDepth" == key)
+			return ParseValue(value, parameters.m_MaxDepth) && IsValidMaxDepth(parameters.m_MaxDepth);
+		else if ("maxTriangles" == key)
+			return ParseValue(value, parameters.m_MaxTriangles) && parameters.m_MaxTriangles > 0;
+		else if ("traversalCost" == key)
+			return ParseValue(value, parameters.m_CostModel.m_TraversalCost) && parameters.m_CostModel.m_TraversalCost > 0.0f;
+		else if ("intersectionCost" == key)
+			return ParseValue(value, parameters.m_CostModel.m_IntersectionCost) && parameters.m_CostModel.m_IntersectionCost > 0.0f;
+		else if ("emptyBonus" == key)
+			return ParseValue(value, parameters.m_CostModel.m_EmptyBonus) && parameters.m_CostModel.m_EmptyBonus >= 0.0f &&
+				parameters.m_CostModel.m_EmptyBonus < 1.0f;
+		else if ("perfectSplits" == key)
+			return ParseValue(value, parameters.m_PerfectSplits);
+		else if ("maxDuplication" == key)
+			return ParseValue(value, parameters.m_MaxDuplication) && parameters.m_MaxDuplication >= 0.0f;
+		else if ("memoryBudget" == key)
+			return ParseValue(value, parameters.m_MemoryBudget);
+
+		return false;
+	}
+
+	bool KdTreeAutotuner::SaveResults(const string& fileName) const
+	{
+		FILE* file;
+		fopen_s(&file, fileName.c_str(), "w");
+		if (nullptr == file)
+		{
+			fprintf(stderr, "Error: Unable to create file [%s] for writing\n", fileName.c_str());
+			return false;
+		}
+
+		string results = FormatResults();
+		fwrite(results.c_str(), 1, results.size(), file);
+		fclose(file);
+
+		return true;
+	}
+
+	string KdTreeAutotuner::FormatResults() const
+	{
+		ostringstream results;
+
+		for (auto& result : m_Results)
+		{
+			const KdTreeBuildParameters& parameters = result.second;
+
+			results << result.first;
+			results << " maxDepth=" << parameters.m_MaxDepth;
+			results << " maxTriangles=" << parameters.m_MaxTriangles;
+			results << " traversalCost=" << parameters.m_CostModel.m_TraversalCost;
+			results << " intersectionCost=" << parameters.m_CostModel.m_IntersectionCost;
+			results << " emptyBonus=" << parameters.m_CostModel.m_EmptyBonus;
+			results << " perfectSplits=" << (parameters.m_PerfectSplits ? 1 : 0);
+			results << " maxDuplication=" << parameters.m_MaxDuplication;
+			results << " memoryBudget=" << parameters.m_MemoryBudget;
+			results << "\n";
+		}
+
+		return results.str();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "KdTreeGeometry.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Finds the kd tree build parameters which trace a mesh fastest. A tree is built with every combination
+	/// of the swept maximum depths, leaf sizes and traversal costs, and a fixed sample of rays is timed against
+	/// each. The winning parameters are stored per mesh ID, and can be saved so later runs reuse them.
+	///
+	/// A results file holds one mesh per line, its ID followed by key=value pairs, e.g.
+	///     monkey maxDepth=20 maxTriangles=8 traversalCost=4 intersectionCost=1 emptyBonus=0.2 perfectSplits=1
+	/// Empty lines and lines starting with '#' are ignored.
+	/// </summary>
+	class KdTreeAutotuner
+	{
+	public:
+
+		KdTreeAutotuner();
+
+		/// <summary>
+		/// Sets the values swept. Returns false, keeping the previous values, if any is invalid: depths must be
+		/// below KdTreeCompact::MaxDepth, leaf sizes above 0 and traversal costs positive.
+		/// </summary>
+		bool SetMaxDepths(const std::vector<unsigned>& maxDepths);
+		bool SetMaxTriangles(const std::vector<unsigned>& maxTriangles);
+		bool SetTraversalCosts(const std::vector<float>& traversalCosts);
+
+		/// <summary>
+		/// Sets the parameters which are not swept, i.e. perfect splits, the intersection cost, the empty bonus
+		/// and the build limits.
+		/// </summary>
+		void SetBaseParameters(const KdTreeBuildParameters& baseParameters);
+
+		void SetNumSampleRays(unsigned numSampleRays);
+
+		/// <summary>
+		/// Builds the mesh's tree with every candidate parameters, and returns those tracing the sample rays
+		/// in the least time. Candidate trees are kept out of the tree cache.
+		/// </summary>
+		KdTreeBuildParameters Tune(const StaticMesh& mesh) const;
+
+		/// <summary>
+		/// Returns the stored parameters of the mesh, tuning and storing them first if there are none.
+		/// </summary>
+		const KdTreeBuildParameters& GetParameters(const std::string& meshId, const StaticMesh& mesh);
+
+		/// <summary>
+		/// Looks up the stored parameters of the mesh. Returns false if it has not been tuned.
+		/// </summary>
+		bool FindParameters(const std::string& meshId, KdTreeBuildParameters& parameters) const;
+
+		/// <summary>
+		/// Reads tuned parameters from the specified file, adding them to those stored. Returns false if the
+		/// file cannot be read or parsed.
+		/// </summary>
+		bool LoadResults(const std::string& fileName);
+
+		/// <summary>
+		/// Parses tuned parameters from the contents of a results file. Returns false if any line cannot be parsed.
+		/// </summary>
+		bool ParseResults(const std::string& results);
+
+		/// <summary>
+		/// Writes the stored parameters to the specified file.
+		/// </summary>
+		bool SaveResults(const std::string& fileName) const;
+
+		std::string FormatResults() const;
+
+	protected:
+
+		std::vector<unsigned> m_MaxDepths;
+		std::vector<unsigned> m_MaxTriangles;
+		std::vector<float> m_TraversalCosts;
+
+		KdTreeBuildParameters m_BaseParameters;
+
+		unsigned m_NumSampleRays;
+
+		std::map<std::string, KdTreeBuildParameters> m_Results;
+
+		/// <summary>Sets a single parameter. Returns false if the key or value are invalid.</summary>
+		bool ParseParameter(const std::string& key, const std::string& value, KdTreeBuildParameters& parameters) const;
+	};
+}
\ No newline at end of file
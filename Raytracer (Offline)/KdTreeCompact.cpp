@@ -0,0 +1,302 @@
+#include "KdTreeCompact.h"
+#include "KdTreeNode.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+using namespace std;
+
+namespace Raytracer
+{
+	namespace
+	{
+		const uint32_t TreeFileMagic = 0x4354444b;	// "KDTC"
+
+		/// Changed whenever the layout of the file or of its nodes changes, invalidating saved trees.
+		const uint32_t TreeFileVersion = 1;
+
+		/// <summary>
+		/// Header of a saved tree. The node array follows it, then the triangle index array. Every field is
+		/// naturally aligned, and the header and nodes are multiples of 8 bytes long, so both arrays are
+		/// aligned for direct use in a mapped file.
+		/// </summary>
+		struct TreeFileHeader
+		{
+			uint32_t m_Magic;
+			uint32_t m_Version;
+			uint64_t m_Key;
+
+			uint32_t m_NumNodes;
+			uint32_t m_NumTriangleIndices;
+
+			float m_BoundingMin[4];
+			float m_BoundingMax[4];
+		};
+
+		static_assert(0 == sizeof(TreeFileHeader) % 8, "The nodes following the header must stay aligned.");
+
+		/// <summary>
+		/// Checks that every node of a loaded tree refers to nodes and triangle indices within its arrays, that
+		/// every triangle index refers to one of the mesh's triangles, and that the tree is no deeper than
+		/// traversal stacks allow, so that a corrupt file cannot make traversal read outside of them.
+		/// </summary>
+		bool ValidateTree(const KdTreeCompactNode* nodes, unsigned numNodes, const unsigned* triangleIndices,
+			unsigned numTriangleIndices, unsigned numTriangles)
+		{
+			for (unsigned i = 0; i < numTriangleIndices; i++)
+			{
+				if (triangleIndices[i] >= numTriangles)
+					return false;
+			}
+
+			// Children always follow their parent, so each node's depth is known before its children are reached.
+			vector<unsigned> depths(numNodes, 0);
+
+			for (unsigned i = 0; i < numNodes; i++)
+			{
+				const KdTreeCompactNode& node = nodes[i];
+
+				if (depths[i] >= KdTreeCompact::MaxDepth)
+					return false;
+
+				if (node.IsLeaf())
+				{
+					if ((uint64_t)node.m_FirstTriangle + node.GetNumTriangles() > numTriangleIndices)
+						return false;
+
+					continue;
+				}
+
+				// The child below the split is the next node, so the child above it comes after that child.
+				unsigned aboveChild = node.GetAboveChild();
+				if (aboveChild <= i + 1 || aboveChild >= numNodes)
+					return false;
+
+				depths[i + 1] = max(depths[i + 1], depths[i] + 1);
+				depths[aboveChild] = max(depths[aboveChild], depths[i] + 1);
+			}
+
+			return true;
+		}
+	}
+
+	KdTreeCompact::KdTreeCompact() :
+		m_Nodes(nullptr),
+		m_NumNodes(0),
+		m_TriangleIndices(nullptr),
+		m_NumTriangleIndices(0)
+	{
+		m_BoundingMin.setXYZW(0.0f, 0.0f, 0.0f, 1.0f);
+		m_BoundingMax.setXYZW(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+
+	bool KdTreeCompact::Build(const KdTreeNode& rootNode)
+	{
+		Clear();
+
+		vector4_copy(m_BoundingMin, rootNode.GetBoundingMin());
+		vector4_copy(m_BoundingMax, rootNode.GetBoundingMax());
+
+		unsigned rootIndex;
+		if (!FlattenNode(rootNode, 0, rootIndex))
+		{
+			Clear();
+			return false;
+		}
+
+		m_Nodes = m_NodeStorage.data();
+		m_NumNodes = (unsigned)m_NodeStorage.size();
+
+		m_TriangleIndices = m_TriangleIndexStorage.data();
+		m_NumTriangleIndices = (unsigned)m_TriangleIndexStorage.size();
+
+		return true;
+	}
+
+	void KdTreeCompact::Clear()
+	{
+		m_NodeStorage.clear();
+		m_TriangleIndexStorage.clear();
+		m_MappedFile.Close();
+
+		m_Nodes = nullptr;
+		m_NumNodes = 0;
+
+		m_TriangleIndices = nullptr;
+		m_NumTriangleIndices = 0;
+	}
+
+	bool KdTreeCompact::Save(const std::string& fileName, uint64_t key) const
+	{
+		assert(!IsEmpty());
+
+		TreeFileHeader header;
+		header.m_Magic = TreeFileMagic;
+		header.m_Version = TreeFileVersion;
+		header.m_Key = key;
+		header.m_NumNodes = m_NumNodes;
+		header.m_NumTriangleIndices = m_NumTriangleIndices;
+
+		for (int axis = 0; axis < 4; axis++)
+		{
+			header.m_BoundingMin[axis] = m_BoundingMin[axis];
+			header.m_BoundingMax[axis] = m_BoundingMax[axis];
+		}
+
+		// The tree is written next to the file and renamed once complete, so that a partially written tree is
+		// never found under the file's name, even if the process stops while writing it.
+		std::string temporaryFileName = fileName + ".tmp";
+
+		FILE* file = nullptr;
+		fopen_s(&file, temporaryFileName.c_str(), "wb");
+		if (nullptr == file)
+			return false;
+
+		bool written =
+			1 == fwrite(&header, sizeof(header), 1, file) &&
+			m_NumNodes == fwrite(m_Nodes, sizeof(KdTreeCompactNode), m_NumNodes, file) &&
+			m_NumTriangleIndices == fwrite(m_TriangleIndices, sizeof(unsigned), m_NumTriangleIndices, file);
+
+		written = (0 == fclose(file)) && written;
+
+		// rename does not replace an existing file on every platform.
+		if (written)
+		{
+			remove(fileName.c_str());
+			written = 0 == rename(temporaryFileName.c_str(), fileName.c_str());
+		}
+
+		if (!written)
+			remove(temporaryFileName.c_str());
+
+		return written;
+	}
+
+	bool KdTreeCompact::Load(const std::string& fileName, uint64_t key, unsigned numTriangles)
+	{
+		Clear();
+
+		if (!m_MappedFile.Open(fileName))
+			return false;
+
+		size_t fileSize = m_MappedFile.GetSize();
+		auto data = static_cast<const uint8_t*>(m_MappedFile.GetData());
+		auto header = reinterpret_cast<const TreeFileHeader*>(data);
+
+		bool valid =
+			fileSize >= sizeof(TreeFileHeader) &&
+			TreeFileMagic == header->m_Magic &&
+			TreeFileVersion == header->m_Version &&
+			key == header->m_Key &&
+			header->m_NumNodes > 0 &&
+			fileSize == sizeof(TreeFileHeader) + (size_t)header->m_NumNodes * sizeof(KdTreeCompactNode) +
+				(size_t)header->m_NumTriangleIndices * sizeof(unsigned);
+
+		if (!valid)
+		{
+			m_MappedFile.Close();
+			return false;
+		}
+
+		auto nodes = reinterpret_cast<const KdTreeCompactNode*>(data + sizeof(TreeFileHeader));
+		auto triangleIndices = reinterpret_cast<const unsigned*>(nodes + header->m_NumNodes);
+
+		if (!ValidateTree(nodes, header->m_NumNodes, triangleIndices, header->m_NumTriangleIndices, numTriangles))
+		{
+			m_MappedFile.Close();
+			return false;
+		}
+
+		m_BoundingMin.setXYZW(header->m_BoundingMin[0], header->m_BoundingMin[1], header->m_BoundingMin[2], header->m_BoundingMin[3]);
+		m_BoundingMax.setXYZW(header->m_BoundingMax[0], header->m_BoundingMax[1], header->m_BoundingMax[2], header->m_BoundingMax[3]);
+
+		// The arrays are used in place, straight from the mapped file.
+		m_Nodes = nodes;
+		m_NumNodes = header->m_NumNodes;
+
+		m_TriangleIndices = triangleIndices;
+		m_NumTriangleIndices = header->m_NumTriangleIndices;
+
+		return true;
+	}
+
+	bool KdTreeCompact::IsEmpty() const
+	{
+		return 0 == m_NumNodes;
+	}
+
+	const KdTreeCompactNode* KdTreeCompact::GetNodes() const
+	{
+		return m_Nodes;
+	}
+
+	unsigned KdTreeCompact::GetNumNodes() const
+	{
+		return m_NumNodes;
+	}
+
+	const unsigned* KdTreeCompact::GetTriangleIndices() const
+	{
+		return m_TriangleIndices;
+	}
+
+	unsigned KdTreeCompact::GetNumTriangleIndices() const
+	{
+		return m_NumTriangleIndices;
+	}
+
+	const vector4& KdTreeCompact::GetBoundingMin() const
+	{
+		return m_BoundingMin;
+	}
+
+	const vector4& KdTreeCompact::GetBoundingMax() const
+	{
+		return m_BoundingMax;
+	}
+
+	bool KdTreeCompact::FlattenNode(const KdTreeNode& node, unsigned depth, unsigned& nodeIndex)
+	{
+		// Traversal stacks hold one entry per level above the deepest leaf.
+		if (depth >= MaxDepth)
+			return false;
+
+		nodeIndex = (unsigned)m_NodeStorage.size();
+		m_NodeStorage.push_back(KdTreeCompactNode());
+
+		if (node.IsChild())
+		{
+			unsigned numTriangles = node.GetNumTriangles();
+			if (numTriangles >= MaxIndex)
+				return false;
+
+			KdTreeCompactNode& leaf = m_NodeStorage[nodeIndex];
+			leaf.m_Flags = (numTriangles << 2) | KdTreeCompactNode::LeafFlag;
+			leaf.m_FirstTriangle = (uint32_t)m_TriangleIndexStorage.size();
+
+			m_TriangleIndexStorage.insert(m_TriangleIndexStorage.end(), node.GetTriangleList(), node.GetTriangleList() + numTriangles);
+
+			return true;
+		}
+
+		// The child below the split comes first.
+		unsigned axis = node.GetSplitAxis();
+
+		auto children = node.GetChildren();
+
+		unsigned belowChild;
+		unsigned aboveChild;
+		if (!FlattenNode(*children[0], depth + 1, belowChild) || !FlattenNode(*children[1], depth + 1, aboveChild) ||
+			aboveChild >= MaxIndex)
+		{
+			return false;
+		}
+
+		// The node array may have been reallocated while flattening the children.
+		KdTreeCompactNode& interior = m_NodeStorage[nodeIndex];
+		interior.m_Flags = (aboveChild << 2) | axis;
+		interior.m_Split = node.GetSplitPosition();
+
+		return true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <MathLib.h>
+#include <MemoryMappedFile.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace MathLib;
+using std::vector;
+
+namespace Raytracer
+{
+	class KdTreeNode;
+
+	/// <summary>
+	/// An 8 byte kd tree node. The child below an interior node's split directly follows it in the node
+	/// array, so only the index of the child above it is stored.
+	/// </summary>
+	struct KdTreeCompactNode
+	{
+		/// Value of the low bits of m_Flags for leaves. Interior nodes store their split axis there instead.
+		static const uint32_t LeafFlag = 3;
+
+		/// The low two bits hold the split axis, or LeafFlag for leaves. The remaining bits hold the index of
+		/// the child above the split for interior nodes, and the number of triangles for leaves.
+		uint32_t m_Flags;
+
+		union
+		{
+			/// Position of the split along its axis, for interior nodes.
+			float m_Split;
+
+			/// Index of the leaf's first triangle in the tree's triangle index array, for leaves.
+			uint32_t m_FirstTriangle;
+		};
+
+		bool IsLeaf() const
+		{
+			return LeafFlag == (m_Flags & 3);
+		}
+
+		unsigned GetAxis() const
+		{
+			return m_Flags & 3;
+		}
+
+		unsigned GetAboveChild() const
+		{
+			return m_Flags >> 2;
+		}
+
+		unsigned GetNumTriangles() const
+		{
+			return m_Flags >> 2;
+		}
+	};
+
+	static_assert(sizeof(KdTreeCompactNode) == 8, "Compact kd tree nodes must stay 8 bytes.");
+
+	/// <summary>
+	/// A kd tree flattened into one contiguous array of nodes in depth first order, with the triangle indices
+	/// of all leaves in a second array. Node bounds are not stored; traversal derives them from the root's
+	/// bounds and the splits.
+	///
+	/// The arrays contain no pointers, so they are saved to a file as they are, and traversed straight from
+	/// the mapped file when loaded again.
+	/// </summary>
+	class KdTreeCompact
+	{
+	public:
+
+		/// Number of levels of nodes a tree can have, so its leaves are at most MaxDepth - 1 splits below the
+		/// root. Traversal stacks are sized for this.
+		static const unsigned MaxDepth = 64;
+
+		/// Limit of the child indices and leaf triangle counts, which share m_Flags with two bits of flags.
+		static const unsigned MaxIndex = 1u << 30;
+
+		KdTreeCompact();
+
+		/// <summary>
+		/// Flattens the tree rooted at the specified node, replacing any tree flattened previously. Returns
+		/// false, leaving this tree empty, if the tree is deeper than MaxDepth allows or too large for the
+		/// node format.
+		/// </summary>
+		bool Build(const KdTreeNode& rootNode);
+
+		void Clear();
+
+		/// <summary>
+		/// Saves the tree to the specified file, tagged with a key identifying what it was built from.
+		/// Returns false if the file cannot be written.
+		/// </summary>
+		bool Save(const std::string& fileName, uint64_t key) const;
+
+		/// <summary>
+		/// Maps a tree saved by Save, replacing this tree. Returns false, leaving this tree empty, if the file
+		/// cannot be read, was saved with a different key, or is not a valid tree of a mesh with the specified
+		/// number of triangles.
+		/// </summary>
+		bool Load(const std::string& fileName, uint64_t key, unsigned numTriangles);
+
+		bool IsEmpty() const;
+
+		const KdTreeCompactNode* GetNodes() const;
+		unsigned GetNumNodes() const;
+
+		const unsigned* GetTriangleIndices() const;
+		unsigned GetNumTriangleIndices() const;
+
+		/// <summary>Returns the minimal extents of the root node's voxel.</summary>
+		const vector4& GetBoundingMin() const;
+
+		/// <summary>Returns the maximal extents of the root node's voxel.</summary>
+		const vector4& GetBoundingMax() const;
+
+	protected:
+
+		/// Storage of a tree built in memory. Loaded trees are stored in the mapped file instead.
+		vector<KdTreeCompactNode> m_NodeStorage;
+		vector<unsigned> m_TriangleIndexStorage;
+
+		Core::MemoryMappedFile m_MappedFile;
+
+		const KdTreeCompactNode* m_Nodes;
+		unsigned m_NumNodes;
+
+		const unsigned* m_TriangleIndices;
+		unsigned m_NumTriangleIndices;
+
+		vector4 m_BoundingMin;
+		vector4 m_BoundingMax;
+
+		/// <summary>
+		/// Appends the node and its subtree, returning the node's index. Returns false if the subtree cannot be
+		/// flattened.
+		/// </summary>
+		bool FlattenNode(const KdTreeNode& node, unsigned depth, unsigned& nodeIndex);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "KdTreeCompactTraversal.h"
+#include "KdTreeCompact.h"
+#include "KdTreeGeometry.h"
+#include "Mailbox.h"
+#include "TraversalLeaf.h"
+#include "TraversalRay.h"
+#include "TraversalStatistics.h"
+#include <Geometry.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+using namespace std;
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// <summary>
+		/// Lets VisitLeaves walk a compact tree. Below children directly follow their parent.
+		/// </summary>
+		struct CompactNodeAdapter
+		{
+			typedef const KdTreeCompactNode Node;
+			static const unsigned MaxDepth = KdTreeCompact::MaxDepth;
+
+			const KdTreeCompactNode* m_Nodes;
+
+			void Visit(const KdTreeCompactNode&) const
+			{
+			}
+
+			bool IsLeaf(const KdTreeCompactNode& node) const
+			{
+				return node.IsLeaf();
+			}
+
+			unsigned GetAxis(const KdTreeCompactNode& node) const
+			{
+				return node.GetAxis();
+			}
+
+			float GetSplit(const KdTreeCompactNode& node) const
+			{
+				return node.m_Split;
+			}
+
+			const KdTreeCompactNode* GetChild(const KdTreeCompactNode& node, bool above) const
+			{
+				return above ? &m_Nodes[node.GetAboveChild()] : &node + 1;
+			}
+		};
+	}
+
+	bool KdTreeCompactTraversal::Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord)
+	{
+		return TraverseFrom(geometry, intersectionRay, 0, hitRecord);
+	}
+
+	bool KdTreeCompactTraversal::TraverseFrom(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned startNode,
+		HitRecord& hitRecord)
+	{
+		const KdTreeCompact& tree = geometry.GetCompactTree();
+		if (tree.IsEmpty())
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tMin = 0.0f;
+		float tMax = FLT_MAX;
+
+		if (!ClipRayToBounds(traversalRay, tree.GetBoundingMin(), tree.GetBoundingMax(), tMin, tMax))
+		{
+			RAYTRACER_COUNT(m_NodesVisited, 1);
+			return false;
+		}
+
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+		auto triangleIndices = tree.GetTriangleIndices();
+
+		bool intersectionFound = false;
+		float closestT = FLT_MAX;
+
+		CompactNodeAdapter adapter = { tree.GetNodes() };
+
+		VisitLeaves(adapter, &adapter.m_Nodes[startNode], traversalRay, tMin, tMax, [&](const KdTreeCompactNode& leaf) -> float
+		{
+			if (IntersectLeafTriangles(intersectionRay, triangles, triangleIndices + leaf.m_FirstTriangle,
+				leaf.GetNumTriangles(), mailbox, closestT, hitRecord))
+				intersectionFound = true;
+
+			return closestT;
+		});
+
+		return intersectionFound;
+	}
+
+	bool KdTreeCompactTraversal::TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax)
+	{
+		const KdTreeCompact& tree = geometry.GetCompactTree();
+		if (tree.IsEmpty())
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tSegmentMin = 0.0f;
+		float tSegmentMax = tMax;
+
+		if (!ClipRayToBounds(traversalRay, tree.GetBoundingMin(), tree.GetBoundingMax(), tSegmentMin, tSegmentMax))
+		{
+			RAYTRACER_COUNT(m_NodesVisited, 1);
+			return false;
+		}
+
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+		auto triangleIndices = tree.GetTriangleIndices();
+
+		bool occluded = false;
+
+		CompactNodeAdapter adapter = { tree.GetNodes() };
+
+		VisitLeaves(adapter, adapter.m_Nodes, traversalRay, tSegmentMin, tSegmentMax, [&](const KdTreeCompactNode& leaf) -> float
+		{
+			if (!OccludedByLeafTriangles(intersectionRay, triangles, triangleIndices + leaf.m_FirstTriangle,
+				leaf.GetNumTriangles(), mailbox, tMax))
+				return FLT_MAX;
+
+			occluded = true;
+			return -FLT_MAX;
+		});
+
+		return occluded;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "IKdTreeTraversal.h"
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Traverses the compact form of a kd tree. The ray is clipped to the root voxel once, and each node then
+	/// only needs its split to divide the ray's interval between its children, so no node bounds are loaded.
+	/// </summary>
+	class KdTreeCompactTraversal : public IKdTreeTraversal
+	{
+	public:
+
+		/// - IKdTreeTraversal Implementation Begin -
+
+		bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord) override;
+
+		/// <summary>
+		/// Visits the leaves pierced by the ray in [0, tMax), stopping at the first triangle found in that range.
+		/// </summary>
+		bool TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax) override;
+
+		/// - IKdTreeTraversal Implementation End -
+
+		/// <summary>
+		/// Traverses the tree from the specified node of the compact tree rather than from the root. Every part of
+		/// the ray inside the root's voxel must lie inside the node's voxel, as for the entry node of a beam
+		/// enclosing the ray; see KdTreePacketTraversal::FindEntryNode.
+		/// </summary>
+		bool TraverseFrom(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned startNode,
+			HitRecord& hitRecord);
+	};
+}
\ No newline at end of file
@@ -1,11 +1,20 @@
 #include "KdTreeGeometry.h"
+#include "KdTreeCompactTraversal.h"
+#include "KdTreePacketTraversal.h"
+#include "KdTreeRopeTraversal.h"
 #include "KdTreeStackTraversal.h"
 #include "KdTreeNode.h"
 #include "NaiveSpatialMedian.h"
 #include "SAH.h"
+#include "SAHEventSweep.h"
+#include "SAHLazy.h"
+#include "DebugManager.h"
 #include <MemoryAllocatorAligned.h>
+#include <HighPerformanceTimer.h>
+#include <Hash.h>
 #include <Geometry.h>
 #include <cassert>
+#include <cstdio>
 
 using namespace MathLib;
 using namespace Assets;
@@ -13,8 +22,32 @@ using namespace Core;
 
 namespace Raytracer
 {
+	std::string KdTreeGeometry::s_TreeCacheDirectory;
+
+	KdTreeBuildParameters::KdTreeBuildParameters() :
+		m_MaxDepth(16),
+		m_MaxTriangles(16),
+		m_PerfectSplits(true),
+		m_MaxDuplication(0.0f),
+		m_MemoryBudget(0),
+		m_Lazy(false),
+		m_BuildRopes(false)
+	{
+	}
+
 	KdTreeGeometry::KdTreeGeometry(const StaticMesh& mesh) :
-		m_Triangles(nullptr)
+		m_Triangles(nullptr),
+		m_RootNode(nullptr),
+		m_TreeFromCache(false)
+	{
+		Initialize(mesh);
+	}
+
+	KdTreeGeometry::KdTreeGeometry(const StaticMesh& mesh, const KdTreeBuildParameters& buildParameters) :
+		m_Triangles(nullptr),
+		m_RootNode(nullptr),
+		m_BuildParameters(buildParameters),
+		m_TreeFromCache(false)
 	{
 		Initialize(mesh);
 	}
@@ -61,13 +94,113 @@ namespace Raytracer
 		// Calculate the bounding volume.
 		GeometryLib::CalculateBoundingVolume(vertexArray, numVertices, m_Bounds[AABB_EXTENTS_MIN], m_Bounds[AABB_EXTENTS_MAX]);
 
+		m_TreeFromCache = false;
+
+		// Only create the root of a lazily built tree; the rest is built while rays are traced.
+		if (m_BuildParameters.m_Lazy)
+		{
+			m_LazyBuilder.reset(new KdTreeConstruction::SAHLazy(m_BuildParameters.m_MaxDepth, m_BuildParameters.m_MaxTriangles));
+			m_LazyBuilder->SetPerfectSplits(m_BuildParameters.m_PerfectSplits);
+			m_LazyBuilder->SetCostModel(m_BuildParameters.m_CostModel);
+			m_LazyBuilder->Construct(*this);
+
+			printf("Kd tree for %u triangles will be built lazily\n", m_NumTriangles);
+			return;
+		}
+
+		// Load the kd tree from the cache if it has already been built for this mesh.
+
+		std::string cacheFileName;
+		uint64_t cacheKey = 0;
+
+		if (!s_TreeCacheDirectory.empty())
+		{
+			cacheKey = ComputeTreeCacheKey(mesh, m_BuildParameters);
+
+			char keyString[32];
+			sprintf_s(keyString, "%016llx", (unsigned long long)cacheKey);
+			cacheFileName = s_TreeCacheDirectory + "/kdtree_" + keyString + ".kdc";
+
+			if (m_CompactTree.Load(cacheFileName, cacheKey, m_NumTriangles))
+			{
+				printf("Kd tree loaded for %u triangles from %s\n", m_NumTriangles, cacheFileName.c_str());
+				m_TreeFromCache = true;
+
+				if (m_BuildParameters.m_BuildRopes)
+					m_Ropes.Build(m_CompactTree);
+
+				return;
+			}
+		}
+
 		// Construct the kd tree.
 		{
 			using namespace KdTreeConstruction;
 			//KdTreeConstruction::NaiveSpatialMedian kdTreeBuilder;
-			KdTreeConstruction::SAH kdTreeBuilder(16, 16);
+			//KdTreeConstruction::SAH kdTreeBuilder(16, 16);
+			KdTreeConstruction::SAHEventSweep kdTreeBuilder(m_BuildParameters.m_MaxDepth, m_BuildParameters.m_MaxTriangles);
+			kdTreeBuilder.SetPerfectSplits(m_BuildParameters.m_PerfectSplits);
+			kdTreeBuilder.SetCostModel(m_BuildParameters.m_CostModel);
+			kdTreeBuilder.SetMaxDuplication(m_BuildParameters.m_MaxDuplication);
+			kdTreeBuilder.SetMemoryBudget(m_BuildParameters.m_MemoryBudget);
+
+			HighPerformanceTimer timer;
+			timer.Start();
+
 			kdTreeBuilder.Construct(*this);
+
+			timer.Stop();
+
+			printf("Kd tree built for %u triangles: %4.2Lf msecs, expected cost %4.2f, duplication factor %4.2f, %llu bytes\n",
+				m_NumTriangles, timer.GetTimeMilliseconds(), kdTreeBuilder.GetExpectedCost(),
+				kdTreeBuilder.GetDuplicationFactor(), (unsigned long long)kdTreeBuilder.GetBytesUsed());
+
+			if (kdTreeBuilder.GetNumLimitedNodes() > 0)
+				printf("Kd tree build limits reached: %u nodes were made leaves early\n", kdTreeBuilder.GetNumLimitedNodes());
 		}
+
+		// Trees which could not be flattened have nothing to save.
+		if (!cacheFileName.empty() && !m_CompactTree.IsEmpty() && !m_CompactTree.Save(cacheFileName, cacheKey))
+			printf("Failed to save the kd tree to %s\n", cacheFileName.c_str());
+	}
+
+	void KdTreeGeometry::SetTreeCacheDirectory(const std::string& directory)
+	{
+		s_TreeCacheDirectory = directory;
+	}
+
+	const std::string& KdTreeGeometry::GetTreeCacheDirectory()
+	{
+		return s_TreeCacheDirectory;
+	}
+
+	uint64_t KdTreeGeometry::ComputeTreeCacheKey(const StaticMesh& mesh, const KdTreeBuildParameters& buildParameters)
+	{
+		uint64_t key = FNV1aOffsetBasis;
+
+		key = HashFNV1a(mesh.GetVertexArray(), (size_t)mesh.GetNumVertices() * 3 * sizeof(float), key);
+		key = HashFNV1a(mesh.GetIndexArray(), (size_t)mesh.GetNumIndices() * sizeof(uint32_t), key);
+
+		// Trees built by an older builder are rebuilt rather than loaded.
+		unsigned builderVersion = KdTreeConstruction::SAHEventSweep::Version;
+		key = HashFNV1aValue(builderVersion, key);
+
+		// The parameters are hashed field by field, as the padding between them is undefined.
+		key = HashFNV1aValue(buildParameters.m_MaxDepth, key);
+		key = HashFNV1aValue(buildParameters.m_MaxTriangles, key);
+		key = HashFNV1aValue(buildParameters.m_PerfectSplits, key);
+		key = HashFNV1aValue(buildParameters.m_MaxDuplication, key);
+		key = HashFNV1aValue((uint64_t)buildParameters.m_MemoryBudget, key);
+		key = HashFNV1aValue(buildParameters.m_CostModel.m_TraversalCost, key);
+		key = HashFNV1aValue(buildParameters.m_CostModel.m_IntersectionCost, key);
+		key = HashFNV1aValue(buildParameters.m_CostModel.m_EmptyBonus, key);
+
+		return key;
+	}
+
+	bool KdTreeGeometry::IsTreeFromCache() const
+	{
+		return m_TreeFromCache;
 	}
 
 	void KdTreeGeometry::FreeMemory()
@@ -81,48 +214,130 @@ namespace Raytracer
 		m_NumTriangles = 0;
 
 		ResetKdTree();
+		m_LazyBuilder.reset();
 	}
 
 	void KdTreeGeometry::ResetKdTree()
 	{
-		if (nullptr != m_RootNode)
-			delete m_RootNode;
-
+		// The nodes are freed along with the arena's blocks, without visiting them.
 		m_RootNode = nullptr;
+		m_KdTreeArena.Reset();
+		m_CompactTree.Clear();
+		m_Ropes.Clear();
+	}
+
+	void KdTreeGeometry::ReplaceKdTree(KdTreeNode* rootNode, Core::MemoryArena& arena)
+	{
+		ResetKdTree();
+
+		m_RootNode = rootNode;
+		m_KdTreeArena.TakeBlocks(arena);
+
+		// A lazily built tree keeps changing while rays are traced, so it is not flattened.
+		if (!m_RootNode->IsUnexpanded())
+		{
+			if (!m_CompactTree.Build(*m_RootNode))
+			{
+				printf("Kd tree is too deep or too large to flatten; its nodes are traversed instead\n");
+				return;
+			}
+
+			if (m_BuildParameters.m_BuildRopes)
+				m_Ropes.Build(m_CompactTree);
+		}
 	}
 
-	bool KdTreeGeometry::Trace(const ray& intersectionRay, float* t, float* results) const
+	bool KdTreeGeometry::Trace(const ray& intersectionRay, HitRecord& hitRecord) const
 	{
-		IKdTreeTraversal& traversalAlgorithm = KdTreeStackTraversal();
+		// Drawing the voxels visited needs their bounds, which only the node tree stores. Lazily built trees
+		// only have their node form.
+		if (m_CompactTree.IsEmpty() || (Debugging::DebugManager::GetInstance().GetEnabled() && nullptr != m_RootNode))
+		{
+			KdTreeStackTraversal nodeTraversalAlgorithm;
+			return nodeTraversalAlgorithm.Traverse(*this, intersectionRay, hitRecord);
+		}
 
-		float u;
-		float v;
-		unsigned int intersectedTriangleIndex;
+		if (!m_Ropes.IsEmpty())
+		{
+			KdTreeRopeTraversal ropeTraversalAlgorithm;
+			return ropeTraversalAlgorithm.Traverse(*this, intersectionRay, hitRecord);
+		}
 
-		if (traversalAlgorithm.Traverse(*this, intersectionRay, &intersectedTriangleIndex, t, &u, &v))
+		KdTreeCompactTraversal traversalAlgorithm;
+
+		return traversalAlgorithm.Traverse(*this, intersectionRay, hitRecord);
+	}
+
+	uint32_t KdTreeGeometry::TracePacket(const RayPacket& packet, HitRecord* hitRecords) const
+	{
+		if (m_CompactTree.IsEmpty())
 		{
-			// Shade result.
-			vector4 objectSpaceNormal;
-			objectSpaceNormal.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedTriangleIndex].m_Vertices[0].m_Normal, 1.0f - u - v, objectSpaceNormal);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedTriangleIndex].m_Vertices[1].m_Normal, v, objectSpaceNormal);
-			vector4_addScaledVector(objectSpaceNormal, m_Triangles[intersectedTriangleIndex].m_Vertices[2].m_Normal, u, objectSpaceNormal);
-			vector4_normalize(objectSpaceNormal);
-
-			float lightFactor = vector4_dotProduct(objectSpaceNormal, vector4(0.0f, 1.0f, 0.0f, 0.0f));
-			if (lightFactor > 1.0f) lightFactor = 1.0f;
-			if (lightFactor < 0.0f) lightFactor = 0.0f;
-
-			results[0] = lightFactor;
-			results[1] = lightFactor;
-			results[2] = lightFactor;
-			results[3] = 1.0f;
-
-			return true;
+			KdTreeStackTraversal nodeTraversalAlgorithm;
+			return nodeTraversalAlgorithm.TraversePacket(*this, packet, hitRecords);
 		}
 
+		KdTreePacketTraversal traversalAlgorithm;
+
+		if (nullptr != packet.m_Beam)
+			return traversalAlgorithm.TraversePacketFrom(*this, packet, FindBeamEntryNode(*packet.m_Beam), hitRecords);
+
+		return traversalAlgorithm.TraversePacket(*this, packet, hitRecords);
+	}
+
+	unsigned KdTreeGeometry::FindBeamEntryNode(const RayBeam& beam) const
+	{
+		unsigned entryNode;
+		if (nullptr != beam.m_EntryCache && beam.m_EntryCache->Find(this, beam.m_Space, entryNode))
+			return entryNode;
 
-		return false;
+		entryNode = KdTreePacketTraversal::FindEntryNode(m_CompactTree, beam);
+
+		if (nullptr != beam.m_EntryCache)
+			beam.m_EntryCache->Add(this, beam.m_Space, entryNode);
+
+		return entryNode;
+	}
+
+	bool KdTreeGeometry::Occluded(const ray& intersectionRay, float tMax) const
+	{
+		if (m_CompactTree.IsEmpty())
+		{
+			KdTreeStackTraversal nodeTraversalAlgorithm;
+			return nodeTraversalAlgorithm.TraverseOcclusion(*this, intersectionRay, tMax);
+		}
+
+		if (!m_Ropes.IsEmpty())
+		{
+			KdTreeRopeTraversal ropeTraversalAlgorithm;
+			return ropeTraversalAlgorithm.TraverseOcclusion(*this, intersectionRay, tMax);
+		}
+
+		KdTreeCompactTraversal traversalAlgorithm;
+
+		return traversalAlgorithm.TraverseOcclusion(*this, intersectionRay, tMax);
+	}
+
+	void KdTreeGeometry::Shade(const HitRecord& hitRecord, float* results) const
+	{
+		const Triangle& triangle = m_Triangles[hitRecord.m_PrimitiveId];
+		float u = hitRecord.m_U;
+		float v = hitRecord.m_V;
+
+		vector4 objectSpaceNormal;
+		objectSpaceNormal.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[0].m_Normal, 1.0f - u - v, objectSpaceNormal);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[1].m_Normal, v, objectSpaceNormal);
+		vector4_addScaledVector(objectSpaceNormal, triangle.m_Vertices[2].m_Normal, u, objectSpaceNormal);
+		vector4_normalize(objectSpaceNormal);
+
+		float lightFactor = vector4_dotProduct(objectSpaceNormal, vector4(0.0f, 1.0f, 0.0f, 0.0f));
+		if (lightFactor > 1.0f) lightFactor = 1.0f;
+		if (lightFactor < 0.0f) lightFactor = 0.0f;
+
+		results[0] = lightFactor;
+		results[1] = lightFactor;
+		results[2] = lightFactor;
+		results[3] = 1.0f;
 	}
 
 	Triangle const * KdTreeGeometry::GetTriangles() const
@@ -139,4 +354,20 @@ namespace Raytracer
 	{
 		return m_RootNode;
 	}
+
+	const KdTreeCompact& KdTreeGeometry::GetCompactTree() const
+	{
+		return m_CompactTree;
+	}
+
+	const KdTreeRopes& KdTreeGeometry::GetRopes() const
+	{
+		return m_Ropes;
+	}
+
+	void KdTreeGeometry::ExpandKdTreeNode(KdTreeNode& node) const
+	{
+		assert(nullptr != m_LazyBuilder);
+		m_LazyBuilder->Expand(node);
+	}
 }
\ No newline at end of file
@@ -1,8 +1,15 @@
 #pragma once
 
 #include "BoundedTraceable.h"
+#include "KdTreeCompact.h"
+#include "KdTreeRopes.h"
+#include "SAHCostModel.h"
+#include <MemoryArena.h>
 #include <Triangle.h>
 #include <StaticMesh.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
 
 using Assets::StaticMesh;
 using GeometryLib::Triangle;
@@ -13,10 +20,41 @@ namespace Raytracer
 	{
 		class NaiveSpatialMedian;
 		class SAH;
+		class SAHEventSweep;
+		class SAHLazy;
 	}
 
 	class KdTreeNode;
 
+	/// <summary>
+	/// Parameters of the kd tree built for a KdTreeGeometry.
+	/// </summary>
+	struct KdTreeBuildParameters
+	{
+		KdTreeBuildParameters();
+
+		/// Maximum depth of the tree. A value of 0 derives it from the number of triangles.
+		unsigned m_MaxDepth;
+		unsigned m_MaxTriangles;
+
+		bool m_PerfectSplits;
+
+		/// Largest duplication factor of triangle references across leaves, and most bytes of nodes and
+		/// triangle lists, that the tree may use. A value of 0 sets no limit. Lazily built trees are not limited.
+		float m_MaxDuplication;
+		size_t m_MemoryBudget;
+
+		/// Whether the tree is built lazily, subdividing each node the first time a ray reaches it, rather
+		/// than up front. Lazily built trees are not cached.
+		bool m_Lazy;
+
+		/// Whether ropes linking neighbouring leaves are built for the tree, and single rays traced along them
+		/// with KdTreeRopeTraversal. They do not change the tree, so are built again for cached trees.
+		bool m_BuildRopes;
+
+		KdTreeConstruction::SAHCostModel m_CostModel;
+	};
+
 	/// <summary>
 	/// Stores the triangles of a static mesh in a KdTree representation.
 	/// </summary>
@@ -25,6 +63,7 @@ namespace Raytracer
 	public:
 
 		KdTreeGeometry(const StaticMesh& mesh);
+		KdTreeGeometry(const StaticMesh& mesh, const KdTreeBuildParameters& buildParameters);
 		~KdTreeGeometry();
 
 		KdTreeGeometry& operator=(const KdTreeGeometry& rvalue) = delete;
@@ -32,25 +71,67 @@ namespace Raytracer
 
 		/// <summary>
 		/// Performs all initialization required for this static mesh.
-		/// This includes construction of the kd tree from the available mesh data.
+		/// This includes construction of the kd tree from the available mesh data, unless the tree cache
+		/// holds a tree built from the same data with the same parameters.
 		/// </summary>
 		void Initialize(const StaticMesh& mesh);
 
+		/// <summary>
+		/// Sets the directory built kd trees are cached in, which must already exist. Trees are only
+		/// cached in their compact form. An empty directory, the default, disables the cache.
+		/// </summary>
+		static void SetTreeCacheDirectory(const std::string& directory);
+		static const std::string& GetTreeCacheDirectory();
+
+		/// <summary>
+		/// Returns the key identifying trees built for the mesh with the specified parameters in the cache.
+		/// Only the data that the tree depends on, the positions and indices, is hashed.
+		/// </summary>
+		static uint64_t ComputeTreeCacheKey(const StaticMesh& mesh, const KdTreeBuildParameters& buildParameters);
+
+		/// <summary>
+		/// Returns true if the kd tree was loaded from the tree cache rather than built.
+		/// </summary>
+		bool IsTreeFromCache() const;
+
 		Triangle const * GetTriangles() const;
 
 		unsigned int GetNumTriangles() const;
 
 		/// ITraceable implementation begin.
 
-		virtual bool Trace(const ray& intersectionRay, float* t, float* results) const override;
+		virtual bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override;
+
+		virtual uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const override;
+
+		virtual bool Occluded(const ray& intersectionRay, float tMax) const override;
+
+		virtual void Shade(const HitRecord& hitRecord, float* results) const override;
 
 		/// ITraceable implementation end.
 
 		/// <summary>
-		/// Returns the root node of the kd tree.
+		/// Returns the root node of the kd tree. This is nullptr if the tree was loaded from the tree cache,
+		/// which only stores the compact form.
 		/// </summary>
 		KdTreeNode* GetRootNode() const;
 
+		/// <summary>
+		/// Returns the compact form of the kd tree, which is what rays are traced against. This is empty for
+		/// lazily built trees, which are traced in their node form.
+		/// </summary>
+		const KdTreeCompact& GetCompactTree() const;
+
+		/// <summary>
+		/// Returns the ropes of the compact tree. These are empty unless the build parameters ask for them.
+		/// </summary>
+		const KdTreeRopes& GetRopes() const;
+
+		/// <summary>
+		/// Builds the subtree of an unexpanded node of a lazily built kd tree. Safe to call from multiple threads.
+		/// </summary>
+		void ExpandKdTreeNode(KdTreeNode& node) const;
+
 	protected:
 
 		unsigned int m_NumTriangles;
@@ -59,19 +140,49 @@ namespace Raytracer
 
 		KdTreeNode* m_RootNode;
 
+		/// Storage of the nodes and triangle lists of the kd tree.
+		Core::MemoryArena m_KdTreeArena;
+
+		KdTreeCompact m_CompactTree;
+
+		KdTreeRopes m_Ropes;
+
+		KdTreeBuildParameters m_BuildParameters;
+
+		/// Builder of a lazily built tree, which expands its nodes.
+		std::unique_ptr<KdTreeConstruction::SAHLazy> m_LazyBuilder;
+
+		bool m_TreeFromCache;
+
+		static std::string s_TreeCacheDirectory;
+
 		/// </summary>
 		/// Frees all resources allocated for this instance.
 		/// </summary>
 		void FreeMemory();
 
+		/// <summary>
+		/// Returns the entry node of the beam into the compact tree, searching for it only if the beam's entry
+		/// cache does not hold it yet.
+		/// </summary>
+		unsigned FindBeamEntryNode(const RayBeam& beam) const;
+
 		/// <summary>
 		/// Resets just the of the kd tree nodes. Useful when needing to rebuild the kd tree.
 		/// </summary>
 		void ResetKdTree();
 
+		/// <summary>
+		/// Replaces the kd tree with the tree rooted at the specified node, taking over the blocks of the arena
+		/// it was allocated from, and flattens it into its compact form, adding ropes if they are built.
+		/// </summary>
+		void ReplaceKdTree(KdTreeNode* rootNode, Core::MemoryArena& arena);
+
 		// Friend class declarations. 
 		// TODO: Is there a cleaner way to do this?
 		friend class KdTreeConstruction::NaiveSpatialMedian;
 		friend class KdTreeConstruction::SAH;
+		friend class KdTreeConstruction::SAHEventSweep;
+		friend class KdTreeConstruction::SAHLazy;
 	};
 }
\ No newline at end of file
@@ -9,18 +9,10 @@ namespace Raytracer
 
 		m_Children[0] = nullptr;
 		m_Children[1] = nullptr;
-	}
-
-	KdTreeNode::~KdTreeNode()
-	{
-		if (nullptr != m_Children[0])
-			delete m_Children[0];
-
-		if (nullptr != m_Children[1])
-			delete m_Children[1];
 
-		if (nullptr != m_TriangleList)
-			delete[] m_TriangleList;
+		m_Unexpanded.store(false, std::memory_order_relaxed);
+		m_Depth = 0;
+		m_BadRefines = 0;
 	}
 
 	const vector4& KdTreeNode::GetBoundingMin() const
@@ -38,6 +30,21 @@ namespace Raytracer
 		return m_SplittingPlane;
 	}
 
+	unsigned int KdTreeNode::GetSplitAxis() const
+	{
+		const vector4& normal = m_SplittingPlane.getNormal();
+
+		if (normal[0] != 0.0f)
+			return 0;
+
+		return normal[1] != 0.0f ? 1 : 2;
+	}
+
+	float KdTreeNode::GetSplitPosition() const
+	{
+		return m_SplittingPlane.getPointOnPlane()[GetSplitAxis()];
+	}
+
 	KdTreeNode* const * KdTreeNode::GetChildren() const
 	{
 		return m_Children;
@@ -57,4 +64,9 @@ namespace Raytracer
 	{
 		return m_TriangleList;
 	}
+
+	bool KdTreeNode::IsUnexpanded() const
+	{
+		return m_Unexpanded.load(std::memory_order_acquire);
+	}
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <MathLib.h>
+#include <atomic>
 
 using namespace MathLib;
 
@@ -10,8 +11,14 @@ namespace Raytracer
 	{
 		class NaiveSpatialMedian;
 		class SAH;
+		class SAHEventSweep;
+		class SAHLazy;
 	}
 
+	/// <summary>
+	/// A node of a kd tree. Nodes and their triangle lists are allocated from the Core::MemoryArena of their
+	/// tree, which frees the whole tree at once, so nodes do not free their children or triangles.
+	/// </summary>
 	class KdTreeNode
 	{
 	public:
@@ -21,11 +28,6 @@ namespace Raytracer
 		/// </summary>
 		KdTreeNode();
 
-		/// <summary>
-		/// Destructs this KdTreeNode instance.
-		/// </summary>
-		~KdTreeNode();
-
 		/// <summary>
 		/// Returns the minimal extents of this KdTreeNode's voxel.
 		/// </summary>
@@ -41,6 +43,16 @@ namespace Raytracer
 		/// </summary>
 		const plane& GetSplittingPlane() const;
 
+		/// <summary>
+		/// Returns the axis of this interior node's split. The builders only produce axis aligned splitting planes.
+		/// </summary>
+		unsigned int GetSplitAxis() const;
+
+		/// <summary>
+		/// Returns the position of this interior node's split along its axis.
+		/// </summary>
+		float GetSplitPosition() const;
+
 		/// <summary>
 		/// Returns the children of this node.
 		/// </summary>
@@ -61,6 +73,12 @@ namespace Raytracer
 		/// <summary>
 		const unsigned int * GetTriangleList() const;
 
+		/// <summary>
+		/// Determines whether or not this is a leaf of a lazily built tree whose subtree has not been built
+		/// yet. Such nodes must be expanded before their children or triangles are read.
+		/// </summary>
+		bool IsUnexpanded() const;
+
 	protected:
 
 		KdTreeNode(const KdTreeNode& rvalue) = delete;
@@ -76,9 +94,20 @@ namespace Raytracer
 
 		KdTreeNode* m_Children[2];
 
+		/// Cleared with release semantics once the node's subtree has been built, so that threads seeing it
+		/// cleared also see the node's children.
+		std::atomic<bool> m_Unexpanded;
+
+		/// Depth of this node, and the number of splits above it costing more than a leaf. Unexpanded nodes
+		/// need these to continue subdividing where construction stopped.
+		unsigned int m_Depth;
+		int m_BadRefines;
+
 		// Friend class declarations. 
 		// TODO: Is there a cleaner way to do this?
-		friend class Raytracer::KdTreeConstruction::NaiveSpatialMedian;
-		friend class Raytracer::KdTreeConstruction::SAH;
+		friend class KdTreeConstruction::NaiveSpatialMedian;
+		friend class KdTreeConstruction::SAH;
+		friend class KdTreeConstruction::SAHEventSweep;
+		friend class KdTreeConstruction::SAHLazy;
 	};
 }
\ No newline at end of file
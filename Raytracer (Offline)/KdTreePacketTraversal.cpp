@@ -0,0 +1,656 @@
+#include "KdTreePacketTraversal.h"
+#include "KdTreeCompact.h"
+#include "KdTreeCompactTraversal.h"
+#include "KdTreeGeometry.h"
+#include "TraversalRay.h"
+#include "TraversalStatistics.h"
+#include <Geometry.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstring>
+
+// MATHLIB_SSE depends on __SSE__, which MSVC never defines, so the packet kernels check for SSE2 support
+// themselves: it is always available on x64 and enabled by /arch:SSE2 on x86.
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#include <emmintrin.h>
+#define KDTREE_PACKET_SSE 1
+#else
+#define KDTREE_PACKET_SSE 0
+#endif
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// Rays processed by one SIMD instruction.
+		const unsigned LaneWidth = 4;
+
+		/// Packets are padded with inactive rays to a multiple of the lane width.
+		const unsigned MaxLanes = (RayPacket::MaxSize + LaneWidth - 1) / LaneWidth * LaneWidth;
+
+		/// <summary>
+		/// The rays of a packet and their closest intersections, stored as structures of arrays so that the rays
+		/// of a lane group are loaded with a single instruction.
+		/// </summary>
+		struct PacketRays
+		{
+			float m_Origin[3][MaxLanes];
+			float m_Direction[3][MaxLanes];
+			float m_InverseDirection[3][MaxLanes];
+
+			float m_ClosestT[MaxLanes];
+			float m_U[MaxLanes];
+			float m_V[MaxLanes];
+			uint32_t m_PrimitiveId[MaxLanes];
+
+			/// Mask of the rays which have intersected a triangle.
+			uint32_t m_HitMask;
+
+			/// The packet's size rounded up to the lane width.
+			unsigned m_NumLanes;
+		};
+
+		/// <summary>
+		/// A subtree still to be traversed by the rays of m_Mask, over their intervals [m_TMin, m_TMax].
+		/// </summary>
+		struct StackEntry
+		{
+			unsigned m_Node;
+			uint32_t m_Mask;
+			float m_TMin[MaxLanes];
+			float m_TMax[MaxLanes];
+		};
+
+		/// <summary>Returns a mask with bit i set if a[i] <= b[i].</summary>
+		uint32_t CompareLessEqual(const float* a, const float* b, unsigned numLanes)
+		{
+			uint32_t mask = 0;
+
+#if (KDTREE_PACKET_SSE)
+			for (unsigned lane = 0; lane < numLanes; lane += LaneWidth)
+				mask |= (uint32_t)_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(a + lane), _mm_loadu_ps(b + lane))) << lane;
+#else
+			for (unsigned lane = 0; lane < numLanes; lane++)
+			{
+				if (a[lane] <= b[lane])
+					mask |= 1u << lane;
+			}
+#endif // (KDTREE_PACKET_SSE)
+
+			return mask;
+		}
+
+		/// <summary>
+		/// Divides the intervals [tMin, tMax] of all lanes at a split. firstMask receives the lanes whose interval
+		/// reaches into the child traversed first, which they leave at firstTMax, and secondMask the lanes whose
+		/// interval reaches into the other child, which they enter at secondTMin. A ray lying in the split only
+		/// visits the first child.
+		/// </summary>
+		void SplitIntervals(const PacketRays& rays, unsigned axis, float split, const float* tMin, const float* tMax,
+			float* firstTMax, float* secondTMin, uint32_t& firstMask, uint32_t& secondMask)
+		{
+			firstMask = 0;
+			secondMask = 0;
+
+#if (KDTREE_PACKET_SSE)
+			const __m128 splitLanes = _mm_set1_ps(split);
+
+			for (unsigned lane = 0; lane < rays.m_NumLanes; lane += LaneWidth)
+			{
+				__m128 tPlane = _mm_mul_ps(_mm_sub_ps(splitLanes, _mm_loadu_ps(rays.m_Origin[axis] + lane)),
+					_mm_loadu_ps(rays.m_InverseDirection[axis] + lane));
+
+				__m128 tMinLanes = _mm_loadu_ps(tMin + lane);
+				__m128 tMaxLanes = _mm_loadu_ps(tMax + lane);
+
+				// The negated comparison is true for NaN, which keeps rays lying in the split in the first child.
+				__m128 first = _mm_cmpnlt_ps(tPlane, tMinLanes);
+				__m128 second = _mm_cmple_ps(tPlane, tMaxLanes);
+
+				_mm_storeu_ps(firstTMax + lane, _mm_or_ps(_mm_and_ps(second, tPlane), _mm_andnot_ps(second, tMaxLanes)));
+				_mm_storeu_ps(secondTMin + lane, _mm_or_ps(_mm_and_ps(first, tPlane), _mm_andnot_ps(first, tMinLanes)));
+
+				firstMask |= (uint32_t)_mm_movemask_ps(first) << lane;
+				secondMask |= (uint32_t)_mm_movemask_ps(second) << lane;
+			}
+#else
+			for (unsigned lane = 0; lane < rays.m_NumLanes; lane++)
+			{
+				float tPlane = (split - rays.m_Origin[axis][lane]) * rays.m_InverseDirection[axis][lane];
+
+				bool first = !(tPlane < tMin[lane]);
+				bool second = tPlane <= tMax[lane];
+
+				firstTMax[lane] = second ? tPlane : tMax[lane];
+				secondTMin[lane] = first ? tPlane : tMin[lane];
+
+				if (first)
+					firstMask |= 1u << lane;
+
+				if (second)
+					secondMask |= 1u << lane;
+			}
+#endif // (KDTREE_PACKET_SSE)
+		}
+
+		/// <summary>
+		/// Intersects the triangle with the rays of mask, recording intersections closer than those found so far.
+		/// Follows GeometryLib::RayTriangleIntersection, including its back face culling.
+		/// </summary>
+		void IntersectTriangle(PacketRays& rays, const Triangle& triangle, uint32_t primitiveId, uint32_t mask)
+		{
+#if (KDTREE_PACKET_SSE)
+			const vector4& p0 = triangle.m_Vertices[0].m_Position;
+			const vector4& p1 = triangle.m_Vertices[1].m_Position;
+			const vector4& p2 = triangle.m_Vertices[2].m_Position;
+
+			const __m128 v0x = _mm_set1_ps(p0[0]);
+			const __m128 v0y = _mm_set1_ps(p0[1]);
+			const __m128 v0z = _mm_set1_ps(p0[2]);
+
+			const __m128 e1x = _mm_set1_ps(p2[0] - p0[0]);
+			const __m128 e1y = _mm_set1_ps(p2[1] - p0[1]);
+			const __m128 e1z = _mm_set1_ps(p2[2] - p0[2]);
+
+			const __m128 e2x = _mm_set1_ps(p1[0] - p0[0]);
+			const __m128 e2y = _mm_set1_ps(p1[1] - p0[1]);
+			const __m128 e2z = _mm_set1_ps(p1[2] - p0[2]);
+
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 one = _mm_set1_ps(1.0f);
+
+			for (unsigned lane = 0; lane < rays.m_NumLanes; lane += LaneWidth)
+			{
+				uint32_t laneMask = (mask >> lane) & 0xf;
+				if (0 == laneMask)
+					continue;
+
+				__m128 dx = _mm_loadu_ps(rays.m_Direction[0] + lane);
+				__m128 dy = _mm_loadu_ps(rays.m_Direction[1] + lane);
+				__m128 dz = _mm_loadu_ps(rays.m_Direction[2] + lane);
+
+				// P = direction x edge2
+				__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+				__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+				__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+				__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+
+				// T = origin - vertex0
+				__m128 tx = _mm_sub_ps(_mm_loadu_ps(rays.m_Origin[0] + lane), v0x);
+				__m128 ty = _mm_sub_ps(_mm_loadu_ps(rays.m_Origin[1] + lane), v0y);
+				__m128 tz = _mm_sub_ps(_mm_loadu_ps(rays.m_Origin[2] + lane), v0z);
+
+				__m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, tx), _mm_mul_ps(py, ty)), _mm_mul_ps(pz, tz));
+
+				// Q = T x edge1
+				__m128 qx = _mm_sub_ps(_mm_mul_ps(ty, e1z), _mm_mul_ps(tz, e1y));
+				__m128 qy = _mm_sub_ps(_mm_mul_ps(tz, e1x), _mm_mul_ps(tx, e1z));
+				__m128 qz = _mm_sub_ps(_mm_mul_ps(tx, e1y), _mm_mul_ps(ty, e1x));
+
+				__m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(qx, dx), _mm_mul_ps(qy, dy)), _mm_mul_ps(qz, dz));
+
+				__m128 inverseDeterminant = _mm_div_ps(one, determinant);
+				__m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)),
+					inverseDeterminant);
+
+				__m128 closestT = _mm_loadu_ps(rays.m_ClosestT + lane);
+
+				__m128 hit = _mm_cmpge_ps(determinant, zero);
+				hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+				hit = _mm_and_ps(hit, _mm_cmple_ps(u, determinant));
+				hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+				hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), determinant));
+				hit = _mm_and_ps(hit, _mm_cmpge_ps(t, zero));
+				hit = _mm_and_ps(hit, _mm_cmplt_ps(t, closestT));
+
+				uint32_t hitLanes = (uint32_t)_mm_movemask_ps(hit) & laneMask;
+				if (0 == hitLanes)
+					continue;
+
+				// Only the lanes of active rays are written.
+				hit = _mm_castsi128_ps(_mm_setr_epi32((hitLanes & 1) ? -1 : 0, (hitLanes & 2) ? -1 : 0,
+					(hitLanes & 4) ? -1 : 0, (hitLanes & 8) ? -1 : 0));
+
+				_mm_storeu_ps(rays.m_ClosestT + lane, _mm_or_ps(_mm_and_ps(hit, t), _mm_andnot_ps(hit, closestT)));
+
+				__m128 previousU = _mm_loadu_ps(rays.m_U + lane);
+				__m128 previousV = _mm_loadu_ps(rays.m_V + lane);
+				_mm_storeu_ps(rays.m_U + lane, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(u, inverseDeterminant)), _mm_andnot_ps(hit, previousU)));
+				_mm_storeu_ps(rays.m_V + lane, _mm_or_ps(_mm_and_ps(hit, _mm_mul_ps(v, inverseDeterminant)), _mm_andnot_ps(hit, previousV)));
+
+				for (unsigned i = 0; i < LaneWidth; i++)
+				{
+					if (0 != (hitLanes & (1u << i)))
+						rays.m_PrimitiveId[lane + i] = primitiveId;
+				}
+
+				rays.m_HitMask |= hitLanes << lane;
+			}
+#else
+			for (unsigned lane = 0; lane < rays.m_NumLanes; lane++)
+			{
+				if (0 == (mask & (1u << lane)))
+					continue;
+
+				ray laneRay(vector4(rays.m_Origin[0][lane], rays.m_Origin[1][lane], rays.m_Origin[2][lane], 1.0f),
+					vector4(rays.m_Direction[0][lane], rays.m_Direction[1][lane], rays.m_Direction[2][lane], 0.0f));
+
+				float t;
+				float u;
+				float v;
+
+				if (!GeometryLib::RayTriangleIntersection(laneRay, triangle, t, u, v))
+					continue;
+
+				if (t < 0.0f || t >= rays.m_ClosestT[lane])
+					continue;
+
+				rays.m_ClosestT[lane] = t;
+				rays.m_U[lane] = u;
+				rays.m_V[lane] = v;
+				rays.m_PrimitiveId[lane] = primitiveId;
+				rays.m_HitMask |= 1u << lane;
+			}
+#endif // (KDTREE_PACKET_SSE)
+		}
+
+		/// <summary>Part of a beam inside a voxel, relative to a split plane through the voxel.</summary>
+		enum BeamSide
+		{
+			BeamBelow,
+			BeamAbove,
+			BeamStraddles
+		};
+
+		/// <summary>
+		/// Margin, relative to the size of a voxel's face, by which a beam must miss the face in a split plane. It
+		/// covers the rounding of the rays' own crossings of the plane.
+		/// </summary>
+		const float BeamMargin = 1e-4f;
+
+		/// <summary>
+		/// Finds where the ray from origin along direction is inside the voxel [cellMin, cellMax], returning false
+		/// if it misses the voxel.
+		/// </summary>
+		bool ClipEdgeToVoxel(const vector4& origin, const vector4& direction, const float* cellMin, const float* cellMax,
+			float& tMin, float& tMax)
+		{
+			tMin = 0.0f;
+			tMax = FLT_MAX;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (0.0f == direction[axis])
+				{
+					if (origin[axis] < cellMin[axis] || origin[axis] > cellMax[axis])
+						return false;
+
+					continue;
+				}
+
+				float inverseDirection = 1.0f / direction[axis];
+				float tNear = (cellMin[axis] - origin[axis]) * inverseDirection;
+				float tFar = (cellMax[axis] - origin[axis]) * inverseDirection;
+
+				if (tNear > tFar)
+					std::swap(tNear, tFar);
+
+				tMin = std::max(tMin, tNear);
+				tMax = std::min(tMax, tFar);
+			}
+
+			return tMin <= tMax;
+		}
+
+		/// <summary>
+		/// Classifies the part of the beam inside the voxel [cellMin, cellMax] against the split plane on the axis.
+		/// That part is convex, so it lies on one side of the plane unless the beam meets the plane inside the voxel.
+		/// The beam straddles the plane wherever that cannot be ruled out.
+		/// </summary>
+		BeamSide ClassifyBeam(const RayBeam& beam, unsigned axis, float split, const float* cellMin, const float* cellMax)
+		{
+			float originOffset = split - beam.m_Origin[axis];
+			if (0.0f == originOffset)
+				return BeamStraddles;
+
+			BeamSide originSide = originOffset > 0.0f ? BeamBelow : BeamAbove;
+
+			unsigned otherAxes[2] = { (axis + 1) % 3, (axis + 2) % 3 };
+			float crossingMin[2] = { FLT_MAX, FLT_MAX };
+			float crossingMax[2] = { -FLT_MAX, -FLT_MAX };
+			unsigned numCrossingEdges = 0;
+
+			for (unsigned i = 0; i < 4; i++)
+			{
+				const vector4& direction = beam.m_Corners[i];
+
+				// Only edges heading towards the plane cross it.
+				if (!(originOffset * direction[axis] > 0.0f))
+					continue;
+
+				numCrossingEdges++;
+				float t = originOffset / direction[axis];
+
+				for (unsigned j = 0; j < 2; j++)
+				{
+					float crossing = beam.m_Origin[otherAxes[j]] + direction[otherAxes[j]] * t;
+					crossingMin[j] = std::min(crossingMin[j], crossing);
+					crossingMax[j] = std::max(crossingMax[j], crossing);
+				}
+			}
+
+			// The whole beam heads away from the plane.
+			if (0 == numCrossingEdges)
+				return originSide;
+
+			// Part of the beam runs parallel to the plane, so its section by the plane is unbounded.
+			if (numCrossingEdges < 4)
+				return BeamStraddles;
+
+			// The beam's section by the plane is the quadrilateral of its edges' crossings, which must miss the
+			// voxel's face in the plane.
+			bool missesFace = false;
+			for (unsigned j = 0; j < 2; j++)
+			{
+				unsigned faceAxis = otherAxes[j];
+				float margin = BeamMargin * (cellMax[faceAxis] - cellMin[faceAxis]);
+
+				if (crossingMax[j] < cellMin[faceAxis] - margin || crossingMin[j] > cellMax[faceAxis] + margin)
+					missesFace = true;
+			}
+
+			if (!missesFace)
+				return BeamStraddles;
+
+			// Any edge passing through the voxel tells which side the beam is on there.
+			for (unsigned i = 0; i < 4; i++)
+			{
+				float tMin;
+				float tMax;
+
+				if (!ClipEdgeToVoxel(beam.m_Origin, beam.m_Corners[i], cellMin, cellMax, tMin, tMax))
+					continue;
+
+				float middle = beam.m_Origin[axis] + beam.m_Corners[i][axis] * (tMin + tMax) * 0.5f;
+				return middle < split ? BeamBelow : BeamAbove;
+			}
+
+			return BeamStraddles;
+		}
+	}
+
+	bool KdTreePacketTraversal::Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord)
+	{
+		KdTreeCompactTraversal singleRayTraversal;
+		return singleRayTraversal.Traverse(geometry, intersectionRay, hitRecord);
+	}
+
+	bool KdTreePacketTraversal::TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax)
+	{
+		KdTreeCompactTraversal singleRayTraversal;
+		return singleRayTraversal.TraverseOcclusion(geometry, intersectionRay, tMax);
+	}
+
+	uint32_t KdTreePacketTraversal::TraversePacket(const KdTreeGeometry& geometry, const RayPacket& packet,
+		HitRecord* hitRecords)
+	{
+		return TraversePacketFrom(geometry, packet, 0, hitRecords);
+	}
+
+	uint32_t KdTreePacketTraversal::TraversePacketFrom(const KdTreeGeometry& geometry, const RayPacket& packet,
+		unsigned startNode, HitRecord* hitRecords)
+	{
+		const KdTreeCompact& tree = geometry.GetCompactTree();
+		if (tree.IsEmpty())
+			return 0;
+
+		// Traversing a packet together only pays off for several rays heading the same way.
+		if (RayPacket::CountRays(packet.m_ActiveMask) < 2 || !IsCoherent(packet))
+		{
+			KdTreeCompactTraversal singleRayTraversal;
+			uint32_t hitMask = 0;
+
+			for (unsigned i = 0; i < packet.m_Size; i++)
+			{
+				if (packet.IsActive(i) && singleRayTraversal.TraverseFrom(geometry, packet.m_Rays[i], startNode, hitRecords[i]))
+					hitMask |= 1u << i;
+			}
+
+			return hitMask;
+		}
+
+		PacketRays rays;
+		rays.m_NumLanes = (packet.m_Size + LaneWidth - 1) / LaneWidth * LaneWidth;
+		rays.m_HitMask = 0;
+
+		float tMin[MaxLanes];
+		float tMax[MaxLanes];
+		uint32_t mask = 0;
+
+		// Each ray is clipped to the root voxel once. Rays missing it, and the padding, start out inactive.
+		for (unsigned lane = 0; lane < rays.m_NumLanes; lane++)
+		{
+			rays.m_ClosestT[lane] = FLT_MAX;
+			tMin[lane] = 0.0f;
+			tMax[lane] = 0.0f;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				rays.m_Origin[axis][lane] = 0.0f;
+				rays.m_Direction[axis][lane] = 1.0f;
+				rays.m_InverseDirection[axis][lane] = 1.0f;
+			}
+
+			if (lane >= packet.m_Size || !packet.IsActive(lane))
+				continue;
+
+			TraversalRay traversalRay(packet.m_Rays[lane]);
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				rays.m_Origin[axis][lane] = traversalRay.m_Origin[axis];
+				rays.m_Direction[axis][lane] = traversalRay.m_Direction[axis];
+				rays.m_InverseDirection[axis][lane] = traversalRay.m_InverseDirection[axis];
+			}
+
+			float rayTMin = 0.0f;
+			float rayTMax = FLT_MAX;
+
+			if (!ClipRayToBounds(traversalRay, tree.GetBoundingMin(), tree.GetBoundingMax(), rayTMin, rayTMax))
+			{
+				RAYTRACER_COUNT(m_NodesVisited, 1);
+				continue;
+			}
+
+			tMin[lane] = rayTMin;
+			tMax[lane] = rayTMax;
+			mask |= 1u << lane;
+		}
+
+		// All rays share their direction signs, so every ray visits the children in the same order.
+		unsigned firstActiveLane = 0;
+		while (!packet.IsActive(firstActiveLane))
+			firstActiveLane++;
+
+		bool aboveFirst[3];
+		for (int axis = 0; axis < 3; axis++)
+			aboveFirst[axis] = rays.m_InverseDirection[axis][firstActiveLane] < 0.0f;
+
+		const KdTreeCompactNode* nodes = tree.GetNodes();
+		auto triangles = geometry.GetTriangles();
+		auto triangleIndices = tree.GetTriangleIndices();
+
+		StackEntry stack[KdTreeCompact::MaxDepth];
+		unsigned stackSize = 0;
+
+		// Rays which have not yet found their closest intersection.
+		uint32_t liveMask = mask;
+		unsigned nodeIndex = startNode;
+
+		while (0 != mask)
+		{
+			const KdTreeCompactNode* node = &nodes[nodeIndex];
+
+			while (!node->IsLeaf())
+			{
+				RAYTRACER_COUNT(m_NodesVisited, RayPacket::CountRays(mask));
+
+				assert(stackSize < KdTreeCompact::MaxDepth);
+				StackEntry& entry = stack[stackSize];
+
+				unsigned axis = node->GetAxis();
+
+				float firstTMax[MaxLanes];
+				uint32_t firstMask;
+				uint32_t secondMask;
+				SplitIntervals(rays, axis, node->m_Split, tMin, tMax, firstTMax, entry.m_TMin, firstMask, secondMask);
+
+				firstMask &= mask;
+				secondMask &= mask;
+
+				unsigned firstChild = aboveFirst[axis] ? node->GetAboveChild() : nodeIndex + 1;
+				unsigned secondChild = aboveFirst[axis] ? nodeIndex + 1 : node->GetAboveChild();
+
+				// Rays entering only one child keep their intervals unchanged.
+				if (0 == secondMask)
+				{
+					nodeIndex = firstChild;
+				}
+				else if (0 == firstMask)
+				{
+					nodeIndex = secondChild;
+					mask = secondMask;
+				}
+				else
+				{
+					entry.m_Node = secondChild;
+					entry.m_Mask = secondMask;
+					memcpy(entry.m_TMax, tMax, sizeof(float) * rays.m_NumLanes);
+					stackSize++;
+
+					memcpy(tMax, firstTMax, sizeof(float) * rays.m_NumLanes);
+					nodeIndex = firstChild;
+					mask = firstMask;
+				}
+
+				node = &nodes[nodeIndex];
+			}
+
+			unsigned numActiveRays = RayPacket::CountRays(mask);
+			unsigned numTriangles = node->GetNumTriangles();
+			auto triangleList = triangleIndices + node->m_FirstTriangle;
+
+			RAYTRACER_COUNT(m_NodesVisited, numActiveRays);
+			RAYTRACER_COUNT(m_LeavesVisited, numActiveRays);
+			RAYTRACER_COUNT(m_TriangleTests, numTriangles * numActiveRays);
+
+			for (unsigned i = 0; i < numTriangles; i++)
+				IntersectTriangle(rays, triangles[triangleList[i]], triangleList[i], mask);
+
+			// Intersections within a ray's part of this leaf are closer than anything the remaining leaves hold.
+			liveMask &= ~(mask & CompareLessEqual(rays.m_ClosestT, tMax, rays.m_NumLanes));
+
+			mask = 0;
+			while (0 == mask && 0 != stackSize)
+			{
+				const StackEntry& entry = stack[--stackSize];
+				mask = entry.m_Mask & liveMask & CompareLessEqual(entry.m_TMin, rays.m_ClosestT, rays.m_NumLanes);
+
+				nodeIndex = entry.m_Node;
+				memcpy(tMin, entry.m_TMin, sizeof(float) * rays.m_NumLanes);
+				memcpy(tMax, entry.m_TMax, sizeof(float) * rays.m_NumLanes);
+			}
+		}
+
+		for (unsigned lane = 0; lane < packet.m_Size; lane++)
+		{
+			if (0 == (rays.m_HitMask & (1u << lane)))
+				continue;
+
+			HitRecord& hitRecord = hitRecords[lane];
+			hitRecord.m_T = rays.m_ClosestT[lane];
+			hitRecord.m_U = rays.m_U[lane];
+			hitRecord.m_V = rays.m_V[lane];
+			hitRecord.m_PrimitiveId = rays.m_PrimitiveId[lane];
+		}
+
+		return rays.m_HitMask;
+	}
+
+	bool KdTreePacketTraversal::IsCoherent(const RayPacket& packet)
+	{
+		bool first = true;
+		unsigned signs = 0;
+
+		for (unsigned i = 0; i < packet.m_Size; i++)
+		{
+			if (!packet.IsActive(i))
+				continue;
+
+			// The signs of the inverse direction, which also tell -0 apart from +0.
+			const vector4& direction = packet.m_Rays[i].getDirection();
+
+			unsigned raySigns = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (1.0f / direction[axis] < 0.0f)
+					raySigns |= 1u << axis;
+			}
+
+			if (first)
+				signs = raySigns;
+			else if (raySigns != signs)
+				return false;
+
+			first = false;
+		}
+
+		return true;
+	}
+
+	unsigned KdTreePacketTraversal::FindEntryNode(const KdTreeCompact& tree, const RayBeam& beam)
+	{
+		if (tree.IsEmpty())
+			return 0;
+
+		float cellMin[3];
+		float cellMax[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			cellMin[axis] = tree.GetBoundingMin()[axis];
+			cellMax[axis] = tree.GetBoundingMax()[axis];
+		}
+
+		const KdTreeCompactNode* nodes = tree.GetNodes();
+		unsigned nodeIndex = 0;
+
+		// The part of the beam inside the root's voxel stays inside the voxel of each node descended into.
+		while (!nodes[nodeIndex].IsLeaf())
+		{
+			RAYTRACER_COUNT(m_NodesVisited, 1);
+
+			const KdTreeCompactNode& node = nodes[nodeIndex];
+			unsigned axis = node.GetAxis();
+
+			BeamSide side = ClassifyBeam(beam, axis, node.m_Split, cellMin, cellMax);
+			if (BeamStraddles == side)
+				break;
+
+			if (BeamBelow == side)
+			{
+				nodeIndex = nodeIndex + 1;
+				cellMax[axis] = node.m_Split;
+			}
+			else
+			{
+				nodeIndex = node.GetAboveChild();
+				cellMin[axis] = node.m_Split;
+			}
+		}
+
+		return nodeIndex;
+	}
+}
\ No newline at end of file
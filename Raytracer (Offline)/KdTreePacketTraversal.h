@@ -0,0 +1,55 @@
+#pragma once
+
+#include "IKdTreeTraversal.h"
+
+namespace Raytracer
+{
+	class KdTreeCompact;
+
+	/// <summary>
+	/// Traverses the compact form of a kd tree with a whole packet of coherent rays, such as primary rays. Each
+	/// node is visited once for the packet, and its split divides the intervals of four rays at a time with SIMD
+	/// instructions. Leaf triangles are likewise tested against four rays at a time.
+	///
+	/// The packet descends the children in the same order for every ray, so its rays must point the same way
+	/// along each axis. Packets whose rays diverge, or which have a single active ray, are traced one ray at a
+	/// time with KdTreeCompactTraversal, which also traces all single rays.
+	///
+	/// Packets carrying a beam start at the beam's entry node, found once per beam by FindEntryNode.
+	/// </summary>
+	class KdTreePacketTraversal : public IKdTreeTraversal
+	{
+	public:
+
+		/// - IKdTreeTraversal Implementation Begin -
+
+		bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord) override;
+
+		bool TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax) override;
+
+		uint32_t TraversePacket(const KdTreeGeometry& geometry, const RayPacket& packet, HitRecord* hitRecords) override;
+
+		/// - IKdTreeTraversal Implementation End -
+
+		/// <summary>
+		/// Traverses the tree with the packet from the specified node of the compact tree rather than from the
+		/// root, such as the entry node of a beam enclosing the packet's rays.
+		/// </summary>
+		uint32_t TraversePacketFrom(const KdTreeGeometry& geometry, const RayPacket& packet, unsigned startNode,
+			HitRecord* hitRecords);
+
+		/// <summary>
+		/// Finds the deepest node of the compact tree which every ray inside the beam passes through on all of its
+		/// way through the tree. Traversing those rays from there visits the same leaves as traversing them from
+		/// the root, so all the nodes above it are skipped. The beam is walked down the tree once, moving to a
+		/// child for as long as the part of the beam inside the node lies entirely on one side of the node's split.
+		/// </summary>
+		static unsigned FindEntryNode(const KdTreeCompact& tree, const RayBeam& beam);
+
+		/// <summary>
+		/// Returns true if the active rays of the packet point the same way along each axis, so that the packet
+		/// can be traversed together.
+		/// </summary>
+		static bool IsCoherent(const RayPacket& packet);
+	};
+}
\ No newline at end of file
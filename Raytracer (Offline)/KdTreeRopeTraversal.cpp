@@ -0,0 +1,187 @@
+#include "KdTreeRopeTraversal.h"
+#include "KdTreeCompact.h"
+#include "KdTreeGeometry.h"
+#include "KdTreeRopes.h"
+#include "Mailbox.h"
+#include "TraversalLeaf.h"
+#include "TraversalRay.h"
+#include "TraversalStatistics.h"
+#include <Geometry.h>
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// <summary>
+		/// Visits the leaves pierced by the ray's interval [tEntry, tMax] front to back, starting from a node
+		/// containing the point at tEntry. intersectLeaf(leaf) is called for each, and returns the distance
+		/// beyond which nothing is of interest any more. Traversal stops once that distance is inside the
+		/// current leaf. Returns the node index of the last leaf visited.
+		/// </summary>
+		template <typename IntersectLeaf>
+		unsigned VisitLeaves(const KdTreeCompact& tree, const KdTreeRopes& ropes, const TraversalRay& traversalRay,
+			unsigned startNode, float tEntry, float tMax, IntersectLeaf intersectLeaf)
+		{
+			const KdTreeCompactNode* nodes = tree.GetNodes();
+			unsigned nodeIndex = startNode;
+
+			for (;;)
+			{
+				// Descend to the leaf containing the point where the ray enters the node.
+				while (!nodes[nodeIndex].IsLeaf())
+				{
+					RAYTRACER_COUNT(m_NodesVisited, 1);
+
+					const KdTreeCompactNode& node = nodes[nodeIndex];
+					unsigned axis = node.GetAxis();
+					float entry = traversalRay.m_Origin[axis] + tEntry * traversalRay.m_Direction[axis];
+
+					// A ray entering on the split continues into the side it is heading into.
+					bool below = entry < node.m_Split || (entry == node.m_Split && traversalRay.m_Direction[axis] <= 0.0f);
+					nodeIndex = below ? nodeIndex + 1 : node.GetAboveChild();
+				}
+
+				RAYTRACER_COUNT(m_NodesVisited, 1);
+
+				const KdTreeRopes::Leaf& leaf = ropes.GetLeaf(nodeIndex);
+
+				// Find the face the ray leaves the leaf's voxel through.
+				float tExit = FLT_MAX;
+				unsigned exitFace = 0;
+
+				for (unsigned axis = 0; axis < 3; axis++)
+				{
+					if (0.0f == traversalRay.m_Direction[axis])
+						continue;
+
+					bool positive = traversalRay.m_Direction[axis] > 0.0f;
+					float bound = positive ? leaf.m_BoundingMax[axis] : leaf.m_BoundingMin[axis];
+					float tFace = (bound - traversalRay.m_Origin[axis]) * traversalRay.m_InverseDirection[axis];
+
+					if (tFace < tExit)
+					{
+						tExit = tFace;
+						exitFace = axis * 2 + (positive ? 1 : 0);
+					}
+				}
+
+				float tLimit = intersectLeaf(nodes[nodeIndex]);
+
+				// Anything within this leaf's part of the ray is closer than what the following leaves hold.
+				if (tLimit <= tExit || tExit >= tMax)
+					return nodeIndex;
+
+				uint32_t rope = leaf.m_Ropes[exitFace];
+				if (KdTreeRopes::NoNeighbour == rope)
+					return nodeIndex;
+
+				// Rounding may put the exit slightly before the entry of a thin leaf; the ray never moves backwards.
+				tEntry = max(tEntry, tExit);
+				nodeIndex = rope;
+			}
+		}
+
+		/// <summary>
+		/// Clips the ray to the root's voxel, returning the interval to traverse. The interval of rays starting
+		/// inside the tree begins at their origin.
+		/// </summary>
+		bool ClipRayToTree(const KdTreeCompact& tree, const TraversalRay& traversalRay, float& tEntry, float& tMax)
+		{
+			if (!ClipRayToBounds(traversalRay, tree.GetBoundingMin(), tree.GetBoundingMax(), tEntry, tMax))
+			{
+				RAYTRACER_COUNT(m_NodesVisited, 1);
+				return false;
+			}
+
+			return true;
+		}
+	}
+
+	bool KdTreeRopeTraversal::Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord)
+	{
+		return TraverseFrom(geometry, intersectionRay, 0, hitRecord);
+	}
+
+	bool KdTreeRopeTraversal::TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax)
+	{
+		return TraverseOcclusionFrom(geometry, intersectionRay, 0, tMax);
+	}
+
+	bool KdTreeRopeTraversal::TraverseFrom(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned startNode,
+		HitRecord& hitRecord, unsigned* hitLeaf)
+	{
+		const KdTreeCompact& tree = geometry.GetCompactTree();
+		const KdTreeRopes& ropes = geometry.GetRopes();
+		if (ropes.IsEmpty())
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tEntry = 0.0f;
+		float tMax = FLT_MAX;
+
+		if (!ClipRayToTree(tree, traversalRay, tEntry, tMax))
+			return false;
+
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+		auto triangleIndices = tree.GetTriangleIndices();
+
+		bool intersectionFound = false;
+		float closestT = FLT_MAX;
+
+		unsigned lastLeaf = VisitLeaves(tree, ropes, traversalRay, startNode, tEntry, tMax,
+			[&](const KdTreeCompactNode& leaf) -> float
+		{
+			if (IntersectLeafTriangles(intersectionRay, triangles, triangleIndices + leaf.m_FirstTriangle,
+				leaf.GetNumTriangles(), mailbox, closestT, hitRecord))
+				intersectionFound = true;
+
+			return closestT;
+		});
+
+		if (intersectionFound && nullptr != hitLeaf)
+			*hitLeaf = lastLeaf;
+
+		return intersectionFound;
+	}
+
+	bool KdTreeRopeTraversal::TraverseOcclusionFrom(const KdTreeGeometry& geometry, const ray& intersectionRay,
+		unsigned startNode, float tMax)
+	{
+		const KdTreeCompact& tree = geometry.GetCompactTree();
+		const KdTreeRopes& ropes = geometry.GetRopes();
+		if (ropes.IsEmpty())
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tSegmentEntry = 0.0f;
+		float tSegmentMax = tMax;
+
+		if (!ClipRayToTree(tree, traversalRay, tSegmentEntry, tSegmentMax))
+			return false;
+
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+		auto triangleIndices = tree.GetTriangleIndices();
+
+		bool occluded = false;
+
+		VisitLeaves(tree, ropes, traversalRay, startNode, tSegmentEntry, tSegmentMax, [&](const KdTreeCompactNode& leaf) -> float
+		{
+			if (!OccludedByLeafTriangles(intersectionRay, triangles, triangleIndices + leaf.m_FirstTriangle,
+				leaf.GetNumTriangles(), mailbox, tMax))
+				return FLT_MAX;
+
+			occluded = true;
+			return -FLT_MAX;
+		});
+
+		return occluded;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "IKdTreeTraversal.h"
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Traverses the compact form of a kd tree without a stack, moving from leaf to leaf along the ropes of
+	/// the geometry's KdTreeRopes. Rays whose origin is known to lie in a node, such as rays leaving an
+	/// intersection found by an earlier ray, can start from that node rather than from the root.
+	/// </summary>
+	class KdTreeRopeTraversal : public IKdTreeTraversal
+	{
+	public:
+
+		/// - IKdTreeTraversal Implementation Begin -
+
+		bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord) override;
+
+		/// <summary>
+		/// Visits the leaves pierced by the ray in [0, tMax), stopping at the first triangle found in that range.
+		/// </summary>
+		bool TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax) override;
+
+		/// - IKdTreeTraversal Implementation End -
+
+		/// <summary>
+		/// Traverses the tree from the specified node of the compact tree, which must contain the ray's origin.
+		/// If hitLeaf is not nullptr, it receives the node index of the leaf containing the intersection found,
+		/// from which rays leaving the intersection can start.
+		/// </summary>
+		bool TraverseFrom(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned startNode,
+			HitRecord& hitRecord, unsigned* hitLeaf = nullptr);
+
+		/// <summary>
+		/// Determines whether the ray intersects any triangle in the range [0, tMax), starting from the
+		/// specified node of the compact tree, which must contain the ray's origin.
+		/// </summary>
+		bool TraverseOcclusionFrom(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned startNode,
+			float tMax);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "KdTreeRopes.h"
+#include "KdTreeCompact.h"
+#include <cassert>
+
+namespace Raytracer
+{
+	void KdTreeRopes::Build(const KdTreeCompact& tree)
+	{
+		Clear();
+
+		if (tree.IsEmpty())
+			return;
+
+		m_LeafIndices.resize(tree.GetNumNodes());
+
+		float boundingMin[3];
+		float boundingMax[3];
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundingMin[axis] = tree.GetBoundingMin()[axis];
+			boundingMax[axis] = tree.GetBoundingMax()[axis];
+		}
+
+		const uint32_t rootRopes[6] = { NoNeighbour, NoNeighbour, NoNeighbour, NoNeighbour, NoNeighbour, NoNeighbour };
+		BuildNode(tree, 0, rootRopes, boundingMin, boundingMax);
+	}
+
+	void KdTreeRopes::Clear()
+	{
+		m_Leaves.clear();
+		m_LeafIndices.clear();
+	}
+
+	bool KdTreeRopes::IsEmpty() const
+	{
+		return m_Leaves.empty();
+	}
+
+	const KdTreeRopes::Leaf& KdTreeRopes::GetLeaf(unsigned nodeIndex) const
+	{
+		assert(nodeIndex < m_LeafIndices.size());
+		return m_Leaves[m_LeafIndices[nodeIndex]];
+	}
+
+	unsigned KdTreeRopes::GetNumLeaves() const
+	{
+		return (unsigned)m_Leaves.size();
+	}
+
+	unsigned KdTreeRopes::FindLeaf(const KdTreeCompact& tree, const vector4& point)
+	{
+		const KdTreeCompactNode* nodes = tree.GetNodes();
+		unsigned nodeIndex = 0;
+
+		while (!nodes[nodeIndex].IsLeaf())
+		{
+			const KdTreeCompactNode& node = nodes[nodeIndex];
+			nodeIndex = point[node.GetAxis()] <= node.m_Split ? nodeIndex + 1 : node.GetAboveChild();
+		}
+
+		return nodeIndex;
+	}
+
+	void KdTreeRopes::BuildNode(const KdTreeCompact& tree, unsigned nodeIndex, const uint32_t ropes[6],
+		const float boundingMin[3], const float boundingMax[3])
+	{
+		const KdTreeCompactNode& node = tree.GetNodes()[nodeIndex];
+
+		if (node.IsLeaf())
+		{
+			Leaf leaf;
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				leaf.m_BoundingMin[axis] = boundingMin[axis];
+				leaf.m_BoundingMax[axis] = boundingMax[axis];
+			}
+
+			for (unsigned face = 0; face < 6; face++)
+				leaf.m_Ropes[face] = OptimizeRope(tree, ropes[face], face, boundingMin, boundingMax);
+
+			m_LeafIndices[nodeIndex] = (uint32_t)m_Leaves.size();
+			m_Leaves.push_back(leaf);
+
+			return;
+		}
+
+		unsigned axis = node.GetAxis();
+		unsigned belowChild = nodeIndex + 1;
+		unsigned aboveChild = node.GetAboveChild();
+
+		// Each child's face on the split leads to the other child; its other faces keep the node's ropes.
+		uint32_t childRopes[6];
+		float childMin[3];
+		float childMax[3];
+
+		for (int i = 0; i < 6; i++)
+			childRopes[i] = ropes[i];
+
+		for (int i = 0; i < 3; i++)
+		{
+			childMin[i] = boundingMin[i];
+			childMax[i] = boundingMax[i];
+		}
+
+		childRopes[axis * 2 + 1] = aboveChild;
+		childMax[axis] = node.m_Split;
+		BuildNode(tree, belowChild, childRopes, childMin, childMax);
+
+		childRopes[axis * 2 + 1] = ropes[axis * 2 + 1];
+		childRopes[axis * 2] = belowChild;
+		childMax[axis] = boundingMax[axis];
+		childMin[axis] = node.m_Split;
+		BuildNode(tree, aboveChild, childRopes, childMin, childMax);
+	}
+
+	uint32_t KdTreeRopes::OptimizeRope(const KdTreeCompact& tree, uint32_t rope, unsigned face, const float boundingMin[3],
+		const float boundingMax[3])
+	{
+		const KdTreeCompactNode* nodes = tree.GetNodes();
+
+		unsigned faceAxis = face / 2;
+		bool maxFace = 1 == (face & 1);
+
+		while (NoNeighbour != rope && !nodes[rope].IsLeaf())
+		{
+			const KdTreeCompactNode& node = nodes[rope];
+			unsigned axis = node.GetAxis();
+
+			if (axis == faceAxis)
+			{
+				// Only the child touching the face is reached through it.
+				rope = maxFace ? rope + 1 : node.GetAboveChild();
+			}
+			else if (node.m_Split <= boundingMin[axis])
+			{
+				rope = node.GetAboveChild();
+			}
+			else if (node.m_Split >= boundingMax[axis])
+			{
+				rope = rope + 1;
+			}
+			else
+			{
+				// The split crosses the face, so both children are neighbours.
+				break;
+			}
+		}
+
+		return rope;
+	}
+}
\ No newline at end of file
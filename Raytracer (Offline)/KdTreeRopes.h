@@ -0,0 +1,86 @@
+#pragma once
+
+#include <MathLib.h>
+#include <stdint.h>
+#include <vector>
+
+using namespace MathLib;
+using std::vector;
+
+namespace Raytracer
+{
+	class KdTreeCompact;
+
+	/// <summary>
+	/// Neighbour links, or ropes, of the leaves of a compact kd tree. Each face of a leaf's voxel links to the
+	/// smallest node which holds everything on the other side of the face. A ray leaving a leaf follows the
+	/// rope of the face it exits through, and descends from there to the next leaf, so the tree is traversed
+	/// without a stack, and rays can start from any node containing their origin rather than the root.
+	///
+	/// The ropes are built as a pass over a finished tree, so they can be added to a tree from any builder,
+	/// including trees loaded from the tree cache.
+	/// </summary>
+	/// <remarks>
+	/// Based on "Stackless KD-Tree Traversal for High Performance GPU Ray Tracing" by Stefan Popov, Johannes
+	/// Gunther, Hans-Peter Seidel and Philipp Slusallek.
+	/// </remarks>
+	class KdTreeRopes
+	{
+	public:
+
+		/// Rope of a face on the boundary of the whole tree.
+		static const uint32_t NoNeighbour = 0xffffffff;
+
+		/// <summary>
+		/// The voxel and ropes of a leaf. Ropes are indexed by axis * 2 for the face at the voxel's minimum along
+		/// the axis, and axis * 2 + 1 for the face at its maximum, and hold node indices of the compact tree.
+		/// </summary>
+		struct Leaf
+		{
+			float m_BoundingMin[3];
+			float m_BoundingMax[3];
+
+			uint32_t m_Ropes[6];
+		};
+
+		/// <summary>
+		/// Builds the ropes of the tree, replacing any built previously.
+		/// </summary>
+		void Build(const KdTreeCompact& tree);
+
+		void Clear();
+
+		bool IsEmpty() const;
+
+		/// <summary>
+		/// Returns the voxel and ropes of the leaf at the specified node index of the tree.
+		/// </summary>
+		const Leaf& GetLeaf(unsigned nodeIndex) const;
+
+		unsigned GetNumLeaves() const;
+
+		/// <summary>
+		/// Returns the node index of the leaf containing the point, which must be inside the tree's root voxel.
+		/// Points on a split are placed in the leaf below it.
+		/// </summary>
+		static unsigned FindLeaf(const KdTreeCompact& tree, const vector4& point);
+
+	protected:
+
+		vector<Leaf> m_Leaves;
+
+		/// Index into m_Leaves of each leaf of the tree, indexed by node. Entries of interior nodes are unused.
+		vector<uint32_t> m_LeafIndices;
+
+		/// <summary>Builds the ropes of the node's subtree, given the ropes and bounds of the node.</summary>
+		void BuildNode(const KdTreeCompact& tree, unsigned nodeIndex, const uint32_t ropes[6], const float boundingMin[3],
+			const float boundingMax[3]);
+
+		/// <summary>
+		/// Moves a rope of a leaf down to the smallest node still holding the whole of the leaf's face, so
+		/// that rays following it descend fewer nodes.
+		/// </summary>
+		static uint32_t OptimizeRope(const KdTreeCompact& tree, uint32_t rope, unsigned face, const float boundingMin[3],
+			const float boundingMax[3]);
+	};
+}
\ No newline at end of file
@@ -1,7 +1,13 @@
 #include "KdTreeStackTraversal.h"
 #include "KdTreeGeometry.h"
+#include "Mailbox.h"
 #include "kdTreeNode.h"
 #include "DebugManager.h"
+#include "TraversalLeaf.h"
+#include "TraversalRay.h"
+#include "TraversalStatistics.h"
+#include <cassert>
+#include <cfloat>
 #include <iostream>
 #include <MathLib.h>
 #include <Geometry.h>
@@ -13,17 +19,19 @@ using namespace CommonCode;
 
 namespace Raytracer
 {
-	struct IntersectionInfo
+	struct PacketIntersectionInfo
 	{
 		const KdTreeGeometry& m_Mesh;
-		const ray& m_Ray;
-		unsigned int& m_Index;
-		float& m_T;
-		float& m_U;
-		float& m_V;
+		const RayPacket& m_Packet;
+		HitRecord* m_HitRecords;
+
+		/// Closest intersection found so far for each ray.
+		float m_ClosestT[RayPacket::MaxSize];
+
+		uint32_t m_HitMask;
 	};
 
-	static void RenderDebugInfo(KdTreeNode& node, IntersectionInfo& intersectionInfo)
+	static void RenderDebugInfo(const KdTreeNode& node, const KdTreeGeometry& geometry)
 	{
 		auto& debugManager = DebugManager::GetInstance();
 		const auto& minExtents = node.GetBoundingMin();
@@ -109,7 +117,7 @@ namespace Raytracer
 		{
 			auto numTriangles = node.GetNumTriangles();
 			auto triangleIndices = node.GetTriangleList();
-			auto triangles = intersectionInfo.m_Mesh.GetTriangles();
+			auto triangles = geometry.GetTriangles();
 			
 			for (unsigned i = 0; i < numTriangles; i++)
 			{
@@ -162,140 +170,251 @@ namespace Raytracer
 		}
 	}
 
-	static bool IntersectKdTreeChildNode(KdTreeNode& node, IntersectionInfo& intersectionInfo)
+	/// <summary>
+	/// Lets VisitLeaves walk a pointer based tree. Nodes of lazily built trees are expanded when they are visited,
+	/// before anything reads their children or triangles.
+	/// </summary>
+	struct KdTreeNodeAdapter
+	{
+		typedef KdTreeNode Node;
+		static const unsigned MaxDepth = KdTreeStackTraversal::MaxDepth;
+
+		const KdTreeGeometry& m_Geometry;
+		bool m_RenderDebugInfo;
+
+		void Visit(KdTreeNode& node) const
+		{
+			if (node.IsUnexpanded())
+				m_Geometry.ExpandKdTreeNode(node);
+
+			if (m_RenderDebugInfo)
+				RenderDebugInfo(node, m_Geometry);
+		}
+
+		bool IsLeaf(const KdTreeNode& node) const
+		{
+			return node.IsChild();
+		}
+
+		unsigned GetAxis(const KdTreeNode& node) const
+		{
+			return node.GetSplitAxis();
+		}
+
+		float GetSplit(const KdTreeNode& node) const
+		{
+			return node.GetSplitPosition();
+		}
+
+		KdTreeNode* GetChild(const KdTreeNode& node, bool above) const
+		{
+			return node.GetChildren()[above ? 1 : 0];
+		}
+	};
+
+	bool KdTreeStackTraversal::Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord)
 	{
+		auto rootNode = geometry.GetRootNode();
+		if (nullptr == rootNode)
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tMin = 0.0f;
+		float tMax = FLT_MAX;
+
+		// The ray is clipped to the root's voxel once. Each node then only divides the interval between its children.
+		if (!ClipRayToBounds(traversalRay, rootNode->GetBoundingMin(), rootNode->GetBoundingMax(), tMin, tMax))
+		{
+			RAYTRACER_COUNT(m_NodesVisited, 1);
+			return false;
+		}
+
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+
 		bool intersectionFound = false;
-		unsigned int index = 0;
-		float t = FLT_MAX;
-		float u;
-		float v;
+		float closestT = FLT_MAX;
+
+		KdTreeNodeAdapter adapter = { geometry, DebugManager::GetInstance().GetEnabled() };
+
+		VisitLeaves(adapter, rootNode, traversalRay, tMin, tMax, [&](const KdTreeNode& leaf) -> float
+		{
+			if (IntersectLeafTriangles(intersectionRay, triangles, leaf.GetTriangleList(),
+				leaf.GetNumTriangles(), mailbox, closestT, hitRecord))
+				intersectionFound = true;
+
+			return closestT;
+		});
+
+		return intersectionFound;
+	}
+
+	bool KdTreeStackTraversal::TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax)
+	{
+		auto rootNode = geometry.GetRootNode();
+		if (nullptr == rootNode)
+			return false;
+
+		TraversalRay traversalRay(intersectionRay);
+
+		float tSegmentMin = 0.0f;
+		float tSegmentMax = tMax;
+
+		if (!ClipRayToBounds(traversalRay, rootNode->GetBoundingMin(), rootNode->GetBoundingMax(), tSegmentMin, tSegmentMax))
+		{
+			RAYTRACER_COUNT(m_NodesVisited, 1);
+			return false;
+		}
 
+		auto triangles = geometry.GetTriangles();
+		TriangleMailbox* mailbox = BeginMailboxRay();
+
+		bool occluded = false;
+
+		KdTreeNodeAdapter adapter = { geometry, DebugManager::GetInstance().GetEnabled() };
+
+		VisitLeaves(adapter, rootNode, traversalRay, tSegmentMin, tSegmentMax, [&](const KdTreeNode& leaf) -> float
+		{
+			if (!OccludedByLeafTriangles(intersectionRay, triangles, leaf.GetTriangleList(),
+				leaf.GetNumTriangles(), mailbox, tMax))
+				return FLT_MAX;
+
+			occluded = true;
+			return -FLT_MAX;
+		});
+
+		return occluded;
+	}
+
+	static void IntersectKdTreeChildNodePacket(KdTreeNode& node, uint32_t activeMask, PacketIntersectionInfo& intersectionInfo)
+	{
 		auto triangleList = node.GetTriangleList();
 		auto triangles = intersectionInfo.m_Mesh.GetTriangles();
 		auto numTriangles = node.GetNumTriangles();
+		auto packetSize = intersectionInfo.m_Packet.m_Size;
+
+		unsigned int numActiveRays = RayPacket::CountRays(activeMask);
+		RAYTRACER_COUNT(m_LeavesVisited, numActiveRays);
+		RAYTRACER_COUNT(m_TriangleTests, numTriangles * numActiveRays);
 
+		// Loop over the triangles on the outside so that each triangle is fetched once for the whole packet.
 		for (unsigned int i = 0; i < numTriangles; i++)
 		{
-			float currentT;
-			float currentU;
-			float currentV;
+			const Triangle& triangle = triangles[triangleList[i]];
 
-			if (GeometryLib::RayTriangleIntersection(intersectionInfo.m_Ray, triangles[triangleList[i]], currentT, currentU, currentV))
+			for (unsigned int r = 0; r < packetSize; r++)
 			{
-				if (currentT < t)
-				{
-					// The triangle is closer to the ray origin than the previous value.
-					intersectionFound = true;
+				if (0 == (activeMask & (1u << r)))
+					continue;
 
-					index = i;
-					t = currentT;
-					u = currentU;
-					v = currentV;
-				}
+				float currentT;
+				float currentU;
+				float currentV;
+
+				if (!GeometryLib::RayTriangleIntersection(intersectionInfo.m_Packet.m_Rays[r], triangle, currentT, currentU, currentV))
+					continue;
+
+				// Triangles behind the ray origin are rejected here, as the packet does not clip the rays to
+				// each node's voxel.
+				if (currentT < 0.0f || currentT >= intersectionInfo.m_ClosestT[r])
+					continue;
+
+				HitRecord& hitRecord = intersectionInfo.m_HitRecords[r];
+				hitRecord.m_T = currentT;
+				hitRecord.m_U = currentU;
+				hitRecord.m_V = currentV;
+				hitRecord.m_PrimitiveId = triangleList[i];
+
+				intersectionInfo.m_ClosestT[r] = currentT;
+				intersectionInfo.m_HitMask |= 1u << r;
 			}
 		}
+	}
+
+	static void IntersectKdTreeNodePacket(KdTreeNode& node, uint32_t activeMask, PacketIntersectionInfo& intersectionInfo)
+	{
+		auto packetSize = intersectionInfo.m_Packet.m_Size;
+
+		// Rays which miss this node's voxel, or which already have an intersection closer than the voxel,
+		// drop out of the packet for this subtree.
+		uint32_t nodeMask = 0;
+		unsigned int firstActiveRay = packetSize;
 
-		if (intersectionFound)
+		unsigned int numActiveRays = RayPacket::CountRays(activeMask);
+		RAYTRACER_COUNT(m_NodesVisited, numActiveRays);
+		RAYTRACER_COUNT(m_AABBTests, numActiveRays);
+
+		for (unsigned int r = 0; r < packetSize; r++)
 		{
-			//?
-			intersectionInfo.m_Index = triangleList[index];
-			intersectionInfo.m_T = t;
-			intersectionInfo.m_U = u;
-			intersectionInfo.m_V = v;
-		}
+			if (0 == (activeMask & (1u << r)))
+				continue;
 
-		return intersectionFound;
-	}
+			float tEntry;
+			float tExit;
 
-	static bool IntersectKdTreeNode(KdTreeNode& node, IntersectionInfo& intersectionInfo)
-	{
-		auto& debugManager = DebugManager::GetInstance();
-		if (debugManager.GetEnabled())
-			RenderDebugInfo(node, intersectionInfo);
+			if (!GeometryLib::RayIntersectsAABB(intersectionInfo.m_Packet.m_Rays[r], &tEntry, &tExit, node.GetBoundingMin(), node.GetBoundingMax()))
+				continue;
 
-		float tEntry;		// t value of the ray at the entry point of this node's voxel.
-		float tExit;		// t value of the ray at the exit point of this node's voxel.
-		float tPlane;		// t value of the ray if it intersects the splitting plane of this node's voxel.
+			if (tEntry > intersectionInfo.m_ClosestT[r])
+				continue;
 
-		bool rayIntersectsAABB = GeometryLib::RayIntersectsAABB(intersectionInfo.m_Ray, &tEntry, &tExit, node.GetBoundingMin(), node.GetBoundingMax());
-		if (!rayIntersectsAABB)
-			return false;
+			nodeMask |= 1u << r;
+
+			if (firstActiveRay == packetSize)
+				firstActiveRay = r;
+		}
+
+		if (0 == nodeMask)
+			return;
+
+		if (node.IsUnexpanded())
+			intersectionInfo.m_Mesh.ExpandKdTreeNode(node);
 
 		if (node.IsChild())
-			return IntersectKdTreeChildNode(node, intersectionInfo);
+		{
+			IntersectKdTreeChildNodePacket(node, nodeMask, intersectionInfo);
+			return;
+		}
 
 		auto childNodes = node.GetChildren();
 
-		// Determine the index of the near and far sides of the node.
+		// The rays of a packet are assumed to be coherent, so the first active ray decides the
+		// order in which the children are visited. This only affects how early rays drop out of the
+		// packet, not the result.
 		unsigned int nearSideIndex = 0;
 		unsigned int farSideIndex = 1;
 
-		bool pointInPositivePlaneHalf = MathLib::pointOnPositivePlaneSide(node.GetSplittingPlane(), intersectionInfo.m_Ray.getPosition());
-		if (pointInPositivePlaneHalf)
+		if (MathLib::pointOnPositivePlaneSide(node.GetSplittingPlane(), intersectionInfo.m_Packet.m_Rays[firstActiveRay].getPosition()))
 		{
 			nearSideIndex = 1;
 			farSideIndex = 0;
 		}
 
-		bool rayIntersectsSplittingPlane = MathLib::intersectRayWithPlane(intersectionInfo.m_Ray, node.GetSplittingPlane(), &tPlane);
-		rayIntersectsSplittingPlane = rayIntersectsSplittingPlane && (tPlane > 0.0f);
-		if (!rayIntersectsSplittingPlane)
-			return IntersectKdTreeNode(*childNodes[nearSideIndex], intersectionInfo);
-
-		// Determine if we need to traverse one or both nodes of the node.
-		if (tExit < tPlane)
-			return IntersectKdTreeNode(*childNodes[nearSideIndex], intersectionInfo);
-
-		if (tPlane < tEntry)
-			return IntersectKdTreeNode(*childNodes[farSideIndex], intersectionInfo);
-
-		bool intersectionFound = IntersectKdTreeNode(*childNodes[nearSideIndex], intersectionInfo);
-		if (intersectionFound)
-		{
-			vector4 point;
-			vector4_addScaledVector(intersectionInfo.m_Ray.getPosition(), intersectionInfo.m_Ray.getDirection(), intersectionInfo.m_T, point);
-
-			auto oldT = intersectionInfo.m_T;
-			auto oldU = intersectionInfo.m_U;
-			auto oldV = intersectionInfo.m_V;
-			auto oldIndex = intersectionInfo.m_Index;
-
-			if (pointInPositivePlaneHalf != MathLib::pointOnPositivePlaneSide(node.GetSplittingPlane(), point))
-			{
-				if (IntersectKdTreeNode(*childNodes[farSideIndex], intersectionInfo))
-				{
-					if (oldT < intersectionInfo.m_T)
-					{
-						intersectionInfo.m_T = oldT;
-						intersectionInfo.m_U = oldU;
-						intersectionInfo.m_V = oldV;
-						intersectionInfo.m_Index = oldIndex;
-					}
-				}
-			}
-			
-			return true;
-		}
-		
-		return IntersectKdTreeNode(*childNodes[farSideIndex], intersectionInfo);
-	} 
+		IntersectKdTreeNodePacket(*childNodes[nearSideIndex], nodeMask, intersectionInfo);
+		IntersectKdTreeNodePacket(*childNodes[farSideIndex], nodeMask, intersectionInfo);
+	}
 
-	bool KdTreeStackTraversal::Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned int* index, float* t, float* u, float* v)
+	uint32_t KdTreeStackTraversal::TraversePacket(const KdTreeGeometry& geometry, const RayPacket& packet, HitRecord* hitRecords)
 	{
 		auto rootNode = geometry.GetRootNode();
 		if (nullptr == rootNode)
-			return false;
+			return 0;
 
-		IntersectionInfo intersectionInfo =
+		PacketIntersectionInfo intersectionInfo =
 		{
 			geometry,
-			intersectionRay,
-			*index,
-			*t,
-			*u,
-			*v
+			packet,
+			hitRecords,
+			{},
+			0
 		};
 
-		return IntersectKdTreeNode(*rootNode, intersectionInfo);
+		for (unsigned int i = 0; i < packet.m_Size; i++)
+			intersectionInfo.m_ClosestT[i] = FLT_MAX;
+
+		IntersectKdTreeNodePacket(*rootNode, packet.m_ActiveMask, intersectionInfo);
+
+		return intersectionInfo.m_HitMask;
 	}
 }
\ No newline at end of file
@@ -1,14 +1,41 @@
+#pragma once
+
 #include "IKdTreeTraversal.h"
+#include "KdTreeCompact.h"
 
 namespace Raytracer
 {
+	/// <summary>
+	/// Traverses a kd tree in its node form, which lazily built trees and debug rendering need. Single rays are
+	/// traversed iteratively with an explicit stack, like KdTreeCompactTraversal: the ray is clipped to the
+	/// root's voxel once, and each node's split then divides the ray's interval between its children.
+	/// </summary>
 	class KdTreeStackTraversal : public IKdTreeTraversal
 	{
 	public:
 
+		/// Deepest tree that single rays can be traversed through, which sizes the traversal stack. The builders
+		/// never build trees deeper than MaxDepth - 1, so the stack cannot overflow.
+		static const unsigned MaxDepth = KdTreeCompact::MaxDepth;
+
 		/// - IKdTreeTraversal Implementation Begin -
 
-		bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, unsigned int* index, float* t, float* u, float* v) override;
+		/// <summary>
+		/// Visits the leaves pierced by the ray front to back, stopping at the first leaf holding an intersection
+		/// closer than the leaf's exit distance.
+		/// </summary>
+		bool Traverse(const KdTreeGeometry& geometry, const ray& intersectionRay, HitRecord& hitRecord) override;
+
+		/// <summary>
+		/// Visits the leaves pierced by the ray in [0, tMax), stopping at the first triangle found in that range.
+		/// </summary>
+		bool TraverseOcclusion(const KdTreeGeometry& geometry, const ray& intersectionRay, float tMax) override;
+
+		/// <summary>
+		/// Traverses the tree once for the whole packet. A node is visited if any active ray intersects its voxel,
+		/// so the rays share node fetches and each leaf triangle is loaded once for the whole packet.
+		/// </summary>
+		uint32_t TraversePacket(const KdTreeGeometry& geometry, const RayPacket& packet, HitRecord* hitRecords) override;
 
 		/// - IKdTreeTraversal Implementation End -
 	};
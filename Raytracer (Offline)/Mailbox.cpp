@@ -0,0 +1,31 @@
+#include "Mailbox.h"
+
+namespace Raytracer
+{
+	namespace
+	{
+		bool s_MailboxingEnabled = false;
+
+		RAYTRACER_THREAD_LOCAL TriangleMailbox g_ThreadMailbox;
+	}
+
+	void SetMailboxingEnabled(bool enabled)
+	{
+		s_MailboxingEnabled = enabled;
+	}
+
+	bool IsMailboxingEnabled()
+	{
+		return s_MailboxingEnabled;
+	}
+
+	TriangleMailbox* BeginMailboxRay()
+	{
+		if (!s_MailboxingEnabled)
+			return nullptr;
+
+		g_ThreadMailbox.BeginRay();
+
+		return &g_ThreadMailbox;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "TraversalStatistics.h"
+#include <stdint.h>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Remembers the triangles the current ray has already been tested against. A triangle overlapping several
+	/// leaves is referenced by each of them, and a ray visiting more than one of those leaves would otherwise
+	/// test it again. Rays are told apart by an ID, so starting a new ray costs nothing.
+	///
+	/// The slots are hashed, and a triangle evicted by another one is simply tested again, so the mailbox
+	/// never changes what a ray hits. It is a plain struct, zero initialized, so it can be thread local.
+	/// </summary>
+	struct TriangleMailbox
+	{
+		static const unsigned NumSlotBits = 6;
+		static const unsigned NumSlots = 1 << NumSlotBits;
+
+		uint32_t m_RayId;
+		uint32_t m_RayIds[NumSlots];
+		uint32_t m_Triangles[NumSlots];
+
+		/// <summary>Starts a new ray, forgetting the triangles tested by all previous rays.</summary>
+		void BeginRay()
+		{
+			// Slots still holding ID 0 were never used, so IDs start at 1 again after wrapping around.
+			if (0 == ++m_RayId)
+			{
+				for (unsigned i = 0; i < NumSlots; i++)
+					m_RayIds[i] = 0;
+
+				m_RayId = 1;
+			}
+		}
+
+		/// <summary>
+		/// Returns true if the current ray has already been tested against the triangle. Otherwise the triangle
+		/// is recorded as tested and false is returned.
+		/// </summary>
+		bool CheckAndMark(uint32_t triangle)
+		{
+			// Fibonacci hashing spreads the consecutive indices of neighbouring triangles over the slots.
+			unsigned slot = (triangle * 2654435769u) >> (32 - NumSlotBits);
+
+			if (m_RayIds[slot] == m_RayId && m_Triangles[slot] == triangle)
+				return true;
+
+			m_RayIds[slot] = m_RayId;
+			m_Triangles[slot] = triangle;
+
+			return false;
+		}
+	};
+
+	/// <summary>
+	/// Enables or disables mailboxing for the single rays traced from now on, on all threads. It is disabled by
+	/// default. Change it only while no rays are being traced.
+	/// </summary>
+	void SetMailboxingEnabled(bool enabled);
+
+	bool IsMailboxingEnabled();
+
+	/// <summary>
+	/// Returns the calling thread's mailbox, started on a new ray, or nullptr if mailboxing is disabled.
+	/// </summary>
+	TriangleMailbox* BeginMailboxRay();
+}
\ No newline at end of file
@@ -16,7 +16,7 @@ namespace KdTreeConstruction
 		m_NumTriangles = geometry.GetNumTriangles();
 		m_Triangles = geometry.GetTriangles();
 
-		auto rootNode = new KdTreeNode;
+		auto rootNode = m_Arena.New<KdTreeNode>();
 
 		vector4 boundingMin;
 		vector4 boundingMax;
@@ -27,8 +27,7 @@ namespace KdTreeConstruction
 
 		RecursiveBuild(rootNode, 0);
 
-		geometry.ResetKdTree();
-		geometry.m_RootNode = rootNode;
+		geometry.ReplaceKdTree(rootNode, m_Arena);
 	}
 
 	bool NaiveSpatialMedian::Terminate(unsigned level)
@@ -98,11 +97,11 @@ namespace KdTreeConstruction
 		splittingPlane.setPointOnPlane(boundingMid);
 		plane_copy(node->m_SplittingPlane, splittingPlane);
 
-		node->m_Children[0] = new KdTreeNode;
+		node->m_Children[0] = m_Arena.New<KdTreeNode>();
 		vector4_copy(node->m_Children[0]->m_BoundingMin, leftBoundingMin);
 		vector4_copy(node->m_Children[0]->m_BoundingMax, leftBoundingMax);
 
-		node->m_Children[1] = new KdTreeNode;
+		node->m_Children[1] = m_Arena.New<KdTreeNode>();
 		vector4_copy(node->m_Children[1]->m_BoundingMin, rightBoundingMin);
 		vector4_copy(node->m_Children[1]->m_BoundingMax, rightBoundingMax);
 
@@ -124,7 +123,7 @@ namespace KdTreeConstruction
 		// Copy triangle indices to node.
 		size_t numIndices = indexVector.size();
 		node->m_NumTriangles = (unsigned)numIndices;
-		node->m_TriangleList = new unsigned[numIndices];
+		node->m_TriangleList = m_Arena.AllocateArray<unsigned>(numIndices);
 
 		for (size_t i = 0; i < numIndices; i++)
 			node->m_TriangleList[i] = indexVector[i];
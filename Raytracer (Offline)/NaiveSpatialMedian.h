@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IKdTreeBuilder.h"
+#include <MemoryArena.h>
 
 namespace GeometryLib
 {
@@ -31,6 +32,9 @@ namespace KdTreeConstruction
 		unsigned m_NumTriangles;
 
 		const GeometryLib::Triangle* m_Triangles;
+
+		/// Storage of the tree being constructed, handed over to the geometry once it is complete.
+		Core::MemoryArena m_Arena;
 		
 		bool Terminate(unsigned level);
 
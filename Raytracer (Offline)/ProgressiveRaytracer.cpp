@@ -0,0 +1,236 @@
+#include "ProgressiveRaytracer.h"
+#include "DeferredShadingPass.h"
+#include "HighPerformanceTimer.h"
+#include <MathLib.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <string>
+
+using namespace MathLib;
+using namespace Core;
+using namespace std;
+using CameraLib::RayGenerator;
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// <summary>
+		/// Calls function(x, y) for every pixel of the tile which is first traced by the pass with the specified step.
+		/// The pass traces pixels whose coordinates are both multiples of step, skipping those which are also
+		/// multiples of twice the step as the previous pass has already traced them.
+		/// </summary>
+		template <typename Function>
+		void ForEachPassPixel(const Tile& tile, unsigned step, Function function)
+		{
+			const bool isFirstPass = ProgressiveRaytracer::CoarsestStep == step;
+			const unsigned previousStep = step * 2;
+
+			unsigned firstY = (tile.m_Y + step - 1) / step * step;
+			unsigned firstX = (tile.m_X + step - 1) / step * step;
+
+			for (unsigned y = firstY; y < tile.m_Y + tile.m_Height; y += step)
+			{
+				// Rows traced by the previous pass only contain new pixels in odd multiples of the step.
+				bool isRowTraced = !isFirstPass && 0 == y % previousStep;
+
+				unsigned x = firstX;
+				if (isRowTraced && 0 == x % previousStep)
+					x += step;
+
+				for (; x < tile.m_X + tile.m_Width; x += isRowTraced ? previousStep : step)
+					function(x, y);
+			}
+		}
+	}
+
+	ProgressiveRaytracer::ProgressiveRaytracer() :
+		TiledRaytracer(),
+		m_TimeBudget(0.0),
+		m_NumCompletedPasses(0)
+	{
+	}
+
+	ProgressiveRaytracer::ProgressiveRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene) :
+		TiledRaytracer(frameBuffer, camera, scene),
+		m_TimeBudget(0.0),
+		m_NumCompletedPasses(0)
+	{
+	}
+
+	void ProgressiveRaytracer::SetTimeBudget(double milliseconds)
+	{
+		assert(milliseconds >= 0.0);
+		m_TimeBudget = milliseconds;
+	}
+
+	double ProgressiveRaytracer::GetTimeBudget() const
+	{
+		return m_TimeBudget;
+	}
+
+	unsigned ProgressiveRaytracer::GetNumCompletedPasses() const
+	{
+		return m_NumCompletedPasses;
+	}
+
+	unsigned ProgressiveRaytracer::GetNumPasses()
+	{
+		unsigned numPasses = 0;
+		for (unsigned step = CoarsestStep; step > 0; step /= 2)
+			numPasses++;
+
+		return numPasses;
+	}
+
+	void ProgressiveRaytracer::Raytrace()
+	{
+		vector<Tile> tiles;
+		unsigned numWorkers = BeginFrame(tiles);
+
+		RayGenerator rayGenerator(*m_Camera, m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight());
+		TileScheduler scheduler(numWorkers);
+
+		HighPerformanceTimer timer;
+		timer.Start();
+
+		m_NumCompletedPasses = 0;
+
+		for (unsigned step = CoarsestStep; step > 0; step /= 2)
+		{
+			// The first pass is rendered regardless of the budget, as it is needed to cover the frame buffer.
+			bool enforceBudget = m_TimeBudget > 0.0 && step != CoarsestStep;
+
+			if (enforceBudget && timer.GetElapsedTimeMilliseconds() >= m_TimeBudget)
+				break;
+
+			scheduler.Reset((unsigned)tiles.size());
+			m_NumTilesRendered = 0;
+
+			RunWorkers(numWorkers, [&](unsigned workerIndex)
+			{
+				RenderPassTiles(workerIndex, scheduler, tiles, rayGenerator, step, enforceBudget, timer);
+			});
+
+			if (m_NumTilesRendered < tiles.size())
+				break;
+
+			m_NumCompletedPasses++;
+		}
+
+		timer.Stop();
+
+		ConvertHeatmapToFalseColour();
+
+		PrintFrameTime(timer.GetTimeMilliseconds(), numWorkers,
+			to_string(m_NumCompletedPasses) + " of " + to_string(GetNumPasses()) + " passes");
+		PrintTraversalStatistics(m_FrameStatistics);
+	}
+
+	void ProgressiveRaytracer::RenderPassTiles(unsigned workerIndex, TileScheduler& scheduler, const vector<Tile>& tiles,
+		const RayGenerator& rayGenerator, unsigned step, bool enforceBudget, const HighPerformanceTimer& timer)
+	{
+		DeferredShadingPass shadingPass;
+
+		unsigned tileIndex;
+		while (scheduler.AcquireTile(workerIndex, tileIndex))
+		{
+			// Tiles are never left partially rendered, so the budget is only checked between tiles. Once it has
+			// run out the remaining tiles are drained without rendering them.
+			if (enforceBudget && timer.GetElapsedTimeMilliseconds() >= m_TimeBudget)
+				continue;
+
+			RenderPassTile(tiles[tileIndex], rayGenerator, step, shadingPass);
+			m_NumTilesRendered++;
+		}
+	}
+
+	void ProgressiveRaytracer::RenderPassTile(const Tile& tile, const RayGenerator& rayGenerator, unsigned step,
+		DeferredShadingPass& shadingPass)
+	{
+		unsigned frameBufferWidth = m_FrameBuffer->GetWidth();
+		unsigned frameBufferHeight = m_FrameBuffer->GetHeight();
+		float* frameBufferData = m_FrameBuffer->GetData();
+
+		// Pixels traced by a pass are spread out, so rays are generated individually and gathered into packets.
+		const unsigned packetWidth = 8;
+
+		RayPacket packet(packetWidth);
+		for (unsigned i = 0; i < packetWidth; i++)
+			packet.m_Rays[i].setPosition(rayGenerator.GetOrigin());
+
+		// Every pixel of the pass lies within the tile, so the tile's beam encloses their rays.
+		RayBeam beam;
+		BeamEntryCache entryCache;
+		packet.m_Beam = PrepareTileBeam(tile, rayGenerator, beam, entryCache);
+
+		unsigned pixelIndices[packetWidth];
+		unsigned numRays = 0;
+
+		ForEachPassPixel(tile, step, [&](unsigned x, unsigned y)
+		{
+			vector4 direction;
+			rayGenerator.GenerateDirection((float)x, (float)y, direction);
+
+			packet.m_Rays[numRays].setDirection(direction);
+			pixelIndices[numRays] = y * frameBufferWidth + x;
+
+			if (++numRays == packetWidth)
+			{
+				TraceSamples(packet, numRays, pixelIndices, shadingPass);
+				numRays = 0;
+			}
+		});
+
+		if (numRays > 0)
+			TraceSamples(packet, numRays, pixelIndices, shadingPass);
+
+		shadingPass.Shade(*m_Scene);
+
+		if (1 == step)
+			return;
+
+		// Replicate each traced pixel over its block. Blocks of a pass never overlap, so this is safe even where
+		// a block extends into a neighbouring tile.
+		ForEachPassPixel(tile, step, [&](unsigned x, unsigned y)
+		{
+			const float* source = frameBufferData + (y * frameBufferWidth + x) * 4;
+
+			unsigned blockWidth = min(step, frameBufferWidth - x);
+			unsigned blockHeight = min(step, frameBufferHeight - y);
+
+			for (unsigned blockY = y; blockY < y + blockHeight; blockY++)
+			{
+				float* destination = frameBufferData + (blockY * frameBufferWidth + x) * 4;
+
+				for (unsigned blockX = 0; blockX < blockWidth; blockX++, destination += 4)
+				{
+					if (destination != source)
+						memcpy(destination, source, sizeof(float) * 4);
+				}
+			}
+		});
+	}
+
+	void ProgressiveRaytracer::TraceSamples(RayPacket& packet, unsigned numRays, const unsigned* pixelIndices,
+		DeferredShadingPass& shadingPass)
+	{
+		float* frameBufferData = m_FrameBuffer->GetData();
+		HitRecord hitRecords[RayPacket::MaxSize];
+
+		packet.m_ActiveMask = RayPacket::MaskForSize(numRays);
+		uint32_t hitMask = TracePixelPacket(packet, hitRecords, pixelIndices);
+
+		// Pixels which miss the scene are cleared to transparent black.
+		for (unsigned i = 0; i < numRays; i++)
+		{
+			float* target = frameBufferData + pixelIndices[i] * 4;
+
+			if (0 != (hitMask & (1u << i)))
+				shadingPass.AddHit(hitRecords[i], target);
+			else
+				memset(target, 0, sizeof(float) * 4);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "TiledRaytracer.h"
+#include <atomic>
+
+namespace Core
+{
+	class HighPerformanceTimer;
+}
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Multithreaded raytracer which renders within a wall clock time budget.
+	///
+	/// The frame is rendered as a sequence of interleaved passes. The first pass traces one pixel in every
+	/// CoarsestStep x CoarsestStep block, and each following pass halves the step, tracing only the pixels
+	/// which earlier passes skipped. Every traced pixel is replicated over the block it stands in for until a
+	/// finer pass refines it, so the frame buffer holds a complete full resolution image once the first pass
+	/// is done. Rendering stops as soon as the budget runs out; the first pass is always completed.
+	/// </summary>
+	class ProgressiveRaytracer : public TiledRaytracer
+	{
+	public:
+
+		static const unsigned CoarsestStep = 16;
+
+		ProgressiveRaytracer();
+		ProgressiveRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene);
+
+		/// <summary>
+		/// Sets the time in milliseconds available to render a frame. A value of 0 disables the budget, in
+		/// which case every pass is rendered.
+		/// </summary>
+		void SetTimeBudget(double milliseconds);
+		double GetTimeBudget() const;
+
+		void Raytrace() override;
+
+		/// <summary>Returns the number of passes the last frame completed before the budget ran out.</summary>
+		unsigned GetNumCompletedPasses() const;
+
+		/// <summary>Returns the total number of passes needed to trace every pixel of a frame.</summary>
+		static unsigned GetNumPasses();
+
+	protected:
+
+		double m_TimeBudget;
+		unsigned m_NumCompletedPasses;
+
+		/// <summary>Number of tiles of the current pass rendered so far.</summary>
+		std::atomic<unsigned> m_NumTilesRendered;
+
+		/// <summary>
+		/// Acquires and renders the tiles of one pass until the scheduler has none remaining, or the budget
+		/// has run out.
+		/// </summary>
+		void RenderPassTiles(unsigned workerIndex, TileScheduler& scheduler, const std::vector<Tile>& tiles,
+			const CameraLib::RayGenerator& rayGenerator, unsigned step, bool enforceBudget,
+			const Core::HighPerformanceTimer& timer);
+
+		/// <summary>
+		/// Traces the pixels of the tile belonging to the pass with the specified step, then fills the block
+		/// each of them stands in for.
+		/// </summary>
+		void RenderPassTile(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, unsigned step,
+			DeferredShadingPass& shadingPass);
+
+		/// <summary>
+		/// Traces the first numRays rays of the packet for the pixels with the specified indices, queueing hits
+		/// to be shaded into the frame buffer.
+		/// </summary>
+		void TraceSamples(RayPacket& packet, unsigned numRays, const unsigned* pixelIndices, DeferredShadingPass& shadingPass);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <MathLib.h>
+
+using namespace MathLib;
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Entry nodes found for one beam, remembered per acceleration structure and per space the beam was
+	/// transformed into, so that every packet of the beam reuses them.
+	/// </summary>
+	class BeamEntryCache
+	{
+	public:
+
+		static const unsigned MaxEntries = 16;
+
+		BeamEntryCache() :
+			m_NumEntries(0)
+		{
+		}
+
+		/// <summary>Looks up the entry node found for the structure in the specified space.</summary>
+		bool Find(const void* structure, const void* space, unsigned& node) const
+		{
+			for (unsigned i = 0; i < m_NumEntries; i++)
+			{
+				if (m_Entries[i].m_Structure == structure && m_Entries[i].m_Space == space)
+				{
+					node = m_Entries[i].m_Node;
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		/// <summary>Remembers an entry node. Once the cache is full, further entry nodes are searched every time.</summary>
+		void Add(const void* structure, const void* space, unsigned node)
+		{
+			if (m_NumEntries == MaxEntries)
+				return;
+
+			Entry& entry = m_Entries[m_NumEntries++];
+			entry.m_Structure = structure;
+			entry.m_Space = space;
+			entry.m_Node = node;
+		}
+
+		void Clear()
+		{
+			m_NumEntries = 0;
+		}
+
+	private:
+
+		struct Entry
+		{
+			const void* m_Structure;
+			const void* m_Space;
+			unsigned m_Node;
+		};
+
+		Entry m_Entries[MaxEntries];
+		unsigned m_NumEntries;
+	};
+
+	/// <summary>
+	/// A pyramid bounding a group of rays which share their origin, such as the primary rays of a screen tile. Its
+	/// apex is the rays' origin, and its edges point along four corner directions; every ray of the group points
+	/// into the convex hull of those directions.
+	///
+	/// Acceleration structures search the beam once for the deepest node that each of its rays enters the
+	/// structure through, and start the rays' traversal there, as in multi-level ray tracing (MLRTA).
+	/// </summary>
+	struct RayBeam
+	{
+		RayBeam() :
+			m_EntryCache(nullptr),
+			m_Space(nullptr)
+		{
+		}
+
+		vector4 m_Origin;
+
+		/// Directions of the beam's edges. They need not be normalized.
+		vector4 m_Corners[4];
+
+		/// Entry nodes found for the beam so far, or nullptr to search for them for every packet.
+		BeamEntryCache* m_EntryCache;
+
+		/// Identifies the space the beam was transformed into, nullptr in world space.
+		const void* m_Space;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "RayBeam.h"
+#include <MathLib.h>
+#include <cassert>
+
+using namespace MathLib;
+
+namespace Raytracer
+{
+	/// <summary>
+	/// A group of up to MaxSize rays which are traced together. Coherent rays (e.g. primary rays
+	/// of adjacent pixels) traced as a packet share instance transforms, node fetches and leaf
+	/// visits.
+	///
+	/// Bit i of the active mask is set if ray i should be traced. Inactive rays are ignored and
+	/// their results are left untouched.
+	/// </summary>
+	struct RayPacket
+	{
+		static const unsigned int MaxSize = 16;
+
+		/// <summary>Initializes an empty packet of the specified size with every ray active.</summary>
+		explicit RayPacket(unsigned int size = MaxSize) :
+			m_Size(size),
+			m_ActiveMask(MaskForSize(size)),
+			m_Beam(nullptr)
+		{
+			assert(size > 0 && size <= MaxSize);
+		}
+
+		/// <summary>Returns a mask with the lowest size bits set.</summary>
+		static uint32_t MaskForSize(unsigned int size)
+		{
+			return (1u << size) - 1;
+		}
+
+		/// <summary>Returns the number of bits set in the mask.</summary>
+		static unsigned int CountRays(uint32_t mask)
+		{
+			unsigned int count = 0;
+			for (; 0 != mask; mask &= mask - 1)
+				count++;
+
+			return count;
+		}
+
+		bool IsActive(unsigned int index) const
+		{
+			return 0 != (m_ActiveMask & (1u << index));
+		}
+
+		ray m_Rays[MaxSize];
+
+		/// <summary>Number of rays in the packet, i.e. 4, 8 or 16.</summary>
+		unsigned int m_Size;
+
+		uint32_t m_ActiveMask;
+
+		/// <summary>
+		/// Beam enclosing every active ray of the packet, or nullptr. Packets of primary rays carry the beam of
+		/// their tile, so that traversal can start below the nodes that all of the tile's rays pass through.
+		/// </summary>
+		const RayBeam* m_Beam;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,394 @@
+#include "ReprojectionRaytracer.h"
+#include "DeferredShadingPass.h"
+#include "HighPerformanceTimer.h"
+#include <MathLib.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+using namespace MathLib;
+using namespace Core;
+using namespace std;
+using CameraLib::RayGenerator;
+
+namespace Raytracer
+{
+	namespace
+	{
+		/// <summary>
+		/// Bend in the inverse depth across a reprojected point, relative to its own inverse depth, above which its
+		/// neighbours are assumed to lie on different surfaces, so that geometry hidden between them may have appeared.
+		/// </summary>
+		const float DepthDiscontinuity = 0.1f;
+
+		/// <summary>
+		/// Sets each element of numRows rows of values to 1 if any element of its row within radius of it is set.
+		/// Consecutive elements of a row are elementStride apart, and consecutive rows rowStride apart.
+		/// </summary>
+		void DilateRows(uint8_t* values, unsigned numRows, unsigned rowLength, unsigned rowStride, unsigned elementStride,
+			unsigned radius, vector<unsigned>& counts)
+		{
+			counts.resize(rowLength + 1);
+
+			for (unsigned row = 0; row < numRows; row++)
+			{
+				uint8_t* rowValues = values + row * rowStride;
+
+				// Prefix counts of the set elements find whether any is set within radius in constant time.
+				counts[0] = 0;
+				for (unsigned i = 0; i < rowLength; i++)
+					counts[i + 1] = counts[i] + (rowValues[i * elementStride] ? 1 : 0);
+
+				for (unsigned i = 0; i < rowLength; i++)
+				{
+					unsigned first = i > radius ? i - radius : 0;
+					unsigned last = min(i + radius + 1, rowLength);
+					rowValues[i * elementStride] = counts[last] > counts[first] ? 1 : 0;
+				}
+			}
+		}
+	}
+
+	ReprojectionRaytracer::ReprojectionRaytracer() :
+		TiledRaytracer(),
+		m_RefreshFraction(0.05f),
+		m_FrameIndex(0),
+		m_Width(0),
+		m_Height(0),
+		m_NumRaysTraced(0),
+		m_NumReprojectedPixels(0),
+		m_NumCheckedPixels(0)
+	{
+	}
+
+	ReprojectionRaytracer::ReprojectionRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene) :
+		TiledRaytracer(frameBuffer, camera, scene),
+		m_RefreshFraction(0.05f),
+		m_FrameIndex(0),
+		m_Width(0),
+		m_Height(0),
+		m_NumRaysTraced(0),
+		m_NumReprojectedPixels(0),
+		m_NumCheckedPixels(0)
+	{
+	}
+
+	void ReprojectionRaytracer::SetRefreshFraction(float refreshFraction)
+	{
+		assert(refreshFraction >= 0.0f && refreshFraction <= 1.0f);
+		m_RefreshFraction = refreshFraction;
+	}
+
+	float ReprojectionRaytracer::GetRefreshFraction() const
+	{
+		return m_RefreshFraction;
+	}
+
+	void ReprojectionRaytracer::Reset()
+	{
+		m_FrameIndex = 0;
+	}
+
+	unsigned ReprojectionRaytracer::GetNumRaysTraced() const
+	{
+		return m_NumRaysTraced;
+	}
+
+	unsigned ReprojectionRaytracer::GetNumReprojectedPixels() const
+	{
+		return m_NumReprojectedPixels;
+	}
+
+	unsigned ReprojectionRaytracer::GetNumCheckedPixels() const
+	{
+		return m_NumCheckedPixels;
+	}
+
+	void ReprojectionRaytracer::Raytrace()
+	{
+		vector<Tile> tiles;
+		unsigned numWorkers = BeginFrame(tiles);
+
+		unsigned width = m_FrameBuffer->GetWidth();
+		unsigned height = m_FrameBuffer->GetHeight();
+		unsigned numPixels = width * height;
+
+		// The previous frame can only be reused if it was rendered at the same resolution.
+		if (width != m_Width || height != m_Height)
+		{
+			m_Width = width;
+			m_Height = height;
+			m_FrameIndex = 0;
+
+			m_HitPositions.assign(numPixels * 3, 0.0f);
+			m_HitValid.assign(numPixels, 0);
+			m_NextHitPositions.assign(numPixels * 3, 0.0f);
+			m_NextHitValid.assign(numPixels, 0);
+		}
+
+		RayGenerator rayGenerator(*m_Camera, width, height);
+
+		HighPerformanceTimer timer;
+		timer.Start();
+
+		m_NumRaysTraced = 0;
+		m_NumReprojectedPixels = 0;
+		m_NumCheckedPixels = 0;
+
+		if (m_FrameIndex > 0)
+			Reproject(rayGenerator);
+		else
+			fill(m_NextHitValid.begin(), m_NextHitValid.end(), 0);
+
+		unsigned refreshPeriod = 0;
+		if (m_RefreshFraction > 0.0f)
+			refreshPeriod = max(1u, (unsigned)floorf(1.0f / m_RefreshFraction + 0.5f));
+
+		TileScheduler scheduler(numWorkers);
+		scheduler.Reset((unsigned)tiles.size());
+
+		RunWorkers(numWorkers, [&](unsigned workerIndex)
+		{
+			RenderTraceTiles(workerIndex, scheduler, tiles, rayGenerator, refreshPeriod);
+		});
+
+		timer.Stop();
+
+		ConvertHeatmapToFalseColour();
+
+		// The hit points of this frame are reprojected into the next one.
+		m_HitPositions.swap(m_NextHitPositions);
+		m_HitValid.swap(m_NextHitValid);
+		m_FrameIndex++;
+
+		PrintFrameTime(timer.GetTimeMilliseconds(), numWorkers, to_string(tiles.size()) + " tiles");
+		printf("Rays traced: %u of %u pixels (%u reprojected, %u checked for disocclusion)\n", (unsigned)m_NumRaysTraced,
+			numPixels, (unsigned)m_NumReprojectedPixels, (unsigned)m_NumCheckedPixels);
+		PrintTraversalStatistics(m_FrameStatistics);
+	}
+
+	void ReprojectionRaytracer::Reproject(const RayGenerator& rayGenerator)
+	{
+		unsigned numPixels = m_Width * m_Height;
+		float* frameBufferData = m_FrameBuffer->GetData();
+
+		// The frame buffer still holds the previous frame, which is the source of the reprojected colours.
+		m_PreviousColors.assign(frameBufferData, frameBufferData + numPixels * 4);
+		m_Depths.assign(numPixels, FLT_MAX);
+		fill(m_NextHitValid.begin(), m_NextHitValid.end(), 0);
+
+		// The furthest any point moves across the screen bounds how far newly visible geometry can reach into it.
+		float maxMotion = 0.0f;
+
+		for (unsigned i = 0; i < numPixels; i++)
+		{
+			if (!m_HitValid[i])
+				continue;
+
+			const float* hitPosition = &m_HitPositions[i * 3];
+			vector4 point(hitPosition[0], hitPosition[1], hitPosition[2], 1.0f);
+
+			float x;
+			float y;
+			float depth;
+
+			if (!rayGenerator.ProjectPoint(point, x, y, depth))
+				continue;
+
+			maxMotion = max(maxMotion, max(fabsf(x - (float)(i % m_Width)), fabsf(y - (float)(i / m_Width))));
+
+			// Each point lands in the pixel containing it; pixel coordinates address pixel centres.
+			float roundedX = floorf(x + 0.5f);
+			float roundedY = floorf(y + 0.5f);
+
+			if (roundedX < 0.0f || roundedY < 0.0f || roundedX >= (float)m_Width || roundedY >= (float)m_Height)
+				continue;
+
+			unsigned pixelIndex = (unsigned)roundedY * m_Width + (unsigned)roundedX;
+
+			// Keep the nearest point when several land in the same pixel.
+			if (depth >= m_Depths[pixelIndex])
+				continue;
+
+			m_Depths[pixelIndex] = depth;
+			m_NextHitValid[pixelIndex] = 1;
+			memcpy(&m_NextHitPositions[pixelIndex * 3], hitPosition, sizeof(float) * 3);
+			memcpy(frameBufferData + pixelIndex * 4, &m_PreviousColors[i * 4], sizeof(float) * 4);
+		}
+
+		MarkDisocclusions((unsigned)floorf(maxMotion + 0.5f));
+	}
+
+	void ReprojectionRaytracer::MarkDisocclusions(unsigned radius)
+	{
+		m_MayBeDisoccluded.assign(m_Width * m_Height, 0);
+
+		for (unsigned y = 0; y < m_Height; y++)
+		{
+			for (unsigned x = 0; x < m_Width; x++)
+			{
+				unsigned pixelIndex = y * m_Width + x;
+
+				if (!m_NextHitValid[pixelIndex])
+				{
+					m_MayBeDisoccluded[pixelIndex] = 1;
+					continue;
+				}
+
+				// The inverse depth of a plane is linear across the screen, so it only bends where neighbouring
+				// points lie on different surfaces, however steeply a surface recedes.
+				unsigned steps[2] = { 1, m_Width };
+				bool hasNeighbours[2] = { x > 0 && x + 1 < m_Width, y > 0 && y + 1 < m_Height };
+
+				for (unsigned axis = 0; axis < 2; axis++)
+				{
+					unsigned before = pixelIndex - steps[axis];
+					unsigned after = pixelIndex + steps[axis];
+
+					if (!hasNeighbours[axis] || !m_NextHitValid[before] || !m_NextHitValid[after])
+						continue;
+
+					float inverseDepth = 1.0f / m_Depths[pixelIndex];
+					float bend = 1.0f / m_Depths[before] + 1.0f / m_Depths[after] - 2.0f * inverseDepth;
+
+					if (fabsf(bend) > DepthDiscontinuity * inverseDepth)
+						m_MayBeDisoccluded[pixelIndex] = 1;
+				}
+			}
+		}
+
+		if (0 == radius)
+			return;
+
+		// Dilating along the rows and then along the columns marks every pixel within radius in both directions.
+		vector<unsigned> counts;
+		DilateRows(m_MayBeDisoccluded.data(), m_Height, m_Width, m_Width, 1, radius, counts);
+		DilateRows(m_MayBeDisoccluded.data(), m_Width, m_Height, 1, m_Width, radius, counts);
+
+		// Geometry which was off screen enters over the edges.
+		for (unsigned y = 0; y < m_Height; y++)
+		{
+			for (unsigned x = 0; x < m_Width; x++)
+			{
+				if (x < radius || y < radius || x + radius >= m_Width || y + radius >= m_Height)
+					m_MayBeDisoccluded[y * m_Width + x] = 1;
+			}
+		}
+	}
+
+	bool ReprojectionRaytracer::NeedsTrace(unsigned pixelIndex, unsigned refreshPeriod) const
+	{
+		if (!m_NextHitValid[pixelIndex] || m_MayBeDisoccluded[pixelIndex])
+			return true;
+
+		// Offsetting by the frame index refreshes a different set of pixels each frame.
+		return refreshPeriod > 0 && 0 == (pixelIndex + m_FrameIndex) % refreshPeriod;
+	}
+
+	void ReprojectionRaytracer::RenderTraceTiles(unsigned workerIndex, TileScheduler& scheduler, const vector<Tile>& tiles,
+		const RayGenerator& rayGenerator, unsigned refreshPeriod)
+	{
+		DeferredShadingPass shadingPass;
+
+		unsigned tileIndex;
+		while (scheduler.AcquireTile(workerIndex, tileIndex))
+			RenderTraceTile(tiles[tileIndex], rayGenerator, refreshPeriod, shadingPass);
+	}
+
+	void ReprojectionRaytracer::RenderTraceTile(const Tile& tile, const RayGenerator& rayGenerator, unsigned refreshPeriod,
+		DeferredShadingPass& shadingPass)
+	{
+		// The pixels needing a trace are scattered, so rays are generated individually and gathered into packets.
+		const unsigned packetWidth = 8;
+
+		RayPacket packet(packetWidth);
+		for (unsigned i = 0; i < packetWidth; i++)
+			packet.m_Rays[i].setPosition(rayGenerator.GetOrigin());
+
+		RayBeam beam;
+		BeamEntryCache entryCache;
+		packet.m_Beam = PrepareTileBeam(tile, rayGenerator, beam, entryCache);
+
+		unsigned pixelIndices[packetWidth];
+		unsigned numRays = 0;
+		unsigned numReprojectedPixels = 0;
+		unsigned numCheckedPixels = 0;
+
+		for (unsigned y = tile.m_Y; y < tile.m_Y + tile.m_Height; y++)
+		{
+			for (unsigned x = tile.m_X; x < tile.m_X + tile.m_Width; x++)
+			{
+				unsigned pixelIndex = y * m_Width + x;
+				if (!NeedsTrace(pixelIndex, refreshPeriod))
+				{
+					numReprojectedPixels++;
+					continue;
+				}
+
+				if (m_NextHitValid[pixelIndex] && m_MayBeDisoccluded[pixelIndex])
+					numCheckedPixels++;
+
+				vector4 direction;
+				rayGenerator.GenerateDirection((float)x, (float)y, direction);
+
+				packet.m_Rays[numRays].setDirection(direction);
+				pixelIndices[numRays] = pixelIndex;
+
+				if (++numRays == packetWidth)
+				{
+					TracePixels(packet, numRays, pixelIndices, shadingPass);
+					numRays = 0;
+				}
+			}
+		}
+
+		if (numRays > 0)
+			TracePixels(packet, numRays, pixelIndices, shadingPass);
+
+		shadingPass.Shade(*m_Scene);
+
+		m_NumReprojectedPixels += numReprojectedPixels;
+		m_NumCheckedPixels += numCheckedPixels;
+	}
+
+	void ReprojectionRaytracer::TracePixels(RayPacket& packet, unsigned numRays, const unsigned* pixelIndices,
+		DeferredShadingPass& shadingPass)
+	{
+		float* frameBufferData = m_FrameBuffer->GetData();
+		HitRecord hitRecords[RayPacket::MaxSize];
+
+		packet.m_ActiveMask = RayPacket::MaskForSize(numRays);
+		uint32_t hitMask = TracePixelPacket(packet, hitRecords, pixelIndices);
+
+		for (unsigned i = 0; i < numRays; i++)
+		{
+			unsigned pixelIndex = pixelIndices[i];
+			float* target = frameBufferData + pixelIndex * 4;
+
+			// Pixels which miss the scene are cleared to transparent black, and have no hit point to reproject.
+			if (0 == (hitMask & (1u << i)))
+			{
+				m_NextHitValid[pixelIndex] = 0;
+				memset(target, 0, sizeof(float) * 4);
+				continue;
+			}
+
+			vector4 hitPosition;
+			vector4_addScaledVector(packet.m_Rays[i].getPosition(), packet.m_Rays[i].getDirection(), hitRecords[i].m_T,
+				hitPosition);
+
+			float* nextHitPosition = &m_NextHitPositions[pixelIndex * 3];
+			nextHitPosition[0] = hitPosition.extractX();
+			nextHitPosition[1] = hitPosition.extractY();
+			nextHitPosition[2] = hitPosition.extractZ();
+			m_NextHitValid[pixelIndex] = 1;
+
+			shadingPass.AddHit(hitRecords[i], target);
+		}
+
+		m_NumRaysTraced += numRays;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "TiledRaytracer.h"
+#include <atomic>
+#include <stdint.h>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Multithreaded raytracer for sequences of frames of a static scene rendered from a moving camera.
+	///
+	/// The world space hit point and colour of every pixel are kept between frames. When the next frame is
+	/// rendered the previous hit points are reprojected through the new camera, keeping the nearest point
+	/// which lands in each pixel. Pixels which receive no reprojected point (those which were disoccluded,
+	/// previously off screen, or missed the scene) and a small rotating fraction of refreshed pixels are
+	/// traced, which limits the error reprojection accumulates over a sequence.
+	///
+	/// Geometry which was hidden or off screen in the previous frame may now lie in front of a reprojected
+	/// point. It can only appear next to holes, depth discontinuities and the edges of the screen, within the
+	/// distance reprojected points moved across the screen, so the pixels there are traced as well. Tracing
+	/// such a pixel costs no more than a visibility ray towards its point would.
+	///
+	/// Reprojected pixels keep the colour they were shaded with, so shading must not depend on the
+	/// position of the camera. Call Reset whenever the scene changes.
+	/// </summary>
+	class ReprojectionRaytracer : public TiledRaytracer
+	{
+	public:
+
+		ReprojectionRaytracer();
+		ReprojectionRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene);
+
+		/// <summary>
+		/// Sets the fraction of the pixels which are traced every frame even if they could be reprojected.
+		/// Every pixel is refreshed once every 1 / fraction frames. A fraction of 0 disables refreshing.
+		/// </summary>
+		void SetRefreshFraction(float refreshFraction);
+		float GetRefreshFraction() const;
+
+		/// <summary>Discards the previous frame, so that the next frame is traced in full.</summary>
+		void Reset();
+
+		void Raytrace() override;
+
+		/// <summary>Returns the number of primary rays traced for the last frame.</summary>
+		unsigned GetNumRaysTraced() const;
+
+		/// <summary>Returns the number of pixels of the last frame filled by reprojection.</summary>
+		unsigned GetNumReprojectedPixels() const;
+
+		/// <summary>
+		/// Returns the number of pixels of the last frame which received a reprojected point, but were traced
+		/// because geometry may have appeared in front of it.
+		/// </summary>
+		unsigned GetNumCheckedPixels() const;
+
+	protected:
+
+		float m_RefreshFraction;
+		unsigned m_FrameIndex;
+
+		unsigned m_Width;
+		unsigned m_Height;
+
+		/// <summary>World space hit point of each pixel of the last frame, and whether there was one.</summary>
+		std::vector<float> m_HitPositions;
+		std::vector<uint8_t> m_HitValid;
+
+		/// <summary>Hit points of the frame being rendered.</summary>
+		std::vector<float> m_NextHitPositions;
+		std::vector<uint8_t> m_NextHitValid;
+
+		/// <summary>Pixels of the frame being rendered near which geometry may have been disoccluded.</summary>
+		std::vector<uint8_t> m_MayBeDisoccluded;
+
+		/// Scratch buffers used while reprojecting.
+		std::vector<float> m_PreviousColors;
+		std::vector<float> m_Depths;
+
+		std::atomic<unsigned> m_NumRaysTraced;
+		std::atomic<unsigned> m_NumReprojectedPixels;
+		std::atomic<unsigned> m_NumCheckedPixels;
+
+		/// <summary>
+		/// Scatters the hit points of the last frame into the pixels of the new frame, copying their colour.
+		/// Pixels which receive no point are marked invalid.
+		/// </summary>
+		void Reproject(const CameraLib::RayGenerator& rayGenerator);
+
+		/// <summary>
+		/// Marks the pixels within radius of a hole, a depth discontinuity or the edge of the screen as possibly
+		/// disoccluded.
+		/// </summary>
+		void MarkDisocclusions(unsigned radius);
+
+		/// <summary>
+		/// Returns true if the pixel should be traced in the current frame because it received no reprojected
+		/// point, may have been disoccluded, or is due to be refreshed.
+		/// </summary>
+		bool NeedsTrace(unsigned pixelIndex, unsigned refreshPeriod) const;
+
+		/// <summary>Acquires and renders tiles until the scheduler has none remaining.</summary>
+		void RenderTraceTiles(unsigned workerIndex, TileScheduler& scheduler, const std::vector<Tile>& tiles,
+			const CameraLib::RayGenerator& rayGenerator, unsigned refreshPeriod);
+
+		/// <summary>
+		/// Traces the pixels of the tile which need tracing, recording their hit points and shading them.
+		/// </summary>
+		void RenderTraceTile(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, unsigned refreshPeriod,
+			DeferredShadingPass& shadingPass);
+
+		/// <summary>
+		/// Traces the first numRays rays of the packet for the pixels with the specified indices.
+		/// </summary>
+		void TracePixels(RayPacket& packet, unsigned numRays, const unsigned* pixelIndices, DeferredShadingPass& shadingPass);
+	};
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "SAH.h"
+#include "KdTreeCompact.h"
 #include "KdTreeGeometry.h"
 #include "KdTreeNode.h"
 #include <vector>
@@ -15,8 +16,9 @@ namespace Raytracer
 namespace KdTreeConstruction
 {
 	SAH::SAH(unsigned maxDepth, unsigned maxTriangles) : 
-		m_MaxDepth(maxDepth), 
-		m_MaxTriangles(maxTriangles)
+		m_MaxDepth(min(maxDepth, KdTreeCompact::MaxDepth - 1)),
+		m_MaxTriangles(maxTriangles),
+		m_ExpectedCost(0.0f)
 	{
 		for (unsigned i = 0; i < 3; i++)
 			m_Edges[i] = nullptr;
@@ -50,14 +52,30 @@ namespace KdTreeConstruction
 		for (unsigned i = 0; i < 3; i++)
 			m_Edges[i] = new BoundEdge[m_NumTriangles * 2];
 
-		auto rootNode = new KdTreeNode;
+		auto rootNode = m_Arena.New<KdTreeNode>();
 		CalculateBoundingVolume(rootNode->m_BoundingMin, rootNode->m_BoundingMax,
 			triangleIndices);
 
 		EvaluateSAH(*rootNode, triangleIndices, 0, 0);
 
-		geometry.ResetKdTree();
-		geometry.m_RootNode = rootNode;
+		m_ExpectedCost = m_CostModel.CalculateTreeCost(*rootNode);
+
+		geometry.ReplaceKdTree(rootNode, m_Arena);
+	}
+
+	void SAH::SetCostModel(const SAHCostModel& costModel)
+	{
+		m_CostModel = costModel;
+	}
+
+	const SAHCostModel& SAH::GetCostModel() const
+	{
+		return m_CostModel;
+	}
+
+	float SAH::GetExpectedCost() const
+	{
+		return m_ExpectedCost;
 	}
 
 	float SAH::CalculateBoundingBoxSurfaceArea(const vector4& min, const vector4& max)
@@ -83,23 +101,9 @@ namespace KdTreeConstruction
 		vector4 m_Max;
 	};
 
-	static int DetermineGreatestExtent(const vector4& min, const vector4& max)
-	{
-		vector4 extents;
-		vector4_sub(max, min, extents);
-
-		unsigned index = extents[1] > extents[0] ? 1 : 0;
-		index = extents[2] > extents[index] ? 2 : index;
-		
-		return index;
-	}
-
 	void SAH::EvaluateSAH(KdTreeNode& node, vector<unsigned> indices, unsigned depth, 
 		int badRefines)
 	{
-		const float triangleIntersectionCost = 1.0f;
-		const float traversalCost = 8.0f;
-
 		unsigned numTriangles = (unsigned)indices.size();
 
 		auto& nodeBoundsMin = node.m_BoundingMin;
@@ -117,90 +121,78 @@ namespace KdTreeConstruction
 		int bestAxis = -1;
 		int bestOffset = -1;
 		float bestCost = FLT_MAX;
-		float oldCost = triangleIntersectionCost * (float)numTriangles;
+		float oldCost = m_CostModel.CalculateLeafCost(numTriangles);
 		float surfaceArea = CalculateBoundingBoxSurfaceArea(node.GetBoundingMin(),
 			node.GetBoundingMax());
 		float surfaceAreaInv = 1.0f / surfaceArea;
 
-		auto splitAxis = DetermineGreatestExtent(node.GetBoundingMin(), 
-			node.GetBoundingMax());
-
-		unsigned retries = 0;
-
-	RetrySplit:
-
-		// Initialize edges for axis.
-		for (unsigned i = 0; i < numTriangles; i++)
+		// Search every axis, as the longest axis does not always have the cheapest split. Each axis has its own
+		// edge array, so the edges of the best axis are still sorted when classifying the primitives.
+		for (int splitAxis = 0; splitAxis < 3; splitAxis++)
 		{
-			auto triangleIndex = indices[i];
+			// Initialize edges for axis.
+			for (unsigned i = 0; i < numTriangles; i++)
+			{
+				auto triangleIndex = indices[i];
 			
-			auto& triangleBoundMin = m_TriangleBounds[triangleIndex].m_Min;
-			auto& triangleBoundMax = m_TriangleBounds[triangleIndex].m_Max;
+				auto& triangleBoundMin = m_TriangleBounds[triangleIndex].m_Min;
+				auto& triangleBoundMax = m_TriangleBounds[triangleIndex].m_Max;
 			
-			m_Edges[splitAxis][2 * i] = BoundEdge(triangleBoundMin[splitAxis], triangleIndex, true);
-			m_Edges[splitAxis][2 * i + 1] = BoundEdge(triangleBoundMax[splitAxis], triangleIndex, false);
-		}
-		sort(&m_Edges[splitAxis][0], &m_Edges[splitAxis][2 * numTriangles]);
+				m_Edges[splitAxis][2 * i] = BoundEdge(triangleBoundMin[splitAxis], triangleIndex, true);
+				m_Edges[splitAxis][2 * i + 1] = BoundEdge(triangleBoundMax[splitAxis], triangleIndex, false);
+			}
+			sort(&m_Edges[splitAxis][0], &m_Edges[splitAxis][2 * numTriangles]);
 
-		// Compute the costs for all splits along the selected axis, and attempt to find the best.
-		int numBelow = 0;
-		int numAbove = numTriangles;
-		for (int i = 0; i < 2 * numTriangles; i++)
-		{
-			auto& currentEdge = m_Edges[splitAxis][i];
+			// Compute the costs for all splits along the selected axis, and attempt to find the best.
+			int numBelow = 0;
+			int numAbove = numTriangles;
+			for (int i = 0; i < 2 * numTriangles; i++)
+			{
+				auto& currentEdge = m_Edges[splitAxis][i];
 
-			if (currentEdge.m_Type == BoundEdge::END)
-				numAbove--;
+				if (currentEdge.m_Type == BoundEdge::END)
+					numAbove--;
 
-			if (currentEdge.m_T > nodeBoundsMin[splitAxis] && 
-				currentEdge.m_T < nodeBoundsMax[splitAxis])
-			{
-				// Compute cost for split at ith edge.
-				vector4 belowBounds[2];
-				vector4_copy(belowBounds[0], nodeBoundsMin);
-				vector4_copy(belowBounds[1], nodeBoundsMax);
-				belowBounds[1][splitAxis] = currentEdge.m_T;
+				if (currentEdge.m_T > nodeBoundsMin[splitAxis] && 
+					currentEdge.m_T < nodeBoundsMax[splitAxis])
+				{
+					// Compute cost for split at ith edge.
+					vector4 belowBounds[2];
+					vector4_copy(belowBounds[0], nodeBoundsMin);
+					vector4_copy(belowBounds[1], nodeBoundsMax);
+					belowBounds[1][splitAxis] = currentEdge.m_T;
 
-				vector4 aboveBounds[2];
-				vector4_copy(aboveBounds[0], nodeBoundsMin);
-				vector4_copy(aboveBounds[1], nodeBoundsMax);
-				aboveBounds[0][splitAxis] = currentEdge.m_T;
+					vector4 aboveBounds[2];
+					vector4_copy(aboveBounds[0], nodeBoundsMin);
+					vector4_copy(aboveBounds[1], nodeBoundsMax);
+					aboveBounds[0][splitAxis] = currentEdge.m_T;
 
-				float currentSurfaceArea[2];
-				currentSurfaceArea[0] = CalculateBoundingBoxSurfaceArea(belowBounds[0], belowBounds[1]);
-				currentSurfaceArea[1] = CalculateBoundingBoxSurfaceArea(aboveBounds[0], aboveBounds[1]);
+					float currentSurfaceArea[2];
+					currentSurfaceArea[0] = CalculateBoundingBoxSurfaceArea(belowBounds[0], belowBounds[1]);
+					currentSurfaceArea[1] = CalculateBoundingBoxSurfaceArea(aboveBounds[0], aboveBounds[1]);
 
-				assert(currentSurfaceArea[0] != 0.0f && currentSurfaceArea[1] != 0.0f);
+					assert(currentSurfaceArea[0] != 0.0f && currentSurfaceArea[1] != 0.0f);
 
-				currentSurfaceArea[0] *= surfaceAreaInv;
-				currentSurfaceArea[1] *= surfaceAreaInv;
+					currentSurfaceArea[0] *= surfaceAreaInv;
+					currentSurfaceArea[1] *= surfaceAreaInv;
 					 
-				// TODO: Implement the "empty bonus" paradigm as well? 
-				float cost = traversalCost + triangleIntersectionCost *
-					(numBelow * currentSurfaceArea[0]) + (numAbove * currentSurfaceArea[1]);
-
-				// Update best split position if this is the lowest cost so far.
-				if (cost < bestCost)
-				{
-					bestCost = cost;
-					bestAxis = splitAxis;
-					// TODO: Remove unsigned ints from usage? 
-					bestOffset = i;
+					float cost = m_CostModel.CalculateSplitCost(currentSurfaceArea[0], currentSurfaceArea[1], numBelow,
+						numAbove);
+
+					// Update best split position if this is the lowest cost so far.
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = splitAxis;
+						// TODO: Remove unsigned ints from usage? 
+						bestOffset = i;
+					}
 				}
-			}
 
-			if (currentEdge.m_Type == BoundEdge::START)
-				numBelow++;
-		}
-		assert(numBelow == numTriangles && numAbove == 0);
-
-		// If no suitable splits were found for the initial axis, attempt to find splits along 
-		// the other two axes.
-		if (bestAxis == -1 && retries < 2)
-		{
-			retries++;
-			splitAxis = (splitAxis + 1) % 3;
-			goto RetrySplit;
+				if (currentEdge.m_Type == BoundEdge::START)
+					numBelow++;
+			}
+			assert(numBelow == numTriangles && numAbove == 0);
 		}
 
 		// If no good split can be found along any axis for this node, attempt to continue because
@@ -241,11 +233,11 @@ namespace KdTreeConstruction
 		splittingPlane.setPointOnPlane(splitPosition);
 		plane_copy(node.m_SplittingPlane, splittingPlane);
 		
-		auto childNode0 = new KdTreeNode;
+		auto childNode0 = m_Arena.New<KdTreeNode>();
 		vector4_copy(childNode0->m_BoundingMin, nodeBoundsMin);
 		vector4_copy(childNode0->m_BoundingMax, nodeBoundsMax);
 		
-		auto childNode1 = new KdTreeNode;
+		auto childNode1 = m_Arena.New<KdTreeNode>();
 		vector4_copy(childNode1->m_BoundingMin, nodeBoundsMin);
 		vector4_copy(childNode1->m_BoundingMax, nodeBoundsMax);
 
@@ -285,7 +277,7 @@ namespace KdTreeConstruction
 	{
 		// Copy triangle indices to node.
 		node.m_NumTriangles = numTriangles;
-		node.m_TriangleList = new unsigned[numTriangles];
+		node.m_TriangleList = m_Arena.AllocateArray<unsigned>(numTriangles);
 
 		for (unsigned i = 0; i < numTriangles; i++)
 			node.m_TriangleList[i] = triangleIndices[i];
@@ -316,7 +308,7 @@ namespace KdTreeConstruction
 		unsigned indicesCount = (unsigned)indices.size();
 
 		node.m_NumTriangles = indicesCount;
-		node.m_TriangleList = new unsigned[indicesCount];
+		node.m_TriangleList = m_Arena.AllocateArray<unsigned>(indicesCount);
 
 		for (unsigned i = 0; i < indicesCount; i++)
 			node.m_TriangleList[i] = indices[i];
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "IKdTreeBuilder.h"
+#include "SAHCostModel.h"
+#include <MemoryArena.h>
 #include <MathLib.h>
 #include <memory>
 #include <vector>
@@ -30,10 +32,20 @@ namespace KdTreeConstruction
 	{
 	public:
 
+		/// <summary>
+		/// Depths beyond what compact trees can hold, KdTreeCompact::MaxDepth - 1, are limited to it, as
+		/// traversal stacks are sized for those trees.
+		/// </summary>
 		SAH(unsigned maxDepth, unsigned maxTriangles);
 		~SAH();
 
 		void Construct(KdTreeGeometry& geometry) override;
+
+		void SetCostModel(const SAHCostModel& costModel);
+		const SAHCostModel& GetCostModel() const;
+
+		/// <summary>Returns the expected cost of the last tree constructed, under the cost model.</summary>
+		float GetExpectedCost() const;
 		
 	protected:
 
@@ -73,6 +85,13 @@ namespace KdTreeConstruction
 		unsigned m_MaxDepth;
 		unsigned m_MaxTriangles;
 
+		SAHCostModel m_CostModel;
+
+		/// Storage of the tree being constructed, handed over to the geometry once it is complete.
+		Core::MemoryArena m_Arena;
+
+		float m_ExpectedCost;
+
 		float CalculateBoundingBoxSurfaceArea(const vector4& min, const vector4& max);
 
 		/// <summary>Perform SAH evaluation on this node.</summary>
@@ -0,0 +1,77 @@
+#include "SAHCostModel.h"
+#include "KdTreeNode.h"
+#include <cassert>
+
+namespace Raytracer
+{
+namespace KdTreeConstruction
+{
+	/// <summary>
+	/// Sums the costs of the subtree's nodes, each weighted by its surface area.
+	/// </summary>
+	static float CalculateWeightedNodeCost(const KdTreeNode& node, const SAHCostModel& costModel)
+	{
+		float surfaceArea = SAHCostModel::CalculateSurfaceArea(node.GetBoundingMin(), node.GetBoundingMax());
+
+		if (node.IsChild())
+			return surfaceArea * costModel.CalculateLeafCost(node.GetNumTriangles());
+
+		auto childNodes = node.GetChildren();
+
+		return surfaceArea * costModel.m_TraversalCost + CalculateWeightedNodeCost(*childNodes[0], costModel) +
+			CalculateWeightedNodeCost(*childNodes[1], costModel);
+	}
+
+	SAHCostModel::SAHCostModel() :
+		m_TraversalCost(8.0f),
+		m_IntersectionCost(1.0f),
+		m_EmptyBonus(0.2f)
+	{
+	}
+
+	SAHCostModel::SAHCostModel(float traversalCost, float intersectionCost, float emptyBonus) :
+		m_TraversalCost(traversalCost),
+		m_IntersectionCost(intersectionCost),
+		m_EmptyBonus(emptyBonus)
+	{
+		assert(emptyBonus >= 0.0f && emptyBonus < 1.0f);
+	}
+
+	float SAHCostModel::CalculateLeafCost(unsigned numTriangles) const
+	{
+		return m_IntersectionCost * (float)numTriangles;
+	}
+
+	float SAHCostModel::CalculateSplitCost(float probabilityBelow, float probabilityAbove, unsigned numTrianglesBelow,
+		unsigned numTrianglesAbove) const
+	{
+		float cost = m_TraversalCost + m_IntersectionCost *
+			(probabilityBelow * (float)numTrianglesBelow + probabilityAbove * (float)numTrianglesAbove);
+
+		if (0 == numTrianglesBelow || 0 == numTrianglesAbove)
+			cost *= 1.0f - m_EmptyBonus;
+
+		return cost;
+	}
+
+	float SAHCostModel::CalculateSurfaceArea(const vector4& min, const vector4& max)
+	{
+		float width = max[0] - min[0];
+		float height = max[1] - min[1];
+		float length = max[2] - min[2];
+
+		return 2.0f * (width * height + width * length + height * length);
+	}
+
+	float SAHCostModel::CalculateTreeCost(const KdTreeNode& rootNode) const
+	{
+		float rootSurfaceArea = CalculateSurfaceArea(rootNode.GetBoundingMin(), rootNode.GetBoundingMax());
+
+		// A root voxel without any surface area is never split.
+		if (rootSurfaceArea <= 0.0f)
+			return rootNode.IsChild() ? CalculateLeafCost(rootNode.GetNumTriangles()) : m_TraversalCost;
+
+		return CalculateWeightedNodeCost(rootNode, *this) / rootSurfaceArea;
+	}
+}
+}
\ No newline at end of file
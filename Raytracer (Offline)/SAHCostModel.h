@@ -0,0 +1,55 @@
+#pragma once
+
+#include <MathLib.h>
+
+using MathLib::vector4;
+
+namespace Raytracer
+{
+	class KdTreeNode;
+
+namespace KdTreeConstruction
+{
+	/// <summary>
+	/// Costs used by the Surface Area Heuristic to estimate how expensive a kd tree is to traverse. The
+	/// probability of a ray visiting a node is taken to be the ratio of the node's surface area to that of
+	/// its parent.
+	/// </summary>
+	struct SAHCostModel
+	{
+		SAHCostModel();
+		SAHCostModel(float traversalCost, float intersectionCost, float emptyBonus);
+
+		/// <summary>Cost of visiting an interior node.</summary>
+		float m_TraversalCost;
+
+		/// <summary>Cost of intersecting a ray with a triangle.</summary>
+		float m_IntersectionCost;
+
+		/// <summary>
+		/// Fraction in [0, 1) taken off the cost of splits leaving one child without triangles, so that
+		/// empty space is cut off early. Rays crossing empty children are cheap to traverse.
+		/// </summary>
+		float m_EmptyBonus;
+
+		/// <summary>Returns the cost of a leaf holding the specified number of triangles.</summary>
+		float CalculateLeafCost(unsigned numTriangles) const;
+
+		/// <summary>
+		/// Returns the cost of splitting a node, given the probabilities of a ray entering the node visiting
+		/// each child and the number of triangles in each child.
+		/// </summary>
+		float CalculateSplitCost(float probabilityBelow, float probabilityAbove, unsigned numTrianglesBelow,
+			unsigned numTrianglesAbove) const;
+
+		/// <summary>Returns the surface area of an axis aligned box.</summary>
+		static float CalculateSurfaceArea(const vector4& min, const vector4& max);
+
+		/// <summary>
+		/// Returns the expected cost of tracing a ray through the tree. Rays are assumed to hit the root
+		/// voxel, and every node they pass is visited.
+		/// </summary>
+		float CalculateTreeCost(const KdTreeNode& rootNode) const;
+	};
+}
+}
\ No newline at end of file
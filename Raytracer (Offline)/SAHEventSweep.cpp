@@ -0,0 +1,691 @@
+#include "SAHEventSweep.h"
+#include "KdTreeCompact.h"
+#include "KdTreeGeometry.h"
+#include "KdTreeNode.h"
+#include <Geometry.h>
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+using namespace MathLib;
+using namespace GeometryLib;
+
+namespace Raytracer
+{
+namespace KdTreeConstruction
+{
+	namespace
+	{
+		/// <summary>
+		/// Calls function(workerIndex) for every worker, each on its own thread. The calling thread acts as
+		/// worker 0.
+		/// </summary>
+		template <typename Function>
+		void ForEachWorker(unsigned numWorkers, Function function)
+		{
+			vector<thread> workers;
+			for (unsigned i = 1; i < numWorkers; i++)
+				workers.push_back(thread(function, i));
+
+			function(0);
+
+			for (auto& worker : workers)
+				worker.join();
+		}
+	}
+
+	SAHEventSweep::SAHEventSweep(unsigned maxDepth, unsigned maxTriangles) :
+		m_NumTriangles(0),
+		m_Triangles(nullptr),
+		m_MaxDepth(maxDepth),
+		m_MaxTriangles(maxTriangles),
+		m_DepthLimit(maxDepth),
+		m_NumThreads(0),
+		m_PerfectSplits(false),
+		m_MaxDuplication(0.0f),
+		m_MemoryBudget(0),
+		m_ExpectedCost(0.0f),
+		m_NumReferences(0),
+		m_NumLimitedNodes(0),
+		m_BytesUsed(0)
+	{
+	}
+
+	unsigned SAHEventSweep::CalculateMaxDepth(unsigned numTriangles)
+	{
+		unsigned maxDepth = 8;
+		if (numTriangles > 1)
+			maxDepth += (unsigned)(1.3f * log2f((float)numTriangles) + 0.5f);
+
+		// Compact trees hold nodes down to a depth of one less than their maximum depth.
+		return min(maxDepth, KdTreeCompact::MaxDepth - 1);
+	}
+
+	void SAHEventSweep::SetNumThreads(unsigned numThreads)
+	{
+		m_NumThreads = numThreads;
+	}
+
+	unsigned SAHEventSweep::GetNumThreads() const
+	{
+		return m_NumThreads;
+	}
+
+	void SAHEventSweep::SetPerfectSplits(bool perfectSplits)
+	{
+		m_PerfectSplits = perfectSplits;
+	}
+
+	bool SAHEventSweep::GetPerfectSplits() const
+	{
+		return m_PerfectSplits;
+	}
+
+	void SAHEventSweep::SetCostModel(const SAHCostModel& costModel)
+	{
+		m_CostModel = costModel;
+	}
+
+	const SAHCostModel& SAHEventSweep::GetCostModel() const
+	{
+		return m_CostModel;
+	}
+
+	void SAHEventSweep::SetMaxDuplication(float maxDuplication)
+	{
+		m_MaxDuplication = maxDuplication;
+	}
+
+	float SAHEventSweep::GetMaxDuplication() const
+	{
+		return m_MaxDuplication;
+	}
+
+	void SAHEventSweep::SetMemoryBudget(size_t memoryBudget)
+	{
+		m_MemoryBudget = memoryBudget;
+	}
+
+	size_t SAHEventSweep::GetMemoryBudget() const
+	{
+		return m_MemoryBudget;
+	}
+
+	float SAHEventSweep::GetExpectedCost() const
+	{
+		return m_ExpectedCost;
+	}
+
+	float SAHEventSweep::GetDuplicationFactor() const
+	{
+		return m_NumTriangles > 0 ? (float)m_NumReferences / m_NumTriangles : 0.0f;
+	}
+
+	size_t SAHEventSweep::GetBytesUsed() const
+	{
+		return m_BytesUsed;
+	}
+
+	unsigned SAHEventSweep::GetNumLimitedNodes() const
+	{
+		return m_NumLimitedNodes;
+	}
+
+	unsigned SAHEventSweep::DetermineNumWorkers() const
+	{
+		if (m_NumThreads > 0)
+			return m_NumThreads;
+
+		// hardware_concurrency() is allowed to return 0 when the value is not computable.
+		unsigned hardwareThreads = thread::hardware_concurrency();
+		return hardwareThreads > 0 ? hardwareThreads : 1;
+	}
+
+	void SAHEventSweep::BeginConstruction(const KdTreeGeometry& geometry)
+	{
+		m_NumTriangles = geometry.GetNumTriangles();
+		m_Triangles = geometry.GetTriangles();
+
+		// Explicit depths are limited as automatic ones are, so that stacks sized for compact trees never overflow.
+		m_DepthLimit = AutomaticMaxDepth == m_MaxDepth ? CalculateMaxDepth(m_NumTriangles) :
+			min(m_MaxDepth, KdTreeCompact::MaxDepth - 1);
+
+		m_ExpectedCost = 0.0f;
+		m_NumReferences = 0;
+		m_NumLimitedNodes = 0;
+		m_BytesUsed = 0;
+	}
+
+	void SAHEventSweep::Construct(KdTreeGeometry& geometry)
+	{
+		BeginConstruction(geometry);
+
+		auto rootNode = m_Arena.New<KdTreeNode>();
+		GeometryLib::ComputeAABBForTriangles(m_NumTriangles, m_Triangles, rootNode->m_BoundingMin,
+			rootNode->m_BoundingMax);
+
+		// The events are only sorted from scratch for the root node.
+		EventList events;
+		events.reserve((size_t)m_NumTriangles * 6);
+
+		for (unsigned i = 0; i < m_NumTriangles; i++)
+		{
+			vector4 boundsMin;
+			vector4 boundsMax;
+			m_Triangles[i].ComputeBounds(boundsMin, boundsMax);
+
+			GenerateEvents(i, boundsMin, boundsMax, events);
+		}
+		sort(events.begin(), events.end());
+
+		// The root's triangle list always fits, even if the limits are smaller than that.
+		Budget budget;
+		budget.m_References = SIZE_MAX;
+		budget.m_Bytes = SIZE_MAX;
+
+		if (m_MaxDuplication > 0.0f)
+			budget.m_References = max((size_t)m_NumTriangles, (size_t)(m_MaxDuplication * (double)m_NumTriangles));
+
+		if (m_MemoryBudget > 0)
+		{
+			size_t rootBytes = sizeof(KdTreeNode) + (size_t)m_NumTriangles * sizeof(unsigned);
+			budget.m_Bytes = max(rootBytes, m_MemoryBudget) - sizeof(KdTreeNode);
+		}
+
+		SideList sides(m_NumTriangles);
+		Subdivide(*rootNode, events, m_NumTriangles, 0, 0, budget, DetermineNumWorkers(), sides, m_Arena);
+
+		m_ExpectedCost = m_CostModel.CalculateTreeCost(*rootNode);
+		m_BytesUsed = m_Arena.GetBytesAllocated();
+
+		geometry.ReplaceKdTree(rootNode, m_Arena);
+	}
+
+	bool SAHEventSweep::ClipTriangleBounds(unsigned triangleIndex, const vector4& voxelMin, const vector4& voxelMax,
+		vector4& boundsMin, vector4& boundsMax)
+	{
+		if (m_PerfectSplits)
+			return ClipTriangleToAABB(m_Triangles[triangleIndex], voxelMin, voxelMax, boundsMin, boundsMax);
+
+		m_Triangles[triangleIndex].ComputeBounds(boundsMin, boundsMax);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = max(boundsMin[axis], voxelMin[axis]);
+			boundsMax[axis] = min(boundsMax[axis], voxelMax[axis]);
+
+			if (boundsMin[axis] > boundsMax[axis])
+				return false;
+		}
+
+		return true;
+	}
+
+	void SAHEventSweep::GenerateEvents(unsigned triangleIndex, const vector4& boundsMin, const vector4& boundsMax,
+		EventList& events)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (boundsMin[axis] == boundsMax[axis])
+			{
+				events.push_back(Event(boundsMin[axis], triangleIndex, axis, Event::PLANAR));
+			}
+			else
+			{
+				events.push_back(Event(boundsMin[axis], triangleIndex, axis, Event::START));
+				events.push_back(Event(boundsMax[axis], triangleIndex, axis, Event::END));
+			}
+		}
+	}
+
+	void SAHEventSweep::FindBestSplitAlongAxis(const KdTreeNode& node, int axis, const Event* firstEvent,
+		const Event* lastEvent, unsigned numTriangles, Split& split)
+	{
+		split.m_Axis = -1;
+		split.m_Cost = FLT_MAX;
+
+		const vector4& nodeBoundsMin = node.GetBoundingMin();
+		const vector4& nodeBoundsMax = node.GetBoundingMax();
+
+		float surfaceArea = SAHCostModel::CalculateSurfaceArea(nodeBoundsMin, nodeBoundsMax);
+		if (surfaceArea <= 0.0f)
+			return;
+
+		float surfaceAreaInv = 1.0f / surfaceArea;
+
+		// The children share the area of the faces perpendicular to the axis, and divide the rest.
+		float width = nodeBoundsMax[(axis + 1) % 3] - nodeBoundsMin[(axis + 1) % 3];
+		float height = nodeBoundsMax[(axis + 2) % 3] - nodeBoundsMin[(axis + 2) % 3];
+		float faceArea = 2.0f * width * height;
+		float facePerimeter = 2.0f * (width + height);
+
+		// Number of triangles entirely below and above the candidate plane.
+		unsigned numBelow = 0;
+		unsigned numAbove = numTriangles;
+
+		const Event* event = firstEvent;
+
+		while (event != lastEvent)
+		{
+			float t = event->m_T;
+
+			// Count the events at this candidate plane. They are sorted by type, so each type is a single run.
+			unsigned numEnding = 0;
+			unsigned numPlanar = 0;
+			unsigned numStarting = 0;
+
+			for (; event != lastEvent && event->m_T == t && event->m_Type == Event::END; event++)
+				numEnding++;
+
+			for (; event != lastEvent && event->m_T == t && event->m_Type == Event::PLANAR; event++)
+				numPlanar++;
+
+			for (; event != lastEvent && event->m_T == t && event->m_Type == Event::START; event++)
+				numStarting++;
+
+			numAbove -= numPlanar + numEnding;
+
+			// Splits on the voxel's faces would produce an empty child.
+			if (t > nodeBoundsMin[axis] && t < nodeBoundsMax[axis])
+			{
+				float probabilityBelow = (faceArea + (t - nodeBoundsMin[axis]) * facePerimeter) * surfaceAreaInv;
+				float probabilityAbove = (faceArea + (nodeBoundsMax[axis] - t) * facePerimeter) * surfaceAreaInv;
+
+				// Triangles lying in the plane are placed on whichever side is cheaper.
+				float costPlanarBelow = m_CostModel.CalculateSplitCost(probabilityBelow, probabilityAbove,
+					numBelow + numPlanar, numAbove);
+				float costPlanarAbove = m_CostModel.CalculateSplitCost(probabilityBelow, probabilityAbove,
+					numBelow, numAbove + numPlanar);
+
+				float cost = min(costPlanarBelow, costPlanarAbove);
+				if (cost < split.m_Cost)
+				{
+					split.m_Axis = axis;
+					split.m_Position = t;
+					split.m_Cost = cost;
+					split.m_PlanarBelow = costPlanarBelow <= costPlanarAbove;
+				}
+			}
+
+			numBelow += numStarting + numPlanar;
+		}
+		assert(numBelow == numTriangles && numAbove == 0);
+	}
+
+	bool SAHEventSweep::FindBestSplit(const KdTreeNode& node, const EventList& events, unsigned numTriangles,
+		unsigned numWorkers, Split& split)
+	{
+		// The events are sorted by axis first, so the events of each axis are a single range.
+		const Event* axisEvents[4];
+		axisEvents[0] = events.data();
+		axisEvents[3] = events.data() + events.size();
+
+		for (int axis = 1; axis < 3; axis++)
+		{
+			axisEvents[axis] = partition_point(axisEvents[axis - 1], axisEvents[3],
+				[axis](const Event& event) { return event.m_Axis < axis; });
+		}
+
+		Split axisSplits[3];
+
+		if (numWorkers > 1 && events.size() >= MinParallelEvents)
+		{
+			unsigned numAxisWorkers = min(numWorkers, 3u);
+
+			ForEachWorker(numAxisWorkers, [&](unsigned workerIndex)
+			{
+				for (int axis = workerIndex; axis < 3; axis += numAxisWorkers)
+					FindBestSplitAlongAxis(node, axis, axisEvents[axis], axisEvents[axis + 1], numTriangles, axisSplits[axis]);
+			});
+		}
+		else
+		{
+			for (int axis = 0; axis < 3; axis++)
+				FindBestSplitAlongAxis(node, axis, axisEvents[axis], axisEvents[axis + 1], numTriangles, axisSplits[axis]);
+		}
+
+		// Ties go to the lowest axis, whichever order the axes were swept in.
+		split = axisSplits[0];
+		for (int axis = 1; axis < 3; axis++)
+		{
+			if (axisSplits[axis].m_Cost < split.m_Cost)
+				split = axisSplits[axis];
+		}
+
+		return split.m_Axis != -1;
+	}
+
+	bool SAHEventSweep::ChooseSplit(const KdTreeNode& node, const EventList& events, unsigned numTriangles,
+		unsigned depth, int& badRefines, unsigned numWorkers, Split& split)
+	{
+		if (numTriangles < m_MaxTriangles || depth == m_DepthLimit)
+			return false;
+		assert(depth <= m_DepthLimit);
+
+		bool splitFound = FindBestSplit(node, events, numTriangles, numWorkers, split);
+
+		// As with the SAH builder a few splits costing more than a leaf are allowed, because following nodes
+		// may have a good split.
+		float leafCost = m_CostModel.CalculateLeafCost(numTriangles);
+		if (splitFound && split.m_Cost > leafCost)
+			badRefines++;
+
+		if (!splitFound || (split.m_Cost > 4.0f * leafCost && numTriangles < 16) || badRefines == 3)
+			return false;
+
+		return true;
+	}
+
+	bool SAHEventSweep::DivideBudget(const Budget& budget, unsigned numTrianglesBelow, unsigned numTrianglesAbove,
+		Budget& budgetBelow, Budget& budgetAbove) const
+	{
+		size_t numReferences = (size_t)numTrianglesBelow + numTrianglesAbove;
+		size_t numBytes = 2 * sizeof(KdTreeNode) + numReferences * sizeof(unsigned);
+
+		if (numReferences > budget.m_References || numBytes > budget.m_Bytes)
+			return false;
+
+		// Whatever the children do not need as leaves is shared in proportion to their triangles, so that
+		// the limits are spread over the whole mesh rather than used up by the first subtrees built.
+		double shareBelow = numReferences > 0 ? (double)numTrianglesBelow / numReferences : 0.5;
+
+		auto divide = [shareBelow](size_t total, size_t needed, size_t neededBelow, size_t neededAbove,
+			size_t& totalBelow, size_t& totalAbove)
+		{
+			if (SIZE_MAX == total)
+			{
+				totalBelow = SIZE_MAX;
+				totalAbove = SIZE_MAX;
+				return;
+			}
+
+			size_t spare = total - needed;
+			size_t spareBelow = min(spare, (size_t)(spare * shareBelow));
+
+			totalBelow = neededBelow + spareBelow;
+			totalAbove = neededAbove + (spare - spareBelow);
+		};
+
+		divide(budget.m_References, numReferences, numTrianglesBelow, numTrianglesAbove, budgetBelow.m_References,
+			budgetAbove.m_References);
+		divide(budget.m_Bytes, numBytes, numTrianglesBelow * sizeof(unsigned), numTrianglesAbove * sizeof(unsigned),
+			budgetBelow.m_Bytes, budgetAbove.m_Bytes);
+
+		return true;
+	}
+
+	void SAHEventSweep::SplitNode(KdTreeNode& node, const Split& split, Core::MemoryArena& arena)
+	{
+		vector4 splitNormal;
+		splitNormal.setXYZW(0.0f, 0.0f, 0.0f, 0.0f);
+		splitNormal[split.m_Axis] = 1.0f;
+		node.m_SplittingPlane.setNormal(splitNormal);
+
+		vector4 splitPosition;
+		vector4_copy(splitPosition, node.m_BoundingMin);
+		splitPosition[split.m_Axis] = split.m_Position;
+		node.m_SplittingPlane.setPointOnPlane(splitPosition);
+
+		auto childNode0 = arena.New<KdTreeNode>();
+		vector4_copy(childNode0->m_BoundingMin, node.m_BoundingMin);
+		vector4_copy(childNode0->m_BoundingMax, node.m_BoundingMax);
+
+		auto childNode1 = arena.New<KdTreeNode>();
+		vector4_copy(childNode1->m_BoundingMin, node.m_BoundingMin);
+		vector4_copy(childNode1->m_BoundingMax, node.m_BoundingMax);
+
+		childNode0->m_BoundingMax[split.m_Axis] = childNode1->m_BoundingMin[split.m_Axis] = split.m_Position;
+
+		node.m_Children[0] = childNode0;
+		node.m_Children[1] = childNode1;
+	}
+
+	void SAHEventSweep::SplitEvents(const KdTreeNode& node, const EventList& events, const Split& split,
+		unsigned numWorkers, SideList& sides, EventList& eventsBelow, unsigned& numTrianglesBelow, EventList& eventsAbove,
+		unsigned& numTrianglesAbove)
+	{
+		if (events.size() < MinParallelEvents)
+			numWorkers = 1;
+
+		// Each worker handles a contiguous range of the events, so that concatenating the results of the
+		// workers keeps the events sorted.
+		size_t numEvents = events.size();
+		auto firstWorkerEvent = [&](unsigned workerIndex)
+		{
+			return events.data() + numEvents * workerIndex / numWorkers;
+		};
+
+		// Classify the triangles. Only the events along the split axis are needed to do so; triangles not
+		// lying entirely on one side straddle the split. Every triangle has one starting or planar event
+		// along the x axis, and at most one of its events along the split axis changes its side, so the
+		// workers never write the same triangle's side.
+		ForEachWorker(numWorkers, [&](unsigned workerIndex)
+		{
+			for (auto event = firstWorkerEvent(workerIndex); event != firstWorkerEvent(workerIndex + 1); event++)
+			{
+				if (0 == event->m_Axis && Event::END != event->m_Type)
+					sides[event->m_PrimitiveIndex] = BOTH;
+			}
+		});
+
+		ForEachWorker(numWorkers, [&](unsigned workerIndex)
+		{
+			for (auto event = firstWorkerEvent(workerIndex); event != firstWorkerEvent(workerIndex + 1); event++)
+			{
+				if (event->m_Axis != split.m_Axis)
+					continue;
+
+				if (Event::END == event->m_Type && event->m_T <= split.m_Position)
+				{
+					sides[event->m_PrimitiveIndex] = BELOW;
+				}
+				else if (Event::START == event->m_Type && event->m_T >= split.m_Position)
+				{
+					sides[event->m_PrimitiveIndex] = ABOVE;
+				}
+				else if (Event::PLANAR == event->m_Type)
+				{
+					bool below = event->m_T < split.m_Position || (event->m_T == split.m_Position && split.m_PlanarBelow);
+					sides[event->m_PrimitiveIndex] = below ? BELOW : ABOVE;
+				}
+			}
+		});
+
+		vector<ChildEvents> workerEvents(numWorkers);
+
+		ForEachWorker(numWorkers, [&](unsigned workerIndex)
+		{
+			DistributeEvents(node, firstWorkerEvent(workerIndex), firstWorkerEvent(workerIndex + 1), split, sides,
+				workerEvents[workerIndex]);
+		});
+
+		EventList straddlingBelow;
+		EventList straddlingAbove;
+
+		numTrianglesBelow = 0;
+		numTrianglesAbove = 0;
+
+		for (auto& childEvents : workerEvents)
+		{
+			if (1 == numWorkers)
+			{
+				eventsBelow.swap(childEvents.m_Below);
+				eventsAbove.swap(childEvents.m_Above);
+				straddlingBelow.swap(childEvents.m_StraddlingBelow);
+				straddlingAbove.swap(childEvents.m_StraddlingAbove);
+			}
+			else
+			{
+				eventsBelow.insert(eventsBelow.end(), childEvents.m_Below.begin(), childEvents.m_Below.end());
+				eventsAbove.insert(eventsAbove.end(), childEvents.m_Above.begin(), childEvents.m_Above.end());
+				straddlingBelow.insert(straddlingBelow.end(), childEvents.m_StraddlingBelow.begin(),
+					childEvents.m_StraddlingBelow.end());
+				straddlingAbove.insert(straddlingAbove.end(), childEvents.m_StraddlingAbove.begin(),
+					childEvents.m_StraddlingAbove.end());
+			}
+
+			numTrianglesBelow += childEvents.m_NumTrianglesBelow;
+			numTrianglesAbove += childEvents.m_NumTrianglesAbove;
+		}
+
+		sort(straddlingBelow.begin(), straddlingBelow.end());
+		sort(straddlingAbove.begin(), straddlingAbove.end());
+
+		EventList mergedEvents;
+
+		mergedEvents.resize(eventsBelow.size() + straddlingBelow.size());
+		merge(eventsBelow.begin(), eventsBelow.end(), straddlingBelow.begin(), straddlingBelow.end(),
+			mergedEvents.begin());
+		eventsBelow.swap(mergedEvents);
+
+		mergedEvents.clear();
+		mergedEvents.resize(eventsAbove.size() + straddlingAbove.size());
+		merge(eventsAbove.begin(), eventsAbove.end(), straddlingAbove.begin(), straddlingAbove.end(),
+			mergedEvents.begin());
+		eventsAbove.swap(mergedEvents);
+	}
+
+	void SAHEventSweep::DistributeEvents(const KdTreeNode& node, const Event* firstEvent, const Event* lastEvent,
+		const Split& split, const SideList& sides, ChildEvents& childEvents)
+	{
+		vector4 belowMax;
+		vector4_copy(belowMax, node.GetBoundingMax());
+		belowMax[split.m_Axis] = split.m_Position;
+
+		vector4 aboveMin;
+		vector4_copy(aboveMin, node.GetBoundingMin());
+		aboveMin[split.m_Axis] = split.m_Position;
+
+		childEvents.m_NumTrianglesBelow = 0;
+		childEvents.m_NumTrianglesAbove = 0;
+
+		childEvents.m_Below.reserve(lastEvent - firstEvent);
+		childEvents.m_Above.reserve(lastEvent - firstEvent);
+
+		// The events of triangles entirely on one side are still sorted after being filtered. Straddling
+		// triangles get new events, clipped to each child's voxel.
+		for (auto event = firstEvent; event != lastEvent; event++)
+		{
+			auto side = sides[event->m_PrimitiveIndex];
+
+			if (BELOW == side)
+				childEvents.m_Below.push_back(*event);
+			else if (ABOVE == side)
+				childEvents.m_Above.push_back(*event);
+
+			// Each triangle is counted at its starting or planar event along the x axis.
+			if (0 != event->m_Axis || Event::END == event->m_Type)
+				continue;
+
+			if (BELOW == side)
+			{
+				childEvents.m_NumTrianglesBelow++;
+			}
+			else if (ABOVE == side)
+			{
+				childEvents.m_NumTrianglesAbove++;
+			}
+			else
+			{
+				vector4 boundsMin;
+				vector4 boundsMax;
+
+				if (ClipTriangleBounds(event->m_PrimitiveIndex, node.GetBoundingMin(), belowMax, boundsMin, boundsMax))
+				{
+					GenerateEvents(event->m_PrimitiveIndex, boundsMin, boundsMax, childEvents.m_StraddlingBelow);
+					childEvents.m_NumTrianglesBelow++;
+				}
+
+				if (ClipTriangleBounds(event->m_PrimitiveIndex, aboveMin, node.GetBoundingMax(), boundsMin, boundsMax))
+				{
+					GenerateEvents(event->m_PrimitiveIndex, boundsMin, boundsMax, childEvents.m_StraddlingAbove);
+					childEvents.m_NumTrianglesAbove++;
+				}
+			}
+		}
+	}
+
+	void SAHEventSweep::Subdivide(KdTreeNode& node, EventList& events, unsigned numTriangles, unsigned depth,
+		int badRefines, const Budget& budget, unsigned numWorkers, SideList& sides, Core::MemoryArena& arena)
+	{
+		Split split;
+		if (!ChooseSplit(node, events, numTriangles, depth, badRefines, numWorkers, split))
+		{
+			InitializeLeafNode(node, events, numTriangles, arena);
+			return;
+		}
+
+		EventList eventsBelow;
+		EventList eventsAbove;
+		unsigned numTrianglesBelow;
+		unsigned numTrianglesAbove;
+		SplitEvents(node, events, split, numWorkers, sides, eventsBelow, numTrianglesBelow, eventsAbove,
+			numTrianglesAbove);
+
+		// The split is only known to fit in the budget once the straddling triangles have been clipped.
+		Budget budgetBelow;
+		Budget budgetAbove;
+		if (!DivideBudget(budget, numTrianglesBelow, numTrianglesAbove, budgetBelow, budgetAbove))
+		{
+			m_NumLimitedNodes++;
+			InitializeLeafNode(node, events, numTriangles, arena);
+			return;
+		}
+
+		// The node's events are no longer needed, so free them before recursing.
+		EventList().swap(events);
+
+		SplitNode(node, split, arena);
+
+		auto childNode0 = node.m_Children[0];
+		auto childNode1 = node.m_Children[1];
+
+		if (numWorkers > 1)
+		{
+			// The workers are divided between the children, and the child below is built on a new thread.
+			// Straddling triangles are in both subtrees, so it needs its own triangle sides, and it allocates
+			// its nodes from its own arena.
+			unsigned numWorkersBelow = numWorkers / 2;
+			SideList sidesBelow(m_NumTriangles);
+			Core::MemoryArena arenaBelow;
+
+			thread belowThread([&]()
+			{
+				Subdivide(*childNode0, eventsBelow, numTrianglesBelow, depth + 1, badRefines, budgetBelow, numWorkersBelow,
+					sidesBelow, arenaBelow);
+			});
+
+			Subdivide(*childNode1, eventsAbove, numTrianglesAbove, depth + 1, badRefines, budgetAbove,
+				numWorkers - numWorkersBelow, sides, arena);
+
+			belowThread.join();
+			arena.TakeBlocks(arenaBelow);
+		}
+		else
+		{
+			Subdivide(*childNode0, eventsBelow, numTrianglesBelow, depth + 1, badRefines, budgetBelow, 1, sides, arena);
+			Subdivide(*childNode1, eventsAbove, numTrianglesAbove, depth + 1, badRefines, budgetAbove, 1, sides, arena);
+		}
+	}
+
+	void SAHEventSweep::InitializeLeafNode(KdTreeNode& node, const EventList& events, unsigned numTriangles,
+		Core::MemoryArena& arena)
+	{
+		node.m_NumTriangles = numTriangles;
+		node.m_TriangleList = arena.AllocateArray<unsigned>(numTriangles);
+		m_NumReferences += numTriangles;
+
+		unsigned index = 0;
+		for (auto& event : events)
+		{
+			if (0 == event.m_Axis && Event::END != event.m_Type)
+				node.m_TriangleList[index++] = event.m_PrimitiveIndex;
+		}
+		assert(index == numTriangles);
+	}
+}
+}
\ No newline at end of file
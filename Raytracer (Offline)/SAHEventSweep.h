@@ -0,0 +1,310 @@
+#pragma once
+
+#include "IKdTreeBuilder.h"
+#include "SAHCostModel.h"
+#include <MathLib.h>
+#include <MemoryArena.h>
+#include <atomic>
+#include <vector>
+
+using std::vector;
+using MathLib::vector4;
+
+namespace GeometryLib
+{
+	class Triangle;
+}
+using GeometryLib::Triangle;
+
+namespace Raytracer
+{
+	class KdTreeNode;
+
+namespace KdTreeConstruction
+{
+	/// <summary>
+	/// Constructs a kd tree using the Surface Area Heuristic, in O(N log N) time.
+	/// The split candidates of all three axes are sorted once for the root node, and the sorted order is
+	/// kept while the candidates are divided between the children of each node. Only the candidates of
+	/// triangles straddling a split are regenerated and sorted again.
+	/// </summary>
+	/// <remarks>
+	/// The size of the tree can be bounded by limiting how often triangles are duplicated across leaves, and
+	/// the memory of its nodes and triangle lists. Each node is given a share of the limits for its subtree,
+	/// split between its children in proportion to their triangles. Nodes which cannot be subdivided within
+	/// their share become leaves, so limited trees are still complete, and still the same for any number
+	/// of threads.
+	///
+	/// Based on "On building fast kd-Trees for Ray Tracing, and on doing that in O(N log N)" by Ingo Wald
+	/// and Vlastimil Havran.
+	/// </remarks>
+	class SAHEventSweep : public IKdTreeBuilder
+	{
+	public:
+
+		/// Nodes with fewer events than this are not worth splitting between threads.
+		static const unsigned MinParallelEvents = 16384;
+
+		/// Maximum depth which is derived from the number of triangles with CalculateMaxDepth.
+		static const unsigned AutomaticMaxDepth = 0;
+
+		/// Changed whenever the trees built for the same triangles and parameters change, invalidating trees
+		/// cached by KdTreeGeometry.
+		static const unsigned Version = 1;
+
+		/// <summary>
+		/// Depths beyond what compact trees can hold, KdTreeCompact::MaxDepth - 1, are limited to it.
+		/// </summary>
+		SAHEventSweep(unsigned maxDepth, unsigned maxTriangles);
+
+		/// <summary>
+		/// Returns the maximum depth suited to a tree of the specified number of triangles, 8 + 1.3 log2(N),
+		/// limited to the depth compact trees can hold.
+		/// </summary>
+		static unsigned CalculateMaxDepth(unsigned numTriangles);
+
+		/// <summary>
+		/// Sets the number of threads used to construct the tree. A value of 0 uses one thread per
+		/// hardware thread available on this machine. The tree built is the same for any number of threads.
+		/// </summary>
+		void SetNumThreads(unsigned numThreads);
+		unsigned GetNumThreads() const;
+
+		/// <summary>
+		/// Sets whether triangles straddling a split are clipped to the voxel of each child, rather than
+		/// having their bounds clipped to it. This places split candidates at the true extents of the part of
+		/// each triangle inside a node, giving tighter leaves and fewer references to long thin triangles.
+		/// </summary>
+		void SetPerfectSplits(bool perfectSplits);
+		bool GetPerfectSplits() const;
+
+		void SetCostModel(const SAHCostModel& costModel);
+		const SAHCostModel& GetCostModel() const;
+
+		/// <summary>
+		/// Sets the largest duplication factor allowed, the number of triangle references in all leaves
+		/// divided by the number of triangles. A value of 0, the default, sets no limit.
+		/// </summary>
+		void SetMaxDuplication(float maxDuplication);
+		float GetMaxDuplication() const;
+
+		/// <summary>
+		/// Sets the most memory the nodes and triangle lists of the tree may use, in bytes. A value of 0, the
+		/// default, sets no limit. The limits never prevent a single leaf holding every triangle.
+		/// </summary>
+		void SetMemoryBudget(size_t memoryBudget);
+		size_t GetMemoryBudget() const;
+
+		/// <summary>Returns the expected cost of the last tree constructed, under the cost model.</summary>
+		float GetExpectedCost() const;
+
+		/// <summary>Returns the duplication factor of the last tree constructed.</summary>
+		float GetDuplicationFactor() const;
+
+		/// <summary>Returns the bytes used by the nodes and triangle lists of the last tree constructed.</summary>
+		size_t GetBytesUsed() const;
+
+		/// <summary>
+		/// Returns the number of nodes of the last tree constructed which were made leaves because subdividing
+		/// them would have exceeded the duplication or memory limits.
+		/// </summary>
+		unsigned GetNumLimitedNodes() const;
+
+		void Construct(KdTreeGeometry& geometry) override;
+
+	protected:
+
+		/// <summary>
+		/// A split candidate, at a bound of a triangle's extents along one axis.
+		/// Triangles with no extent along an axis produce a single planar event for it.
+		/// </summary>
+		struct Event
+		{
+			float m_T;
+
+			unsigned m_PrimitiveIndex;
+
+			unsigned char m_Axis;
+
+			/// Ordered so that at equal positions triangles ending are removed before triangles starting
+			/// are added.
+			enum Type : unsigned char { END, PLANAR, START } m_Type;
+
+			Event() {}
+			Event(float t, unsigned primitiveIndex, unsigned axis, Type type) :
+				m_T(t), m_PrimitiveIndex(primitiveIndex), m_Axis((unsigned char)axis), m_Type(type)
+			{}
+
+			/// Events are totally ordered, so sorting them gives the same order however they were gathered.
+			bool operator<(const Event& event) const
+			{
+				if (m_Axis != event.m_Axis)
+					return m_Axis < event.m_Axis;
+
+				if (m_T != event.m_T)
+					return m_T < event.m_T;
+
+				if (m_Type != event.m_Type)
+					return m_Type < event.m_Type;
+
+				return m_PrimitiveIndex < event.m_PrimitiveIndex;
+			}
+		};
+		typedef vector<Event> EventList;
+
+		struct Split
+		{
+			int m_Axis;
+			float m_Position;
+			float m_Cost;
+
+			/// Whether triangles lying in the splitting plane are placed in the child below it.
+			bool m_PlanarBelow;
+		};
+
+		/// <summary>
+		/// Share of the duplication and memory limits which the leaves and nodes of a subtree may use. The
+		/// share always covers the triangle list of the subtree's root as a leaf.
+		/// </summary>
+		struct Budget
+		{
+			/// Triangle references in the subtree's leaves.
+			size_t m_References;
+
+			/// Bytes of the nodes below the subtree's root, and of the triangle lists of its leaves.
+			size_t m_Bytes;
+		};
+
+		/// Side of a split that a triangle has been classified to.
+		enum Side : unsigned char { BELOW, ABOVE, BOTH };
+
+		/// Classification of each triangle against the split of the node being subdivided, indexed by
+		/// triangle. Each thread building a subtree has its own.
+		typedef vector<unsigned char> SideList;
+
+		/// Events of a range of a node's events, divided between the node's children.
+		struct ChildEvents
+		{
+			EventList m_Below;
+			EventList m_Above;
+
+			/// Clipped events of triangles straddling the split. These are not sorted.
+			EventList m_StraddlingBelow;
+			EventList m_StraddlingAbove;
+
+			unsigned m_NumTrianglesBelow;
+			unsigned m_NumTrianglesAbove;
+		};
+
+		unsigned m_NumTriangles;
+		const Triangle* m_Triangles;
+
+		unsigned m_MaxDepth;
+		unsigned m_MaxTriangles;
+
+		/// Maximum depth of the tree being constructed, derived from its triangles if m_MaxDepth is automatic.
+		unsigned m_DepthLimit;
+
+		unsigned m_NumThreads;
+
+		bool m_PerfectSplits;
+
+		SAHCostModel m_CostModel;
+
+		float m_MaxDuplication;
+		size_t m_MemoryBudget;
+
+		float m_ExpectedCost;
+
+		/// Triangle references and nodes made leaves by the limits in the tree being constructed. Updated by
+		/// every thread building it.
+		std::atomic<size_t> m_NumReferences;
+		std::atomic<unsigned> m_NumLimitedNodes;
+
+		size_t m_BytesUsed;
+
+		/// Storage of the tree being constructed, handed over to the geometry once it is complete.
+		Core::MemoryArena m_Arena;
+
+		unsigned DetermineNumWorkers() const;
+
+		/// <summary>
+		/// Starts constructing a tree for the geometry, resolving the depth limit and clearing the statistics
+		/// of the previous tree.
+		/// </summary>
+		void BeginConstruction(const KdTreeGeometry& geometry);
+
+		/// <summary>
+		/// Divides the budget of a node between the children of a split, in proportion to their triangles.
+		/// Returns false if the split's children do not fit in the budget.
+		/// </summary>
+		bool DivideBudget(const Budget& budget, unsigned numTrianglesBelow, unsigned numTrianglesAbove,
+			Budget& budgetBelow, Budget& budgetAbove) const;
+
+		/// <summary>
+		/// Calculates the bounds of the part of the triangle inside the voxel. Without perfect splits these are
+		/// the triangle's bounds clipped to the voxel. Returns false if the triangle does not overlap the voxel.
+		/// </summary>
+		bool ClipTriangleBounds(unsigned triangleIndex, const vector4& voxelMin, const vector4& voxelMax,
+			vector4& boundsMin, vector4& boundsMax);
+
+		/// <summary>Appends the events of a triangle with the specified bounds.</summary>
+		void GenerateEvents(unsigned triangleIndex, const vector4& boundsMin, const vector4& boundsMax,
+			EventList& events);
+
+		/// <summary>
+		/// Sweeps the sorted events of a node along one axis to find the cheapest split on it.
+		/// Leaves the split's axis at -1 if there are no split candidates inside the node's voxel.
+		/// </summary>
+		void FindBestSplitAlongAxis(const KdTreeNode& node, int axis, const Event* firstEvent, const Event* lastEvent,
+			unsigned numTriangles, Split& split);
+
+		/// <summary>
+		/// Finds the cheapest split along any axis, sweeping the axes in parallel if numWorkers is above one.
+		/// Returns false if the node has no split candidates inside its voxel.
+		/// </summary>
+		bool FindBestSplit(const KdTreeNode& node, const EventList& events, unsigned numTriangles, unsigned numWorkers,
+			Split& split);
+
+		/// <summary>
+		/// Decides whether the node is subdivided, finding the split to do so with. Returns false if the node
+		/// should be a leaf. badRefines counts the splits above the node costing more than a leaf, and is
+		/// updated for the split found.
+		/// </summary>
+		bool ChooseSplit(const KdTreeNode& node, const EventList& events, unsigned numTriangles, unsigned depth,
+			int& badRefines, unsigned numWorkers, Split& split);
+
+		/// <summary>
+		/// Sets the splitting plane of the node, and gives it two empty children with the voxels on either side,
+		/// allocated from the arena.
+		/// </summary>
+		void SplitNode(KdTreeNode& node, const Split& split, Core::MemoryArena& arena);
+
+		/// <summary>
+		/// Divides the events of a node between its children, keeping both lists sorted. The events are
+		/// divided in parallel ranges if numWorkers is above one.
+		/// </summary>
+		void SplitEvents(const KdTreeNode& node, const EventList& events, const Split& split, unsigned numWorkers,
+			SideList& sides, EventList& eventsBelow, unsigned& numTrianglesBelow, EventList& eventsAbove,
+			unsigned& numTrianglesAbove);
+
+		/// <summary>
+		/// Divides a range of a node's events between its children. The sides of the node's triangles must
+		/// already be classified.
+		/// </summary>
+		void DistributeEvents(const KdTreeNode& node, const Event* firstEvent, const Event* lastEvent,
+			const Split& split, const SideList& sides, ChildEvents& childEvents);
+
+		/// <summary>
+		/// Recursively subdivides the node, consuming its events, within the budget. Up to numWorkers threads
+		/// are used, with the children of a node being built concurrently while more than one is available.
+		/// The subtree is allocated from the arena, which only the calling thread uses.
+		/// </summary>
+		void Subdivide(KdTreeNode& node, EventList& events, unsigned numTriangles, unsigned depth, int badRefines,
+			const Budget& budget, unsigned numWorkers, SideList& sides, Core::MemoryArena& arena);
+
+		void InitializeLeafNode(KdTreeNode& node, const EventList& events, unsigned numTriangles,
+			Core::MemoryArena& arena);
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#include "SAHLazy.h"
+#include "KdTreeGeometry.h"
+#include "KdTreeNode.h"
+#include <Geometry.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+using namespace std;
+using namespace MathLib;
+using namespace GeometryLib;
+
+namespace Raytracer
+{
+namespace KdTreeConstruction
+{
+	SAHLazy::SAHLazy(unsigned maxDepth, unsigned maxTriangles) :
+		SAHEventSweep(maxDepth, maxTriangles)
+	{
+	}
+
+	void SAHLazy::Construct(KdTreeGeometry& geometry)
+	{
+		BeginConstruction(geometry);
+
+		auto rootNode = m_Arena.New<KdTreeNode>();
+		GeometryLib::ComputeAABBForTriangles(m_NumTriangles, m_Triangles, rootNode->m_BoundingMin,
+			rootNode->m_BoundingMax);
+
+		rootNode->m_NumTriangles = m_NumTriangles;
+		rootNode->m_TriangleList = m_Arena.AllocateArray<unsigned>(m_NumTriangles);
+
+		for (unsigned i = 0; i < m_NumTriangles; i++)
+			rootNode->m_TriangleList[i] = i;
+
+		rootNode->m_Unexpanded.store(true, memory_order_relaxed);
+
+		geometry.ReplaceKdTree(rootNode, m_Arena);
+
+		for (auto& arena : m_ExpansionArenas)
+			arena.Reset();
+	}
+
+	void SAHLazy::Expand(KdTreeNode& node)
+	{
+		unsigned lockIndex = ((uintptr_t)&node / sizeof(KdTreeNode)) % NumExpansionLocks;
+		lock_guard<mutex> lock(m_ExpansionLocks[lockIndex]);
+		Core::MemoryArena& arena = m_ExpansionArenas[lockIndex];
+
+		// Another thread may have expanded the node while this one waited for the lock.
+		if (!node.m_Unexpanded.load(memory_order_relaxed))
+			return;
+
+		// The events of the node are regenerated from its triangles, as only the triangles are kept for
+		// unexpanded nodes.
+		vector<ClippedTriangle> triangles;
+		triangles.reserve(node.m_NumTriangles);
+
+		EventList events;
+		events.reserve((size_t)node.m_NumTriangles * 6);
+
+		for (unsigned i = 0; i < node.m_NumTriangles; i++)
+		{
+			ClippedTriangle triangle;
+			triangle.m_Index = node.m_TriangleList[i];
+
+			if (!ClipTriangleBounds(triangle.m_Index, node.m_BoundingMin, node.m_BoundingMax, triangle.m_Min, triangle.m_Max))
+				continue;
+
+			GenerateEvents(triangle.m_Index, triangle.m_Min, triangle.m_Max, events);
+			triangles.push_back(triangle);
+		}
+		sort(events.begin(), events.end());
+
+		unsigned numTriangles = (unsigned)triangles.size();
+		int badRefines = node.m_BadRefines;
+
+		Split split;
+		bool subdivide = ChooseSplit(node, events, numTriangles, node.m_Depth, badRefines, 1, split);
+
+		// Threads which have not seen the node expanded yet wait for the lock rather than reading the node,
+		// so its triangles can be replaced. The old list stays in its arena until the tree is freed.
+		node.m_TriangleList = nullptr;
+		node.m_NumTriangles = 0;
+
+		if (subdivide)
+		{
+			SplitNode(node, split, arena);
+
+			InitializeUnexpandedNode(*node.m_Children[0], triangles, split, BELOW, node.m_Depth + 1, badRefines, arena);
+			InitializeUnexpandedNode(*node.m_Children[1], triangles, split, ABOVE, node.m_Depth + 1, badRefines, arena);
+		}
+		else
+		{
+			// Listing the triangles from the events orders them as SAHEventSweep does.
+			InitializeLeafNode(node, events, numTriangles, arena);
+		}
+
+		node.m_Unexpanded.store(false, memory_order_release);
+	}
+
+	void SAHLazy::InitializeUnexpandedNode(KdTreeNode& node, const vector<ClippedTriangle>& triangles,
+		const Split& split, Side side, unsigned depth, int badRefines, Core::MemoryArena& arena)
+	{
+		vector<unsigned> triangleIndices;
+
+		// Triangles are classified as SplitEvents classifies them from their events.
+		for (auto& triangle : triangles)
+		{
+			float triangleMin = triangle.m_Min[split.m_Axis];
+			float triangleMax = triangle.m_Max[split.m_Axis];
+
+			Side triangleSide = BOTH;
+
+			if (triangleMin == triangleMax)
+			{
+				bool below = triangleMin < split.m_Position || (triangleMin == split.m_Position && split.m_PlanarBelow);
+				triangleSide = below ? BELOW : ABOVE;
+			}
+			else if (triangleMax <= split.m_Position)
+			{
+				triangleSide = BELOW;
+			}
+			else if (triangleMin >= split.m_Position)
+			{
+				triangleSide = ABOVE;
+			}
+
+			if (triangleSide == side)
+			{
+				triangleIndices.push_back(triangle.m_Index);
+			}
+			else if (BOTH == triangleSide)
+			{
+				vector4 boundsMin;
+				vector4 boundsMax;
+
+				if (ClipTriangleBounds(triangle.m_Index, node.m_BoundingMin, node.m_BoundingMax, boundsMin, boundsMax))
+					triangleIndices.push_back(triangle.m_Index);
+			}
+		}
+
+		node.m_NumTriangles = (unsigned)triangleIndices.size();
+		node.m_TriangleList = arena.AllocateArray<unsigned>(node.m_NumTriangles);
+		copy(triangleIndices.begin(), triangleIndices.end(), node.m_TriangleList);
+
+		node.m_Depth = depth;
+		node.m_BadRefines = badRefines;
+
+		// Published along with the parent's children when the parent is marked expanded.
+		node.m_Unexpanded.store(true, memory_order_relaxed);
+	}
+}
+}
\ No newline at end of file
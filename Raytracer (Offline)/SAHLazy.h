@@ -0,0 +1,65 @@
+#pragma once
+
+#include "SAHEventSweep.h"
+#include <mutex>
+
+namespace Raytracer
+{
+namespace KdTreeConstruction
+{
+	/// <summary>
+	/// Constructs a kd tree lazily. Construction only creates the root, holding every triangle, and each node
+	/// is subdivided the first time a ray reaches it. Build work is then only spent where rays actually go,
+	/// which for huge meshes of which little is visible is a small part of the tree.
+	///
+	/// Nodes are subdivided one level at a time, choosing splits exactly as SAHEventSweep does, so a fully
+	/// expanded tree is the one SAHEventSweep builds. The builder must outlive the tree it constructed, and
+	/// the tree is only traversed in its node form, as it keeps changing while rays are traced.
+	/// </summary>
+	class SAHLazy : public SAHEventSweep
+	{
+	public:
+
+		/// Number of locks guarding the expansion of nodes. Each node is guarded by one of them, chosen by
+		/// its address, so threads expanding different nodes rarely wait for each other.
+		static const unsigned NumExpansionLocks = 64;
+
+		SAHLazy(unsigned maxDepth, unsigned maxTriangles);
+
+		/// <summary>
+		/// Creates the unexpanded root node of the tree, freeing the nodes expanded for the previous tree. The
+		/// expected cost is not known for lazily built trees, so is left at 0.
+		/// </summary>
+		void Construct(KdTreeGeometry& geometry) override;
+
+		/// <summary>
+		/// Subdivides an unexpanded node of the tree constructed, either into two unexpanded children or into
+		/// a leaf. Safe to call from multiple threads, including for the same node, which is only expanded once.
+		/// </summary>
+		void Expand(KdTreeNode& node);
+
+	protected:
+
+		/// A triangle of a node being expanded, with its bounds clipped to the node's voxel.
+		struct ClippedTriangle
+		{
+			unsigned m_Index;
+
+			vector4 m_Min;
+			vector4 m_Max;
+		};
+
+		std::mutex m_ExpansionLocks[NumExpansionLocks];
+
+		/// Storage of the nodes expanded while holding each lock.
+		Core::MemoryArena m_ExpansionArenas[NumExpansionLocks];
+
+		/// <summary>
+		/// Makes the child of a node being expanded an unexpanded node, holding the triangles of its parent on
+		/// the specified side of the split, and those straddling the split which overlap its voxel.
+		/// </summary>
+		void InitializeUnexpandedNode(KdTreeNode& node, const vector<ClippedTriangle>& triangles, const Split& split,
+			Side side, unsigned depth, int badRefines, Core::MemoryArena& arena);
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include "..\AdaptiveRaytracer.h"
+#include "..\FrameBuffer.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+using namespace CameraLib;
+
+namespace
+{
+	// The odd width places the centre column of pixels exactly on the edge of the half space.
+	const unsigned int FrameBufferWidth = 41;
+	const unsigned int FrameBufferHeight = 30;
+	const unsigned int EdgeColumn = FrameBufferWidth / 2;
+
+	/// <summary>
+	/// Scene which is hit, and shaded white, by every ray pointing into the positive half space of a plane
+	/// through the origin of the rays.
+	/// </summary>
+	class HalfSpaceScene : public TestScene
+	{
+	public:
+
+		HalfSpaceScene(const vector4& normal) :
+			m_Normal(normal)
+		{
+		}
+
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override
+		{
+			hitRecord.m_T = 1.0f;
+			hitRecord.m_U = 0.0f;
+			hitRecord.m_V = 0.0f;
+			hitRecord.m_PrimitiveId = 0;
+			hitRecord.m_InstanceId = 0;
+
+			return vector4_dotProduct(intersectionRay.getDirection(), m_Normal) > 0.0f;
+		}
+
+		void Shade(const HitRecord& hitRecord, float* results) const override
+		{
+			results[0] = 1.0f;
+			results[1] = 1.0f;
+			results[2] = 1.0f;
+			results[3] = 1.0f;
+		}
+
+	private:
+
+		vector4 m_Normal;
+	};
+}
+
+TEST(AdaptiveRaytracer, AdaptiveRaytracer_Refines_Only_Edges)
+{
+	initMathLib();
+
+	Camera camera;
+	camera.SetPosition(0.0f, 0.0f, 0.0f);
+	camera.Update();
+
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	HalfSpaceScene scene(camera.GetXAxis());
+
+	AdaptiveRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetTileSize(16);
+	raytracer.Raytrace();
+
+	unsigned int numBaseSamples = raytracer.GetBaseSamplesPerAxis() * raytracer.GetBaseSamplesPerAxis();
+	unsigned int numRefinedSamples = raytracer.GetRefinedSamplesPerAxis() * raytracer.GetRefinedSamplesPerAxis();
+
+	// The edge column and its two neighbours are refined.
+	ASSERT_EQ(raytracer.GetNumRefinedPixels(), FrameBufferHeight * 3);
+	ASSERT_EQ(raytracer.GetNumRaysTraced(), FrameBufferWidth * FrameBufferHeight * numBaseSamples +
+		raytracer.GetNumRefinedPixels() * numRefinedSamples);
+
+	for (unsigned int y = 0; y < FrameBufferHeight; y++)
+	{
+		for (unsigned int x = 0; x < FrameBufferWidth; x++)
+		{
+			const float* pixel = frameBuffer.GetData() + (y * FrameBufferWidth + x) * 4;
+
+			if (x == EdgeColumn)
+				ASSERT_NEAR(pixel[0], 0.5f, 1e-5f);
+			else
+				ASSERT_EQ(pixel[0], x > EdgeColumn ? 1.0f : 0.0f);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <gtest\gtest.h>
+#include "..\BatchRenderer.h"
+
+using namespace Raytracer;
+
+TEST(BatchRenderer, BatchRenderer_Parses_Jobs_With_Defaults)
+{
+	BatchRenderer batchRenderer;
+
+	ASSERT_TRUE(batchRenderer.ParseJobs(
+		"# Comments and empty lines are ignored.\n"
+		"\n"
+		"defaults width=320 height=240 fov=45 raytracer=progressive budget=50\n"
+		"name=front position=-5,7,0 rotation=-30,-30 entrysearch=0\n"
+		"output=side.tga position=1,2.5,3 width=640 raytracer=adaptive mailbox=1\n"));
+
+	auto& jobs = batchRenderer.GetJobs();
+	ASSERT_EQ(jobs.size(), 2);
+
+	ASSERT_EQ(jobs[0].m_Name, "front");
+	ASSERT_EQ(jobs[0].m_OutputFileName, "front.tga");
+	ASSERT_EQ(jobs[0].m_Width, 320);
+	ASSERT_EQ(jobs[0].m_Height, 240);
+	ASSERT_EQ(jobs[0].m_YFov, 45.0f);
+	ASSERT_EQ(jobs[0].m_Raytracer, "progressive");
+	ASSERT_EQ(jobs[0].m_TimeBudget, 50.0);
+	ASSERT_EQ(jobs[0].m_Position[0], -5.0f);
+	ASSERT_EQ(jobs[0].m_Position[1], 7.0f);
+	ASSERT_EQ(jobs[0].m_Position[2], 0.0f);
+	ASSERT_EQ(jobs[0].m_Rotation[0], -30.0f);
+	ASSERT_EQ(jobs[0].m_Rotation[1], -30.0f);
+	ASSERT_FALSE(jobs[0].m_Mailboxing);
+	ASSERT_FALSE(jobs[0].m_EntryPointSearch);
+
+	ASSERT_EQ(jobs[1].m_Name, "job1");
+	ASSERT_EQ(jobs[1].m_OutputFileName, "side.tga");
+	ASSERT_EQ(jobs[1].m_Width, 640);
+	ASSERT_EQ(jobs[1].m_Height, 240);
+	ASSERT_EQ(jobs[1].m_Raytracer, "adaptive");
+	ASSERT_EQ(jobs[1].m_Position[1], 2.5f);
+	ASSERT_TRUE(jobs[1].m_Mailboxing);
+	ASSERT_TRUE(jobs[1].m_EntryPointSearch);
+}
+
+TEST(BatchRenderer, BatchRenderer_Rejects_Invalid_Jobs)
+{
+	ASSERT_FALSE(BatchRenderer().ParseJobs("width=wide\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("position=1,2\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("raytracer=unknown\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("colour=red\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("name\n"));
+
+	// Negative sizes would wrap around to huge ones, and huge ones overflow the frame buffer's size.
+	ASSERT_FALSE(BatchRenderer().ParseJobs("width=-5\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("height=-720\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("width=65536\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("threads=-1\n"));
+	ASSERT_FALSE(BatchRenderer().ParseJobs("threads=100000\n"));
+	ASSERT_TRUE(BatchRenderer().ParseJobs("width=16384 height=16384 threads=256\n"));
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include <gtest\gtest.h>
+#include <vector>
+#include "..\DeferredShadingPass.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+
+namespace
+{
+	/// <summary>
+	/// Scene which shades each hit with its instance and primitive IDs and records the batches it is asked to shade.
+	/// </summary>
+	class RecordingScene : public TestScene
+	{
+	public:
+
+		RecordingScene(unsigned int numElements) :
+			m_NumElements(numElements)
+		{
+		}
+
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override { return false; }
+
+		void Shade(const HitRecord& hitRecord, float* results) const override
+		{
+			results[0] = (float)hitRecord.m_InstanceId;
+			results[1] = (float)hitRecord.m_PrimitiveId;
+			results[2] = 0.0f;
+			results[3] = 1.0f;
+		}
+
+		void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const override
+		{
+			for (unsigned int i = 0; i < numHits; i++)
+			{
+				EXPECT_EQ(hitRecords[i].m_InstanceId, hitRecords[0].m_InstanceId);
+				Shade(hitRecords[i], results + i * 4);
+			}
+
+			m_Batches.push_back(hitRecords[0].m_InstanceId);
+		}
+
+		unsigned int GetNumElements() const override
+		{
+			return m_NumElements;
+		}
+
+		mutable std::vector<unsigned int> m_Batches;
+
+	private:
+
+		unsigned int m_NumElements;
+	};
+}
+
+TEST(DeferredShadingPass, DeferredShadingPass_Shades_Each_Instance_In_One_Batch)
+{
+	const unsigned int numInstances = 4;
+	const unsigned int numHits = 64;
+
+	RecordingScene scene(numInstances);
+	DeferredShadingPass shadingPass;
+
+	std::vector<float> pixels(numHits * 4, -1.0f);
+
+	// Interleave the instances so that the pass has to group them.
+	for (unsigned int i = 0; i < numHits; i++)
+	{
+		HitRecord hitRecord;
+		hitRecord.m_T = 1.0f;
+		hitRecord.m_U = 0.0f;
+		hitRecord.m_V = 0.0f;
+		hitRecord.m_PrimitiveId = i;
+		hitRecord.m_InstanceId = (i * 3) % numInstances;
+
+		shadingPass.AddHit(hitRecord, &pixels[i * 4]);
+	}
+
+	ASSERT_EQ(shadingPass.GetNumPendingHits(), numHits);
+
+	shadingPass.Shade(scene);
+
+	ASSERT_EQ(shadingPass.GetNumPendingHits(), 0);
+	ASSERT_EQ(scene.m_Batches.size(), numInstances);
+
+	// Every hit must be written back to the pixel it was queued with.
+	for (unsigned int i = 0; i < numHits; i++)
+	{
+		ASSERT_EQ(pixels[i * 4], (float)((i * 3) % numInstances));
+		ASSERT_EQ(pixels[i * 4 + 1], (float)i);
+		ASSERT_EQ(pixels[i * 4 + 3], 1.0f);
+	}
+}
\ No newline at end of file
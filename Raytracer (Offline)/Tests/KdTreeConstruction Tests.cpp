@@ -0,0 +1,602 @@
+#include <gtest\gtest.h>
+#include <StaticMesh.h>
+#include <Geometry.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include "..\KdTreeAutotuner.h"
+#include "..\KdTreeCompact.h"
+#include "..\KdTreeGeometry.h"
+#include "..\KdTreeNode.h"
+#include "..\KdTreeStackTraversal.h"
+#include "..\SAH.h"
+#include "..\SAHCostModel.h"
+#include "..\SAHEventSweep.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+using namespace Assets;
+
+namespace
+{
+	const unsigned int NumTestRays = 1000;
+
+	/// <summary>
+	/// Creates a mesh of randomly placed axis aligned boxes, mixed with randomly oriented triangles.
+	/// The box faces produce many triangles lying in candidate splitting planes.
+	/// </summary>
+	std::unique_ptr<StaticMesh> CreateBoxesAndTriangles(unsigned int numBoxes, unsigned int numTriangles, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> centerDistribution(-5.0f, 5.0f);
+		std::uniform_real_distribution<float> offsetDistribution(-0.6f, 0.6f);
+		std::uniform_real_distribution<float> sizeDistribution(0.1f, 1.0f);
+
+		std::vector<float> vertices;
+
+		for (unsigned int i = 0; i < numBoxes; i++)
+		{
+			// Snapping the boxes to a grid makes their faces share planes.
+			float min[3];
+			float max[3];
+			for (unsigned int axis = 0; axis < 3; axis++)
+			{
+				min[axis] = floorf(centerDistribution(generator) * 4.0f) * 0.25f;
+				max[axis] = min[axis] + ceilf(sizeDistribution(generator) * 4.0f) * 0.25f;
+			}
+
+			for (unsigned int axis = 0; axis < 3; axis++)
+			{
+				unsigned int u = (axis + 1) % 3;
+				unsigned int v = (axis + 2) % 3;
+
+				for (float plane : { min[axis], max[axis] })
+				{
+					float corners[4][2] = { { min[u], min[v] }, { max[u], min[v] }, { max[u], max[v] }, { min[u], max[v] } };
+					unsigned int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+					for (unsigned int index : quadIndices)
+					{
+						float position[3];
+						position[axis] = plane;
+						position[u] = corners[index][0];
+						position[v] = corners[index][1];
+
+						vertices.insert(vertices.end(), position, position + 3);
+					}
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < numTriangles; i++)
+		{
+			float center[3] = { centerDistribution(generator), centerDistribution(generator), centerDistribution(generator) };
+
+			for (unsigned int v = 0; v < 3; v++)
+			{
+				for (unsigned int axis = 0; axis < 3; axis++)
+					vertices.push_back(center[axis] + offsetDistribution(generator));
+			}
+		}
+
+		unsigned int numVertices = (unsigned int)vertices.size() / 3;
+
+		std::unique_ptr<float[]> vertexArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> normalArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> texCoordArray(new float[numVertices * 2]);
+		std::unique_ptr<uint32_t[]> indexArray(new uint32_t[numVertices]);
+
+		for (unsigned int v = 0; v < numVertices; v++)
+		{
+			for (unsigned int axis = 0; axis < 3; axis++)
+			{
+				vertexArray[v * 3 + axis] = vertices[v * 3 + axis];
+				normalArray[v * 3 + axis] = axis == 1 ? 1.0f : 0.0f;
+			}
+
+			texCoordArray[v * 2] = 0.0f;
+			texCoordArray[v * 2 + 1] = 0.0f;
+			indexArray[v] = v;
+		}
+
+		return std::unique_ptr<StaticMesh>(new StaticMesh(numVertices, std::move(vertexArray), std::move(texCoordArray),
+			std::move(normalArray), numVertices, std::move(indexArray)));
+	}
+
+	/// <summary>
+	/// Creates a row of triangles, each a fraction of the size of the previous one. Splits cheaply peel off one
+	/// triangle at a time, so builders free to subdivide build a tree as deep as the number of triangles.
+	/// </summary>
+	std::unique_ptr<StaticMesh> CreateShrinkingTriangles(unsigned int numTriangles)
+	{
+		unsigned int numVertices = numTriangles * 3;
+
+		std::unique_ptr<float[]> vertexArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> normalArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> texCoordArray(new float[numVertices * 2]);
+		std::unique_ptr<uint32_t[]> indexArray(new uint32_t[numVertices]);
+
+		// Starting large keeps the smallest triangles' surface areas representable.
+		float size = 1e16f;
+
+		for (unsigned int i = 0; i < numTriangles; i++, size *= 0.6f)
+		{
+			float triangle[9] = { size, 0.0f, 0.0f, size * 0.85f, size * 0.15f, 0.0f, size, size * 0.15f, size * 0.15f };
+
+			for (unsigned int j = 0; j < 9; j++)
+			{
+				vertexArray[i * 9 + j] = triangle[j];
+				normalArray[i * 9 + j] = 1 == j % 3 ? 1.0f : 0.0f;
+			}
+		}
+
+		for (unsigned int v = 0; v < numVertices; v++)
+		{
+			texCoordArray[v * 2] = 0.0f;
+			texCoordArray[v * 2 + 1] = 0.0f;
+			indexArray[v] = v;
+		}
+
+		return std::unique_ptr<StaticMesh>(new StaticMesh(numVertices, std::move(vertexArray), std::move(texCoordArray),
+			std::move(normalArray), numVertices, std::move(indexArray)));
+	}
+
+	/// <summary>
+	/// Creates a ray starting at a random position outside the mesh, pointing towards its center.
+	/// </summary>
+	ray CreateTestRay(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		vector4 position(distribution(generator), distribution(generator), distribution(generator), 0.0f);
+		vector4_normalize(position);
+		vector4_scale(position, 15.0f, position);
+		position.setW(1.0f);
+
+		vector4 target(distribution(generator) * 3.0f, distribution(generator) * 3.0f, distribution(generator) * 3.0f, 1.0f);
+
+		vector4 direction;
+		vector4_sub(target, position, direction);
+		vector4_normalize(direction);
+
+		ray testRay;
+		testRay.setPosition(position);
+		testRay.setDirection(direction);
+
+		return testRay;
+	}
+
+	void ExpectMatchesBruteForce(const KdTreeGeometry& geometry, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		KdTreeStackTraversal traversal;
+
+		for (unsigned int i = 0; i < NumTestRays; i++)
+		{
+			ray testRay = CreateTestRay(generator);
+
+			float expectedT;
+			bool expectedHit = TraceBruteForce(geometry, testRay, expectedT);
+
+			HitRecord hitRecord;
+
+			ASSERT_EQ(traversal.Traverse(geometry, testRay, hitRecord), expectedHit);
+			if (expectedHit)
+				ASSERT_NEAR(hitRecord.m_T, expectedT, 1e-4f);
+		}
+	}
+
+	void ExpectSameTree(const KdTreeNode& node, const KdTreeNode& expectedNode)
+	{
+		ASSERT_EQ(node.IsChild(), expectedNode.IsChild());
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			ASSERT_EQ(node.GetBoundingMin()[axis], expectedNode.GetBoundingMin()[axis]);
+			ASSERT_EQ(node.GetBoundingMax()[axis], expectedNode.GetBoundingMax()[axis]);
+		}
+
+		if (node.IsChild())
+		{
+			ASSERT_EQ(node.GetNumTriangles(), expectedNode.GetNumTriangles());
+			for (unsigned int i = 0; i < node.GetNumTriangles(); i++)
+				ASSERT_EQ(node.GetTriangleList()[i], expectedNode.GetTriangleList()[i]);
+
+			return;
+		}
+
+		ExpectSameTree(*node.GetChildren()[0], *expectedNode.GetChildren()[0]);
+		ExpectSameTree(*node.GetChildren()[1], *expectedNode.GetChildren()[1]);
+	}
+
+	unsigned int CountNodes(const KdTreeNode& node)
+	{
+		if (node.IsChild())
+			return 1;
+
+		return 1 + CountNodes(*node.GetChildren()[0]) + CountNodes(*node.GetChildren()[1]);
+	}
+
+	void ExpandAllNodes(const KdTreeGeometry& geometry, KdTreeNode& node)
+	{
+		if (node.IsUnexpanded())
+			geometry.ExpandKdTreeNode(node);
+
+		if (node.IsChild())
+			return;
+
+		ExpandAllNodes(geometry, *node.GetChildren()[0]);
+		ExpandAllNodes(geometry, *node.GetChildren()[1]);
+	}
+
+	unsigned int CalculateDepth(const KdTreeNode& node)
+	{
+		if (node.IsChild())
+			return 0;
+
+		return 1 + std::max(CalculateDepth(*node.GetChildren()[0]), CalculateDepth(*node.GetChildren()[1]));
+	}
+
+	unsigned int CountTriangleReferences(const KdTreeNode& node)
+	{
+		if (node.IsChild())
+			return node.GetNumTriangles();
+
+		return CountTriangleReferences(*node.GetChildren()[0]) + CountTriangleReferences(*node.GetChildren()[1]);
+	}
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Matches_Brute_Force)
+{
+	auto mesh = CreateBoxesAndTriangles(150, 1000, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep builder(20, 8);
+	builder.SetNumThreads(1);
+	builder.Construct(geometry);
+
+	ASSERT_NE(geometry.GetRootNode(), nullptr);
+	ASSERT_GT(CountNodes(*geometry.GetRootNode()), 1);
+
+	ExpectMatchesBruteForce(geometry, 2);
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Handles_Planar_Triangles)
+{
+	// Every triangle of a box lies in one of the box's faces, and is planar along that axis.
+	auto mesh = CreateBoxesAndTriangles(20, 0, 3);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep builder(20, 1);
+	builder.SetNumThreads(1);
+	builder.Construct(geometry);
+
+	ASSERT_GT(CountNodes(*geometry.GetRootNode()), 1);
+
+	ExpectMatchesBruteForce(geometry, 4);
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Parallel_Build_Matches_Serial_Build)
+{
+	// Enough triangles for the top levels to be split between threads.
+	auto mesh = CreateBoxesAndTriangles(300, 8000, 5);
+	KdTreeGeometry serialGeometry(*mesh);
+	KdTreeGeometry parallelGeometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep serialBuilder(20, 8);
+	serialBuilder.SetNumThreads(1);
+	serialBuilder.Construct(serialGeometry);
+
+	KdTreeConstruction::SAHEventSweep parallelBuilder(20, 8);
+	parallelBuilder.SetNumThreads(5);
+	parallelBuilder.Construct(parallelGeometry);
+
+	ExpectSameTree(*parallelGeometry.GetRootNode(), *serialGeometry.GetRootNode());
+}
+
+TEST(KdTreeConstruction, SAHCostModel_Rewards_Empty_Space)
+{
+	KdTreeConstruction::SAHCostModel costModel(8.0f, 1.0f, 0.25f);
+
+	ASSERT_FLOAT_EQ(costModel.CalculateLeafCost(10), 10.0f);
+	ASSERT_FLOAT_EQ(costModel.CalculateSplitCost(0.5f, 0.75f, 4, 6), 8.0f + 0.5f * 4.0f + 0.75f * 6.0f);
+	ASSERT_FLOAT_EQ(costModel.CalculateSplitCost(0.5f, 0.75f, 0, 6), (8.0f + 0.75f * 6.0f) * 0.75f);
+}
+
+TEST(KdTreeConstruction, SAH_Builders_Report_Expected_Cost)
+{
+	auto mesh = CreateBoxesAndTriangles(50, 2000, 6);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHCostModel costModel;
+	float leafCost = costModel.CalculateLeafCost(geometry.GetNumTriangles());
+
+	KdTreeConstruction::SAH builder(20, 8);
+	builder.Construct(geometry);
+
+	ASSERT_FLOAT_EQ(builder.GetExpectedCost(), costModel.CalculateTreeCost(*geometry.GetRootNode()));
+	ASSERT_LT(builder.GetExpectedCost(), leafCost);
+	ExpectMatchesBruteForce(geometry, 7);
+
+	KdTreeConstruction::SAHEventSweep sweepBuilder(20, 8);
+	sweepBuilder.SetNumThreads(1);
+	sweepBuilder.Construct(geometry);
+
+	ASSERT_FLOAT_EQ(sweepBuilder.GetExpectedCost(), costModel.CalculateTreeCost(*geometry.GetRootNode()));
+	ASSERT_LT(sweepBuilder.GetExpectedCost(), leafCost);
+
+	// Making traversal more expensive relative to intersection produces a shallower tree.
+	unsigned int numNodes = CountNodes(*geometry.GetRootNode());
+
+	sweepBuilder.SetCostModel(KdTreeConstruction::SAHCostModel(80.0f, 1.0f, 0.2f));
+	sweepBuilder.Construct(geometry);
+
+	ASSERT_LT(CountNodes(*geometry.GetRootNode()), numNodes);
+	ExpectMatchesBruteForce(geometry, 8);
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Perfect_Splits_Reduce_Triangle_References)
+{
+	// The bounds of randomly oriented triangles overlap many voxels which the triangles themselves do not.
+	auto mesh = CreateBoxesAndTriangles(50, 1000, 9);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep builder(20, 4);
+	builder.SetNumThreads(1);
+	builder.Construct(geometry);
+
+	unsigned int numReferences = CountTriangleReferences(*geometry.GetRootNode());
+
+	builder.SetPerfectSplits(true);
+	builder.Construct(geometry);
+
+	ASSERT_LT(CountTriangleReferences(*geometry.GetRootNode()), numReferences);
+	ExpectMatchesBruteForce(geometry, 10);
+}
+
+TEST(KdTreeConstruction, SAHLazy_Expands_To_The_SAHEventSweep_Tree)
+{
+	auto mesh = CreateBoxesAndTriangles(150, 1000, 11);
+
+	KdTreeBuildParameters parameters;
+	parameters.m_MaxDepth = 20;
+	parameters.m_MaxTriangles = 8;
+	parameters.m_PerfectSplits = false;
+
+	KdTreeGeometry eagerGeometry(*mesh, parameters);
+
+	parameters.m_Lazy = true;
+	KdTreeGeometry lazyGeometry(*mesh, parameters);
+
+	ASSERT_TRUE(lazyGeometry.GetRootNode()->IsUnexpanded());
+	ASSERT_TRUE(lazyGeometry.GetCompactTree().IsEmpty());
+
+	// Rays traced concurrently expand the nodes they reach, racing each other to the top levels.
+	const unsigned int numThreads = 4;
+	std::atomic<unsigned int> numMismatches(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned int threadIndex = 0; threadIndex < numThreads; threadIndex++)
+	{
+		threads.push_back(std::thread([&, threadIndex]()
+		{
+			std::mt19937 generator(12 + threadIndex);
+
+			for (unsigned int i = 0; i < NumTestRays / numThreads; i++)
+			{
+				ray testRay = CreateTestRay(generator);
+
+				float expectedT;
+				bool expectedHit = TraceBruteForce(lazyGeometry, testRay, expectedT);
+
+				HitRecord hitRecord;
+				bool hit = lazyGeometry.Trace(testRay, hitRecord);
+
+				if (hit != expectedHit || (hit && fabsf(hitRecord.m_T - expectedT) > 1e-4f))
+					numMismatches++;
+			}
+		}));
+	}
+
+	for (auto& thread : threads)
+		thread.join();
+
+	ASSERT_EQ(numMismatches, 0u);
+	ASSERT_FALSE(lazyGeometry.GetRootNode()->IsUnexpanded());
+
+	ExpandAllNodes(lazyGeometry, *lazyGeometry.GetRootNode());
+	ExpectSameTree(*lazyGeometry.GetRootNode(), *eagerGeometry.GetRootNode());
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Derives_Max_Depth_From_Triangles)
+{
+	ASSERT_EQ(KdTreeConstruction::SAHEventSweep::CalculateMaxDepth(0), 8u);
+	ASSERT_EQ(KdTreeConstruction::SAHEventSweep::CalculateMaxDepth(1), 8u);
+	ASSERT_EQ(KdTreeConstruction::SAHEventSweep::CalculateMaxDepth(1024), 21u);
+	ASSERT_EQ(KdTreeConstruction::SAHEventSweep::CalculateMaxDepth(1u << 20), 34u);
+	ASSERT_TRUE(KdTreeConstruction::SAHEventSweep::CalculateMaxDepth(UINT_MAX) < KdTreeCompact::MaxDepth);
+
+	auto mesh = CreateBoxesAndTriangles(50, 1000, 15);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep builder(KdTreeConstruction::SAHEventSweep::AutomaticMaxDepth, 1);
+	builder.SetNumThreads(1);
+	builder.Construct(geometry);
+
+	ASSERT_GT(CountNodes(*geometry.GetRootNode()), 1u);
+	ExpectMatchesBruteForce(geometry, 16);
+}
+
+TEST(KdTreeConstruction, Builders_Limit_Explicit_Max_Depth_To_Compact_Trees)
+{
+	auto mesh = CreateShrinkingTriangles(150);
+	KdTreeGeometry geometry(*mesh);
+
+	// Traversal is cheap enough for every split to pay off, so only the depth limit stops the builders.
+	KdTreeConstruction::SAHCostModel costModel(0.01f, 100.0f, 0.0f);
+	unsigned int depthLimit = KdTreeCompact::MaxDepth - 1;
+
+	KdTreeConstruction::SAHEventSweep sweepBuilder(200, 1);
+	sweepBuilder.SetNumThreads(1);
+	sweepBuilder.SetCostModel(costModel);
+	sweepBuilder.Construct(geometry);
+
+	ASSERT_EQ(CalculateDepth(*geometry.GetRootNode()), depthLimit);
+	ASSERT_FALSE(geometry.GetCompactTree().IsEmpty());
+
+	KdTreeConstruction::SAH sahBuilder(200, 1);
+	sahBuilder.SetCostModel(costModel);
+	sahBuilder.Construct(geometry);
+
+	ASSERT_EQ(CalculateDepth(*geometry.GetRootNode()), depthLimit);
+	ASSERT_FALSE(geometry.GetCompactTree().IsEmpty());
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Respects_Duplication_And_Memory_Limits)
+{
+	auto mesh = CreateBoxesAndTriangles(50, 2000, 17);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep builder(24, 2);
+	builder.SetNumThreads(1);
+	builder.Construct(geometry);
+
+	float duplicationFactor = builder.GetDuplicationFactor();
+	size_t bytesUsed = builder.GetBytesUsed();
+
+	ASSERT_EQ(builder.GetNumLimitedNodes(), 0u);
+	ASSERT_FLOAT_EQ(duplicationFactor, (float)CountTriangleReferences(*geometry.GetRootNode()) / geometry.GetNumTriangles());
+
+	// Trees hitting a limit stop subdividing where they would exceed it, and are still complete.
+	float maxDuplication = 1.0f + (duplicationFactor - 1.0f) * 0.5f;
+	builder.SetMaxDuplication(maxDuplication);
+	builder.Construct(geometry);
+
+	ASSERT_GT(builder.GetNumLimitedNodes(), 0u);
+	ASSERT_LE(builder.GetDuplicationFactor(), maxDuplication);
+	ASSERT_FLOAT_EQ(builder.GetDuplicationFactor(), (float)CountTriangleReferences(*geometry.GetRootNode()) / geometry.GetNumTriangles());
+	ExpectMatchesBruteForce(geometry, 18);
+
+	builder.SetMaxDuplication(0.0f);
+	builder.SetMemoryBudget(bytesUsed / 2);
+	builder.Construct(geometry);
+
+	ASSERT_GT(builder.GetNumLimitedNodes(), 0u);
+	ASSERT_LE(builder.GetBytesUsed(), bytesUsed / 2);
+	ExpectMatchesBruteForce(geometry, 19);
+
+	// A budget too small for any split leaves a single leaf holding every triangle.
+	builder.SetMemoryBudget(1);
+	builder.Construct(geometry);
+
+	ASSERT_EQ(CountNodes(*geometry.GetRootNode()), 1u);
+	ASSERT_EQ(builder.GetBytesUsed(), sizeof(KdTreeNode) + geometry.GetNumTriangles() * sizeof(unsigned));
+	ASSERT_FLOAT_EQ(builder.GetDuplicationFactor(), 1.0f);
+}
+
+TEST(KdTreeConstruction, SAHEventSweep_Limited_Parallel_Build_Matches_Serial_Build)
+{
+	auto mesh = CreateBoxesAndTriangles(300, 8000, 20);
+	KdTreeGeometry serialGeometry(*mesh);
+	KdTreeGeometry parallelGeometry(*mesh);
+
+	KdTreeConstruction::SAHEventSweep serialBuilder(20, 2);
+	serialBuilder.SetNumThreads(1);
+	serialBuilder.SetMaxDuplication(1.5f);
+	serialBuilder.SetMemoryBudget(512 * 1024);
+	serialBuilder.Construct(serialGeometry);
+
+	KdTreeConstruction::SAHEventSweep parallelBuilder(20, 2);
+	parallelBuilder.SetNumThreads(5);
+	parallelBuilder.SetMaxDuplication(1.5f);
+	parallelBuilder.SetMemoryBudget(512 * 1024);
+	parallelBuilder.Construct(parallelGeometry);
+
+	ASSERT_GT(serialBuilder.GetNumLimitedNodes(), 0u);
+	ASSERT_EQ(parallelBuilder.GetNumLimitedNodes(), serialBuilder.GetNumLimitedNodes());
+	ASSERT_EQ(parallelBuilder.GetBytesUsed(), serialBuilder.GetBytesUsed());
+
+	ExpectSameTree(*parallelGeometry.GetRootNode(), *serialGeometry.GetRootNode());
+}
+
+TEST(KdTreeConstruction, KdTreeAutotuner_Results_Round_Trip)
+{
+	KdTreeAutotuner autotuner;
+	ASSERT_TRUE(autotuner.ParseResults(
+		"# Tuned kd tree parameters\n"
+		"\n"
+		"monkey maxDepth=20 maxTriangles=8 traversalCost=4 intersectionCost=1 emptyBonus=0.2 perfectSplits=1\n"
+		"plane maxTriangles=2 perfectSplits=0\n"));
+
+	KdTreeBuildParameters parameters;
+	ASSERT_TRUE(autotuner.FindParameters("monkey", parameters));
+	ASSERT_EQ(parameters.m_MaxDepth, 20u);
+	ASSERT_EQ(parameters.m_MaxTriangles, 8u);
+	ASSERT_FLOAT_EQ(parameters.m_CostModel.m_TraversalCost, 4.0f);
+	ASSERT_FLOAT_EQ(parameters.m_CostModel.m_EmptyBonus, 0.2f);
+	ASSERT_TRUE(parameters.m_PerfectSplits);
+
+	// Parameters missing from a line keep their defaults.
+	ASSERT_TRUE(autotuner.FindParameters("plane", parameters));
+	ASSERT_EQ(parameters.m_MaxDepth, KdTreeBuildParameters().m_MaxDepth);
+	ASSERT_EQ(parameters.m_MaxTriangles, 2u);
+	ASSERT_FALSE(parameters.m_PerfectSplits);
+
+	ASSERT_FALSE(autotuner.FindParameters("cube", parameters));
+
+	KdTreeAutotuner reloaded;
+	ASSERT_TRUE(reloaded.ParseResults(autotuner.FormatResults()));
+	ASSERT_EQ(reloaded.FormatResults(), autotuner.FormatResults());
+
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey maxDepth=twenty\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey leafSize=8\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey emptyBonus=1.5\n"));
+
+	// Depths beyond what traversal stacks hold, and empty leaves, are never tuned.
+	ASSERT_TRUE(KdTreeAutotuner().ParseResults("monkey maxDepth=63\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey maxDepth=64\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey maxDepth=-1\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey maxTriangles=0\n"));
+	ASSERT_FALSE(KdTreeAutotuner().ParseResults("monkey maxTriangles=-8\n"));
+}
+
+TEST(KdTreeConstruction, KdTreeAutotuner_Picks_A_Swept_Candidate_Once)
+{
+	auto mesh = CreateBoxesAndTriangles(50, 500, 13);
+
+	KdTreeAutotuner autotuner;
+	ASSERT_TRUE(autotuner.SetMaxDepths(std::vector<unsigned>(1, 2)));
+	ASSERT_TRUE(autotuner.SetMaxTriangles(std::vector<unsigned>(1, 4)));
+	ASSERT_TRUE(autotuner.SetTraversalCosts(std::vector<float>(1, 8.0f)));
+	autotuner.SetNumSampleRays(200);
+
+	// Invalid values leave the sweep unchanged.
+	ASSERT_FALSE(autotuner.SetMaxDepths({ 2, 64 }));
+	ASSERT_FALSE(autotuner.SetMaxTriangles({ 4, 0 }));
+	ASSERT_FALSE(autotuner.SetTraversalCosts({ 8.0f, 0.0f }));
+
+	// With a single candidate, it has to be the one picked.
+	KdTreeBuildParameters parameters = autotuner.GetParameters("boxes", *mesh);
+	ASSERT_EQ(parameters.m_MaxDepth, 2u);
+	ASSERT_EQ(parameters.m_MaxTriangles, 4u);
+	ASSERT_FLOAT_EQ(parameters.m_CostModel.m_TraversalCost, 8.0f);
+
+	// Stored parameters are reused rather than tuned again with the new sweep.
+	autotuner.SetMaxDepths(std::vector<unsigned>(1, 12));
+	ASSERT_EQ(autotuner.GetParameters("boxes", *mesh).m_MaxDepth, 2u);
+
+	// A wider sweep picks one of its own candidates, and the tuned parameters build a correct tree.
+	autotuner.SetMaxDepths({ 8, 12 });
+	autotuner.SetMaxTriangles({ 2, 8 });
+	parameters = autotuner.Tune(*mesh);
+
+	ASSERT_TRUE(parameters.m_MaxDepth == 8 || parameters.m_MaxDepth == 12);
+	ASSERT_TRUE(parameters.m_MaxTriangles == 2 || parameters.m_MaxTriangles == 8);
+
+	KdTreeGeometry geometry(*mesh, parameters);
+	ExpectMatchesBruteForce(geometry, 14);
+}
\ No newline at end of file
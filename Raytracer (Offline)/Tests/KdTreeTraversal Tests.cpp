@@ -0,0 +1,992 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include <RayGenerator.h>
+#include <StaticMesh.h>
+#include <Geometry.h>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include "..\KdTreeCompact.h"
+#include "..\KdTreeCompactTraversal.h"
+#include "..\KdTreeGeometry.h"
+#include "..\KdTreeNode.h"
+#include "..\KdTreePacketTraversal.h"
+#include "..\KdTreeRopes.h"
+#include "..\KdTreeRopeTraversal.h"
+#include "..\KdTreeStackTraversal.h"
+#include "..\Mailbox.h"
+#include "..\NaiveSpatialMedian.h"
+#include "..\SAH.h"
+#include "..\TiledRaytracer.h"
+#include "..\TraversalStatistics.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+using namespace Assets;
+
+namespace
+{
+	const unsigned int NumTestRays = 1000;
+
+	/// <summary>
+	/// Creates a ray starting in front of the triangle soup, pointing roughly down the negative z axis.
+	/// </summary>
+	ray CreateTestRay(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		vector4 position(distribution(generator) * 8.0f, distribution(generator) * 8.0f, 12.0f, 1.0f);
+		vector4 direction(distribution(generator) * 0.5f, distribution(generator) * 0.5f, -1.0f, 0.0f);
+		vector4_normalize(direction);
+
+		ray testRay;
+		testRay.setPosition(position);
+		testRay.setDirection(direction);
+
+		return testRay;
+	}
+
+	/// <summary>
+	/// Fills the packet with rays sharing an origin in front of the triangle soup, like the primary rays of a few
+	/// neighbouring pixels. Their directions all have the same signs.
+	/// </summary>
+	void CreateCoherentPacket(std::mt19937& generator, RayPacket& packet)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> spreadDistribution(0.01f, 0.3f);
+
+		vector4 position(distribution(generator) * 8.0f, distribution(generator) * 8.0f, 12.0f, 1.0f);
+		float signX = distribution(generator) < 0.0f ? -1.0f : 1.0f;
+		float signY = distribution(generator) < 0.0f ? -1.0f : 1.0f;
+
+		for (unsigned int r = 0; r < packet.m_Size; r++)
+		{
+			vector4 direction(signX * spreadDistribution(generator), signY * spreadDistribution(generator), -1.0f, 0.0f);
+			vector4_normalize(direction);
+
+			packet.m_Rays[r].setPosition(position);
+			packet.m_Rays[r].setDirection(direction);
+		}
+	}
+
+	/// <summary>
+	/// Creates a ray starting at a random position inside the triangle soup, pointing in a random direction.
+	/// </summary>
+	ray CreateInteriorTestRay(std::mt19937& generator)
+	{
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+		vector4 position(distribution(generator) * 5.0f, distribution(generator) * 5.0f, distribution(generator) * 5.0f, 1.0f);
+		vector4 direction(distribution(generator), distribution(generator), distribution(generator), 0.0f);
+		vector4_normalize(direction);
+
+		ray testRay;
+		testRay.setPosition(position);
+		testRay.setDirection(direction);
+
+		return testRay;
+	}
+
+	unsigned int CountNodes(const KdTreeNode& node, unsigned int& numTriangleReferences)
+	{
+		if (node.IsChild())
+		{
+			numTriangleReferences += node.GetNumTriangles();
+			return 1;
+		}
+
+		return 1 + CountNodes(*node.GetChildren()[0], numTriangleReferences) +
+			CountNodes(*node.GetChildren()[1], numTriangleReferences);
+	}
+
+	/// <summary>
+	/// Returns the index following the last node of the compact tree's subtree rooted at the specified node.
+	/// </summary>
+	unsigned int FindSubtreeEnd(const KdTreeCompact& tree, unsigned int nodeIndex)
+	{
+		const KdTreeCompactNode& node = tree.GetNodes()[nodeIndex];
+		return node.IsLeaf() ? nodeIndex + 1 : FindSubtreeEnd(tree, node.GetAboveChild());
+	}
+
+	/// <summary>
+	/// Sets the directory kd trees are cached in for as long as it is in scope, so that a failing assertion
+	/// does not leave the cache enabled for the tests that follow.
+	/// </summary>
+	class TreeCacheDirectoryScope
+	{
+	public:
+
+		explicit TreeCacheDirectoryScope(const std::string& directory)
+		{
+			KdTreeGeometry::SetTreeCacheDirectory(directory);
+		}
+
+		~TreeCacheDirectoryScope()
+		{
+			KdTreeGeometry::SetTreeCacheDirectory("");
+		}
+	};
+
+	/// <summary>
+	/// A kd tree node whose children are set directly, to build trees that no builder would.
+	/// </summary>
+	class TestKdTreeNode : public KdTreeNode
+	{
+	public:
+
+		void Split(TestKdTreeNode& below, TestKdTreeNode& above)
+		{
+			m_SplittingPlane.setNormal(vector4(1.0f, 0.0f, 0.0f, 0.0f));
+			m_SplittingPlane.setPointOnPlane(vector4(0.0f, 0.0f, 0.0f, 1.0f));
+
+			m_Children[0] = &below;
+			m_Children[1] = &above;
+		}
+	};
+
+	/// <summary>
+	/// Flattens a chain of empty nodes whose deepest leaves are the specified number of splits below the root.
+	/// </summary>
+	bool FlattenChain(unsigned int numSplits, KdTreeCompact& tree)
+	{
+		std::unique_ptr<TestKdTreeNode[]> nodes(new TestKdTreeNode[2 * numSplits + 1]);
+
+		for (unsigned int i = 0; i < numSplits; i++)
+			nodes[2 * i].Split(nodes[2 * i + 1], nodes[2 * i + 2]);
+
+		return tree.Build(nodes[0]);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeStackTraversal_Matches_Brute_Force)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(2);
+	KdTreeStackTraversal traversal;
+
+	for (unsigned int i = 0; i < NumTestRays; i++)
+	{
+		ray testRay = CreateTestRay(generator);
+
+		float expectedT;
+		bool expectedHit = TraceBruteForce(geometry, testRay, expectedT);
+
+		HitRecord hitRecord;
+
+		ASSERT_EQ(traversal.Traverse(geometry, testRay, hitRecord), expectedHit);
+		if (expectedHit)
+			ASSERT_NEAR(hitRecord.m_T, expectedT, 1e-4f);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeStackTraversal_Packets_Match_Single_Rays)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(3);
+	KdTreeStackTraversal traversal;
+
+	for (unsigned int i = 0; i < NumTestRays / RayPacket::MaxSize; i++)
+	{
+		RayPacket packet;
+		for (unsigned int r = 0; r < packet.m_Size; r++)
+			packet.m_Rays[r] = CreateTestRay(generator);
+
+		// Leave a couple of rays inactive.
+		packet.m_ActiveMask &= ~((1u << 3) | (1u << 10));
+
+		HitRecord hitRecords[RayPacket::MaxSize];
+
+		uint32_t hitMask = traversal.TraversePacket(geometry, packet, hitRecords);
+
+		for (unsigned int r = 0; r < packet.m_Size; r++)
+		{
+			bool packetHit = 0 != (hitMask & (1u << r));
+
+			if (!packet.IsActive(r))
+			{
+				ASSERT_FALSE(packetHit);
+				continue;
+			}
+
+			float expectedT;
+			bool expectedHit = TraceBruteForce(geometry, packet.m_Rays[r], expectedT);
+
+			ASSERT_EQ(packetHit, expectedHit);
+			if (expectedHit)
+				ASSERT_NEAR(hitRecords[r].m_T, expectedT, 1e-4f);
+		}
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeStackTraversal_Occlusion_Matches_Brute_Force)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(4);
+	std::uniform_real_distribution<float> tMaxDistribution(0.0f, 25.0f);
+	KdTreeStackTraversal traversal;
+
+	for (unsigned int i = 0; i < NumTestRays; i++)
+	{
+		ray testRay = CreateTestRay(generator);
+		float tMax = tMaxDistribution(generator);
+
+		float closestT;
+		bool expectedOccluded = TraceBruteForce(geometry, testRay, closestT) && closestT < tMax;
+
+		ASSERT_EQ(traversal.TraverseOcclusion(geometry, testRay, tMax), expectedOccluded);
+		ASSERT_EQ(geometry.Occluded(testRay, tMax), expectedOccluded);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeStackTraversal_Counts_Traversal_Work)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+	KdTreeStackTraversal traversal;
+
+	// A ray which misses the root voxel only tests the root's bounds.
+	ray missingRay;
+	missingRay.setPosition(vector4(0.0f, 20.0f, 0.0f, 1.0f));
+	missingRay.setDirection(vector4(0.0f, 1.0f, 0.0f, 0.0f));
+
+	TraversalStatistics before = g_ThreadTraversalStatistics;
+	HitRecord hitRecord;
+
+	ASSERT_FALSE(traversal.Traverse(geometry, missingRay, hitRecord));
+
+	TraversalStatistics work = g_ThreadTraversalStatistics;
+	work -= before;
+
+	ASSERT_EQ(work.m_NodesVisited, 1);
+	ASSERT_EQ(work.m_AABBTests, 1);
+	ASSERT_EQ(work.m_LeavesVisited, 0);
+	ASSERT_EQ(work.m_TriangleTests, 0);
+
+	// Rays through the soup visit leaves and test triangles, and packets count work for every active ray.
+	std::mt19937 generator(5);
+	RayPacket packet;
+	for (unsigned int r = 0; r < packet.m_Size; r++)
+		packet.m_Rays[r] = CreateTestRay(generator);
+
+	packet.m_ActiveMask = 0x00ff;
+
+	before = g_ThreadTraversalStatistics;
+
+	HitRecord hitRecords[RayPacket::MaxSize];
+	traversal.TraversePacket(geometry, packet, hitRecords);
+
+	work = g_ThreadTraversalStatistics;
+	work -= before;
+
+	ASSERT_GE(work.m_NodesVisited, 8);
+	ASSERT_EQ(work.m_AABBTests, work.m_NodesVisited);
+	ASSERT_GT(work.m_LeavesVisited, 0);
+	ASSERT_LT(work.m_LeavesVisited, work.m_NodesVisited);
+	ASSERT_GT(work.m_TriangleTests, 0);
+}
+
+TEST(KdTreeTraversal, KdTreeStackTraversal_Clips_Once_And_Matches_Compact_Traversal_Work)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 6);
+	KdTreeGeometry geometry(*mesh);
+
+	KdTreeStackTraversal stackTraversal;
+	KdTreeCompactTraversal compactTraversal;
+
+	std::mt19937 generator(7);
+
+	for (unsigned int i = 0; i < NumTestRays; i++)
+	{
+		ray testRay = CreateTestRay(generator);
+
+		TraversalStatistics before = g_ThreadTraversalStatistics;
+		HitRecord stackHitRecord;
+		bool stackHit = stackTraversal.Traverse(geometry, testRay, stackHitRecord);
+
+		TraversalStatistics stackWork = g_ThreadTraversalStatistics;
+		stackWork -= before;
+
+		before = g_ThreadTraversalStatistics;
+		HitRecord compactHitRecord;
+		bool compactHit = compactTraversal.Traverse(geometry, testRay, compactHitRecord);
+
+		TraversalStatistics compactWork = g_ThreadTraversalStatistics;
+		compactWork -= before;
+
+		// Both visit the same leaves in the same order, and only test the root's bounds.
+		ASSERT_EQ(stackHit, compactHit);
+		if (stackHit)
+			ASSERT_EQ(stackHitRecord.m_PrimitiveId, compactHitRecord.m_PrimitiveId);
+
+		ASSERT_EQ(stackWork.m_AABBTests, 1);
+		ASSERT_EQ(stackWork.m_NodesVisited, compactWork.m_NodesVisited);
+		ASSERT_EQ(stackWork.m_LeavesVisited, compactWork.m_LeavesVisited);
+		ASSERT_EQ(stackWork.m_TriangleTests, compactWork.m_TriangleTests);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeCompact_Flattens_Every_Node)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	unsigned int numTriangleReferences = 0;
+	unsigned int numNodes = CountNodes(*geometry.GetRootNode(), numTriangleReferences);
+
+	const KdTreeCompact& tree = geometry.GetCompactTree();
+
+	ASSERT_EQ(tree.GetNumNodes(), numNodes);
+	ASSERT_EQ(tree.GetNumTriangleIndices(), numTriangleReferences);
+
+	// Every leaf's triangles are in the index array, and every interior node's children follow it.
+	unsigned int numLeafTriangles = 0;
+	for (unsigned int i = 0; i < tree.GetNumNodes(); i++)
+	{
+		const KdTreeCompactNode& node = tree.GetNodes()[i];
+
+		if (node.IsLeaf())
+		{
+			ASSERT_LE(node.m_FirstTriangle + node.GetNumTriangles(), tree.GetNumTriangleIndices());
+			numLeafTriangles += node.GetNumTriangles();
+		}
+		else
+		{
+			ASSERT_LT(node.GetAxis(), 3u);
+			ASSERT_GT(node.GetAboveChild(), i + 1);
+			ASSERT_LT(node.GetAboveChild(), tree.GetNumNodes());
+		}
+	}
+
+	ASSERT_EQ(numLeafTriangles, numTriangleReferences);
+}
+
+TEST(KdTreeTraversal, KdTreeCompact_Refuses_Trees_Too_Deep_For_Traversal_Stacks)
+{
+	KdTreeCompact tree;
+
+	ASSERT_TRUE(FlattenChain(KdTreeCompact::MaxDepth - 1, tree));
+	ASSERT_EQ(tree.GetNumNodes(), 2 * KdTreeCompact::MaxDepth - 1);
+
+	ASSERT_FALSE(FlattenChain(KdTreeCompact::MaxDepth, tree));
+	ASSERT_TRUE(tree.IsEmpty());
+}
+
+TEST(KdTreeTraversal, KdTreeCompactTraversal_Matches_Brute_Force)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(6);
+	KdTreeCompactTraversal traversal;
+
+	// Rays starting inside the soup also have triangles behind them, which must not be hit.
+	for (unsigned int i = 0; i < NumTestRays * 2; i++)
+	{
+		ray testRay = (i < NumTestRays) ? CreateTestRay(generator) : CreateInteriorTestRay(generator);
+
+		float expectedT;
+		bool expectedHit = TraceBruteForce(geometry, testRay, expectedT);
+
+		HitRecord hitRecord;
+
+		ASSERT_EQ(traversal.Traverse(geometry, testRay, hitRecord), expectedHit);
+		if (expectedHit)
+			ASSERT_NEAR(hitRecord.m_T, expectedT, 1e-4f);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeCompactTraversal_Occlusion_Matches_Brute_Force)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(7);
+	std::uniform_real_distribution<float> tMaxDistribution(0.0f, 25.0f);
+	KdTreeCompactTraversal traversal;
+
+	for (unsigned int i = 0; i < NumTestRays * 2; i++)
+	{
+		ray testRay = (i < NumTestRays) ? CreateTestRay(generator) : CreateInteriorTestRay(generator);
+		float tMax = tMaxDistribution(generator);
+
+		float closestT;
+		bool expectedOccluded = TraceBruteForce(geometry, testRay, closestT) && closestT < tMax;
+
+		ASSERT_EQ(traversal.TraverseOcclusion(geometry, testRay, tMax), expectedOccluded);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeCompact_Load_Requires_Matching_Key)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	const char* fileName = "KdTreeCompact_Load_Test.kdc";
+
+	ASSERT_TRUE(geometry.GetCompactTree().Save(fileName, 42));
+
+	KdTreeCompact loadedTree;
+	// The tree is written to a temporary file, which is renamed once complete.
+	FILE* temporaryFile = nullptr;
+	fopen_s(&temporaryFile, "KdTreeCompact_Load_Test.kdc.tmp", "rb");
+	ASSERT_EQ(temporaryFile, nullptr);
+
+	ASSERT_FALSE(loadedTree.Load(fileName, 43, geometry.GetNumTriangles()));
+	ASSERT_TRUE(loadedTree.IsEmpty());
+
+	ASSERT_TRUE(loadedTree.Load(fileName, 42, geometry.GetNumTriangles()));
+	ASSERT_EQ(loadedTree.GetNumNodes(), geometry.GetCompactTree().GetNumNodes());
+	ASSERT_EQ(loadedTree.GetNumTriangleIndices(), geometry.GetCompactTree().GetNumTriangleIndices());
+
+	loadedTree.Clear();
+	remove(fileName);
+}
+
+TEST(KdTreeTraversal, KdTreeCompact_Load_Rejects_Corrupt_Trees)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	KdTreeGeometry geometry(*mesh);
+
+	const KdTreeCompact& tree = geometry.GetCompactTree();
+	const char* fileName = "KdTreeCompact_Corrupt_Test.kdc";
+
+	KdTreeCompact loadedTree;
+
+	// Saves the tree with one 32 bit word overwritten, at an offset from the start of the node array.
+	auto loadPatched = [&](const KdTreeCompact& savedTree, size_t offset, uint32_t value) -> bool
+	{
+		EXPECT_TRUE(savedTree.Save(fileName, 42));
+
+		FILE* file = nullptr;
+		fopen_s(&file, fileName, "r+b");
+		EXPECT_NE(file, nullptr);
+		if (nullptr == file)
+			return false;
+
+		fseek(file, 0, SEEK_END);
+		size_t headerSize = (size_t)ftell(file) - savedTree.GetNumNodes() * sizeof(KdTreeCompactNode) -
+			savedTree.GetNumTriangleIndices() * sizeof(unsigned);
+
+		fseek(file, (long)(headerSize + offset), SEEK_SET);
+		fwrite(&value, sizeof(value), 1, file);
+		fclose(file);
+
+		bool loaded = loadedTree.Load(fileName, 42, geometry.GetNumTriangles());
+		EXPECT_EQ(loaded, !loadedTree.IsEmpty());
+
+		loadedTree.Clear();
+		return loaded;
+	};
+
+	const KdTreeCompactNode& root = tree.GetNodes()[0];
+	ASSERT_FALSE(root.IsLeaf());
+	ASSERT_TRUE(loadPatched(tree, 0, root.m_Flags));
+
+	// Children must lie within the node array, after the node and its child below the split.
+	ASSERT_FALSE(loadPatched(tree, 0, (tree.GetNumNodes() << 2) | root.GetAxis()));
+	ASSERT_FALSE(loadPatched(tree, 0, (1 << 2) | root.GetAxis()));
+
+	// Leaves must lie within the triangle index array, whose indices must refer to the mesh's triangles.
+	unsigned int leafIndex = 0;
+	while (!tree.GetNodes()[leafIndex].IsLeaf() || 0 == tree.GetNodes()[leafIndex].GetNumTriangles())
+		leafIndex++;
+
+	size_t firstTriangleOffset = leafIndex * sizeof(KdTreeCompactNode) + sizeof(uint32_t);
+	ASSERT_FALSE(loadPatched(tree, firstTriangleOffset, tree.GetNumTriangleIndices()));
+
+	size_t triangleIndicesOffset = tree.GetNumNodes() * sizeof(KdTreeCompactNode);
+	ASSERT_FALSE(loadPatched(tree, triangleIndicesOffset, geometry.GetNumTriangles()));
+
+	// Turning the first leaf of the deepest chain traversal stacks hold into an interior node deepens the
+	// whole chain below it by one.
+	KdTreeCompact chain;
+	ASSERT_TRUE(FlattenChain(KdTreeCompact::MaxDepth - 1, chain));
+	ASSERT_TRUE(loadPatched(chain, sizeof(KdTreeCompactNode), chain.GetNodes()[1].m_Flags));
+	ASSERT_FALSE(loadPatched(chain, sizeof(KdTreeCompactNode), 3 << 2));
+
+	remove(fileName);
+}
+
+TEST(KdTreeTraversal, KdTreeGeometry_Cache_Key_Depends_On_Mesh_And_Parameters)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 1);
+	auto sameMesh = CreateTriangleSoup(NumTestTriangles, 1);
+	auto otherMesh = CreateTriangleSoup(NumTestTriangles, 2);
+
+	KdTreeBuildParameters parameters;
+	KdTreeBuildParameters otherParameters;
+	otherParameters.m_MaxTriangles = 8;
+
+	uint64_t key = KdTreeGeometry::ComputeTreeCacheKey(*mesh, parameters);
+
+	ASSERT_EQ(key, KdTreeGeometry::ComputeTreeCacheKey(*sameMesh, parameters));
+	ASSERT_NE(key, KdTreeGeometry::ComputeTreeCacheKey(*otherMesh, parameters));
+	ASSERT_NE(key, KdTreeGeometry::ComputeTreeCacheKey(*mesh, otherParameters));
+}
+
+TEST(KdTreeTraversal, KdTreeGeometry_Cached_Tree_Matches_Brute_Force)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 3);
+	KdTreeBuildParameters parameters;
+
+	char fileName[64];
+	sprintf_s(fileName, "./kdtree_%016llx.kdc", (unsigned long long)KdTreeGeometry::ComputeTreeCacheKey(*mesh, parameters));
+	remove(fileName);
+
+	// The cached tree stays mapped until the geometry is destroyed, so it must go before the file is removed.
+	{
+		TreeCacheDirectoryScope cacheDirectory(".");
+
+		{
+			KdTreeGeometry builtGeometry(*mesh, parameters);
+			ASSERT_FALSE(builtGeometry.IsTreeFromCache());
+		}
+
+		KdTreeGeometry cachedGeometry(*mesh, parameters);
+		ASSERT_TRUE(cachedGeometry.IsTreeFromCache());
+
+		std::mt19937 generator(8);
+		KdTreeCompactTraversal traversal;
+
+		for (unsigned int i = 0; i < NumTestRays; i++)
+		{
+			ray testRay = CreateTestRay(generator);
+
+			float expectedT;
+			bool expectedHit = TraceBruteForce(cachedGeometry, testRay, expectedT);
+
+			HitRecord hitRecord;
+
+			ASSERT_EQ(traversal.Traverse(cachedGeometry, testRay, hitRecord), expectedHit);
+			if (expectedHit)
+				ASSERT_NEAR(hitRecord.m_T, expectedT, 1e-4f);
+		}
+	}
+
+	remove(fileName);
+}
+
+TEST(KdTreeTraversal, KdTreeRopes_Link_Each_Leaf_Face_To_Its_Neighbours)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 8);
+
+	KdTreeBuildParameters parameters;
+	parameters.m_BuildRopes = true;
+	KdTreeGeometry geometry(*mesh, parameters);
+
+	const KdTreeCompact& tree = geometry.GetCompactTree();
+	const KdTreeRopes& ropes = geometry.GetRopes();
+
+	unsigned int numLeaves = 0;
+
+	for (unsigned int i = 0; i < tree.GetNumNodes(); i++)
+	{
+		if (!tree.GetNodes()[i].IsLeaf())
+			continue;
+
+		numLeaves++;
+		const KdTreeRopes::Leaf& leaf = ropes.GetLeaf(i);
+
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			unsigned int axis = face / 2;
+			bool maxFace = 1 == (face & 1);
+			float facePosition = maxFace ? leaf.m_BoundingMax[axis] : leaf.m_BoundingMin[axis];
+			float treeBound = maxFace ? tree.GetBoundingMax()[axis] : tree.GetBoundingMin()[axis];
+
+			// Only faces on the boundary of the tree have no neighbours.
+			ASSERT_EQ(KdTreeRopes::NoNeighbour == leaf.m_Ropes[face], facePosition == treeBound);
+			if (KdTreeRopes::NoNeighbour == leaf.m_Ropes[face])
+				continue;
+
+			// The leaf just across the centre of the face is inside the subtree the rope leads to.
+			vector4 point(0.0f, 0.0f, 0.0f, 1.0f);
+			for (unsigned int centerAxis = 0; centerAxis < 3; centerAxis++)
+				point[centerAxis] = (leaf.m_BoundingMin[centerAxis] + leaf.m_BoundingMax[centerAxis]) * 0.5f;
+			point[axis] = nextafterf(facePosition, maxFace ? FLT_MAX : -FLT_MAX);
+
+			unsigned int neighbour = KdTreeRopes::FindLeaf(tree, point);
+
+			ASSERT_GE(neighbour, leaf.m_Ropes[face]);
+			ASSERT_LT(neighbour, FindSubtreeEnd(tree, leaf.m_Ropes[face]));
+			ASSERT_NE(neighbour, i);
+		}
+	}
+
+	ASSERT_EQ(ropes.GetNumLeaves(), numLeaves);
+}
+
+TEST(KdTreeTraversal, KdTreeRopeTraversal_Matches_Brute_Force_For_Every_Builder)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 9);
+
+	KdTreeBuildParameters parameters;
+	parameters.m_BuildRopes = true;
+	KdTreeGeometry geometry(*mesh, parameters);
+
+	KdTreeConstruction::SAH sahBuilder(16, 8);
+	KdTreeConstruction::NaiveSpatialMedian medianBuilder;
+
+	std::mt19937 generator(10);
+	std::uniform_real_distribution<float> tMaxDistribution(0.0f, 25.0f);
+	KdTreeRopeTraversal traversal;
+
+	// The ropes are rebuilt for each tree the geometry is given.
+	for (KdTreeConstruction::IKdTreeBuilder* builder : { (KdTreeConstruction::IKdTreeBuilder*)nullptr,
+		(KdTreeConstruction::IKdTreeBuilder*)&sahBuilder, (KdTreeConstruction::IKdTreeBuilder*)&medianBuilder })
+	{
+		if (nullptr != builder)
+			builder->Construct(geometry);
+
+		ASSERT_FALSE(geometry.GetRopes().IsEmpty());
+
+		for (unsigned int i = 0; i < NumTestRays; i++)
+		{
+			ray testRay = (i % 2) ? CreateTestRay(generator) : CreateInteriorTestRay(generator);
+			float tMax = tMaxDistribution(generator);
+
+			float expectedT;
+			bool expectedHit = TraceBruteForce(geometry, testRay, expectedT);
+
+			HitRecord hitRecord;
+
+			ASSERT_EQ(traversal.Traverse(geometry, testRay, hitRecord), expectedHit);
+			if (expectedHit)
+				ASSERT_NEAR(hitRecord.m_T, expectedT, 1e-4f);
+
+			ASSERT_EQ(traversal.TraverseOcclusion(geometry, testRay, tMax), expectedHit && expectedT < tMax);
+		}
+	}
+}
+
+TEST(KdTreeTraversal, KdTreeRopeTraversal_Starts_Secondary_Rays_From_The_Hit_Leaf)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 11);
+
+	KdTreeBuildParameters parameters;
+	parameters.m_BuildRopes = true;
+	KdTreeGeometry geometry(*mesh, parameters);
+
+	std::mt19937 generator(12);
+	KdTreeRopeTraversal traversal;
+
+	unsigned int numSecondaryRays = 0;
+
+	for (unsigned int i = 0; i < NumTestRays; i++)
+	{
+		ray testRay = CreateTestRay(generator);
+
+		HitRecord hitRecord;
+		unsigned int hitLeaf;
+
+		if (!traversal.TraverseFrom(geometry, testRay, 0, hitRecord, &hitLeaf))
+			continue;
+
+		// The hit leaf contains the intersection.
+		vector4 hitPoint;
+		vector4_addScaledVector(testRay.getPosition(), testRay.getDirection(), hitRecord.m_T, hitPoint);
+		hitPoint.setW(1.0f);
+
+		const KdTreeRopes::Leaf& leaf = geometry.GetRopes().GetLeaf(hitLeaf);
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			ASSERT_GE(hitPoint[axis], leaf.m_BoundingMin[axis] - 1e-3f);
+			ASSERT_LE(hitPoint[axis], leaf.m_BoundingMax[axis] + 1e-3f);
+		}
+
+		// A ray leaving the intersection in a new direction finds the same intersections from the hit leaf as
+		// from the root. It starts slightly along the new direction to leave the triangle hit.
+		ray secondaryRay = CreateTestRay(generator);
+		vector4 origin;
+		vector4_addScaledVector(hitPoint, secondaryRay.getDirection(), 1e-4f, origin);
+		origin.setW(1.0f);
+		secondaryRay.setPosition(origin);
+
+		bool insideLeaf = true;
+		for (unsigned int axis = 0; axis < 3; axis++)
+			insideLeaf = insideLeaf && origin[axis] >= leaf.m_BoundingMin[axis] && origin[axis] <= leaf.m_BoundingMax[axis];
+
+		if (!insideLeaf)
+			continue;
+
+		numSecondaryRays++;
+
+		float expectedT;
+		bool expectedHit = TraceBruteForce(geometry, secondaryRay, expectedT);
+
+		HitRecord secondaryHitRecord;
+		ASSERT_EQ(traversal.TraverseFrom(geometry, secondaryRay, hitLeaf, secondaryHitRecord), expectedHit);
+		if (expectedHit)
+			ASSERT_NEAR(secondaryHitRecord.m_T, expectedT, 1e-4f);
+
+		ASSERT_EQ(traversal.TraverseOcclusionFrom(geometry, secondaryRay, hitLeaf, 5.0f), expectedHit && expectedT < 5.0f);
+	}
+
+	ASSERT_GT(numSecondaryRays, NumTestRays / 4);
+}
+
+TEST(KdTreeTraversal, TriangleMailbox_Forgets_Triangles_Of_Previous_Rays)
+{
+	TriangleMailbox mailbox = {};
+
+	mailbox.BeginRay();
+	ASSERT_FALSE(mailbox.CheckAndMark(7));
+	ASSERT_TRUE(mailbox.CheckAndMark(7));
+	ASSERT_FALSE(mailbox.CheckAndMark(8));
+
+	mailbox.BeginRay();
+	ASSERT_FALSE(mailbox.CheckAndMark(7));
+
+	// Slots marked before the ray ID wrapped around must not match the rays after it.
+	mailbox.m_RayId = 0xffffffff;
+	ASSERT_FALSE(mailbox.CheckAndMark(9));
+	mailbox.BeginRay();
+	ASSERT_EQ(mailbox.m_RayId, 1u);
+	ASSERT_FALSE(mailbox.CheckAndMark(9));
+}
+
+TEST(KdTreeTraversal, Mailboxing_Skips_Repeated_Triangle_Tests_Without_Changing_Hits)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 11);
+
+	KdTreeBuildParameters parameters;
+	parameters.m_BuildRopes = true;
+	KdTreeGeometry geometry(*mesh, parameters);
+
+	KdTreeStackTraversal stackTraversal;
+	KdTreeCompactTraversal compactTraversal;
+	KdTreeRopeTraversal ropeTraversal;
+	IKdTreeTraversal* traversals[] = { &stackTraversal, &compactTraversal, &ropeTraversal };
+
+	for (IKdTreeTraversal* traversal : traversals)
+	{
+		std::mt19937 generator(12);
+		std::uniform_real_distribution<float> tMaxDistribution(0.0f, 25.0f);
+
+		TraversalStatistics plainWork;
+		TraversalStatistics mailboxWork;
+		plainWork.Reset();
+		mailboxWork.Reset();
+
+		for (unsigned int i = 0; i < NumTestRays; i++)
+		{
+			ray testRay = CreateTestRay(generator);
+			float tMax = tMaxDistribution(generator);
+
+			TraversalStatistics before = g_ThreadTraversalStatistics;
+			HitRecord plainHitRecord;
+			bool plainHit = traversal->Traverse(geometry, testRay, plainHitRecord);
+			bool plainOccluded = traversal->TraverseOcclusion(geometry, testRay, tMax);
+
+			TraversalStatistics work = g_ThreadTraversalStatistics;
+			work -= before;
+			plainWork += work;
+
+			SetMailboxingEnabled(true);
+
+			before = g_ThreadTraversalStatistics;
+			HitRecord mailboxHitRecord;
+			bool mailboxHit = traversal->Traverse(geometry, testRay, mailboxHitRecord);
+			bool mailboxOccluded = traversal->TraverseOcclusion(geometry, testRay, tMax);
+
+			work = g_ThreadTraversalStatistics;
+			work -= before;
+			mailboxWork += work;
+
+			SetMailboxingEnabled(false);
+
+			ASSERT_EQ(mailboxHit, plainHit);
+			if (plainHit)
+			{
+				ASSERT_EQ(mailboxHitRecord.m_PrimitiveId, plainHitRecord.m_PrimitiveId);
+				ASSERT_EQ(mailboxHitRecord.m_T, plainHitRecord.m_T);
+			}
+
+			ASSERT_EQ(mailboxOccluded, plainOccluded);
+		}
+
+		// The same leaves are visited, and every triangle reference in them is either tested or skipped.
+		ASSERT_EQ(plainWork.m_MailboxSkips, 0);
+		ASSERT_GT(mailboxWork.m_MailboxSkips, 0);
+		ASSERT_EQ(mailboxWork.m_LeavesVisited, plainWork.m_LeavesVisited);
+		ASSERT_EQ(mailboxWork.m_TriangleTests + mailboxWork.m_MailboxSkips, plainWork.m_TriangleTests);
+	}
+}
+
+TEST(KdTreeTraversal, KdTreePacketTraversal_Matches_Single_Rays)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 13);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(14);
+	KdTreePacketTraversal packetTraversal;
+	KdTreeCompactTraversal singleRayTraversal;
+
+	const unsigned int packetSizes[] = { 4, 8, RayPacket::MaxSize };
+
+	for (unsigned int packetSize : packetSizes)
+	{
+		for (unsigned int i = 0; i < NumTestRays / packetSize; i++)
+		{
+			RayPacket packet(packetSize);
+			CreateCoherentPacket(generator, packet);
+			ASSERT_TRUE(KdTreePacketTraversal::IsCoherent(packet));
+
+			// Leave a ray inactive.
+			packet.m_ActiveMask &= ~(1u << (i % packetSize));
+
+			HitRecord hitRecords[RayPacket::MaxSize];
+			uint32_t hitMask = packetTraversal.TraversePacket(geometry, packet, hitRecords);
+
+			for (unsigned int r = 0; r < packet.m_Size; r++)
+			{
+				bool packetHit = 0 != (hitMask & (1u << r));
+
+				if (!packet.IsActive(r))
+				{
+					ASSERT_FALSE(packetHit);
+					continue;
+				}
+
+				HitRecord expectedHitRecord;
+				bool expectedHit = singleRayTraversal.Traverse(geometry, packet.m_Rays[r], expectedHitRecord);
+
+				ASSERT_EQ(packetHit, expectedHit);
+				if (expectedHit)
+				{
+					ASSERT_EQ(hitRecords[r].m_PrimitiveId, expectedHitRecord.m_PrimitiveId);
+					ASSERT_NEAR(hitRecords[r].m_T, expectedHitRecord.m_T, 1e-4f);
+					ASSERT_NEAR(hitRecords[r].m_U, expectedHitRecord.m_U, 1e-4f);
+					ASSERT_NEAR(hitRecords[r].m_V, expectedHitRecord.m_V, 1e-4f);
+				}
+			}
+		}
+	}
+}
+
+TEST(KdTreeTraversal, KdTreePacketTraversal_Falls_Back_To_Single_Rays_For_Divergent_Packets)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 15);
+	KdTreeGeometry geometry(*mesh);
+
+	std::mt19937 generator(16);
+	KdTreePacketTraversal packetTraversal;
+
+	for (unsigned int i = 0; i < NumTestRays / RayPacket::MaxSize; i++)
+	{
+		// Rays starting inside the soup point in every direction.
+		RayPacket packet;
+		for (unsigned int r = 0; r < packet.m_Size; r++)
+			packet.m_Rays[r] = CreateInteriorTestRay(generator);
+
+		ASSERT_FALSE(KdTreePacketTraversal::IsCoherent(packet));
+
+		HitRecord hitRecords[RayPacket::MaxSize];
+		uint32_t hitMask = packetTraversal.TraversePacket(geometry, packet, hitRecords);
+
+		for (unsigned int r = 0; r < packet.m_Size; r++)
+		{
+			float expectedT;
+			bool expectedHit = TraceBruteForce(geometry, packet.m_Rays[r], expectedT);
+
+			ASSERT_EQ(0 != (hitMask & (1u << r)), expectedHit);
+			if (expectedHit)
+				ASSERT_NEAR(hitRecords[r].m_T, expectedT, 1e-4f);
+		}
+	}
+}
+
+TEST(KdTreeTraversal, KdTreePacketTraversal_Starts_Tile_Rays_At_The_Beam_Entry_Node)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 17);
+	KdTreeGeometry geometry(*mesh);
+	const KdTreeCompact& tree = geometry.GetCompactTree();
+
+	initMathLib();
+
+	CameraLib::Camera camera;
+	camera.SetPosition(1.0f, 0.5f, 12.0f);
+	camera.Update();
+
+	const unsigned int width = 64;
+	const unsigned int height = 48;
+	const unsigned int tileSize = 8;
+	CameraLib::RayGenerator rayGenerator(camera, width, height);
+
+	KdTreePacketTraversal packetTraversal;
+	KdTreeCompactTraversal singleRayTraversal;
+
+	unsigned int numEntryNodesBelowRoot = 0;
+	TraversalStatistics rootWork;
+	TraversalStatistics entryWork;
+	rootWork.Reset();
+	entryWork.Reset();
+
+	for (unsigned int tileY = 0; tileY < height; tileY += tileSize)
+	{
+		for (unsigned int tileX = 0; tileX < width; tileX += tileSize)
+		{
+			Tile tile = { tileX, tileY, tileSize, tileSize };
+
+			RayBeam beam;
+			TiledRaytracer::GenerateTileBeam(tile, rayGenerator, beam);
+
+			unsigned int entryNode = KdTreePacketTraversal::FindEntryNode(tree, beam);
+			ASSERT_LT(entryNode, tree.GetNumNodes());
+			if (0 != entryNode)
+				numEntryNodesBelowRoot++;
+
+			for (unsigned int y = tileY; y < tileY + tileSize; y++)
+			{
+				RayPacket packet(tileSize);
+				for (unsigned int r = 0; r < tileSize; r++)
+					rayGenerator.GenerateRay((float)(tileX + r), (float)y, packet.m_Rays[r]);
+
+				TraversalStatistics before = g_ThreadTraversalStatistics;
+				HitRecord rootHitRecords[RayPacket::MaxSize];
+				uint32_t rootHitMask = packetTraversal.TraversePacket(geometry, packet, rootHitRecords);
+
+				TraversalStatistics work = g_ThreadTraversalStatistics;
+				work -= before;
+				rootWork += work;
+
+				before = g_ThreadTraversalStatistics;
+				HitRecord entryHitRecords[RayPacket::MaxSize];
+				uint32_t entryHitMask = packetTraversal.TraversePacketFrom(geometry, packet, entryNode, entryHitRecords);
+
+				work = g_ThreadTraversalStatistics;
+				work -= before;
+				entryWork += work;
+
+				// Starting below the root visits the same leaves, so finds the same intersections.
+				ASSERT_EQ(entryHitMask, rootHitMask);
+
+				for (unsigned int r = 0; r < tileSize; r++)
+				{
+					HitRecord singleHitRecord;
+					bool singleHit = singleRayTraversal.TraverseFrom(geometry, packet.m_Rays[r], entryNode, singleHitRecord);
+					ASSERT_EQ(singleHit, 0 != (rootHitMask & (1u << r)));
+
+					if (!singleHit)
+						continue;
+
+					ASSERT_EQ(entryHitRecords[r].m_PrimitiveId, rootHitRecords[r].m_PrimitiveId);
+					ASSERT_EQ(entryHitRecords[r].m_T, rootHitRecords[r].m_T);
+					ASSERT_EQ(singleHitRecord.m_PrimitiveId, rootHitRecords[r].m_PrimitiveId);
+				}
+			}
+		}
+	}
+
+	ASSERT_GT(numEntryNodesBelowRoot, 0);
+	ASSERT_EQ(entryWork.m_LeavesVisited, rootWork.m_LeavesVisited);
+	ASSERT_LT(entryWork.m_NodesVisited, rootWork.m_NodesVisited);
+}
\ No newline at end of file
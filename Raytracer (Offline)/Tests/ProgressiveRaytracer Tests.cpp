@@ -0,0 +1,114 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include <RayGenerator.h>
+#include "..\ProgressiveRaytracer.h"
+#include "..\FrameBuffer.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+using namespace CameraLib;
+
+namespace
+{
+	const unsigned int FrameBufferWidth = 75;
+	const unsigned int FrameBufferHeight = 42;
+
+	/// <summary>
+	/// Scene which every ray hits, shaded with the direction of the ray so that each pixel can be checked.
+	/// </summary>
+	class DirectionScene : public TestScene
+	{
+	public:
+
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override
+		{
+			hitRecord.m_T = intersectionRay.getDirection().x;
+			hitRecord.m_U = intersectionRay.getDirection().y;
+			hitRecord.m_V = intersectionRay.getDirection().z;
+			hitRecord.m_PrimitiveId = 0;
+			hitRecord.m_InstanceId = 0;
+
+			return true;
+		}
+
+		void Shade(const HitRecord& hitRecord, float* results) const override
+		{
+			results[0] = hitRecord.m_T;
+			results[1] = hitRecord.m_U;
+			results[2] = hitRecord.m_V;
+			results[3] = 1.0f;
+		}
+	};
+
+	Camera CreateTestCamera()
+	{
+		initMathLib();
+
+		Camera camera;
+		camera.SetPosition(0.0f, 1.0f, 5.0f);
+		camera.RotateYAxis(25.0f);
+		camera.Update();
+
+		return camera;
+	}
+
+	void ExpectPixelHasDirection(const FrameBuffer& frameBuffer, const RayGenerator& rayGenerator, unsigned int x,
+		unsigned int y, unsigned int tracedX, unsigned int tracedY)
+	{
+		vector4 direction;
+		rayGenerator.GenerateDirection((float)tracedX, (float)tracedY, direction);
+
+		const float* pixel = frameBuffer.GetData() + (y * frameBuffer.GetWidth() + x) * 4;
+
+		ASSERT_EQ(pixel[0], direction.x);
+		ASSERT_EQ(pixel[1], direction.y);
+		ASSERT_EQ(pixel[2], direction.z);
+		ASSERT_EQ(pixel[3], 1.0f);
+	}
+}
+
+TEST(ProgressiveRaytracer, ProgressiveRaytracer_Without_Budget_Traces_Every_Pixel)
+{
+	Camera camera = CreateTestCamera();
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	DirectionScene scene;
+
+	ProgressiveRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetTileSize(20);
+	raytracer.Raytrace();
+
+	ASSERT_EQ(raytracer.GetNumCompletedPasses(), ProgressiveRaytracer::GetNumPasses());
+
+	RayGenerator rayGenerator(camera, FrameBufferWidth, FrameBufferHeight);
+
+	for (unsigned int y = 0; y < FrameBufferHeight; y++)
+	{
+		for (unsigned int x = 0; x < FrameBufferWidth; x++)
+			ExpectPixelHasDirection(frameBuffer, rayGenerator, x, y, x, y);
+	}
+}
+
+TEST(ProgressiveRaytracer, ProgressiveRaytracer_Covers_Frame_When_Budget_Runs_Out)
+{
+	Camera camera = CreateTestCamera();
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	DirectionScene scene;
+
+	// The budget expires before the second pass, so only the coarse first pass is rendered.
+	ProgressiveRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetTimeBudget(1e-6);
+	raytracer.Raytrace();
+
+	ASSERT_EQ(raytracer.GetNumCompletedPasses(), 1);
+
+	RayGenerator rayGenerator(camera, FrameBufferWidth, FrameBufferHeight);
+	const unsigned int step = ProgressiveRaytracer::CoarsestStep;
+
+	for (unsigned int y = 0; y < FrameBufferHeight; y++)
+	{
+		for (unsigned int x = 0; x < FrameBufferWidth; x++)
+			ExpectPixelHasDirection(frameBuffer, rayGenerator, x, y, x / step * step, y / step * step);
+	}
+}
\ No newline at end of file
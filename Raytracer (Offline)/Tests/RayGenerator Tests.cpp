@@ -0,0 +1,148 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include <RayGenerator.h>
+
+using namespace MathLib;
+using namespace CameraLib;
+
+namespace
+{
+	const uint32_t ViewportWidth = 97;
+	const uint32_t ViewportHeight = 61;
+
+	// vector4_normalize uses an unrefined reciprocal square root estimate when SIMD is enabled.
+	const float DirectionTolerance = 1e-3f;
+
+	// Reference implementation which projects the pixel onto the near clip plane in camera space
+	// and rotates the result into world space.
+	void CalculateReferenceDirection(const Camera& camera, float x, float y, vector4& direction)
+	{
+		const float top = camera.GetNearClipPlaneDistance() * tanf(MATHLIB_DEG_TO_RAD(camera.GetYFov() * 0.5f));
+		const float right = top * ((float)ViewportWidth / (float)ViewportHeight);
+
+		float cameraX = right * (2.0f * x / (ViewportWidth - 1.0f) - 1.0f);
+		float cameraY = top * (1.0f - 2.0f * y / (ViewportHeight - 1.0f));
+		float cameraZ = -camera.GetNearClipPlaneDistance();
+
+		vector4_scale(camera.GetXAxis(), cameraX, direction);
+		vector4_addScaledVector(direction, camera.GetYAxis(), cameraY, direction);
+		vector4_addScaledVector(direction, camera.GetZAxis(), cameraZ, direction);
+		vector4_setToVector(direction);
+		vector4_normalize(direction);
+	}
+
+	Camera CreateRotatedCamera()
+	{
+		initMathLib();
+
+		Camera camera;
+		camera.SetPosition(1.0f, 2.0f, 3.0f);
+		camera.RotateXAxis(20.0f);
+		camera.RotateYAxis(-35.0f);
+		camera.Update();
+
+		return camera;
+	}
+}
+
+TEST(RayGenerator, RayGenerator_Matches_Reference_Directions)
+{
+	Camera camera = CreateRotatedCamera();
+	RayGenerator rayGenerator(camera, ViewportWidth, ViewportHeight);
+
+	for (uint32_t y = 0; y < ViewportHeight; y += 5)
+	{
+		for (uint32_t x = 0; x < ViewportWidth; x += 3)
+		{
+			vector4 expected;
+			CalculateReferenceDirection(camera, (float)x, (float)y, expected);
+
+			ray primaryRay;
+			rayGenerator.GenerateRay((float)x, (float)y, primaryRay);
+
+			const vector4& direction = primaryRay.getDirection();
+			ASSERT_NEAR(direction.extractX(), expected.extractX(), DirectionTolerance);
+			ASSERT_NEAR(direction.extractY(), expected.extractY(), DirectionTolerance);
+			ASSERT_NEAR(direction.extractZ(), expected.extractZ(), DirectionTolerance);
+
+			const vector4& position = primaryRay.getPosition();
+			ASSERT_FLOAT_EQ(position.extractX(), 1.0f);
+			ASSERT_FLOAT_EQ(position.extractY(), 2.0f);
+			ASSERT_FLOAT_EQ(position.extractZ(), 3.0f);
+		}
+	}
+}
+
+TEST(RayGenerator, RayGenerator_Batches_Match_Single_Directions)
+{
+	Camera camera = CreateRotatedCamera();
+	RayGenerator rayGenerator(camera, ViewportWidth, ViewportHeight);
+
+	// Use an odd count so that the scalar tail is exercised as well as the SIMD path.
+	const uint32_t count = 19;
+	float directionsX[count];
+	float directionsY[count];
+	float directionsZ[count];
+
+	rayGenerator.GenerateDirections(7, 13, count, directionsX, directionsY, directionsZ);
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		vector4 expected;
+		rayGenerator.GenerateDirection((float)(7 + i), 13.0f, expected);
+
+		ASSERT_NEAR(directionsX[i], expected.extractX(), DirectionTolerance);
+		ASSERT_NEAR(directionsY[i], expected.extractY(), DirectionTolerance);
+		ASSERT_NEAR(directionsZ[i], expected.extractZ(), DirectionTolerance);
+	}
+
+	RayDirectionBatch8 batch;
+	rayGenerator.GenerateBatch(40, 30, batch);
+
+	for (uint32_t i = 0; i < RayDirectionBatch8::BatchWidth; i++)
+	{
+		vector4 expected;
+		rayGenerator.GenerateDirection((float)(40 + i), 30.0f, expected);
+
+		ASSERT_NEAR(batch.m_X[i], expected.extractX(), DirectionTolerance);
+		ASSERT_NEAR(batch.m_Y[i], expected.extractY(), DirectionTolerance);
+		ASSERT_NEAR(batch.m_Z[i], expected.extractZ(), DirectionTolerance);
+	}
+}
+
+TEST(RayGenerator, RayGenerator_Projects_Points_Back_To_Pixels)
+{
+	Camera camera = CreateRotatedCamera();
+	RayGenerator rayGenerator(camera, ViewportWidth, ViewportHeight);
+
+	for (uint32_t y = 0; y < ViewportHeight; y += 5)
+	{
+		for (uint32_t x = 0; x < ViewportWidth; x += 3)
+		{
+			ray primaryRay;
+			rayGenerator.GenerateRay((float)x, (float)y, primaryRay);
+
+			vector4 point;
+			vector4_addScaledVector(primaryRay.getPosition(), primaryRay.getDirection(), 7.5f, point);
+
+			float projectedX;
+			float projectedY;
+			float depth;
+
+			ASSERT_TRUE(rayGenerator.ProjectPoint(point, projectedX, projectedY, depth));
+			ASSERT_NEAR(projectedX, (float)x, 1e-2f);
+			ASSERT_NEAR(projectedY, (float)y, 1e-2f);
+			ASSERT_GT(depth, 0.0f);
+			ASSERT_LE(depth, 7.5f);
+		}
+	}
+
+	// Points behind the camera can not be projected.
+	vector4 behind;
+	vector4_addScaledVector(camera.GetPosition(), camera.GetZAxis(), 1.0f, behind);
+
+	float projectedX;
+	float projectedY;
+	float depth;
+	ASSERT_FALSE(rayGenerator.ProjectPoint(behind, projectedX, projectedY, depth));
+}
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "..\ReprojectionRaytracer.h"
+#include "..\TiledRaytracer.h"
+#include "..\FrameBuffer.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+using namespace CameraLib;
+
+namespace
+{
+	const unsigned int FrameBufferWidth = 96;
+	const unsigned int FrameBufferHeight = 64;
+
+	/// <summary>
+	/// Scene containing a chequered ground plane at y = 0, and optionally a red box standing on it. The chequer
+	/// pattern is stored in the hit record, so the colour of a hit does not depend on the camera.
+	/// </summary>
+	class GroundPlaneScene : public TestScene
+	{
+	public:
+
+		GroundPlaneScene() :
+			m_HasBox(false)
+		{
+		}
+
+		void SetBox(float minX, float minY, float minZ, float maxX, float maxY, float maxZ)
+		{
+			m_BoxMin[0] = minX;
+			m_BoxMin[1] = minY;
+			m_BoxMin[2] = minZ;
+			m_BoxMax[0] = maxX;
+			m_BoxMax[1] = maxY;
+			m_BoxMax[2] = maxZ;
+			m_HasBox = true;
+		}
+
+		bool Trace(const ray& intersectionRay, HitRecord& hitRecord) const override
+		{
+			const vector4& position = intersectionRay.getPosition();
+			const vector4& direction = intersectionRay.getDirection();
+
+			// The box stands on the plane, so the box is the nearest hit wherever the ray hits it.
+			float boxT;
+			if (IntersectBox(intersectionRay, boxT))
+			{
+				hitRecord.m_T = boxT;
+				hitRecord.m_U = 0.0f;
+				hitRecord.m_V = 0.0f;
+				hitRecord.m_PrimitiveId = 1;
+				hitRecord.m_InstanceId = 0;
+
+				return true;
+			}
+
+			if (direction.y >= 0.0f)
+				return false;
+
+			hitRecord.m_T = -position.y / direction.y;
+			hitRecord.m_U = position.x + direction.x * hitRecord.m_T;
+			hitRecord.m_V = position.z + direction.z * hitRecord.m_T;
+			hitRecord.m_PrimitiveId = 0;
+			hitRecord.m_InstanceId = 0;
+
+			return true;
+		}
+
+		bool Occluded(const ray& intersectionRay, float tMax) const override
+		{
+			HitRecord hitRecord;
+			return Trace(intersectionRay, hitRecord) && hitRecord.m_T < tMax;
+		}
+
+		void Shade(const HitRecord& hitRecord, float* results) const override
+		{
+			if (1 == hitRecord.m_PrimitiveId)
+			{
+				results[0] = 1.0f;
+				results[1] = 0.0f;
+				results[2] = 0.0f;
+				results[3] = 1.0f;
+				return;
+			}
+
+			bool isOddSquare = 0 != (((int)floorf(hitRecord.m_U) + (int)floorf(hitRecord.m_V)) & 1);
+
+			results[0] = isOddSquare ? 1.0f : 0.25f;
+			results[1] = results[0];
+			results[2] = results[0];
+			results[3] = 1.0f;
+		}
+
+	private:
+
+		bool m_HasBox;
+		float m_BoxMin[3];
+		float m_BoxMax[3];
+
+		bool IntersectBox(const ray& intersectionRay, float& t) const
+		{
+			if (!m_HasBox)
+				return false;
+
+			const vector4& position = intersectionRay.getPosition();
+			const vector4& direction = intersectionRay.getDirection();
+
+			float origin[3] = { position.x, position.y, position.z };
+			float dir[3] = { direction.x, direction.y, direction.z };
+
+			float tNear = 0.0f;
+			float tFar = FLT_MAX;
+			for (unsigned int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (m_BoxMin[axis] - origin[axis]) / dir[axis];
+				float t1 = (m_BoxMax[axis] - origin[axis]) / dir[axis];
+
+				tNear = std::max(tNear, std::min(t0, t1));
+				tFar = std::min(tFar, std::max(t0, t1));
+			}
+
+			t = tNear;
+			return tNear <= tFar;
+		}
+	};
+
+	void SetCameraPosition(Camera& camera, float x)
+	{
+		camera.SetPosition(x, 3.0f, 0.0f);
+		camera.ResetCameraOrientation();
+		camera.RotateXAxis(-20.0f);
+		camera.Update();
+	}
+
+	unsigned int CountBoxPixels(const FrameBuffer& frameBuffer)
+	{
+		unsigned int numBoxPixels = 0;
+		for (unsigned int i = 0; i < frameBuffer.GetWidth() * frameBuffer.GetHeight(); i++)
+		{
+			const float* pixel = frameBuffer.GetData() + i * 4;
+			if (1.0f == pixel[0] && 0.0f == pixel[1])
+				numBoxPixels++;
+		}
+
+		return numBoxPixels;
+	}
+}
+
+TEST(ReprojectionRaytracer, ReprojectionRaytracer_Reuses_Previous_Frame)
+{
+	initMathLib();
+
+	Camera camera;
+	SetCameraPosition(camera, 0.0f);
+
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	GroundPlaneScene scene;
+
+	ReprojectionRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetRefreshFraction(0.0f);
+
+	// The first frame is traced in full.
+	raytracer.Raytrace();
+	ASSERT_EQ(raytracer.GetNumRaysTraced(), FrameBufferWidth * FrameBufferHeight);
+	ASSERT_EQ(raytracer.GetNumReprojectedPixels(), 0);
+
+	// Rendering the same view again only traces the pixels which miss the plane, as nothing can have been
+	// disoccluded.
+	FrameBuffer firstFrame(frameBuffer);
+	raytracer.Raytrace();
+	ASSERT_EQ(raytracer.GetNumCheckedPixels(), 0);
+	ASSERT_EQ(raytracer.GetNumRaysTraced(), FrameBufferWidth * FrameBufferHeight - raytracer.GetNumReprojectedPixels());
+	ASSERT_GT(raytracer.GetNumReprojectedPixels(), FrameBufferWidth * FrameBufferHeight / 2);
+	ASSERT_EQ(0, memcmp(firstFrame.GetData(), frameBuffer.GetData(), FrameBufferWidth * FrameBufferHeight * 4 * sizeof(float)));
+}
+
+TEST(ReprojectionRaytracer, ReprojectionRaytracer_Matches_Full_Trace_After_Camera_Move)
+{
+	initMathLib();
+
+	Camera camera;
+	SetCameraPosition(camera, 0.0f);
+
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	GroundPlaneScene scene;
+
+	ReprojectionRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetRefreshFraction(0.1f);
+	raytracer.Raytrace();
+
+	SetCameraPosition(camera, 0.05f);
+	raytracer.Raytrace();
+
+	// Only the pixels near the horizon and the edges of the screen are checked for disocclusion.
+	ASSERT_GT(raytracer.GetNumCheckedPixels(), 0);
+	ASSERT_LT(raytracer.GetNumRaysTraced(), FrameBufferWidth * FrameBufferHeight / 2);
+
+	FrameBuffer referenceFrame(FrameBufferWidth, FrameBufferHeight);
+	TiledRaytracer referenceRaytracer(&referenceFrame, &camera, &scene);
+	referenceRaytracer.Raytrace();
+
+	// Reprojected points do not pass exactly through pixel centres, so pixels next to the edges of the
+	// chequers may differ.
+	unsigned int numDifferentPixels = 0;
+	for (unsigned int i = 0; i < FrameBufferWidth * FrameBufferHeight; i++)
+	{
+		if (fabsf(frameBuffer.GetData()[i * 4] - referenceFrame.GetData()[i * 4]) > 1e-3f)
+			numDifferentPixels++;
+	}
+
+	ASSERT_LT(numDifferentPixels, FrameBufferWidth * FrameBufferHeight / 10);
+}
+
+TEST(ReprojectionRaytracer, ReprojectionRaytracer_Traces_Geometry_Entering_In_Front_Of_Reprojected_Points)
+{
+	initMathLib();
+
+	Camera camera;
+	SetCameraPosition(camera, 0.0f);
+
+	FrameBuffer frameBuffer(FrameBufferWidth, FrameBufferHeight);
+	GroundPlaneScene scene;
+	scene.SetBox(-5.7f, 0.0f, -5.0f, -5.0f, 5.0f, -4.5f);
+
+	ReprojectionRaytracer raytracer(&frameBuffer, &camera, &scene);
+	raytracer.SetNumThreads(4);
+	raytracer.SetRefreshFraction(0.0f);
+
+	// The box is close to the camera and just off screen, so it sweeps into the frame over ground which the
+	// first frame saw.
+	raytracer.Raytrace();
+	ASSERT_EQ(CountBoxPixels(frameBuffer), 0);
+
+	// The box moves across the screen further than the ground behind it, so part of it lands on reprojected
+	// ground points rather than on the pixels which came into view. Those lie within the band along the edge
+	// which is checked for disocclusion.
+	SetCameraPosition(camera, -1.2f);
+	raytracer.Raytrace();
+	ASSERT_GT(raytracer.GetNumReprojectedPixels(), 0);
+	ASSERT_LT(raytracer.GetNumRaysTraced(), FrameBufferWidth * FrameBufferHeight);
+
+	FrameBuffer referenceFrame(FrameBufferWidth, FrameBufferHeight);
+	TiledRaytracer referenceRaytracer(&referenceFrame, &camera, &scene);
+	referenceRaytracer.Raytrace();
+
+	unsigned int numBoxPixels = CountBoxPixels(referenceFrame);
+	ASSERT_GT(numBoxPixels, FrameBufferWidth * FrameBufferHeight / 25);
+
+	// Ground points reprojected next to the box's silhouette do not pass exactly through pixel centres, so
+	// they may be visible in a few pixels whose centre is covered by the box.
+	unsigned int numReprojectedBoxPixels = CountBoxPixels(frameBuffer);
+	ASSERT_LE(numReprojectedBoxPixels, numBoxPixels);
+	ASSERT_GE(numReprojectedBoxPixels, numBoxPixels - numBoxPixels / 50);
+}
\ No newline at end of file
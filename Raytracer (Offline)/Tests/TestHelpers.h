@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Geometry.h>
+#include <StaticMesh.h>
+#include <cfloat>
+#include <memory>
+#include <random>
+#include "..\IScene.h"
+#include "..\KdTreeGeometry.h"
+
+namespace Raytracer
+{
+	const unsigned int NumTestTriangles = 2000;
+
+	/// <summary>
+	/// Creates a mesh of small triangles scattered randomly through a 10x10x10 box.
+	/// </summary>
+	inline std::unique_ptr<StaticMesh> CreateTriangleSoup(unsigned int numTriangles, unsigned int seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> centerDistribution(-5.0f, 5.0f);
+		std::uniform_real_distribution<float> offsetDistribution(-0.6f, 0.6f);
+
+		unsigned int numVertices = numTriangles * 3;
+
+		std::unique_ptr<float[]> vertexArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> normalArray(new float[numVertices * 3]);
+		std::unique_ptr<float[]> texCoordArray(new float[numVertices * 2]);
+		std::unique_ptr<uint32_t[]> indexArray(new uint32_t[numVertices]);
+
+		for (unsigned int i = 0; i < numTriangles; i++)
+		{
+			float center[3] = { centerDistribution(generator), centerDistribution(generator), centerDistribution(generator) };
+
+			for (unsigned int v = i * 3; v < i * 3 + 3; v++)
+			{
+				for (unsigned int axis = 0; axis < 3; axis++)
+				{
+					vertexArray[v * 3 + axis] = center[axis] + offsetDistribution(generator);
+					normalArray[v * 3 + axis] = axis == 1 ? 1.0f : 0.0f;
+				}
+
+				texCoordArray[v * 2] = 0.0f;
+				texCoordArray[v * 2 + 1] = 0.0f;
+				indexArray[v] = v;
+			}
+		}
+
+		return std::unique_ptr<StaticMesh>(new StaticMesh(numVertices, std::move(vertexArray), std::move(texCoordArray),
+			std::move(normalArray), numVertices, std::move(indexArray)));
+	}
+
+	/// <summary>
+	/// Finds the closest intersection by testing the ray against every triangle.
+	/// </summary>
+	inline bool TraceBruteForce(const KdTreeGeometry& geometry, const ray& testRay, float& closestT)
+	{
+		closestT = FLT_MAX;
+
+		for (unsigned int i = 0; i < geometry.GetNumTriangles(); i++)
+		{
+			float t;
+			float u;
+			float v;
+
+			if (GeometryLib::RayTriangleIntersection(testRay, geometry.GetTriangles()[i], t, u, v) && t >= 0.0f && t < closestT)
+				closestT = t;
+		}
+
+		return closestT < FLT_MAX;
+	}
+
+	/// <summary>
+	/// Base of the stub scenes used to test the raytracers. Packets are traced and batches shaded one ray at a
+	/// time, nothing is ever occluded and the scene is a single element, so scenes only need Trace and Shade.
+	/// </summary>
+	class TestScene : public IScene
+	{
+	public:
+
+		uint32_t TracePacket(const RayPacket& packet, HitRecord* hitRecords) const override
+		{
+			uint32_t hitMask = 0;
+
+			for (unsigned int i = 0; i < packet.m_Size; i++)
+			{
+				if (packet.IsActive(i) && Trace(packet.m_Rays[i], hitRecords[i]))
+					hitMask |= 1u << i;
+			}
+
+			return hitMask;
+		}
+
+		bool Occluded(const ray& intersectionRay, float tMax) const override { return false; }
+		void AddTraceable(ITraceable& traceable) override {}
+		void Clear() override {}
+
+		void ShadeBatch(const HitRecord* hitRecords, unsigned int numHits, float* results) const override
+		{
+			for (unsigned int i = 0; i < numHits; i++)
+				Shade(hitRecords[i], results + i * 4);
+		}
+
+		unsigned int GetNumElements() const override
+		{
+			return 1;
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <gtest\gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "..\TileScheduler.h"
+
+using namespace Raytracer;
+
+TEST(TileScheduler, TileScheduler_Hands_Out_Every_Tile_Exactly_Once)
+{
+	const unsigned numWorkers = 4;
+	const unsigned numTiles = 1000;
+
+	TileScheduler scheduler(numWorkers);
+	scheduler.Reset(numTiles);
+
+	std::vector<std::atomic<unsigned>> acquisitionCounts(numTiles);
+	for (auto& count : acquisitionCounts)
+		count = 0;
+
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < numWorkers; i++)
+	{
+		workers.push_back(std::thread([&scheduler, &acquisitionCounts, i]()
+		{
+			unsigned tileIndex;
+			while (scheduler.AcquireTile(i, tileIndex))
+				acquisitionCounts[tileIndex]++;
+		}));
+	}
+
+	for (auto& worker : workers)
+		worker.join();
+
+	for (unsigned i = 0; i < numTiles; i++)
+		ASSERT_EQ(acquisitionCounts[i], 1);
+}
+
+TEST(TileScheduler, TileScheduler_Steals_From_Other_Workers)
+{
+	const unsigned numWorkers = 3;
+	const unsigned numTiles = 30;
+
+	TileScheduler scheduler(numWorkers);
+	scheduler.Reset(numTiles);
+
+	// A single worker must be able to drain every queue.
+	std::vector<bool> acquired(numTiles, false);
+
+	unsigned tileIndex;
+	unsigned numAcquired = 0;
+	while (scheduler.AcquireTile(0, tileIndex))
+	{
+		ASSERT_LT(tileIndex, numTiles);
+		ASSERT_FALSE(acquired[tileIndex]);
+
+		acquired[tileIndex] = true;
+		numAcquired++;
+	}
+
+	ASSERT_EQ(numAcquired, numTiles);
+
+	// All queues are now empty.
+	for (unsigned i = 0; i < numWorkers; i++)
+		ASSERT_FALSE(scheduler.AcquireTile(i, tileIndex));
+}
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include <gtest\gtest.h>
+#include <Camera.h>
+#include <cstring>
+#include <memory>
+#include "..\AdaptiveRaytracer.h"
+#include "..\BasicScene.h"
+#include "..\FrameBuffer.h"
+#include "..\GeometryInstance.h"
+#include "..\KdTreeGeometry.h"
+#include "..\ProgressiveRaytracer.h"
+#include "..\ReprojectionRaytracer.h"
+#include "..\TiledRaytracer.h"
+#include "TestHelpers.h"
+
+using namespace Raytracer;
+
+TEST(TiledRaytracer, TiledRaytracer_Entry_Point_Search_Renders_The_Same_Frame)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 18);
+	KdTreeGeometry geometry(*mesh);
+
+	initMathLib();
+
+	// The instance moves and stretches the soup, so the beams are searched in its object space.
+	Basis basis;
+	basis.m_Position.setXYZW(0.5f, -0.5f, -1.0f, 1.0f);
+	quaternion_setToIdentity(basis.m_Orientation);
+	basis.m_Scale.setXYZ(1.2f, 0.8f, 1.0f);
+
+	GeometryInstance instance(geometry, basis);
+
+	BasicScene scene;
+	scene.AddTraceable(instance);
+
+	CameraLib::Camera camera;
+	camera.SetPosition(0.0f, 1.0f, 12.0f);
+	camera.Update();
+
+	const unsigned int width = 67;
+	const unsigned int height = 45;
+
+	FrameBuffer plainFrameBuffer(width, height);
+	TiledRaytracer plainRaytracer(&plainFrameBuffer, &camera, &scene);
+	plainRaytracer.SetEntryPointSearch(false);
+	plainRaytracer.SetTileSize(16);
+	plainRaytracer.SetNumThreads(2);
+	plainRaytracer.Raytrace();
+
+	FrameBuffer entryFrameBuffer(width, height);
+	TiledRaytracer entryRaytracer(&entryFrameBuffer, &camera, &scene);
+	entryRaytracer.SetTileSize(16);
+	entryRaytracer.SetNumThreads(2);
+	entryRaytracer.Raytrace();
+
+	ASSERT_EQ(0, memcmp(plainFrameBuffer.GetData(), entryFrameBuffer.GetData(), sizeof(float) * 4 * width * height));
+
+	ASSERT_EQ(entryRaytracer.GetFrameStatistics().m_LeavesVisited, plainRaytracer.GetFrameStatistics().m_LeavesVisited);
+	ASSERT_LT(entryRaytracer.GetFrameStatistics().m_NodesVisited, plainRaytracer.GetFrameStatistics().m_NodesVisited);
+}
+
+TEST(TiledRaytracer, Tiled_Raytracers_Render_Heatmaps_And_Search_Entry_Points)
+{
+	auto mesh = CreateTriangleSoup(NumTestTriangles, 19);
+	KdTreeGeometry geometry(*mesh);
+
+	initMathLib();
+
+	BasicScene scene;
+	scene.AddTraceable(geometry);
+
+	CameraLib::Camera camera;
+	camera.SetPosition(0.0f, 1.0f, 12.0f);
+	camera.Update();
+
+	const unsigned int width = 53;
+	const unsigned int height = 38;
+	const unsigned int numRaytracers = 4;
+
+	// Every raytracer traces each pixel of the first frame with a single ray through its centre.
+	auto createRaytracer = [&](unsigned int raytracerIndex, FrameBuffer* frameBuffer) -> std::unique_ptr<TiledRaytracer>
+	{
+		std::unique_ptr<TiledRaytracer> raytracer;
+		if (1 == raytracerIndex)
+			raytracer.reset(new ProgressiveRaytracer(frameBuffer, &camera, &scene));
+		else if (2 == raytracerIndex)
+		{
+			auto adaptiveRaytracer = new AdaptiveRaytracer(frameBuffer, &camera, &scene);
+			adaptiveRaytracer->SetSamplesPerAxis(1, 0);
+			raytracer.reset(adaptiveRaytracer);
+		}
+		else if (3 == raytracerIndex)
+			raytracer.reset(new ReprojectionRaytracer(frameBuffer, &camera, &scene));
+		else
+			raytracer.reset(new TiledRaytracer(frameBuffer, &camera, &scene));
+
+		raytracer->SetTileSize(16);
+		raytracer->SetNumThreads(2);
+
+		return raytracer;
+	};
+
+	FrameBuffer tiledHeatmap(width, height);
+
+	for (unsigned int raytracerIndex = 0; raytracerIndex < numRaytracers; raytracerIndex++)
+	{
+		FrameBuffer plainFrameBuffer(width, height);
+		auto plainRaytracer = createRaytracer(raytracerIndex, &plainFrameBuffer);
+		plainRaytracer->SetEntryPointSearch(false);
+		plainRaytracer->Raytrace();
+
+		FrameBuffer entryFrameBuffer(width, height);
+		auto entryRaytracer = createRaytracer(raytracerIndex, &entryFrameBuffer);
+		entryRaytracer->Raytrace();
+
+		ASSERT_EQ(0, memcmp(plainFrameBuffer.GetData(), entryFrameBuffer.GetData(), sizeof(float) * 4 * width * height));
+
+		ASSERT_EQ(entryRaytracer->GetFrameStatistics().m_LeavesVisited, plainRaytracer->GetFrameStatistics().m_LeavesVisited);
+		ASSERT_LT(entryRaytracer->GetFrameStatistics().m_NodesVisited, plainRaytracer->GetFrameStatistics().m_NodesVisited);
+
+		// The heatmap starts out as garbage, which has to be replaced for every pixel.
+		FrameBuffer heatmapFrameBuffer(width, height);
+		FrameBuffer heatmap(width, height);
+		for (unsigned int i = 0; i < width * height * 4; i++)
+			heatmap.GetData()[i] = -1.0f;
+
+		auto heatmapRaytracer = createRaytracer(raytracerIndex, &heatmapFrameBuffer);
+		heatmapRaytracer->SetHeatmapFrameBuffer(&heatmap);
+		heatmapRaytracer->Raytrace();
+
+		if (0 == raytracerIndex)
+		{
+			tiledHeatmap = heatmap;
+			continue;
+		}
+
+		ASSERT_EQ(0, memcmp(tiledHeatmap.GetData(), heatmap.GetData(), sizeof(float) * 4 * width * height));
+	}
+
+	// Pixels the scene misses cost nothing, so the heatmap is not a single colour.
+	const float* heatmapData = tiledHeatmap.GetData();
+	bool isUniform = true;
+	for (unsigned int i = 1; i < width * height && isUniform; i++)
+		isUniform = 0 == memcmp(heatmapData, heatmapData + i * 4, sizeof(float) * 4);
+
+	ASSERT_FALSE(isUniform);
+}
\ No newline at end of file
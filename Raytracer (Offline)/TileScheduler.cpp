@@ -0,0 +1,87 @@
+#include "TileScheduler.h"
+#include <cassert>
+
+using namespace std;
+
+namespace Raytracer
+{
+	TileScheduler::TileScheduler(unsigned numWorkers)
+	{
+		assert(numWorkers > 0);
+
+		for (unsigned i = 0; i < numWorkers; i++)
+			m_Queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+	}
+
+	void TileScheduler::Reset(unsigned numTiles)
+	{
+		unsigned numWorkers = GetNumWorkers();
+
+		// Seed each worker with a contiguous span of tiles so that neighbouring tiles (which
+		// tend to touch the same geometry) are rendered by the same thread.
+		for (unsigned i = 0; i < numWorkers; i++)
+		{
+			auto& queue = *m_Queues[i];
+			lock_guard<mutex> lock(queue.m_Mutex);
+
+			unsigned spanBegin = (unsigned)(((unsigned long long)numTiles * i) / numWorkers);
+			unsigned spanEnd = (unsigned)(((unsigned long long)numTiles * (i + 1)) / numWorkers);
+
+			queue.m_Tiles.clear();
+			for (unsigned tileIndex = spanBegin; tileIndex < spanEnd; tileIndex++)
+				queue.m_Tiles.push_back(tileIndex);
+		}
+	}
+
+	bool TileScheduler::AcquireTile(unsigned workerIndex, unsigned& tileIndex)
+	{
+		assert(workerIndex < GetNumWorkers());
+
+		if (PopLocal(workerIndex, tileIndex))
+			return true;
+
+		return Steal(workerIndex, tileIndex);
+	}
+
+	unsigned TileScheduler::GetNumWorkers() const
+	{
+		return (unsigned)m_Queues.size();
+	}
+
+	bool TileScheduler::PopLocal(unsigned workerIndex, unsigned& tileIndex)
+	{
+		auto& queue = *m_Queues[workerIndex];
+		lock_guard<mutex> lock(queue.m_Mutex);
+
+		if (queue.m_Tiles.empty())
+			return false;
+
+		tileIndex = queue.m_Tiles.front();
+		queue.m_Tiles.pop_front();
+
+		return true;
+	}
+
+	bool TileScheduler::Steal(unsigned workerIndex, unsigned& tileIndex)
+	{
+		unsigned numWorkers = GetNumWorkers();
+
+		// Visit the other workers in order, starting with our neighbour, so that thieves
+		// spread themselves across victims rather than all contending on the same queue.
+		for (unsigned i = 1; i < numWorkers; i++)
+		{
+			auto& victim = *m_Queues[(workerIndex + i) % numWorkers];
+			lock_guard<mutex> lock(victim.m_Mutex);
+
+			if (victim.m_Tiles.empty())
+				continue;
+
+			tileIndex = victim.m_Tiles.back();
+			victim.m_Tiles.pop_back();
+
+			return true;
+		}
+
+		return false;
+	}
+}
\ No newline at end of file
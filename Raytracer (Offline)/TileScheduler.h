@@ -0,0 +1,66 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Rectangular region of the frame buffer which is rendered as a single unit of work.
+	/// </summary>
+	struct Tile
+	{
+		unsigned m_X;
+		unsigned m_Y;
+		unsigned m_Width;
+		unsigned m_Height;
+	};
+
+	/// <summary>
+	/// Hands out tile indices to a fixed set of workers using work-stealing.
+	/// Each worker owns a queue seeded with a contiguous span of tiles which it consumes from
+	/// the front. A worker that runs out of tiles steals from the back of another worker's
+	/// queue, so tiles that are expensive to render do not leave the remaining workers idle.
+	/// </summary>
+	class TileScheduler
+	{
+	public:
+
+		TileScheduler(unsigned numWorkers);
+
+		TileScheduler(const TileScheduler& other) = delete;
+		TileScheduler& operator=(const TileScheduler& other) = delete;
+
+		/// <summary>
+		/// Discards any outstanding tiles and distributes the tile indices [0, numTiles) across
+		/// the worker queues.
+		/// </summary>
+		void Reset(unsigned numTiles);
+
+		/// <summary>
+		/// Retrieves the next tile for the specified worker. Returns false once every tile has
+		/// been handed out.
+		/// </summary>
+		bool AcquireTile(unsigned workerIndex, unsigned& tileIndex);
+
+		unsigned GetNumWorkers() const;
+
+	protected:
+
+		struct WorkQueue
+		{
+			std::mutex m_Mutex;
+			std::deque<unsigned> m_Tiles;
+		};
+
+		std::vector<std::unique_ptr<WorkQueue>> m_Queues;
+
+		/// <summary>Pops a tile from the front of the worker's own queue.</summary>
+		bool PopLocal(unsigned workerIndex, unsigned& tileIndex);
+
+		/// <summary>Steals a tile from the back of another worker's queue.</summary>
+		bool Steal(unsigned workerIndex, unsigned& tileIndex);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "TiledRaytracer.h"
+#include "DeferredShadingPass.h"
+#include "DebugManager.h"
+#include "HighPerformanceTimer.h"
+#include <MathLib.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using namespace MathLib;
+using namespace Core;
+using namespace std;
+using CameraLib::RayGenerator;
+using CameraLib::RayDirectionBatch8;
+
+namespace Raytracer
+{
+	TiledRaytracer::TiledRaytracer() :
+		Raytracer(),
+		m_NumThreads(0),
+		m_TileSize(DefaultTileSize),
+		m_HeatmapFrameBuffer(nullptr),
+		m_EntryPointSearch(true)
+	{
+		m_FrameStatistics.Reset();
+	}
+
+	TiledRaytracer::TiledRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene) :
+		Raytracer(frameBuffer, camera, scene),
+		m_NumThreads(0),
+		m_TileSize(DefaultTileSize),
+		m_HeatmapFrameBuffer(nullptr),
+		m_EntryPointSearch(true)
+	{
+		m_FrameStatistics.Reset();
+	}
+
+	void TiledRaytracer::SetNumThreads(unsigned numThreads)
+	{
+		m_NumThreads = numThreads;
+	}
+
+	unsigned TiledRaytracer::GetNumThreads() const
+	{
+		return m_NumThreads;
+	}
+
+	void TiledRaytracer::SetTileSize(unsigned tileSize)
+	{
+		assert(tileSize > 0);
+		m_TileSize = tileSize;
+	}
+
+	unsigned TiledRaytracer::GetTileSize() const
+	{
+		return m_TileSize;
+	}
+
+	void TiledRaytracer::SetHeatmapFrameBuffer(FrameBuffer* heatmapFrameBuffer)
+	{
+		m_HeatmapFrameBuffer = heatmapFrameBuffer;
+	}
+
+	FrameBuffer* TiledRaytracer::GetHeatmapFrameBuffer() const
+	{
+		return m_HeatmapFrameBuffer;
+	}
+
+	void TiledRaytracer::SetEntryPointSearch(bool entryPointSearch)
+	{
+		m_EntryPointSearch = entryPointSearch;
+	}
+
+	bool TiledRaytracer::GetEntryPointSearch() const
+	{
+		return m_EntryPointSearch;
+	}
+
+	const TraversalStatistics& TiledRaytracer::GetFrameStatistics() const
+	{
+		return m_FrameStatistics;
+	}
+
+	void TiledRaytracer::Raytrace()
+	{
+		vector<Tile> tiles;
+		unsigned numWorkers = BeginFrame(tiles);
+
+		RayGenerator rayGenerator(*m_Camera, m_FrameBuffer->GetWidth(), m_FrameBuffer->GetHeight());
+
+		TileScheduler scheduler(numWorkers);
+		scheduler.Reset((unsigned)tiles.size());
+
+		HighPerformanceTimer timer;
+		timer.Start();
+
+		RunWorkers(numWorkers, [&](unsigned workerIndex)
+		{
+			RenderTiles(workerIndex, scheduler, tiles, rayGenerator);
+		});
+
+		timer.Stop();
+
+		ConvertHeatmapToFalseColour();
+
+		float numPixels = (float)(m_FrameBuffer->GetWidth() * m_FrameBuffer->GetHeight());
+		PrintFrameTime(timer.GetTimeMilliseconds(), numWorkers, to_string(tiles.size()) + " tiles");
+		printf("Average ray time: %4.5Lf microseconds\n", timer.GetTimeMicroseconds() / numPixels);
+		PrintTraversalStatistics(m_FrameStatistics);
+	}
+
+	unsigned TiledRaytracer::BeginFrame(vector<Tile>& tiles)
+	{
+		assert(nullptr != m_Camera);
+		assert(nullptr != m_FrameBuffer);
+		assert(nullptr != m_Scene);
+
+		// The debug manager is not thread safe, so debug output is not supported when
+		// rendering with multiple threads.
+		Debugging::DebugManager::GetInstance().SetEnabled(false);
+
+		GenerateTiles(tiles);
+		m_FrameStatistics.Reset();
+
+		if (nullptr != m_HeatmapFrameBuffer)
+		{
+			assert(m_HeatmapFrameBuffer->GetWidth() == m_FrameBuffer->GetWidth() &&
+				m_HeatmapFrameBuffer->GetHeight() == m_FrameBuffer->GetHeight());
+
+			// Costs are accumulated over the frame, so pixels which are not traced are left at zero.
+			size_t numPixels = (size_t)m_HeatmapFrameBuffer->GetWidth() * m_HeatmapFrameBuffer->GetHeight();
+			memset(m_HeatmapFrameBuffer->GetData(), 0, sizeof(float) * 4 * numPixels);
+		}
+
+		return DetermineNumWorkers();
+	}
+
+	void TiledRaytracer::PrintFrameTime(long double milliseconds, unsigned numWorkers, const string& work) const
+	{
+		printf("Total trace time: %4.2Lf msecs (%u threads, %s)\n", milliseconds, numWorkers, work.c_str());
+	}
+
+	void TiledRaytracer::GenerateTiles(vector<Tile>& tiles) const
+	{
+		unsigned width = m_FrameBuffer->GetWidth();
+		unsigned height = m_FrameBuffer->GetHeight();
+
+		tiles.clear();
+		for (unsigned y = 0; y < height; y += m_TileSize)
+		{
+			for (unsigned x = 0; x < width; x += m_TileSize)
+			{
+				Tile tile;
+				tile.m_X = x;
+				tile.m_Y = y;
+				tile.m_Width = min(m_TileSize, width - x);
+				tile.m_Height = min(m_TileSize, height - y);
+
+				tiles.push_back(tile);
+			}
+		}
+	}
+
+	unsigned TiledRaytracer::DetermineNumWorkers() const
+	{
+		if (m_NumThreads > 0)
+			return m_NumThreads;
+
+		// hardware_concurrency() is allowed to return 0 when the value is not computable.
+		unsigned hardwareThreads = thread::hardware_concurrency();
+		return hardwareThreads > 0 ? hardwareThreads : 1;
+	}
+
+	void TiledRaytracer::RenderTiles(unsigned workerIndex, TileScheduler& scheduler, const vector<Tile>& tiles,
+		const RayGenerator& rayGenerator)
+	{
+		DeferredShadingPass shadingPass;
+
+		unsigned tileIndex;
+		while (scheduler.AcquireTile(workerIndex, tileIndex))
+			RenderTile(tiles[tileIndex], rayGenerator, shadingPass);
+	}
+
+	void TiledRaytracer::AccumulateWorkerStatistics(const TraversalStatistics& workerStart)
+	{
+		TraversalStatistics workerStatistics = g_ThreadTraversalStatistics;
+		workerStatistics -= workerStart;
+
+		lock_guard<mutex> lock(m_StatisticsMutex);
+		m_FrameStatistics += workerStatistics;
+	}
+
+	uint32_t TiledRaytracer::TracePixelPacket(const RayPacket& packet, HitRecord* hitRecords, const unsigned* pixelIndices)
+	{
+		if (nullptr == m_HeatmapFrameBuffer)
+			return m_Scene->TracePacket(packet, hitRecords);
+
+		return TracePacketWithHeatmap(packet, hitRecords, pixelIndices);
+	}
+
+	uint32_t TiledRaytracer::TracePacketWithHeatmap(const RayPacket& packet, HitRecord* hitRecords, const unsigned* pixelIndices)
+	{
+		float* heatmapData = m_HeatmapFrameBuffer->GetData();
+
+		uint32_t hitMask = 0;
+
+		for (unsigned i = 0; i < packet.m_Size; i++)
+		{
+			if (!packet.IsActive(i))
+				continue;
+
+			uint64_t numTestsBefore = g_ThreadTraversalStatistics.GetNumIntersectionTests();
+
+			if (m_Scene->Trace(packet.m_Rays[i], hitRecords[i]))
+				hitMask |= 1u << i;
+
+			// The raw cost is stored until the frame is complete and the most expensive pixel is known. Each
+			// pixel belongs to a single tile, so no other thread writes to it.
+			heatmapData[pixelIndices[i] * 4] += (float)(g_ThreadTraversalStatistics.GetNumIntersectionTests() - numTestsBefore);
+		}
+
+		return hitMask;
+	}
+
+	void TiledRaytracer::ConvertHeatmapToFalseColour()
+	{
+		if (nullptr == m_HeatmapFrameBuffer)
+			return;
+
+		float* heatmapData = m_HeatmapFrameBuffer->GetData();
+		unsigned numPixels = m_HeatmapFrameBuffer->GetWidth() * m_HeatmapFrameBuffer->GetHeight();
+
+		float maxCost = 0.0f;
+		for (unsigned i = 0; i < numPixels; i++)
+			maxCost = max(maxCost, heatmapData[i * 4]);
+
+		float inverseMaxCost = maxCost > 0.0f ? 1.0f / maxCost : 0.0f;
+
+		// Blue for the cheapest pixels, through green, to red for the most expensive.
+		for (unsigned i = 0; i < numPixels; i++)
+		{
+			float* pixel = heatmapData + i * 4;
+			float cost = pixel[0] * inverseMaxCost;
+
+			pixel[0] = max(0.0f, 2.0f * cost - 1.0f);
+			pixel[1] = 1.0f - fabsf(2.0f * cost - 1.0f);
+			pixel[2] = max(0.0f, 1.0f - 2.0f * cost);
+			pixel[3] = 1.0f;
+		}
+	}
+
+	void TiledRaytracer::GenerateTileBeam(const Tile& tile, const RayGenerator& rayGenerator, RayBeam& beam)
+	{
+		float left = (float)tile.m_X - 0.5f;
+		float right = (float)(tile.m_X + tile.m_Width - 1) + 0.5f;
+		float top = (float)tile.m_Y - 0.5f;
+		float bottom = (float)(tile.m_Y + tile.m_Height - 1) + 0.5f;
+
+		vector4_copy(beam.m_Origin, rayGenerator.GetOrigin());
+
+		rayGenerator.GenerateDirection(left, top, beam.m_Corners[0]);
+		rayGenerator.GenerateDirection(right, top, beam.m_Corners[1]);
+		rayGenerator.GenerateDirection(right, bottom, beam.m_Corners[2]);
+		rayGenerator.GenerateDirection(left, bottom, beam.m_Corners[3]);
+	}
+
+	const RayBeam* TiledRaytracer::PrepareTileBeam(const Tile& tile, const RayGenerator& rayGenerator, RayBeam& beam,
+		BeamEntryCache& entryCache) const
+	{
+		if (!m_EntryPointSearch)
+			return nullptr;
+
+		// The scene finds where the tile's beam enters each of its kd trees the first time a packet reaches it.
+		GenerateTileBeam(tile, rayGenerator, beam);
+		beam.m_EntryCache = &entryCache;
+
+		return &beam;
+	}
+
+	void TiledRaytracer::RenderTile(const Tile& tile, const RayGenerator& rayGenerator, DeferredShadingPass& shadingPass)
+	{
+		unsigned frameBufferWidth = m_FrameBuffer->GetWidth();
+		float* frameBufferData = m_FrameBuffer->GetData();
+
+		RayDirectionBatch8 directions;
+		const unsigned batchWidth = RayDirectionBatch8::BatchWidth;
+
+		// Each batch of directions is traced as a single packet.
+		RayPacket packet(batchWidth);
+		for (unsigned i = 0; i < batchWidth; i++)
+			packet.m_Rays[i].setPosition(rayGenerator.GetOrigin());
+
+		HitRecord hitRecords[batchWidth];
+		unsigned pixelIndices[batchWidth];
+
+		RayBeam beam;
+		BeamEntryCache entryCache;
+		packet.m_Beam = PrepareTileBeam(tile, rayGenerator, beam, entryCache);
+
+		for (unsigned y = tile.m_Y; y < tile.m_Y + tile.m_Height; y++)
+		{
+			float* currentFrameBufferPosition = frameBufferData + (y * frameBufferWidth + tile.m_X) * 4;
+
+			for (unsigned x = tile.m_X; x < tile.m_X + tile.m_Width; x += batchWidth)
+			{
+				// Directions are generated a batch at a time along the row. The batch may run past
+				// the edge of the tile, in which case the extra rays are deactivated.
+				rayGenerator.GenerateBatch(x, y, directions);
+				unsigned batchSize = min(batchWidth, tile.m_X + tile.m_Width - x);
+
+				for (unsigned i = 0; i < batchSize; i++)
+				{
+					packet.m_Rays[i].setDirection(vector4(directions.m_X[i], directions.m_Y[i], directions.m_Z[i], 0.0f));
+					pixelIndices[i] = y * frameBufferWidth + x + i;
+				}
+
+				packet.m_ActiveMask = RayPacket::MaskForSize(batchSize);
+				uint32_t hitMask = TracePixelPacket(packet, hitRecords, pixelIndices);
+
+				// Hits are shaded once the whole tile has been traced. Pixels which miss the scene
+				// are cleared to transparent black.
+				for (unsigned i = 0; i < batchSize; i++)
+				{
+					if (0 != (hitMask & (1u << i)))
+						shadingPass.AddHit(hitRecords[i], currentFrameBufferPosition);
+					else
+						memset(currentFrameBufferPosition, 0, sizeof(float) * 4);
+
+					currentFrameBufferPosition += 4;
+				}
+			}
+		}
+
+		shadingPass.Shade(*m_Scene);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "RayBeam.h"
+#include "Raytracer.h"
+#include "TileScheduler.h"
+#include "TraversalStatistics.h"
+#include <RayGenerator.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Raytracer
+{
+	class DeferredShadingPass;
+
+	/// <summary>
+	/// Multithreaded implementation of a raytracer.
+	/// The frame buffer is split into square tiles which are rendered by a pool of worker
+	/// threads. Tiles are distributed using a work-stealing TileScheduler.
+	/// </summary>
+	class TiledRaytracer : public Raytracer
+	{
+	public:
+
+		static const unsigned DefaultTileSize = 32;
+
+		TiledRaytracer();
+		TiledRaytracer(FrameBuffer* frameBuffer, Camera* camera, IScene* scene);
+
+		/// <summary>
+		/// Sets the number of threads used to render a frame. A value of 0 uses one thread per
+		/// hardware thread available on this machine.
+		/// </summary>
+		void SetNumThreads(unsigned numThreads);
+		unsigned GetNumThreads() const;
+
+		/// <summary>Sets the width and height in pixels of the tiles the frame is split into.</summary>
+		void SetTileSize(unsigned tileSize);
+		unsigned GetTileSize() const;
+
+		/// <summary>
+		/// Sets a frame buffer, of the same size as the rendered frame, which receives a false colour image of
+		/// the number of intersection tests done for each pixel. Pass nullptr to disable the heatmap.
+		/// Rays are traced individually rather than as packets while a heatmap is rendered, so that the work
+		/// can be attributed to pixels. A pixel traced with several rays is charged for all of them, and a pixel
+		/// the raytracer does not trace in a frame, e.g. one filled by reprojection, costs nothing.
+		/// </summary>
+		void SetHeatmapFrameBuffer(FrameBuffer* heatmapFrameBuffer);
+		FrameBuffer* GetHeatmapFrameBuffer() const;
+
+		/// <summary>
+		/// Sets whether a beam enclosing each tile's primary rays is traced first, so that the rays start their
+		/// traversal at the deepest node they all pass through rather than at the root. Enabled by default.
+		/// </summary>
+		void SetEntryPointSearch(bool entryPointSearch);
+		bool GetEntryPointSearch() const;
+
+		/// <summary>Returns the traversal statistics of every thread which rendered the last frame.</summary>
+		const TraversalStatistics& GetFrameStatistics() const;
+
+		void Raytrace() override;
+
+		/// <summary>
+		/// Calculates the beam from the camera through the outer edges of the tile's corner pixels, which encloses
+		/// the primary ray of every pixel of the tile.
+		/// </summary>
+		static void GenerateTileBeam(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, RayBeam& beam);
+
+	protected:
+
+		unsigned m_NumThreads;
+		unsigned m_TileSize;
+
+		FrameBuffer* m_HeatmapFrameBuffer;
+
+		bool m_EntryPointSearch;
+
+		TraversalStatistics m_FrameStatistics;
+		std::mutex m_StatisticsMutex;
+
+		/// <summary>
+		/// Prepares a frame for rendering by worker threads: splits the frame buffer into tiles, resets the
+		/// frame statistics and clears the heatmap. Returns the number of worker threads to render the frame with.
+		/// </summary>
+		unsigned BeginFrame(std::vector<Tile>& tiles);
+
+		/// <summary>
+		/// Calls function(workerIndex) once for each of numWorkers workers, each on its own thread, and adds the
+		/// work they do to the frame statistics. Returns once every worker has finished.
+		/// </summary>
+		template <typename Function>
+		void RunWorkers(unsigned numWorkers, Function function);
+
+		/// <summary>
+		/// Prints the time in milliseconds taken to render the frame with numWorkers threads, followed by a
+		/// description of the work done such as the number of tiles.
+		/// </summary>
+		void PrintFrameTime(long double milliseconds, unsigned numWorkers, const std::string& work) const;
+
+		/// <summary>
+		/// Adds the work done by the calling thread since workerStart was captured to the frame statistics.
+		/// </summary>
+		void AccumulateWorkerStatistics(const TraversalStatistics& workerStart);
+
+		/// <summary>
+		/// Traces the active rays of the packet, which belong to the pixels with the specified indices. While a
+		/// heatmap is rendered the rays are traced individually, adding the number of intersection tests each
+		/// needed to the cost of its pixel.
+		/// </summary>
+		uint32_t TracePixelPacket(const RayPacket& packet, HitRecord* hitRecords, const unsigned* pixelIndices);
+
+		/// <summary>
+		/// Traces each active ray of the packet individually, adding the number of intersection tests it
+		/// needed to the cost of its pixel in the heatmap.
+		/// </summary>
+		uint32_t TracePacketWithHeatmap(const RayPacket& packet, HitRecord* hitRecords, const unsigned* pixelIndices);
+
+		/// <summary>
+		/// Maps the raw costs written to the heatmap onto a blue to red colour ramp, relative to the most
+		/// expensive pixel. Does nothing if no heatmap is rendered.
+		/// </summary>
+		void ConvertHeatmapToFalseColour();
+
+		/// <summary>
+		/// Returns the beam enclosing the primary rays of the tile, for packets of the tile to start their traversal
+		/// at its entry node, or nullptr if entry point search is disabled. The beam and its entry cache are
+		/// stored in the specified objects, which have to outlive the packets traced with the beam.
+		/// </summary>
+		const RayBeam* PrepareTileBeam(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, RayBeam& beam,
+			BeamEntryCache& entryCache) const;
+
+		/// <summary>Splits the frame buffer into tiles.</summary>
+		void GenerateTiles(std::vector<Tile>& tiles) const;
+
+		/// <summary>Returns the number of worker threads to render with.</summary>
+		unsigned DetermineNumWorkers() const;
+
+		/// <summary>Acquires and renders tiles until the scheduler has none remaining.</summary>
+		void RenderTiles(unsigned workerIndex, TileScheduler& scheduler, const std::vector<Tile>& tiles,
+			const CameraLib::RayGenerator& rayGenerator);
+
+		/// <summary>
+		/// Traces every pixel of a single tile, then shades the tile's hits into the frame buffer.
+		/// </summary>
+		void RenderTile(const Tile& tile, const CameraLib::RayGenerator& rayGenerator, DeferredShadingPass& shadingPass);
+	};
+
+	template <typename Function>
+	void TiledRaytracer::RunWorkers(unsigned numWorkers, Function function)
+	{
+		auto worker = [this, &function](unsigned workerIndex)
+		{
+			TraversalStatistics workerStart = g_ThreadTraversalStatistics;
+			function(workerIndex);
+			AccumulateWorkerStatistics(workerStart);
+		};
+
+		// The calling thread acts as worker 0.
+		std::vector<std::thread> threads;
+		for (unsigned i = 1; i < numWorkers; i++)
+			threads.push_back(std::thread(worker, i));
+
+		worker(0);
+
+		for (auto& workerThread : threads)
+			workerThread.join();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "HitRecord.h"
+#include "Mailbox.h"
+#include "TraversalRay.h"
+#include "TraversalStatistics.h"
+#include <Geometry.h>
+#include <Triangle.h>
+#include <cassert>
+
+using GeometryLib::Triangle;
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Tests the ray against the triangles of a leaf, skipping those the mailbox has already seen. Intersections
+	/// closer than closestT are written to hitRecord, and closestT is moved up to them. Returns true if one was found.
+	/// </summary>
+	inline bool IntersectLeafTriangles(const ray& intersectionRay, const Triangle* triangles, const unsigned* triangleList,
+		unsigned numTriangles, TriangleMailbox* mailbox, float& closestT, HitRecord& hitRecord)
+	{
+		RAYTRACER_COUNT(m_LeavesVisited, 1);
+
+		bool intersectionFound = false;
+
+		for (unsigned i = 0; i < numTriangles; i++)
+		{
+			if (nullptr != mailbox && mailbox->CheckAndMark(triangleList[i]))
+			{
+				RAYTRACER_COUNT(m_MailboxSkips, 1);
+				continue;
+			}
+
+			RAYTRACER_COUNT(m_TriangleTests, 1);
+
+			float t;
+			float u;
+			float v;
+
+			if (!GeometryLib::RayTriangleIntersection(intersectionRay, triangles[triangleList[i]], t, u, v))
+				continue;
+
+			if (t < 0.0f || t >= closestT)
+				continue;
+
+			intersectionFound = true;
+			closestT = t;
+
+			hitRecord.m_T = t;
+			hitRecord.m_U = u;
+			hitRecord.m_V = v;
+			hitRecord.m_PrimitiveId = triangleList[i];
+		}
+
+		return intersectionFound;
+	}
+
+	/// <summary>
+	/// Returns true as soon as the ray hits any triangle of a leaf in [0, tMax), skipping those the mailbox has
+	/// already seen.
+	/// </summary>
+	inline bool OccludedByLeafTriangles(const ray& intersectionRay, const Triangle* triangles, const unsigned* triangleList,
+		unsigned numTriangles, TriangleMailbox* mailbox, float tMax)
+	{
+		RAYTRACER_COUNT(m_LeavesVisited, 1);
+
+		for (unsigned i = 0; i < numTriangles; i++)
+		{
+			if (nullptr != mailbox && mailbox->CheckAndMark(triangleList[i]))
+			{
+				RAYTRACER_COUNT(m_MailboxSkips, 1);
+				continue;
+			}
+
+			RAYTRACER_COUNT(m_TriangleTests, 1);
+
+			float t;
+			float u;
+			float v;
+
+			if (GeometryLib::RayTriangleIntersection(intersectionRay, triangles[triangleList[i]], t, u, v) &&
+				t >= 0.0f && t < tMax)
+				return true;
+		}
+
+		return false;
+	}
+
+	/// <summary>
+	/// Visits the leaves below startNode pierced by the ray's interval [tMin, tMax] front to back, keeping the far
+	/// children still to be visited on a fixed size stack. intersectLeaf(leaf) is called for each, and returns the
+	/// distance beyond which nothing is of interest any more. Traversal stops once that distance is inside the
+	/// current leaf, or in front of the next one.
+	///
+	/// The adapter gives access to the tree's nodes: Node, MaxDepth, Visit(node), which is called on each node before
+	/// anything else reads it, IsLeaf(node), GetAxis(node), GetSplit(node) and GetChild(node, above).
+	/// </summary>
+	template <typename NodeAdapter, typename IntersectLeaf>
+	void VisitLeaves(const NodeAdapter& adapter, typename NodeAdapter::Node* startNode, const TraversalRay& traversalRay,
+		float tMin, float tMax, IntersectLeaf intersectLeaf)
+	{
+		typedef typename NodeAdapter::Node Node;
+
+		struct StackEntry
+		{
+			Node* m_Node;
+			float m_TMin;
+			float m_TMax;
+		};
+
+		StackEntry stack[NodeAdapter::MaxDepth];
+		unsigned stackSize = 0;
+
+		Node* node = startNode;
+
+		for (;;)
+		{
+			for (;;)
+			{
+				adapter.Visit(*node);
+
+				RAYTRACER_COUNT(m_NodesVisited, 1);
+
+				if (adapter.IsLeaf(*node))
+					break;
+
+				unsigned axis = adapter.GetAxis(*node);
+				float split = adapter.GetSplit(*node);
+				float origin = traversalRay.m_Origin[axis];
+				float tPlane = (split - origin) * traversalRay.m_InverseDirection[axis];
+
+				// A ray starting on the split visits the side it is heading into first.
+				bool belowFirst = origin < split || (origin == split && traversalRay.m_Direction[axis] <= 0.0f);
+
+				Node* nearChild = adapter.GetChild(*node, !belowFirst);
+				Node* farChild = adapter.GetChild(*node, belowFirst);
+
+				// tPlane is NaN for a ray lying in the split, which then stays on the near side.
+				if (!(tPlane > 0.0f) || tPlane > tMax)
+				{
+					node = nearChild;
+				}
+				else if (tPlane < tMin)
+				{
+					node = farChild;
+				}
+				else
+				{
+					assert(stackSize < NodeAdapter::MaxDepth);
+
+					StackEntry& entry = stack[stackSize++];
+					entry.m_Node = farChild;
+					entry.m_TMin = tPlane;
+					entry.m_TMax = tMax;
+
+					node = nearChild;
+					tMax = tPlane;
+				}
+			}
+
+			float tLimit = intersectLeaf(*node);
+
+			// Anything within this leaf's part of the ray is closer than what the remaining leaves hold.
+			if (tLimit <= tMax || 0 == stackSize)
+				return;
+
+			const StackEntry& entry = stack[--stackSize];
+			if (entry.m_TMin > tLimit)
+				return;
+
+			node = entry.m_Node;
+			tMin = entry.m_TMin;
+			tMax = entry.m_TMax;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "TraversalStatistics.h"
+#include <MathLib.h>
+#include <algorithm>
+
+using namespace MathLib;
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Components of a ray, unpacked once so that each kd tree node only needs a subtraction and a
+	/// multiplication to find where the ray crosses its split.
+	/// </summary>
+	struct TraversalRay
+	{
+		float m_Origin[3];
+		float m_Direction[3];
+		float m_InverseDirection[3];
+
+		TraversalRay(const ray& intersectionRay)
+		{
+			const vector4& position = intersectionRay.getPosition();
+			const vector4& direction = intersectionRay.getDirection();
+
+			for (int axis = 0; axis < 3; axis++)
+			{
+				m_Origin[axis] = position[axis];
+				m_Direction[axis] = direction[axis];
+				m_InverseDirection[axis] = 1.0f / direction[axis];
+			}
+		}
+	};
+
+	/// <summary>
+	/// Clips the interval [tMin, tMax] of the ray to the AABB. Returns false if nothing of it is left.
+	/// </summary>
+	inline bool ClipRayToBounds(const TraversalRay& traversalRay, const vector4& min, const vector4& max, float& tMin,
+		float& tMax)
+	{
+		RAYTRACER_COUNT(m_AABBTests, 1);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			// A ray parallel to the slab never crosses it, so is either always or never inside it.
+			if (0.0f == traversalRay.m_Direction[axis])
+			{
+				if (traversalRay.m_Origin[axis] < min[axis] || traversalRay.m_Origin[axis] > max[axis])
+					return false;
+
+				continue;
+			}
+
+			float tNear = (min[axis] - traversalRay.m_Origin[axis]) * traversalRay.m_InverseDirection[axis];
+			float tFar = (max[axis] - traversalRay.m_Origin[axis]) * traversalRay.m_InverseDirection[axis];
+
+			if (tNear > tFar)
+				std::swap(tNear, tFar);
+
+			tMin = std::max(tMin, tNear);
+			tMax = std::min(tMax, tFar);
+		}
+
+		return tMin <= tMax;
+	}
+}
\ No newline at end of file
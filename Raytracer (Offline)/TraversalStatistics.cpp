@@ -0,0 +1,22 @@
+#include "TraversalStatistics.h"
+#include <stdio.h>
+
+namespace Raytracer
+{
+	RAYTRACER_THREAD_LOCAL TraversalStatistics g_ThreadTraversalStatistics;
+
+	void PrintTraversalStatistics(const TraversalStatistics& statistics)
+	{
+		if (0 == statistics.m_RaysTraced)
+			return;
+
+		double numRays = (double)statistics.m_RaysTraced;
+
+		printf("Traversal per ray: %4.2f elements, %4.2f nodes, %4.2f AABB tests, %4.2f leaves, %4.2f triangle tests\n",
+			statistics.m_ElementsTested / numRays, statistics.m_NodesVisited / numRays, statistics.m_AABBTests / numRays,
+			statistics.m_LeavesVisited / numRays, statistics.m_TriangleTests / numRays);
+
+		if (statistics.m_MailboxSkips > 0)
+			printf("Mailbox per ray: %4.2f triangle tests skipped\n", statistics.m_MailboxSkips / numRays);
+	}
+}
\ No newline at end of file
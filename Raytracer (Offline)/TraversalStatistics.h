@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Set to 0 to compile out the traversal counters.
+#ifndef RAYTRACER_TRAVERSAL_STATISTICS
+#define RAYTRACER_TRAVERSAL_STATISTICS 1
+#endif
+
+// VS2013 does not support thread_local.
+#if defined(_MSC_VER)
+#define RAYTRACER_THREAD_LOCAL __declspec(thread)
+#else
+#define RAYTRACER_THREAD_LOCAL __thread
+#endif
+
+namespace Raytracer
+{
+	/// <summary>
+	/// Counts the work done tracing rays. Work done for a packet is counted once for every active ray it is
+	/// done for, so the counts of single rays and packets can be compared.
+	/// </summary>
+	struct TraversalStatistics
+	{
+		/// <summary>Rays traced through the scene.</summary>
+		uint64_t m_RaysTraced;
+
+		/// <summary>Scene elements tested against a ray.</summary>
+		uint64_t m_ElementsTested;
+
+		/// <summary>Kd tree nodes, including leaves, visited by a ray.</summary>
+		uint64_t m_NodesVisited;
+
+		/// <summary>Ray-AABB intersection tests.</summary>
+		uint64_t m_AABBTests;
+
+		/// <summary>Kd tree leaves visited by a ray.</summary>
+		uint64_t m_LeavesVisited;
+
+		/// <summary>Ray-triangle intersection tests.</summary>
+		uint64_t m_TriangleTests;
+
+		/// <summary>Ray-triangle intersection tests skipped, as the ray had already been tested by the mailbox.</summary>
+		uint64_t m_MailboxSkips;
+
+		void Reset()
+		{
+			m_RaysTraced = 0;
+			m_ElementsTested = 0;
+			m_NodesVisited = 0;
+			m_AABBTests = 0;
+			m_LeavesVisited = 0;
+			m_TriangleTests = 0;
+			m_MailboxSkips = 0;
+		}
+
+		/// <summary>Returns the number of intersection tests, used as the cost shown in heatmaps.</summary>
+		uint64_t GetNumIntersectionTests() const
+		{
+			return m_AABBTests + m_TriangleTests;
+		}
+
+		TraversalStatistics& operator+=(const TraversalStatistics& other)
+		{
+			m_RaysTraced += other.m_RaysTraced;
+			m_ElementsTested += other.m_ElementsTested;
+			m_NodesVisited += other.m_NodesVisited;
+			m_AABBTests += other.m_AABBTests;
+			m_LeavesVisited += other.m_LeavesVisited;
+			m_TriangleTests += other.m_TriangleTests;
+			m_MailboxSkips += other.m_MailboxSkips;
+
+			return *this;
+		}
+
+		TraversalStatistics& operator-=(const TraversalStatistics& other)
+		{
+			m_RaysTraced -= other.m_RaysTraced;
+			m_ElementsTested -= other.m_ElementsTested;
+			m_NodesVisited -= other.m_NodesVisited;
+			m_AABBTests -= other.m_AABBTests;
+			m_LeavesVisited -= other.m_LeavesVisited;
+			m_TriangleTests -= other.m_TriangleTests;
+			m_MailboxSkips -= other.m_MailboxSkips;
+
+			return *this;
+		}
+	};
+
+	/// <summary>
+	/// Counters of the calling thread. They are never reset; the work done by a section of code is the
+	/// difference between the counters before and after it.
+	/// </summary>
+	extern RAYTRACER_THREAD_LOCAL TraversalStatistics g_ThreadTraversalStatistics;
+
+	/// <summary>
+	/// Prints the statistics averaged per ray.
+	/// </summary>
+	void PrintTraversalStatistics(const TraversalStatistics& statistics);
+}
+
+#if (RAYTRACER_TRAVERSAL_STATISTICS)
+#define RAYTRACER_COUNT(counter, amount) (::Raytracer::g_ThreadTraversalStatistics.counter += (amount))
+#else
+#define RAYTRACER_COUNT(counter, amount) ((void)0)
+#endif
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include <stdio.h>
+#include <string.h>
+#include <fstream>
 #include <gtest\gtest.h>
 #include <Camera.h>
 #include <MeshManager.h>
 #include <MathLib.h>
 #include "FrameBuffer.h"
-#include "BasicRaytracer.h"
+#include "TiledRaytracer.h"
 #include "KdTreeGeometry.h"
 #include "GeometryInstance.h"
 #include "BasicScene.h"
@@ -12,6 +14,9 @@
 #include "DebugManager.h"
 #include "BasicGeometry.h"
 #include "GeometryCollection.h"
+#include "BatchRenderer.h"
+#include "HighPerformanceTimer.h"
+#include "KdTreeAutotuner.h"
 
 using namespace Assets;
 using namespace Raytracer;
@@ -29,10 +34,10 @@ int DoUnitTests(int argc, char** argv)
 	return result;
 }
 
-void PrepareScene(IScene& scene)
+void PrepareScene(IScene& scene, const char* meshDatabase = "test.mdb")
 {
 	auto& meshManager = MeshManager::GetInstance();
-	meshManager.SetMeshDatabase("test.mdb");
+	meshManager.SetMeshDatabase(meshDatabase);
 
 	Basis basis;
 	basis.m_Position.setXYZW(0.0f, -2.0f, -12.0f, 1.0f);
@@ -83,7 +88,7 @@ int DoScene(int argc, char** argv)
 
 	BasicScene scene;
 
-	auto raytracer = new BasicRaytracer(frameBuffer, camera, &scene);
+	auto raytracer = new TiledRaytracer(frameBuffer, camera, &scene);
 	PrepareScene(scene);
 	raytracer->Raytrace();
 	debugManager.Process();
@@ -93,10 +98,88 @@ int DoScene(int argc, char** argv)
 	return 0;
 }
 
+/// <summary>
+/// Renders every job of a job file without any user interaction. The scene is prepared once, so the kd trees
+/// of its geometry are built once and shared by every job.
+/// With --autotune, the kd tree build parameters of each mesh are read from the results file, and meshes
+/// missing from it are tuned and added to it.
+/// Usage: --batch jobFile [--database meshDatabase] [--timings timings.json] [--autotune results.txt]
+/// </summary>
+int DoBatch(int argc, char** argv)
+{
+	std::string jobFileName;
+	std::string timingsFileName;
+	std::string autotuneFileName;
+	const char* meshDatabase = "test.mdb";
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--batch") && i + 1 < argc)
+			jobFileName = argv[++i];
+		else if (0 == strcmp(argv[i], "--database") && i + 1 < argc)
+			meshDatabase = argv[++i];
+		else if (0 == strcmp(argv[i], "--timings") && i + 1 < argc)
+			timingsFileName = argv[++i];
+		else if (0 == strcmp(argv[i], "--autotune") && i + 1 < argc)
+			autotuneFileName = argv[++i];
+		else
+		{
+			fprintf(stderr, "Usage: %s --batch jobFile [--database meshDatabase] [--timings timings.json] [--autotune results.txt]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (timingsFileName.empty())
+		timingsFileName = jobFileName + ".json";
+
+	BatchRenderer batchRenderer;
+	if (!batchRenderer.LoadJobFile(jobFileName))
+		return 1;
+
+	KdTreeAutotuner autotuner;
+
+	if (!autotuneFileName.empty())
+	{
+		// A missing results file only means nothing has been tuned yet.
+		if (std::ifstream(autotuneFileName) && !autotuner.LoadResults(autotuneFileName))
+			return 1;
+
+		g_GeometryCollection.SetFactory([&autotuner](const string& id, const Assets::StaticMesh& mesh)
+		{
+			return new KdTreeGeometry(mesh, autotuner.GetParameters(id, mesh));
+		});
+	}
+
+	Core::HighPerformanceTimer timer;
+	timer.Start();
+
+	BasicScene scene;
+	PrepareScene(scene, meshDatabase);
+
+	timer.Stop();
+
+	if (!autotuneFileName.empty() && !autotuner.SaveResults(autotuneFileName))
+		return 1;
+
+	printf("Scene build time: %4.2Lf msecs\n", timer.GetTimeMilliseconds());
+	batchRenderer.SetSceneBuildTime((double)timer.GetTimeMilliseconds());
+
+	batchRenderer.Render(scene);
+
+	return batchRenderer.WriteTimings(timingsFileName) ? 0 : 1;
+}
+
 int main(int argc, char** argv)
 {
 	bool doTests = false;
 
+	// Reuse the kd trees built by previous runs for meshes which have not changed.
+	KdTreeGeometry::SetTreeCacheDirectory(".");
+
+	if (argc > 1)
+		return DoBatch(argc, argv);
+
 	if (doTests)
 		return DoUnitTests(argc, argv);
 	else
@@ -1,5 +1,6 @@
 #include "Raytracer.h"
 #include "ShaderManager.h"
+#include <RayGenerator.h>
 #include <Meshmanager.h>
 #include <MathLib.h>
 #include <MathUtil.h>
@@ -151,54 +152,36 @@ namespace Raytracer
 		glEnable(GL_TEXTURE_2D);
 		glBindImageTexture(0, m_SceneTexture, 0, false, 0, GL_WRITE_ONLY, GL_RGBA32F);
 
-		// Ray generation matrix.
+		// Ray generation deltas.
 		{
-			float aspectRatio = (float)m_ViewportWidth / (float)m_ViewportHeight;
-
-			float halfYFov = m_Camera->GetYFov() * 0.5f;
-
-			float nearPlaneDistance = m_Camera->GetNearClipPlaneDistance();
-			float top = nearPlaneDistance * tan(MATHLIB_DEG_TO_RAD(halfYFov));
-			float right = top * aspectRatio;
-
-			MathLib::matrix4x4 screenCoordToNearPlaneScale
-			(
-				right, 0.0f, 0.0f, 0.0f,
-				0.0f, top, 0.0f, 0.0f,
-				0.0f, 0.0f, 1.0f, 0.0f,
-				0.0f, 0.0f, 0.0f, 1.0f
-			);
-
-			MathLib::matrix4x4 screenCoordToNearPlaneNormalize
-			(
-				2.0f / (m_ViewportWidth - 1.0f), 0.0f, 0.0f, -1.0f,
-				0.0f, -2.0f / (m_ViewportHeight - 1.0f), 0.0f, +1.0f,
-				0.0f, 0.0f, 0.0f, -nearPlaneDistance, 
-				0.0f, 0.0f, 0.0f, 1.0f
-			);
-
-			MathLib::matrix4x4 screenCoordTransform;
-			MathLib::matrix4x4_mul(screenCoordToNearPlaneScale, screenCoordToNearPlaneNormalize, screenCoordTransform);
-			
-			// Now we need to transform the direction into world space.
-			auto& cameraXAxis = m_Camera->GetXAxis();
-			auto& cameraYAxis = m_Camera->GetYAxis();
-			auto& cameraZAxis = m_Camera->GetZAxis();
-
-			MathLib::matrix4x4 rotationTransform
-			(
-				cameraXAxis.extractX(), cameraYAxis.extractX(), cameraZAxis.extractX(), 0.0f,
-				cameraXAxis.extractY(), cameraYAxis.extractY(), cameraZAxis.extractY(), 0.0f,
-				cameraXAxis.extractZ(), cameraYAxis.extractZ(), cameraZAxis.extractZ(), 0.0f,
-				0.0f, 0.0f, 0.0f, 1.0f
-			);
-
-			GLfloat matrixArray[16];
-			screenCoordTransform.setOpenGLMatrix(matrixArray);
-			shader->SetUniformMatrix4fv("u_ScreenCoordTransform", matrixArray);
-
-			rotationTransform.setOpenGLMatrix(matrixArray);
-			shader->SetUniformMatrix4fv("u_RotationTransform", matrixArray);
+			CameraLib::RayGenerator rayGenerator(*m_Camera, m_ViewportWidth, m_ViewportHeight);
+
+			// Texel row 0 is the bottom of the image, whereas the ray generator treats row 0 as
+			// the top of the viewport, so we start from the last row and step upwards instead.
+			MathLib::vector4 directionOrigin;
+			MathLib::vector4_addScaledVector(rayGenerator.GetDirectionOrigin(), rayGenerator.GetDirectionDeltaY(),
+				(float)m_ViewportHeight - 1.0f, directionOrigin);
+
+			const MathLib::vector4& directionDeltaX = rayGenerator.GetDirectionDeltaX();
+			const MathLib::vector4& directionDeltaY = rayGenerator.GetDirectionDeltaY();
+
+			shader->SetUniform4f("u_RayDirectionOrigin",
+								 directionOrigin.extractX(),
+								 directionOrigin.extractY(),
+								 directionOrigin.extractZ(),
+								 0.0f);
+
+			shader->SetUniform4f("u_RayDirectionDeltaX",
+								 directionDeltaX.extractX(),
+								 directionDeltaX.extractY(),
+								 directionDeltaX.extractZ(),
+								 0.0f);
+
+			shader->SetUniform4f("u_RayDirectionDeltaY",
+								 -directionDeltaY.extractX(),
+								 -directionDeltaY.extractY(),
+								 -directionDeltaY.extractZ(),
+								 0.0f);
 
 			auto& cameraPosition = m_Camera->GetPosition();
 